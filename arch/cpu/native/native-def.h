@@ -35,5 +35,16 @@
 #define GPIO_HAL_CONF_ARCH_SW_TOGGLE     1
 #define GPIO_HAL_CONF_PORT_PIN_NUMBERING 0
 /*---------------------------------------------------------------------------*/
+/* Use the SHA extensions of x86 CPUs, if present */
+#ifdef NATIVE_CONF_SHA_256_ARCH
+#define NATIVE_SHA_256_ARCH NATIVE_CONF_SHA_256_ARCH
+#else /* NATIVE_CONF_SHA_256_ARCH */
+#define NATIVE_SHA_256_ARCH 1
+#endif /* NATIVE_CONF_SHA_256_ARCH */
+
+#if NATIVE_SHA_256_ARCH && !defined(SHA_256_CONF_ARCH_TRANSFORM)
+#define SHA_256_CONF_ARCH_TRANSFORM sha_256_arch_transform
+#endif
+/*---------------------------------------------------------------------------*/
 #endif /* NATIVE_DEF_H_ */
 /*---------------------------------------------------------------------------*/
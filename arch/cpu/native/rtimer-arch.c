@@ -40,6 +40,10 @@
 #include <signal.h>
 #include <sys/time.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "sys/rtimer.h"
 #include "sys/clock.h"
@@ -52,6 +56,153 @@
 #define PRINTF(...)
 #endif
 
+/*---------------------------------------------------------------------------*/
+#if RTIMER_ARCH_POSIX_TIMER
+
+#if !defined(_POSIX_TIMERS) || _POSIX_TIMERS <= 0
+#error RTIMER_ARCH_CONF_POSIX_TIMER requires POSIX timers
+#endif
+
+#define NSEC_PER_SEC 1000000000ULL
+
+static timer_t timer;
+/* The deadline that the timer is programmed with, in nanoseconds. */
+static volatile uint64_t deadline_ns;
+#if RTIMER_STATS
+static rtimer_arch_stats_t stats;
+#endif /* RTIMER_STATS */
+/*---------------------------------------------------------------------------*/
+/* The number of rtimer ticks since the start of the monotonic clock. */
+static uint64_t
+timespec_to_ticks(const struct timespec *ts)
+{
+  return (uint64_t)ts->tv_sec * RTIMER_ARCH_SECOND +
+    (uint64_t)ts->tv_nsec * RTIMER_ARCH_SECOND / NSEC_PER_SEC;
+}
+/*---------------------------------------------------------------------------*/
+/* The start of the given tick, rounded up to a whole nanosecond. */
+static uint64_t
+ticks_to_ns(uint64_t ticks)
+{
+  return ticks / RTIMER_ARCH_SECOND * NSEC_PER_SEC +
+    ((ticks % RTIMER_ARCH_SECOND) * NSEC_PER_SEC + RTIMER_ARCH_SECOND - 1) /
+    RTIMER_ARCH_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static void
+interrupt(int sig)
+{
+#if RTIMER_STATS
+  struct timespec now;
+  uint64_t lateness;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  lateness = (uint64_t)now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+  lateness = lateness > deadline_ns ? lateness - deadline_ns : 0;
+  stats.interrupts++;
+  stats.total_ns += lateness;
+  if(lateness > stats.max_ns) {
+    stats.max_ns = lateness > UINT32_MAX ? UINT32_MAX : lateness;
+  }
+#endif /* RTIMER_STATS */
+
+  rtimer_run_next();
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_init(void)
+{
+  struct sigaction action;
+  struct sigevent event;
+
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = interrupt;
+  /* Do not make the interrupted system calls fail with EINTR. */
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGALRM, &action, NULL);
+
+  memset(&event, 0, sizeof(event));
+  event.sigev_notify = SIGEV_SIGNAL;
+  event.sigev_signo = SIGALRM;
+  if(timer_create(CLOCK_MONOTONIC, &event, &timer) < 0) {
+    perror("timer_create");
+  }
+}
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+rtimer_arch_now(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (rtimer_clock_t)timespec_to_ticks(&now);
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_schedule(rtimer_clock_t t)
+{
+  struct itimerspec val;
+  struct timespec now;
+  uint64_t ticks;
+  uint64_t ns;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  ticks = timespec_to_ticks(&now);
+
+  /*
+   * Extend the deadline to the full width of the monotonic clock. A
+   * deadline that has already passed makes the timer fire immediately.
+   */
+  ticks += RTIMER_CLOCK_DIFF(t, (rtimer_clock_t)ticks);
+  ns = ticks_to_ns(ticks);
+  deadline_ns = ns;
+
+  memset(&val, 0, sizeof(val));
+  val.it_value.tv_sec = ns / NSEC_PER_SEC;
+  val.it_value.tv_nsec = ns % NSEC_PER_SEC;
+  if(val.it_value.tv_sec == 0 && val.it_value.tv_nsec == 0) {
+    /* An all-zero timer value would disarm the timer. */
+    val.it_value.tv_nsec = 1;
+  }
+
+  PRINTF("rtimer_arch_schedule time %"PRIu32 " at %ld.%09ld\n",
+         (uint32_t)t, (long)val.it_value.tv_sec, (long)val.it_value.tv_nsec);
+
+  timer_settime(timer, TIMER_ABSTIME, &val, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_stats(rtimer_arch_stats_t *dst)
+{
+#if RTIMER_STATS
+  sigset_t set, old;
+
+  sigemptyset(&set);
+  sigaddset(&set, SIGALRM);
+  sigprocmask(SIG_BLOCK, &set, &old);
+  memcpy(dst, &stats, sizeof(*dst));
+  sigprocmask(SIG_SETMASK, &old, NULL);
+#else /* RTIMER_STATS */
+  memset(dst, 0, sizeof(*dst));
+#endif /* RTIMER_STATS */
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_arch_stats_reset(void)
+{
+#if RTIMER_STATS
+  sigset_t set, old;
+
+  sigemptyset(&set);
+  sigaddset(&set, SIGALRM);
+  sigprocmask(SIG_BLOCK, &set, &old);
+  memset(&stats, 0, sizeof(stats));
+  sigprocmask(SIG_SETMASK, &old, NULL);
+#endif /* RTIMER_STATS */
+}
+/*---------------------------------------------------------------------------*/
+#else /* RTIMER_ARCH_POSIX_TIMER */
 /*---------------------------------------------------------------------------*/
 static void
 interrupt(int sig)
@@ -73,9 +224,16 @@ rtimer_arch_schedule(rtimer_clock_t t)
   rtimer_clock_t c;
 
   c = t - clock_time();
-  
-  val.it_value.tv_sec = c / CLOCK_SECOND;
-  val.it_value.tv_usec = (c % CLOCK_SECOND) * CLOCK_SECOND;
+
+  if(RTIMER_CLOCK_DIFF(t, clock_time()) <= 0) {
+    /* The deadline has already passed, and an all-zero timer value
+       would disarm the timer. Fire as soon as possible instead. */
+    val.it_value.tv_sec = 0;
+    val.it_value.tv_usec = 1;
+  } else {
+    val.it_value.tv_sec = c / CLOCK_SECOND;
+    val.it_value.tv_usec = (c % CLOCK_SECOND) * CLOCK_SECOND;
+  }
 
   PRINTF("rtimer_arch_schedule time %"PRIu32 " %"PRIu32 " in %ld.%ld seconds\n",
          t, c, (long)val.it_value.tv_sec, (long)val.it_value.tv_usec);
@@ -84,3 +242,5 @@ rtimer_arch_schedule(rtimer_clock_t t)
   setitimer(ITIMER_REAL, &val, NULL);
 }
 /*---------------------------------------------------------------------------*/
+#endif /* RTIMER_ARCH_POSIX_TIMER */
+/*---------------------------------------------------------------------------*/
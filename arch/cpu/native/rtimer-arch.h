@@ -42,8 +42,67 @@
 
 #include "contiki.h"
 
+/*
+ * RTIMER_ARCH_CONF_POSIX_TIMER makes rtimers use a POSIX timer on
+ * CLOCK_MONOTONIC, programmed with absolute deadlines at nanosecond
+ * resolution, instead of setitimer(). The rtimer clock then runs at
+ * RTIMER_ARCH_CONF_SECOND ticks per second rather than at the rate of
+ * the system clock.
+ */
+#ifdef RTIMER_ARCH_CONF_POSIX_TIMER
+#define RTIMER_ARCH_POSIX_TIMER RTIMER_ARCH_CONF_POSIX_TIMER
+#else
+#define RTIMER_ARCH_POSIX_TIMER 0
+#endif
+
+#ifdef RTIMER_ARCH_CONF_SECOND
+#define RTIMER_ARCH_SECOND RTIMER_ARCH_CONF_SECOND
+#else
 #define RTIMER_ARCH_SECOND CLOCK_CONF_SECOND
+#endif
+
+#if RTIMER_ARCH_POSIX_TIMER
+
+#if RTIMER_ARCH_SECOND > 1000000000
+#error RTIMER_ARCH_CONF_SECOND cannot exceed the nanosecond resolution
+#endif
+
+rtimer_clock_t rtimer_arch_now(void);
+
+/**
+ * \brief Statistics on how late the timer signal is delivered
+ *
+ * The lateness is measured in nanoseconds between the programmed
+ * deadline and the entry of the signal handler, and hence excludes the
+ * dispatching done by the rtimer module (see rtimer_stats()).
+ */
+typedef struct {
+  uint32_t interrupts;
+  uint64_t total_ns;
+  uint32_t max_ns;
+} rtimer_arch_stats_t;
+
+/**
+ * \brief Get the timer signal lateness statistics.
+ *
+ * The statistics are only collected when RTIMER_CONF_STATS is enabled;
+ * otherwise, all counters are zero.
+ */
+void rtimer_arch_stats(rtimer_arch_stats_t *stats);
+
+/**
+ * \brief Reset the timer signal lateness statistics.
+ */
+void rtimer_arch_stats_reset(void);
+
+#else /* RTIMER_ARCH_POSIX_TIMER */
+
+#if RTIMER_ARCH_SECOND != CLOCK_CONF_SECOND
+#error RTIMER_ARCH_CONF_SECOND requires RTIMER_ARCH_CONF_POSIX_TIMER
+#endif
 
 #define rtimer_arch_now() clock_time()
 
+#endif /* RTIMER_ARCH_POSIX_TIMER */
+
 #endif /* RTIMER_ARCH_H_ */
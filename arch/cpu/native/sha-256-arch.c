@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         SHA-256 compression function using the SHA extensions of x86 CPUs.
+ */
+
+#include "contiki.h"
+#include "lib/sha-256.h"
+
+#if NATIVE_SHA_256_ARCH
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+
+static const uint32_t k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+  0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+  0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+  0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+  0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+  0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/* -1 = not checked yet, 0 = unsupported, 1 = supported */
+static int8_t have_sha_ni = -1;
+/*---------------------------------------------------------------------------*/
+static int8_t
+detect_sha_ni(void)
+{
+  unsigned int eax, ebx, ecx, edx;
+
+  if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)
+     || !(ecx & bit_SSSE3)
+     || !(ecx & bit_SSE4_1)) {
+    return 0;
+  }
+  if(!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)
+     || !(ebx & bit_SHA)) {
+    return 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+__attribute__((target("sha,sse4.1")))
+static void
+transform_sha_ni(uint32_t state[static 8],
+    const uint8_t *blocks, size_t count)
+{
+  const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                       0x0405060700010203ULL);
+  __m128i state0, state1, abef, cdgh, tmp, msg;
+  __m128i w[4];
+  uint_fast8_t i;
+
+  /* The SHA instructions expect the state as ABEF and CDGH */
+  tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xB1);
+  state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]),
+                             0x1B);
+  state0 = _mm_alignr_epi8(tmp, state1, 8);
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+  for(; count > 0; count--) {
+    abef = state0;
+    cdgh = state1;
+
+    /* Four rounds per iteration, w[] holds the last 16 schedule words */
+#pragma GCC unroll 16
+    for(i = 0; i < 16; i++) {
+      if(i < 4) {
+        w[i] = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i *)(blocks + 16 * i)), bswap);
+      } else {
+        w[i & 3] = _mm_sha256msg2_epu32(
+            _mm_add_epi32(_mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]),
+                          _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4)),
+            w[(i + 3) & 3]);
+      }
+      msg = _mm_add_epi32(w[i & 3],
+                          _mm_loadu_si128((const __m128i *)&k[4 * i]));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      state0 = _mm_sha256rnds2_epu32(state0, state1,
+                                     _mm_shuffle_epi32(msg, 0x0E));
+    }
+
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+    blocks += SHA_256_BLOCK_SIZE;
+  }
+
+  /* Back to ABCD and EFGH */
+  tmp = _mm_shuffle_epi32(state0, 0x1B);
+  state1 = _mm_shuffle_epi32(state1, 0xB1);
+  state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+  state1 = _mm_alignr_epi8(state1, tmp, 8);
+  _mm_storeu_si128((__m128i *)&state[0], state0);
+  _mm_storeu_si128((__m128i *)&state[4], state1);
+}
+#endif /* defined(__x86_64__) || defined(__i386__) */
+/*---------------------------------------------------------------------------*/
+bool
+sha_256_arch_transform(uint32_t state[static 8],
+    const uint8_t *blocks, size_t count)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  if(have_sha_ni < 0) {
+    have_sha_ni = detect_sha_ni();
+  }
+  if(have_sha_ni) {
+    transform_sha_ni(state, blocks, count);
+    return true;
+  }
+#endif /* defined(__x86_64__) || defined(__i386__) */
+  return false;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* NATIVE_SHA_256_ARCH */
@@ -49,6 +49,25 @@ struct select_callback {
 };
 int select_set_callback(int fd, const struct select_callback *callback);
 
+/*
+ * Descriptors registered with select_register_fd() are monitored for
+ * the given events until they are unregistered, without being asked
+ * for fd_sets on every main loop iteration. The handler is called with
+ * the events that are ready; hangups and errors are reported as
+ * whichever of the events was registered. With SELECT_CONF_EPOLL, the
+ * functions map directly to epoll_ctl() and the descriptor number is
+ * not limited. A descriptor cannot have both a handler and a callback.
+ */
+#define SELECT_FD_READ  0x01
+#define SELECT_FD_WRITE 0x02
+
+typedef void (* select_fd_handler_t)(int fd, unsigned events, void *ptr);
+
+int select_register_fd(int fd, unsigned events, select_fd_handler_t handler,
+                       void *ptr);
+int select_modify_fd(int fd, unsigned events);
+int select_unregister_fd(int fd);
+
 #define CC_CONF_VA_ARGS                1
 
 #ifndef EEPROM_CONF_SIZE
@@ -0,0 +1,696 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \addtogroup native_platform
+ * @{
+ *
+ * \file
+ *         A virtual radio medium for native nodes, based on Unix
+ *         datagram sockets.
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/netstack.h"
+#include "net/linkaddr.h"
+#include "net/mac/framer/frame802154.h"
+#include "sys/energest.h"
+#include "lib/random.h"
+#include "dev/virtual-radio.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+/*---------------------------------------------------------------------------*/
+#include "sys/log.h"
+#define LOG_MODULE "VRadio"
+#define LOG_LEVEL LOG_LEVEL_MAIN
+/*---------------------------------------------------------------------------*/
+#define MIN_CHANNEL 11
+#define MAX_CHANNEL 26
+#define DEFAULT_CHANNEL 26
+#define RSSI_NO_SIGNAL -110
+#define ACK_LEN 3
+/* The probability scale of the packet reception ratio. */
+#define PRR_SCALE 65536
+
+/* The header that precedes each frame on the medium. */
+struct medium_header {
+  /* The CLOCK_MONOTONIC time at which the frame is received. */
+  uint64_t deliver_at;
+  uint16_t src;
+  int8_t rssi;
+  uint8_t channel;
+};
+
+struct link {
+  uint16_t dst;
+  int8_t rssi;
+  /* The reception ratio of the link and of its reverse link. */
+  uint32_t prr;
+  uint32_t ack_prr;
+  uint32_t delay_us;
+  struct sockaddr_un addr;
+};
+
+struct rx_frame {
+  struct medium_header hdr;
+  uint16_t len;
+  uint8_t data[VIRTUAL_RADIO_BUFSIZE];
+};
+
+static int sock = -1;
+static uint16_t own_id;
+static struct link *links;
+static unsigned link_count;
+
+/*
+ * The links have different propagation delays, so frames are not due
+ * in the order in which they arrive. The first rx_count entries of
+ * rx_order are the queued slots in the order of their delivery time,
+ * and the others are the free slots.
+ */
+static struct rx_frame rx_queue[VIRTUAL_RADIO_RX_QUEUE];
+static uint8_t rx_order[VIRTUAL_RADIO_RX_QUEUE];
+static unsigned rx_count;
+
+static_assert(VIRTUAL_RADIO_RX_QUEUE <= 256,
+              "The virtual radio queue is indexed by uint8_t.");
+
+static uint8_t ack_buf[ACK_LEN];
+static uint8_t ack_len;
+
+static const void *pending_data;
+static bool radio_on_state;
+static bool poll_mode;
+static int channel = DEFAULT_CHANNEL;
+static int last_rssi = RSSI_NO_SIGNAL;
+static rtimer_clock_t last_timestamp;
+static struct virtual_radio_stats stats;
+
+PROCESS(virtual_radio_process, "Virtual radio");
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+addr_to_id(const linkaddr_t *addr)
+{
+  return (addr->u8[LINKADDR_SIZE - 2] << 8) | addr->u8[LINKADDR_SIZE - 1];
+}
+/*---------------------------------------------------------------------------*/
+static bool
+set_sockaddr(struct sockaddr_un *addr, const char *dir, unsigned id)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  return snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/%u", dir, id)
+    < (int)sizeof(addr->sun_path);
+}
+/*---------------------------------------------------------------------------*/
+static struct link *
+find_link(uint16_t dst)
+{
+  for(unsigned i = 0; i < link_count; i++) {
+    if(links[i].dst == dst) {
+      return &links[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+read_topology(const char *dir)
+{
+  char path[256];
+  char line[128];
+  const char *file;
+  unsigned src, dst, delay_us;
+  float prr;
+  int rssi;
+  struct link *link;
+  FILE *fp;
+
+  file = getenv("CONTIKI_RADIO_TOPOLOGY");
+  if(file == NULL) {
+    snprintf(path, sizeof(path), "%s/topology", dir);
+    file = path;
+  }
+
+  fp = fopen(file, "r");
+  if(fp == NULL) {
+    LOG_WARN("no topology in %s, the node has no links\n", file);
+    return;
+  }
+
+  /* Outgoing links first, so that the reverse links can be attached. */
+  for(int pass = 0; pass < 2; pass++) {
+    rewind(fp);
+    while(fgets(line, sizeof(line), fp) != NULL) {
+      if(sscanf(line, "%u %u %f %d %u", &src, &dst, &prr, &rssi,
+                &delay_us) != 5) {
+        continue;
+      }
+      if(prr < 0) {
+        prr = 0;
+      } else if(prr > 1) {
+        prr = 1;
+      }
+
+      if(pass == 0 && src == own_id && dst != own_id) {
+        link = realloc(links, (link_count + 1) * sizeof(*links));
+        if(link == NULL) {
+          break;
+        }
+        links = link;
+        link = &links[link_count];
+        link->dst = dst;
+        link->rssi = rssi;
+        link->prr = prr * PRR_SCALE;
+        link->ack_prr = 0;
+        link->delay_us = delay_us;
+        if(set_sockaddr(&link->addr, dir, dst)) {
+          link_count++;
+        }
+      } else if(pass == 1 && dst == own_id &&
+                (link = find_link(src)) != NULL) {
+        link->ack_prr = prr * PRR_SCALE;
+      }
+    }
+  }
+  fclose(fp);
+
+  LOG_INFO("node %u has %u links\n", own_id, link_count);
+}
+/*---------------------------------------------------------------------------*/
+static bool
+link_delivers(uint32_t prr)
+{
+  return prr >= PRR_SCALE || random_rand() < prr;
+}
+/*---------------------------------------------------------------------------*/
+static struct rx_frame *
+rx_next(void)
+{
+  return rx_count > 0 ? &rx_queue[rx_order[0]] : NULL;
+}
+/*---------------------------------------------------------------------------*/
+static bool
+rx_due(void)
+{
+  return rx_count > 0 && rx_next()->hdr.deliver_at <= now_ns();
+}
+/*---------------------------------------------------------------------------*/
+/* Queue the frame received into the first free slot. */
+static void
+rx_insert(void)
+{
+  uint8_t slot = rx_order[rx_count];
+  uint64_t deliver_at = rx_queue[slot].hdr.deliver_at;
+  unsigned i;
+
+  for(i = rx_count; i > 0 &&
+      rx_queue[rx_order[i - 1]].hdr.deliver_at > deliver_at; i--) {
+    rx_order[i] = rx_order[i - 1];
+  }
+  rx_order[i] = slot;
+  rx_count++;
+}
+/*---------------------------------------------------------------------------*/
+/* Dequeue the next frame, which stays valid until the next reception. */
+static struct rx_frame *
+rx_remove(void)
+{
+  uint8_t slot = rx_order[0];
+
+  rx_count--;
+  memmove(&rx_order[0], &rx_order[1], rx_count);
+  rx_order[rx_count] = slot;
+  return &rx_queue[slot];
+}
+/*---------------------------------------------------------------------------*/
+static void
+sock_handle_fd(int fd, unsigned events, void *ptr)
+{
+  struct rx_frame *frame;
+  struct medium_header scratch;
+  struct iovec iov[2];
+  struct msghdr msg;
+  ssize_t len;
+
+  while(1) {
+    if(rx_count == VIRTUAL_RADIO_RX_QUEUE) {
+      /* There is no free slot, so the datagram is drained into a
+         scratch buffer instead. */
+      if(recv(sock, &scratch, sizeof(scratch), MSG_DONTWAIT) < 0) {
+        break;
+      }
+      stats.rx_dropped++;
+      continue;
+    }
+
+    frame = &rx_queue[rx_order[rx_count]];
+    memset(&frame->hdr, 0, sizeof(frame->hdr));
+    iov[0].iov_base = &frame->hdr;
+    iov[0].iov_len = sizeof(frame->hdr);
+    iov[1].iov_base = frame->data;
+    iov[1].iov_len = sizeof(frame->data);
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+
+    len = recvmsg(sock, &msg, MSG_DONTWAIT);
+    if(len < 0) {
+      break;
+    }
+    if(len <= (ssize_t)sizeof(frame->hdr) ||
+       (msg.msg_flags & MSG_TRUNC) != 0) {
+      continue;
+    }
+    if(!radio_on_state || frame->hdr.channel != channel) {
+      stats.rx_dropped++;
+      continue;
+    }
+    frame->len = len - sizeof(frame->hdr);
+    rx_insert();
+  }
+
+  if(rx_count > 0) {
+    process_poll(&virtual_radio_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  if(!radio_on_state) {
+    ENERGEST_ON(ENERGEST_TYPE_LISTEN);
+    radio_on_state = true;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(void)
+{
+  if(radio_on_state) {
+    ENERGEST_OFF(ENERGEST_TYPE_LISTEN);
+    radio_on_state = false;
+    rx_count = 0;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+init(void)
+{
+  struct sockaddr_un addr;
+  const char *dir;
+
+  own_id = addr_to_id(&linkaddr_node_addr);
+  dir = getenv("CONTIKI_RADIO_DIR");
+  if(dir == NULL) {
+    dir = VIRTUAL_RADIO_DIR;
+  }
+  mkdir(dir, 0777);
+
+  if(!set_sockaddr(&addr, dir, own_id)) {
+    LOG_ERR("medium directory name too long: %s\n", dir);
+    return 0;
+  }
+
+  sock = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if(sock < 0) {
+    LOG_ERR("socket: %s\n", strerror(errno));
+    return 0;
+  }
+  unlink(addr.sun_path);
+  if(bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    LOG_ERR("bind %s: %s\n", addr.sun_path, strerror(errno));
+    close(sock);
+    sock = -1;
+    return 0;
+  }
+
+  read_topology(dir);
+
+  for(unsigned i = 0; i < VIRTUAL_RADIO_RX_QUEUE; i++) {
+    rx_order[i] = i;
+  }
+
+  select_register_fd(sock, SELECT_FD_READ, sock_handle_fd, NULL);
+  process_start(&virtual_radio_process, NULL);
+  on();
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_send(const void *payload, unsigned short payload_len)
+{
+  struct medium_header hdr;
+  struct iovec iov[2];
+  struct msghdr msg;
+  frame802154_t frame;
+  linkaddr_t dest;
+  uint16_t ack_dst = 0;
+  bool want_ack = false;
+  uint64_t now;
+
+  if(payload_len == 0 || payload_len > VIRTUAL_RADIO_BUFSIZE || sock < 0) {
+    return RADIO_TX_ERR;
+  }
+
+  /* A unicast frame that requests an acknowledgement. */
+  if(frame802154_parse((uint8_t *)payload, payload_len, &frame) > 0 &&
+     frame.fcf.ack_required && !frame.fcf.sequence_number_suppression &&
+     frame802154_extract_linkaddr(&frame, NULL, &dest)) {
+    want_ack = true;
+    ack_dst = addr_to_id(&dest);
+  }
+  ack_len = 0;
+
+  if(radio_on_state) {
+    ENERGEST_SWITCH(ENERGEST_TYPE_LISTEN, ENERGEST_TYPE_TRANSMIT);
+  } else {
+    ENERGEST_ON(ENERGEST_TYPE_TRANSMIT);
+  }
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.src = own_id;
+  hdr.channel = channel;
+  iov[0].iov_base = &hdr;
+  iov[0].iov_len = sizeof(hdr);
+  iov[1].iov_base = (void *)payload;
+  iov[1].iov_len = payload_len;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+  msg.msg_namelen = sizeof(struct sockaddr_un);
+
+  now = now_ns();
+  for(unsigned i = 0; i < link_count; i++) {
+    if(!link_delivers(links[i].prr)) {
+      stats.tx_lost++;
+      continue;
+    }
+    hdr.rssi = links[i].rssi;
+    hdr.deliver_at = now + (uint64_t)links[i].delay_us * 1000;
+    msg.msg_name = &links[i].addr;
+    /* Fails if the receiver is not running or cannot keep up. */
+    if(sendmsg(sock, &msg, MSG_DONTWAIT) < 0) {
+      stats.tx_lost++;
+      continue;
+    }
+    if(want_ack && links[i].dst == ack_dst &&
+       link_delivers(links[i].ack_prr)) {
+      ack_buf[0] = FRAME802154_ACKFRAME;
+      ack_buf[1] = 0;
+      ack_buf[2] = frame.seq;
+      ack_len = ACK_LEN;
+    }
+  }
+  stats.tx++;
+
+  if(radio_on_state) {
+    ENERGEST_SWITCH(ENERGEST_TYPE_TRANSMIT, ENERGEST_TYPE_LISTEN);
+  } else {
+    ENERGEST_OFF(ENERGEST_TYPE_TRANSMIT);
+  }
+
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+prepare_packet(const void *data, unsigned short len)
+{
+  if(len > VIRTUAL_RADIO_BUFSIZE) {
+    return RADIO_TX_ERR;
+  }
+  pending_data = data;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+transmit_packet(unsigned short len)
+{
+  int ret = RADIO_TX_ERR;
+  if(pending_data != NULL) {
+    ret = radio_send(pending_data, len);
+  }
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_read(void *buf, unsigned short bufsize)
+{
+  struct rx_frame *frame;
+  int len;
+
+  /* An acknowledgement is read right after the transmission. */
+  if(ack_len > 0) {
+    len = ack_len;
+    ack_len = 0;
+    if(bufsize < len) {
+      return 0;
+    }
+    memcpy(buf, ack_buf, len);
+    return len;
+  }
+
+  if(!rx_due()) {
+    return 0;
+  }
+
+  frame = rx_remove();
+
+  if(bufsize < frame->len) {
+    return 0;
+  }
+  memcpy(buf, frame->data, frame->len);
+  last_rssi = frame->hdr.rssi;
+  last_timestamp = RTIMER_NOW();
+  if(!poll_mode) {
+    packetbuf_set_attr(PACKETBUF_ATTR_RSSI, last_rssi);
+  }
+  stats.rx++;
+  return frame->len;
+}
+/*---------------------------------------------------------------------------*/
+static int
+channel_clear(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+receiving_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+pending_packet(void)
+{
+  return ack_len > 0 || rx_due();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(virtual_radio_process, ev, data)
+{
+  static struct etimer et;
+  uint64_t now;
+  int len;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL || ev == PROCESS_EVENT_TIMER);
+    if(poll_mode) {
+      continue;
+    }
+
+    /* An acknowledgement that the MAC layer did not read right after
+       the transmission is stale. */
+    ack_len = 0;
+
+    while(rx_due()) {
+      packetbuf_clear();
+      len = radio_read(packetbuf_dataptr(), PACKETBUF_SIZE);
+      if(len > 0) {
+        packetbuf_set_datalen(len);
+        NETSTACK_MAC.input();
+      }
+    }
+
+    /* Wait for the propagation delay of the next frame. */
+    now = now_ns();
+    if(rx_count > 0 && rx_next()->hdr.deliver_at > now) {
+      etimer_set(&et, ((rx_next()->hdr.deliver_at - now) *
+                       CLOCK_SECOND + 999999999) / 1000000000);
+    } else if(rx_count > 0) {
+      process_poll(&virtual_radio_process);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_value(radio_param_t param, radio_value_t *value)
+{
+  switch(param) {
+  case RADIO_PARAM_POWER_MODE:
+    *value = radio_on_state ? RADIO_POWER_MODE_ON : RADIO_POWER_MODE_OFF;
+    return RADIO_RESULT_OK;
+  case RADIO_PARAM_RX_MODE:
+    *value = RADIO_RX_MODE_AUTOACK;
+    if(poll_mode) {
+      *value |= RADIO_RX_MODE_POLL_MODE;
+    }
+    return RADIO_RESULT_OK;
+  case RADIO_PARAM_TX_MODE:
+    *value = 0;
+    return RADIO_RESULT_OK;
+  case RADIO_PARAM_CHANNEL:
+    *value = channel;
+    return RADIO_RESULT_OK;
+  case RADIO_PARAM_LAST_RSSI:
+    *value = last_rssi;
+    return RADIO_RESULT_OK;
+  case RADIO_PARAM_RSSI:
+    *value = RSSI_NO_SIGNAL;
+    return RADIO_RESULT_OK;
+  case RADIO_CONST_CHANNEL_MIN:
+    *value = MIN_CHANNEL;
+    return RADIO_RESULT_OK;
+  case RADIO_CONST_CHANNEL_MAX:
+    *value = MAX_CHANNEL;
+    return RADIO_RESULT_OK;
+  case RADIO_CONST_MAX_PAYLOAD_LEN:
+    *value = (radio_value_t)VIRTUAL_RADIO_BUFSIZE;
+    return RADIO_RESULT_OK;
+  default:
+    return RADIO_RESULT_NOT_SUPPORTED;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_value(radio_param_t param, radio_value_t value)
+{
+  switch(param) {
+  case RADIO_PARAM_POWER_MODE:
+    if(value == RADIO_POWER_MODE_ON) {
+      on();
+      return RADIO_RESULT_OK;
+    }
+    if(value == RADIO_POWER_MODE_OFF) {
+      off();
+      return RADIO_RESULT_OK;
+    }
+    return RADIO_RESULT_INVALID_VALUE;
+  case RADIO_PARAM_RX_MODE:
+    if(value & ~(RADIO_RX_MODE_ADDRESS_FILTER |
+                 RADIO_RX_MODE_AUTOACK | RADIO_RX_MODE_POLL_MODE)) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    /* Acknowledgements are generated by the medium. */
+    poll_mode = (value & RADIO_RX_MODE_POLL_MODE) != 0;
+    return RADIO_RESULT_OK;
+  case RADIO_PARAM_TX_MODE:
+    if(value & ~RADIO_TX_MODE_SEND_ON_CCA) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    return RADIO_RESULT_OK;
+  case RADIO_PARAM_CHANNEL:
+    if(value < MIN_CHANNEL || value > MAX_CHANNEL) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    channel = value;
+    return RADIO_RESULT_OK;
+  default:
+    return RADIO_RESULT_NOT_SUPPORTED;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+get_object(radio_param_t param, void *dest, size_t size)
+{
+  if(param == RADIO_PARAM_LAST_PACKET_TIMESTAMP) {
+    if(size != sizeof(rtimer_clock_t) || !dest) {
+      return RADIO_RESULT_INVALID_VALUE;
+    }
+    *(rtimer_clock_t *)dest = last_timestamp;
+    return RADIO_RESULT_OK;
+  }
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+const struct virtual_radio_stats *
+virtual_radio_get_stats(void)
+{
+  return &stats;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver virtual_radio_driver = {
+  init,
+  prepare_packet,
+  transmit_packet,
+  radio_send,
+  radio_read,
+  channel_clear,
+  receiving_packet,
+  pending_packet,
+  on,
+  off,
+  get_value,
+  set_value,
+  get_object,
+  set_object
+};
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \addtogroup native_platform
+ * @{
+ *
+ * \file
+ *         A virtual radio medium for native nodes that run on the same host
+ *
+ *         Each node binds a Unix datagram socket named after its node ID
+ *         in a shared medium directory. A transmitted frame is sent to
+ *         the socket of every node that the sender has a link to. Links
+ *         are read at startup from a topology file, in which each line
+ *         describes one directed link:
+ *
+ *           <src> <dst> <prr> <rssi> <delay>
+ *
+ *         where prr is the packet reception ratio between 0 and 1, rssi
+ *         is in dBm, and delay is the propagation delay in microseconds.
+ *         Loss is drawn by the sender for each receiver. Acknowledgements
+ *         are generated by the medium when a unicast frame that requests
+ *         one is delivered, and are lost with the loss of the reverse
+ *         link. Collisions are not modelled.
+ *
+ *         The following environment variables configure a node:
+ *         - CONTIKI_NODE_ID: the node ID, which sets the last two bytes
+ *           of the link-layer address (see platform.c).
+ *         - CONTIKI_RADIO_DIR: the medium directory, by default
+ *           VIRTUAL_RADIO_DIR.
+ *         - CONTIKI_RADIO_TOPOLOGY: the topology file, by default the
+ *           file "topology" in the medium directory.
+ *
+ *         tools/native-radio/launch.py generates a topology and starts
+ *         a network of nodes.
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef VIRTUAL_RADIO_H_
+#define VIRTUAL_RADIO_H_
+
+#include "contiki.h"
+#include "dev/radio.h"
+
+/*
+ * The maximum number of bytes this driver can accept from the MAC layer for
+ * transmission or will deliver to the MAC layer after reception. Includes
+ * the MAC header and payload, but not the FCS.
+ */
+#ifdef VIRTUAL_RADIO_CONF_BUFSIZE
+#define VIRTUAL_RADIO_BUFSIZE VIRTUAL_RADIO_CONF_BUFSIZE
+#else
+#define VIRTUAL_RADIO_BUFSIZE 125
+#endif
+
+/* The number of received frames that can wait to be delivered. */
+#ifdef VIRTUAL_RADIO_CONF_RX_QUEUE
+#define VIRTUAL_RADIO_RX_QUEUE VIRTUAL_RADIO_CONF_RX_QUEUE
+#else
+#define VIRTUAL_RADIO_RX_QUEUE 8
+#endif
+
+/* The medium directory used when CONTIKI_RADIO_DIR is not set. */
+#ifdef VIRTUAL_RADIO_CONF_DIR
+#define VIRTUAL_RADIO_DIR VIRTUAL_RADIO_CONF_DIR
+#else
+#define VIRTUAL_RADIO_DIR "/tmp/contiki-ng-radio"
+#endif
+
+/** \brief Counters of the virtual radio */
+struct virtual_radio_stats {
+  /** Frames transmitted */
+  uint32_t tx;
+  /** Copies of transmitted frames lost on a link */
+  uint32_t tx_lost;
+  /** Frames delivered to the MAC layer */
+  uint32_t rx;
+  /** Received frames dropped because the queue was full or the radio off */
+  uint32_t rx_dropped;
+};
+
+extern const struct radio_driver virtual_radio_driver;
+
+/**
+ * \brief Get the counters of the virtual radio.
+ */
+const struct virtual_radio_stats *virtual_radio_get_stats(void);
+
+#endif /* VIRTUAL_RADIO_H_ */
+/** @} */
@@ -43,10 +43,12 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/select.h>
 #include <errno.h>
+#include <signal.h>
 
 #include "contiki.h"
 #include "net/netstack.h"
@@ -105,6 +107,30 @@
 #define SELECT_TIMEOUT 1000
 #endif
 
+/*
+ * Uses epoll(7) instead of select(2) to wait for the monitored file
+ * descriptors, and a timerfd armed from the next etimer expiration to
+ * wake up exactly when an etimer is due. With epoll, descriptors of
+ * select_register_fd() are limited by neither SELECT_MAX nor
+ * FD_SETSIZE, and only cost a system call when their events change.
+ * Callbacks still need descriptors below FD_SETSIZE. Linux only.
+ */
+#ifdef SELECT_CONF_EPOLL
+#define SELECT_EPOLL SELECT_CONF_EPOLL
+#else
+#define SELECT_EPOLL 0
+#endif
+
+/*
+ * Defines the maximum number of ready file descriptors that are fetched
+ * from epoll per main loop iteration.
+ */
+#ifdef SELECT_CONF_EPOLL_EVENTS
+#define SELECT_EPOLL_EVENTS SELECT_CONF_EPOLL_EVENTS
+#else
+#define SELECT_EPOLL_EVENTS 16
+#endif
+
 /*
  * Adds the STDIN file descriptor to the list of monitored file descriptors.
  */
@@ -116,7 +142,50 @@
 /** @} */
 /*---------------------------------------------------------------------------*/
 
-static const struct select_callback *select_callback[SELECT_MAX];
+#if SELECT_EPOLL
+#ifndef __linux__
+#error SELECT_CONF_EPOLL requires Linux
+#endif
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+/*
+ * Pseudo event for descriptors that epoll refuses (regular files and
+ * some character devices). As with select, they are always ready.
+ */
+#define EPOLL_ALWAYS_READY 0x80000000U
+#endif /* SELECT_EPOLL */
+
+/*
+ * A monitored descriptor has either a callback, which is asked for its
+ * fd_sets on every main loop iteration, or a handler registered with
+ * select_register_fd().
+ */
+struct select_fd {
+  const struct select_callback *callback;
+  select_fd_handler_t handler;
+  void *ptr;
+  unsigned events;
+#if SELECT_EPOLL
+  /* The events the descriptor is currently registered with in epoll. */
+  uint32_t registered;
+#endif /* SELECT_EPOLL */
+};
+
+#if SELECT_EPOLL
+/* Indexed by file descriptor, and grows on demand. */
+static struct select_fd *select_fds;
+static int select_size;
+static unsigned always_ready_fds;
+static int epoll_fd = -1;
+static int timer_fd = -1;
+static bool timer_armed;
+static clock_time_t timer_expiration;
+#else /* SELECT_EPOLL */
+static struct select_fd select_fds[SELECT_MAX];
+static const int select_size = SELECT_MAX;
+#endif /* SELECT_EPOLL */
+/* The highest descriptor that the main loop looks at on every iteration */
 static int select_max = 0;
 
 #ifdef PLATFORM_CONF_MAC_ADDR
@@ -125,46 +194,232 @@ static uint8_t mac_addr[] = PLATFORM_CONF_MAC_ADDR;
 static uint8_t mac_addr[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08 };
 #endif /* PLATFORM_CONF_MAC_ADDR */
 
+/*---------------------------------------------------------------------------*/
+#if SELECT_EPOLL
+static bool
+select_grow(int fd)
+{
+  struct select_fd *fds;
+  int size;
+
+  size = select_size > 0 ? select_size : SELECT_MAX;
+  while(size <= fd) {
+    size *= 2;
+  }
+
+  fds = realloc(select_fds, size * sizeof(*fds));
+  if(fds == NULL) {
+    return false;
+  }
+  memset(&fds[select_size], 0, (size - select_size) * sizeof(*fds));
+  select_fds = fds;
+  select_size = size;
+  return true;
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_init(void)
+{
+  struct epoll_event ev;
+
+  if(epoll_fd >= 0) {
+    return;
+  }
+
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if(epoll_fd < 0 || timer_fd < 0) {
+    perror("epoll");
+    exit(EXIT_FAILURE);
+  }
+
+  ev.events = EPOLLIN;
+  ev.data.fd = timer_fd;
+  if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev) < 0) {
+    perror("epoll_ctl");
+    exit(EXIT_FAILURE);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+epoll_events(unsigned events)
+{
+  return ((events & SELECT_FD_READ) ? EPOLLIN : 0) |
+    ((events & SELECT_FD_WRITE) ? EPOLLOUT : 0);
+}
+/*---------------------------------------------------------------------------*/
+static bool
+epoll_update(int fd, uint32_t events)
+{
+  struct epoll_event ev;
+  uint32_t old = select_fds[fd].registered;
+
+  if(events == old) {
+    return true;
+  }
+
+  if(old & EPOLL_ALWAYS_READY) {
+    /* The descriptor is not registered with epoll. */
+    if(events == 0) {
+      always_ready_fds--;
+    }
+    select_fds[fd].registered = events ? (events | EPOLL_ALWAYS_READY) : 0;
+    return true;
+  }
+
+  epoll_init();
+  ev.events = events;
+  ev.data.fd = fd;
+  if(events == 0) {
+    /* Fails harmlessly if the descriptor has already been closed. */
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+  } else if(old == 0 || epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+    /* A descriptor that was closed and reopened is no longer registered. */
+    if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+      if(errno != EPERM) {
+        LOG_ERR("epoll_ctl fd %d: %s\n", fd, strerror(errno));
+        select_fds[fd].registered = 0;
+        return false;
+      }
+      events |= EPOLL_ALWAYS_READY;
+      always_ready_fds++;
+    }
+  }
+  select_fds[fd].registered = events;
+  return true;
+}
+#endif /* SELECT_EPOLL */
+/*---------------------------------------------------------------------------*/
+/* Whether the main loop looks at the descriptor on every iteration */
+static bool
+select_polled(int fd)
+{
+#if SELECT_EPOLL
+  return select_fds[fd].callback != NULL;
+#else /* SELECT_EPOLL */
+  return select_fds[fd].callback != NULL || select_fds[fd].handler != NULL;
+#endif /* SELECT_EPOLL */
+}
+/*---------------------------------------------------------------------------*/
+static void
+select_update_max(int fd)
+{
+  if(select_polled(fd)) {
+    if(fd > select_max) {
+      select_max = fd;
+    }
+  } else if(fd == select_max) {
+    while(select_max > 0 && !select_polled(select_max)) {
+      select_max--;
+    }
+  }
+}
 /*---------------------------------------------------------------------------*/
 int
 select_set_callback(int fd, const struct select_callback *callback)
 {
-  int i;
-  if(fd >= 0 && fd < SELECT_MAX) {
-    /* Check that the callback functions are set */
-    if(callback != NULL &&
-       (callback->set_fd == NULL || callback->handle_fd == NULL)) {
-      callback = NULL;
+  /* Check that the callback functions are set */
+  if(callback != NULL &&
+     (callback->set_fd == NULL || callback->handle_fd == NULL)) {
+    callback = NULL;
+  }
+
+#if SELECT_EPOLL
+  /* The callbacks operate on fd_sets, which cannot hold larger descriptors. */
+  if(fd < 0 || fd >= FD_SETSIZE) {
+    return 0;
+  }
+  if(fd >= select_size) {
+    if(callback == NULL) {
+      return 1;
     }
+    if(!select_grow(fd)) {
+      return 0;
+    }
+  }
+#else /* SELECT_EPOLL */
+  if(fd < 0 || fd >= SELECT_MAX) {
+    return 0;
+  }
+#endif /* SELECT_EPOLL */
+  if(select_fds[fd].handler != NULL) {
+    return 0;
+  }
 
-    select_callback[fd] = callback;
+#if SELECT_EPOLL
+  if(callback == NULL) {
+    epoll_update(fd, 0);
+  }
+#endif /* SELECT_EPOLL */
+  select_fds[fd].callback = callback;
+  select_update_max(fd);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+select_register_fd(int fd, unsigned events, select_fd_handler_t handler,
+                   void *ptr)
+{
+  if(fd < 0 || handler == NULL) {
+    return 0;
+  }
+#if SELECT_EPOLL
+  if(fd >= select_size && !select_grow(fd)) {
+    return 0;
+  }
+#else /* SELECT_EPOLL */
+  if(fd >= SELECT_MAX) {
+    return 0;
+  }
+#endif /* SELECT_EPOLL */
+  if(select_fds[fd].callback != NULL || select_fds[fd].handler != NULL) {
+    return 0;
+  }
 
-    /* Update fd max */
-    if(callback != NULL) {
-      if(fd > select_max) {
-        select_max = fd;
-      }
-    } else {
-      select_max = 0;
-      for(i = SELECT_MAX - 1; i > 0; i--) {
-        if(select_callback[i] != NULL) {
-          select_max = i;
-          break;
-        }
-      }
-    }
-    return 1;
+#if SELECT_EPOLL
+  if(!epoll_update(fd, epoll_events(events))) {
+    return 0;
   }
-  return 0;
+#endif /* SELECT_EPOLL */
+  select_fds[fd].handler = handler;
+  select_fds[fd].ptr = ptr;
+  select_fds[fd].events = events;
+  select_update_max(fd);
+  return 1;
 }
 /*---------------------------------------------------------------------------*/
-#if SELECT_STDIN
-static int
-stdin_set_fd(fd_set *rset, fd_set *wset)
+int
+select_modify_fd(int fd, unsigned events)
 {
-  FD_SET(STDIN_FILENO, rset);
+  if(fd < 0 || fd >= select_size || select_fds[fd].handler == NULL) {
+    return 0;
+  }
+
+#if SELECT_EPOLL
+  if(!epoll_update(fd, epoll_events(events))) {
+    return 0;
+  }
+#endif /* SELECT_EPOLL */
+  select_fds[fd].events = events;
   return 1;
 }
+/*---------------------------------------------------------------------------*/
+int
+select_unregister_fd(int fd)
+{
+  if(fd < 0 || fd >= select_size || select_fds[fd].handler == NULL) {
+    return 0;
+  }
+
+#if SELECT_EPOLL
+  epoll_update(fd, 0);
+#endif /* SELECT_EPOLL */
+  memset(&select_fds[fd], 0, sizeof(select_fds[fd]));
+  select_update_max(fd);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#if SELECT_STDIN
 static int (*input_handler)(unsigned char c);
 
 void
@@ -173,24 +428,25 @@ native_uart_set_input(int (*input)(unsigned char c))
   input_handler = input;
 }
 static void
-stdin_handle_fd(fd_set *rset, fd_set *wset)
+stdin_handle_fd(int fd, unsigned events, void *ptr)
 {
   char c;
-  if(FD_ISSET(STDIN_FILENO, rset)) {
-    if(read(STDIN_FILENO, &c, 1) > 0) {
-      input_handler(c);
-    }
+  ssize_t len = read(fd, &c, 1);
+  if(len > 0) {
+    input_handler(c);
+  } else if(len == 0) {
+    /* End of file: stop monitoring stdin instead of spinning on it. */
+    select_unregister_fd(fd);
   }
 }
-const static struct select_callback stdin_fd = {
-  stdin_set_fd, stdin_handle_fd
-};
 #endif /* SELECT_STDIN */
 /*---------------------------------------------------------------------------*/
 static void
 set_lladdr(void)
 {
   linkaddr_t addr;
+  const char *node_id_env;
+  unsigned id;
 
   memset(&addr, 0, sizeof(linkaddr_t));
 #if NETSTACK_CONF_WITH_IPV6
@@ -201,6 +457,15 @@ set_lladdr(void)
     addr.u8[i] = mac_addr[7 - i];
   }
 #endif
+
+  /* Tell nodes that run on the same host apart. */
+  node_id_env = getenv("CONTIKI_NODE_ID");
+  if(node_id_env != NULL) {
+    id = atoi(node_id_env);
+    addr.u8[LINKADDR_SIZE - 2] = id >> 8;
+    addr.u8[LINKADDR_SIZE - 1] = id & 0xff;
+  }
+
   linkaddr_set_node_addr(&addr);
 }
 /*---------------------------------------------------------------------------*/
@@ -230,6 +495,39 @@ set_global_address(void)
 }
 #endif
 /*---------------------------------------------------------------------------*/
+#if PROCESS_CONF_HISTOGRAMS
+/* Set by SIGUSR1, which requests a dump of the event loop histograms. */
+static volatile sig_atomic_t dump_histograms;
+/*---------------------------------------------------------------------------*/
+static void
+sigusr1(int signo)
+{
+  dump_histograms = 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+dump_histogram(const char *name, const process_histogram_t *h)
+{
+  char buf[256];
+
+  process_histogram_snprint(buf, sizeof(buf), h);
+  fprintf(stderr, "%s (max %lu): %s\n", name, (unsigned long)h->max, buf);
+}
+/*---------------------------------------------------------------------------*/
+static void
+dump_process_histograms(void)
+{
+  const process_histograms_t *h = process_get_histograms();
+
+  fprintf(stderr, "Event loop histograms (%lu rtimer ticks per second):\n",
+          (unsigned long)RTIMER_SECOND);
+  dump_histogram("Event latency", &h->event_latency);
+  dump_histogram("Poll latency", &h->poll_latency);
+  dump_histogram("Run interval", &h->run_interval);
+  dump_histogram("Queue depth", &h->queue_depth);
+}
+#endif /* PROCESS_CONF_HISTOGRAMS */
+/*---------------------------------------------------------------------------*/
 int contiki_argc = 0;
 char **contiki_argv;
 /*---------------------------------------------------------------------------*/
@@ -280,32 +578,233 @@ platform_init_stage_three()
 
   /* Make standard output unbuffered. */
   setvbuf(stdout, (char *)NULL, _IONBF, 0);
+
+#if PROCESS_CONF_HISTOGRAMS
+  signal(SIGUSR1, sigusr1);
+#endif /* PROCESS_CONF_HISTOGRAMS */
 }
 /*---------------------------------------------------------------------------*/
+#if SELECT_EPOLL
+/*
+ * Arms the timerfd for the next etimer expiration. Returns true if an
+ * etimer has already expired, in which case the timerfd is left alone.
+ */
+static bool
+epoll_arm_timer(void)
+{
+  struct itimerspec its;
+  struct timespec now;
+  clock_time_t next;
+  clock_time_t ticks;
+  uint64_t ns;
+
+  memset(&its, 0, sizeof(its));
+
+  if(etimer_pending()) {
+    next = etimer_next_expiration_time();
+
+    /* Same conversion as clock_time(), but from a single clock reading. */
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ticks = now.tv_sec * CLOCK_SECOND +
+      now.tv_nsec / (1000000000 / CLOCK_SECOND);
+    if(!CLOCK_LT(ticks, next)) {
+      return true;
+    }
+    if(timer_armed && next == timer_expiration) {
+      return false;
+    }
+
+    /* The clock ticks at the start of each tick period. */
+    ns = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    ns -= now.tv_nsec % (1000000000 / CLOCK_SECOND);
+    ns += (uint64_t)(clock_time_t)(next - ticks) * (1000000000 / CLOCK_SECOND);
+    its.it_value.tv_sec = ns / 1000000000;
+    its.it_value.tv_nsec = ns % 1000000000;
+    timer_armed = true;
+    timer_expiration = next;
+  } else if(timer_armed) {
+    /* Disarm the timer. */
+    timer_armed = false;
+  } else {
+    return false;
+  }
+
+  if(timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+    perror("timerfd_settime");
+  }
+  return false;
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_handle_fd(int fd, uint32_t events)
+{
+  const struct select_fd *f;
+  fd_set fdr;
+  fd_set fdw;
+  unsigned ready = 0;
+
+  if(fd >= select_size) {
+    return;
+  }
+
+  /* Like select, report hangups and errors as readiness. Descriptors
+     removed by another callback in the same iteration are no longer
+     registered for any events. */
+  f = &select_fds[fd];
+  if((f->registered & EPOLLIN) && (events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+    ready |= SELECT_FD_READ;
+  }
+  if((f->registered & EPOLLOUT) && (events & (EPOLLOUT | EPOLLHUP | EPOLLERR))) {
+    ready |= SELECT_FD_WRITE;
+  }
+
+  if(f->handler != NULL) {
+    if(ready != 0) {
+      f->handler(fd, ready, f->ptr);
+    }
+  } else if(f->callback != NULL) {
+    FD_ZERO(&fdr);
+    FD_ZERO(&fdw);
+    if(ready & SELECT_FD_READ) {
+      FD_SET(fd, &fdr);
+    }
+    if(ready & SELECT_FD_WRITE) {
+      FD_SET(fd, &fdw);
+    }
+    f->callback->handle_fd(&fdr, &fdw);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+epoll_main_loop(void)
+{
+  struct epoll_event events[SELECT_EPOLL_EVENTS];
+  fd_set fdr;
+  fd_set fdw;
+  uint64_t expirations;
+  uint32_t interest;
+  int timeout;
+  int retval;
+  int i;
+
+  epoll_init();
+
+  while(1) {
+    retval = process_run();
+
+    /* Refresh the events each legacy callback is interested in. The
+       descriptors of select_register_fd() stay registered as they are. */
+    for(i = 0; i <= select_max && i < select_size; i++) {
+      if(select_fds[i].callback != NULL) {
+        interest = 0;
+        FD_ZERO(&fdr);
+        FD_ZERO(&fdw);
+        if(select_fds[i].callback->set_fd(&fdr, &fdw)) {
+          interest |= FD_ISSET(i, &fdr) ? EPOLLIN : 0;
+          interest |= FD_ISSET(i, &fdw) ? EPOLLOUT : 0;
+        }
+        epoll_update(i, interest);
+      }
+    }
+
+    timeout = retval || always_ready_fds > 0 ? 0 : SELECT_TIMEOUT;
+    if(epoll_arm_timer()) {
+      etimer_request_poll();
+      timeout = 0;
+    }
+
+    retval = epoll_wait(epoll_fd, events, SELECT_EPOLL_EVENTS, timeout);
+    if(retval < 0) {
+      if(errno != EINTR) {
+        perror("epoll_wait");
+      }
+      retval = 0;
+    }
+
+    for(i = 0; i < retval; i++) {
+      if(events[i].data.fd == timer_fd) {
+        if(read(timer_fd, &expirations, sizeof(expirations)) < 0 &&
+           errno != EAGAIN) {
+          perror("timerfd read");
+        }
+        timer_armed = false;
+        etimer_request_poll();
+      } else {
+        epoll_handle_fd(events[i].data.fd, events[i].events);
+      }
+    }
+
+    if(always_ready_fds > 0) {
+      for(i = 0; i < select_size; i++) {
+        if(select_fds[i].registered & EPOLL_ALWAYS_READY) {
+          epoll_handle_fd(i, select_fds[i].registered);
+        }
+      }
+    }
+
+#if PROCESS_CONF_HISTOGRAMS
+    if(dump_histograms) {
+      dump_histograms = 0;
+      dump_process_histograms();
+    }
+#endif /* PROCESS_CONF_HISTOGRAMS */
+  }
+}
+#endif /* SELECT_EPOLL */
+/*---------------------------------------------------------------------------*/
 void
 platform_main_loop()
 {
 #if SELECT_STDIN
-  select_set_callback(STDIN_FILENO, &stdin_fd);
+  select_register_fd(STDIN_FILENO, SELECT_FD_READ, stdin_handle_fd, NULL);
 #endif /* SELECT_STDIN */
+#if SELECT_EPOLL
+  epoll_main_loop();
+#else /* SELECT_EPOLL */
   while(1) {
     fd_set fdr;
     fd_set fdw;
     int maxfd;
     int i;
     int retval;
+    unsigned ready;
     struct timeval tv;
+    uint64_t timeout;
+    uint64_t wait;
+    clock_time_t now;
+    clock_time_t next;
 
     retval = process_run();
 
-    tv.tv_sec = retval ? 0 : SELECT_TIMEOUT / 1000;
-    tv.tv_usec = retval ? 1 : (SELECT_TIMEOUT * 1000) % 1000000;
+    timeout = retval ? 1 : SELECT_TIMEOUT * 1000;
+    if(!retval && etimer_pending()) {
+      /* Wake up when the next etimer expires. */
+      now = clock_time();
+      next = etimer_next_expiration_time();
+      wait = CLOCK_LT(now, next) ?
+        (uint64_t)(next - now) * 1000000 / CLOCK_SECOND : 0;
+      if(wait < timeout) {
+        timeout = wait;
+      }
+    }
+    tv.tv_sec = timeout / 1000000;
+    tv.tv_usec = timeout % 1000000;
 
     FD_ZERO(&fdr);
     FD_ZERO(&fdw);
     maxfd = 0;
     for(i = 0; i <= select_max; i++) {
-      if(select_callback[i] != NULL && select_callback[i]->set_fd(&fdr, &fdw)) {
+      if(select_fds[i].callback != NULL) {
+        if(select_fds[i].callback->set_fd(&fdr, &fdw)) {
+          maxfd = i;
+        }
+      } else if(select_fds[i].handler != NULL && select_fds[i].events != 0) {
+        if(select_fds[i].events & SELECT_FD_READ) {
+          FD_SET(i, &fdr);
+        }
+        if(select_fds[i].events & SELECT_FD_WRITE) {
+          FD_SET(i, &fdw);
+        }
         maxfd = i;
       }
     }
@@ -318,14 +817,33 @@ platform_main_loop()
     } else if(retval > 0) {
       /* timeout => retval == 0 */
       for(i = 0; i <= maxfd; i++) {
-        if(select_callback[i] != NULL) {
-          select_callback[i]->handle_fd(&fdr, &fdw);
+        if(select_fds[i].callback != NULL) {
+          select_fds[i].callback->handle_fd(&fdr, &fdw);
+        } else if(select_fds[i].handler != NULL) {
+          ready = 0;
+          if((select_fds[i].events & SELECT_FD_READ) && FD_ISSET(i, &fdr)) {
+            ready |= SELECT_FD_READ;
+          }
+          if((select_fds[i].events & SELECT_FD_WRITE) && FD_ISSET(i, &fdw)) {
+            ready |= SELECT_FD_WRITE;
+          }
+          if(ready != 0) {
+            select_fds[i].handler(i, ready, select_fds[i].ptr);
+          }
         }
       }
     }
 
     etimer_request_poll();
+
+#if PROCESS_CONF_HISTOGRAMS
+    if(dump_histograms) {
+      dump_histograms = 0;
+      dump_process_histograms();
+    }
+#endif /* PROCESS_CONF_HISTOGRAMS */
   }
+#endif /* SELECT_EPOLL */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""Compares two runs of the microbenchmarks.
+
+Each input is the output of microbench.native. Benchmarks whose throughput
+dropped by more than the threshold are reported as regressions, and the
+exit status is 1 if there are any.
+"""
+
+import argparse
+import json
+import sys
+
+PREFIX = '=bench= '
+
+
+def load(path):
+    results = {}
+    with open(path, errors='replace') as f:
+        for line in f:
+            start = line.find(PREFIX)
+            if start < 0:
+                continue
+            record = json.loads(line[start + len(PREFIX):])
+            if 'name' in record:
+                results[record['name']] = record
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('baseline', help='output of the baseline run')
+    parser.add_argument('current', help='output of the run to check')
+    parser.add_argument('--threshold', type=float, default=10.0,
+                        help='allowed throughput drop in percent (default 10)')
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    print(f"{'benchmark':32} {'ops/s before':>14} {'ops/s after':>14} "
+          f"{'change':>8} {'batch p99 before':>17} {'batch p99 after':>16}")
+    regressions = 0
+    for name in sorted(set(baseline) | set(current)):
+        if name not in baseline or name not in current:
+            print(f"{name:32} only in {'baseline' if name in baseline else 'current'}")
+            continue
+        before = baseline[name]
+        after = current[name]
+        change = 100.0 * (after['ops_per_sec'] / before['ops_per_sec'] - 1)
+        regressed = change < -args.threshold
+        regressions += regressed
+        print(f"{name:32} {before['ops_per_sec']:14.0f} "
+              f"{after['ops_per_sec']:14.0f} {change:+7.1f}% "
+              f"{before['batch_p99_ns']:17.1f} {after['batch_p99_ns']:16.1f}"
+              f"{'  REGRESSION' if regressed else ''}")
+
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
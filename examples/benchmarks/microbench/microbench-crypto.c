@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Microbenchmarks for AES-128, CCM*, SHA-256, and CRC16, through the
+ *         same drivers that the network stack uses.
+ */
+
+#include "contiki.h"
+#include "lib/aes-128.h"
+#include "lib/ccm-star.h"
+#include "lib/crc16.h"
+#include "lib/sha-256.h"
+#include "microbench.h"
+
+/*---------------------------------------------------------------------------*/
+#define SHORT_LEN 64
+#define LONG_LEN 1024
+#define CCM_HEADER_LEN 13
+#define CCM_MIC_LEN 8
+
+static const uint8_t key[AES_128_KEY_LENGTH] = {
+  0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+  0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf
+};
+static uint8_t data[LONG_LEN];
+static uint8_t nonce[CCM_STAR_NONCE_LENGTH];
+static uint8_t mic[CCM_MIC_LEN];
+static uint8_t digest[SHA_256_DIGEST_LENGTH];
+static sha_256_hmac_context_t hmac_context;
+/*---------------------------------------------------------------------------*/
+static void
+crypto_setup(void)
+{
+  for(unsigned i = 0; i < sizeof(data); i++) {
+    data[i] = i * 7;
+  }
+  AES_128.set_key(key);
+  CCM_STAR.set_key(key);
+  sha_256_hmac_context_init(&hmac_context, key, sizeof(key));
+}
+/*---------------------------------------------------------------------------*/
+static void
+aes_128_op(uint32_t i)
+{
+  AES_128.encrypt(data);
+}
+/*---------------------------------------------------------------------------*/
+/* Encrypts and authenticates a frame with a 13-byte header and a 64-byte
+   payload, like a secured IEEE 802.15.4 data frame. */
+static void
+ccm_star_op(uint32_t i)
+{
+  nonce[CCM_STAR_NONCE_LENGTH - 1] = i;
+  CCM_STAR.aead(nonce, data + CCM_HEADER_LEN, SHORT_LEN,
+                data, CCM_HEADER_LEN, mic, CCM_MIC_LEN, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+sha_256_short_op(uint32_t i)
+{
+  SHA_256.hash(data, SHORT_LEN, digest);
+}
+/*---------------------------------------------------------------------------*/
+static void
+sha_256_long_op(uint32_t i)
+{
+  SHA_256.hash(data, LONG_LEN, digest);
+}
+/*---------------------------------------------------------------------------*/
+static void
+hmac_op(uint32_t i)
+{
+  sha_256_hmac(key, sizeof(key), data, SHORT_LEN, digest);
+}
+/*---------------------------------------------------------------------------*/
+static void
+hmac_with_context_op(uint32_t i)
+{
+  sha_256_hmac_with_context(&hmac_context, data, SHORT_LEN, digest);
+}
+/*---------------------------------------------------------------------------*/
+static void
+crc16_short_op(uint32_t i)
+{
+  microbench_sink += crc16_data(data, SHORT_LEN, i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+crc16_long_op(uint32_t i)
+{
+  microbench_sink += crc16_data(data, LONG_LEN, i);
+}
+/*---------------------------------------------------------------------------*/
+void
+microbench_crypto(void)
+{
+  static const struct microbench benchmarks[] = {
+    { "aes-128/encrypt-block", crypto_setup, aes_128_op, NULL },
+    { "ccm-star/encrypt-64", crypto_setup, ccm_star_op, NULL },
+    { "sha-256/hash-64", crypto_setup, sha_256_short_op, NULL },
+    { "sha-256/hash-1024", crypto_setup, sha_256_long_op, NULL },
+    { "sha-256/hmac-64", crypto_setup, hmac_op, NULL },
+    { "sha-256/hmac-64-context", crypto_setup, hmac_with_context_op, NULL },
+    { "crc16/data-64", crypto_setup, crc16_short_op, NULL },
+    { "crc16/data-1024", crypto_setup, crc16_long_op, NULL },
+  };
+
+  for(unsigned i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+    microbench_run(&benchmarks[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
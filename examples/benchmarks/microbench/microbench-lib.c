@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Microbenchmarks for the data structures in os/lib and the
+ *         neighbor table.
+ */
+
+#include "contiki.h"
+#include "lib/heapmem.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+#include "lib/ringbuf.h"
+#include "lib/ringbufindex.h"
+#include "net/nbr-table.h"
+#include "microbench.h"
+
+/*---------------------------------------------------------------------------*/
+#define LIST_ITEMS 32
+#define HEAP_SLOTS 16
+#define NBR_ENTRIES 48
+
+struct item {
+  struct item *next;
+  uint32_t value;
+};
+
+struct bench_nbr {
+  uint32_t value;
+};
+
+LIST(items);
+MEMB(items_memb, struct item, LIST_ITEMS);
+static struct item item_array[LIST_ITEMS];
+static void *heap_slots[HEAP_SLOTS];
+NBR_TABLE(struct bench_nbr, bench_nbrs);
+static linkaddr_t nbr_addrs[NBR_ENTRIES];
+static struct ringbuf ringbuf;
+static uint8_t ringbuf_data[64];
+static struct ringbufindex ringbufindex;
+/*---------------------------------------------------------------------------*/
+static void
+list_setup(void)
+{
+  list_init(items);
+  for(unsigned i = 0; i < LIST_ITEMS; i++) {
+    list_add(items, &item_array[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Moves the head of a list of LIST_ITEMS items to its tail. */
+static void
+list_op(uint32_t i)
+{
+  list_add(items, list_pop(items));
+}
+/*---------------------------------------------------------------------------*/
+static void
+list_contains_op(uint32_t i)
+{
+  microbench_sink += list_contains(items, &item_array[i % LIST_ITEMS]);
+}
+/*---------------------------------------------------------------------------*/
+static void
+memb_setup(void)
+{
+  memb_init(&items_memb);
+  for(unsigned i = 0; i < LIST_ITEMS / 2; i++) {
+    memb_alloc(&items_memb);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+memb_op(uint32_t i)
+{
+  void *p = memb_alloc(&items_memb);
+  memb_free(&items_memb, p);
+}
+/*---------------------------------------------------------------------------*/
+/* Replaces one of HEAP_SLOTS live allocations by one of another size, so
+   that the heap stays fragmented. */
+static void
+heapmem_op(uint32_t i)
+{
+  void **slot = &heap_slots[i % HEAP_SLOTS];
+
+  heapmem_free(*slot);
+  *slot = heapmem_alloc(8 + (i * 37) % 120);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heapmem_teardown(void)
+{
+  for(unsigned i = 0; i < HEAP_SLOTS; i++) {
+    heapmem_free(heap_slots[i]);
+    heap_slots[i] = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+nbr_table_setup(void)
+{
+  nbr_table_register(bench_nbrs, NULL);
+  for(unsigned i = 0; i < NBR_ENTRIES; i++) {
+    nbr_addrs[i].u8[0] = 0x02;
+    nbr_addrs[i].u8[LINKADDR_SIZE - 2] = i >> 8;
+    nbr_addrs[i].u8[LINKADDR_SIZE - 1] = i;
+    nbr_table_add_lladdr(bench_nbrs, &nbr_addrs[i],
+                         NBR_TABLE_REASON_UNDEFINED, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+nbr_table_op(uint32_t i)
+{
+  microbench_sink +=
+    (uintptr_t)nbr_table_get_from_lladdr(bench_nbrs,
+                                         &nbr_addrs[(i * 7) % NBR_ENTRIES]);
+}
+/*---------------------------------------------------------------------------*/
+static void
+nbr_table_teardown(void)
+{
+  for(unsigned i = 0; i < NBR_ENTRIES; i++) {
+    nbr_table_remove(bench_nbrs,
+                     nbr_table_get_from_lladdr(bench_nbrs, &nbr_addrs[i]));
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+ringbuf_setup(void)
+{
+  ringbuf_init(&ringbuf, ringbuf_data, sizeof(ringbuf_data));
+}
+/*---------------------------------------------------------------------------*/
+static void
+ringbuf_op(uint32_t i)
+{
+  ringbuf_put(&ringbuf, i);
+  microbench_sink += ringbuf_get(&ringbuf);
+}
+/*---------------------------------------------------------------------------*/
+static void
+ringbufindex_setup(void)
+{
+  ringbufindex_init(&ringbufindex, 16);
+}
+/*---------------------------------------------------------------------------*/
+static void
+ringbufindex_op(uint32_t i)
+{
+  ringbufindex_put(&ringbufindex);
+  microbench_sink += ringbufindex_get(&ringbufindex);
+}
+/*---------------------------------------------------------------------------*/
+void
+microbench_lib(void)
+{
+  static const struct microbench benchmarks[] = {
+    { "list/pop-add-32", list_setup, list_op, NULL },
+    { "list/contains-32", list_setup, list_contains_op, NULL },
+    { "memb/alloc-free", memb_setup, memb_op, NULL },
+    { "heapmem/free-alloc", NULL, heapmem_op, heapmem_teardown },
+    { "nbr-table/lookup-48", nbr_table_setup, nbr_table_op,
+      nbr_table_teardown },
+    { "ringbuf/put-get", ringbuf_setup, ringbuf_op, NULL },
+    { "ringbufindex/put-get", ringbufindex_setup, ringbufindex_op, NULL },
+  };
+
+  for(unsigned i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+    microbench_run(&benchmarks[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
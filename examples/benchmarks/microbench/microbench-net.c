@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Microbenchmarks for the IPv6 routing table, 6LoWPAN header
+ *         compression, and CoAP message handling. 6LoWPAN runs on a MAC
+ *         layer that captures the outgoing frame instead of sending it.
+ */
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "coap.h"
+#include "microbench.h"
+
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+#define ROUTES 200
+#define DESTINATIONS 64
+#define DATAGRAM_PAYLOAD 64
+
+static uip_ipaddr_t nexthop;
+static uip_ipaddr_t destinations[DESTINATIONS];
+
+static uint8_t datagram[UIP_BUFSIZE];
+static uint16_t datagram_len;
+static uint8_t frame[PACKETBUF_SIZE];
+static uint16_t frame_len;
+static const linkaddr_t dest = { { 0x02, 0x12, 0x74, 0x01, 0, 0x01, 0x01, 0x01 } };
+
+static coap_message_t coap_message;
+static uint8_t coap_payload[DATAGRAM_PAYLOAD];
+static uint8_t coap_buffer[COAP_MAX_HEADER_SIZE + DATAGRAM_PAYLOAD + 1];
+static size_t coap_len;
+/*---------------------------------------------------------------------------*/
+static void
+mac_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  memcpy(frame, packetbuf_hdrptr(), packetbuf_totlen());
+  frame_len = packetbuf_totlen();
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+mac_input(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_off(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+mac_max_payload(void)
+{
+  return 127 - 23;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver microbench_mac_driver = {
+  "microbench-mac",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_max_payload,
+};
+/*---------------------------------------------------------------------------*/
+static void
+route_setup(void)
+{
+  uip_lladdr_t lladdr = { { 0x02, 0, 0, 0, 0, 0, 0, 0x01 } };
+  uip_ipaddr_t host;
+
+  uip_ip6addr(&nexthop, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  uip_ds6_nbr_add(&nexthop, &lladdr, 1, NBR_REACHABLE,
+                  NBR_TABLE_REASON_UNDEFINED, NULL);
+
+  for(unsigned i = 0; i < ROUTES; i++) {
+    uip_ip6addr(&host, 0xfd00, 0, 0, i % 8, 0x0200, 0, 0, i);
+    uip_ds6_route_add(&host, 128, &nexthop);
+  }
+
+  /* Every second destination has a route. */
+  for(unsigned i = 0; i < DESTINATIONS; i++) {
+    unsigned n = i * 3;
+    uip_ip6addr(&destinations[i], 0xfd00, 0, 0, n % 8, 0x0200, 0, 0,
+                i & 1 ? n : ROUTES + n);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_op(uint32_t i)
+{
+  microbench_sink +=
+    (uintptr_t)uip_ds6_route_lookup(&destinations[i % DESTINATIONS]);
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_teardown(void)
+{
+  uip_ds6_route_rm_by_nexthop(&nexthop);
+  uip_ds6_nbr_rm(uip_ds6_nbr_lookup(&nexthop));
+}
+/*---------------------------------------------------------------------------*/
+/* A UDP datagram to a multicast group that this node is not a member
+   of, so that the IPv6 layer drops it after 6LoWPAN has uncompressed
+   it. */
+static void
+sicslowpan_setup(void)
+{
+  struct uip_udp_hdr *udp;
+
+  memset(uip_buf, 0, UIP_IPUDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfd00, 0, 0, 0, 0x0212, 0x7401,
+              0x0001, 0x0101);
+  uip_ip6addr(&UIP_IP_BUF->destipaddr, 0xff05, 0, 0, 0, 0, 0, 0, 0x1234);
+  uipbuf_set_len_field(UIP_IP_BUF, UIP_UDPH_LEN + DATAGRAM_PAYLOAD);
+
+  udp = (struct uip_udp_hdr *)UIP_IP_PAYLOAD(0);
+  udp->srcport = UIP_HTONS(5683);
+  udp->destport = UIP_HTONS(61616);
+  udp->udplen = UIP_HTONS(UIP_UDPH_LEN + DATAGRAM_PAYLOAD);
+  udp->udpchksum = UIP_HTONS(0xbeef);
+
+  for(uint16_t i = 0; i < DATAGRAM_PAYLOAD; i++) {
+    uip_buf[UIP_IPUDPH_LEN + i] = i;
+  }
+  uip_len = UIP_IPUDPH_LEN + DATAGRAM_PAYLOAD;
+  uipbuf_clear_attr();
+
+  datagram_len = uip_len;
+  memcpy(datagram, uip_buf, uip_len);
+
+  /* Capture one frame for the uncompression benchmark. */
+  NETSTACK_NETWORK.output(&dest);
+}
+/*---------------------------------------------------------------------------*/
+static void
+sicslowpan_compress_op(uint32_t i)
+{
+  memcpy(uip_buf, datagram, datagram_len);
+  uip_len = datagram_len;
+  microbench_sink += NETSTACK_NETWORK.output(&dest);
+}
+/*---------------------------------------------------------------------------*/
+static void
+sicslowpan_uncompress_op(uint32_t i)
+{
+  packetbuf_copyfrom(frame, frame_len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &dest);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+  NETSTACK_NETWORK.input();
+}
+/*---------------------------------------------------------------------------*/
+/* A confirmable POST with a token, an URI path, a content format, and a
+   block option. */
+static void
+coap_setup(void)
+{
+  static const uint8_t token[] = { 0x12, 0x34, 0x56, 0x78 };
+
+  for(unsigned i = 0; i < sizeof(coap_payload); i++) {
+    coap_payload[i] = i;
+  }
+  coap_init_message(&coap_message, COAP_TYPE_CON, COAP_POST, 0x1234);
+  coap_set_token(&coap_message, token, sizeof(token));
+  coap_set_header_uri_path(&coap_message, "sensors/temperature");
+  coap_set_header_content_format(&coap_message, APPLICATION_OCTET_STREAM);
+  coap_set_header_block1(&coap_message, 2, 1, DATAGRAM_PAYLOAD);
+  coap_set_payload(&coap_message, coap_payload, sizeof(coap_payload));
+  coap_len = coap_serialize_message(&coap_message, coap_buffer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+coap_serialize_op(uint32_t i)
+{
+  coap_message.mid = i;
+  microbench_sink += coap_serialize_message(&coap_message, coap_buffer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+coap_parse_op(uint32_t i)
+{
+  coap_message_t message;
+
+  microbench_sink += coap_parse_message(&message, coap_buffer, coap_len);
+}
+/*---------------------------------------------------------------------------*/
+void
+microbench_net(void)
+{
+  static const struct microbench benchmarks[] = {
+    { "uip-ds6-route/lookup-200", route_setup, route_op, route_teardown },
+    { "sicslowpan/compress", sicslowpan_setup, sicslowpan_compress_op, NULL },
+    { "sicslowpan/uncompress", sicslowpan_setup, sicslowpan_uncompress_op,
+      NULL },
+    { "coap/serialize", coap_setup, coap_serialize_op, NULL },
+    { "coap/parse", coap_setup, coap_parse_op, NULL },
+  };
+
+  for(unsigned i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+    microbench_run(&benchmarks[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Microbenchmarks for the native platform. The benchmarks whose
+ *         names start with one of the command line arguments are run, or
+ *         all of them if there are no arguments. Each result is printed as
+ *         a line of JSON that starts with MICROBENCH_PREFIX, and compare.py
+ *         compares the results of two runs.
+ */
+
+#include "contiki.h"
+#include "microbench.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*---------------------------------------------------------------------------*/
+#ifndef CONTIKI_VERSION_STRING
+#define CONTIKI_VERSION_STRING "Contiki-NG"
+#endif
+
+#define MAX_BATCH (1UL << 20)
+
+extern int contiki_argc;
+extern char **contiki_argv;
+
+volatile uintptr_t microbench_sink;
+static uint64_t samples[MICROBENCH_SAMPLES];
+/*---------------------------------------------------------------------------*/
+PROCESS(microbench_process, "Microbenchmarks");
+AUTOSTART_PROCESSES(&microbench_process);
+/*---------------------------------------------------------------------------*/
+static uint64_t
+nsec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static bool
+selected(const char *name)
+{
+  if(contiki_argc <= 1) {
+    return true;
+  }
+  for(int i = 1; i < contiki_argc; i++) {
+    if(strncmp(name, contiki_argv[i], strlen(contiki_argv[i])) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+/*---------------------------------------------------------------------------*/
+static uint64_t
+run_batch(const struct microbench *b, uint32_t *i, unsigned long batch)
+{
+  uint64_t start = nsec_now();
+  for(unsigned long k = 0; k < batch; k++) {
+    b->op((*i)++);
+  }
+  return nsec_now() - start;
+}
+/*---------------------------------------------------------------------------*/
+static int
+compare_samples(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+
+  return x < y ? -1 : x > y;
+}
+/*---------------------------------------------------------------------------*/
+/* The mean time per operation of the batch at percentile p. The batch
+   means smooth out the variation of single operations, so these are not
+   per-operation latency percentiles. */
+static double
+percentile(unsigned p, unsigned long batch)
+{
+  return (double)samples[(MICROBENCH_SAMPLES - 1) * p / 100] / batch;
+}
+/*---------------------------------------------------------------------------*/
+void
+microbench_run(const struct microbench *b)
+{
+  unsigned long batch;
+  uint64_t total = 0;
+  uint32_t i = 0;
+
+  if(!selected(b->name)) {
+    return;
+  }
+
+  if(b->setup != NULL) {
+    b->setup();
+  }
+
+  /* Find a batch size that takes long enough to time, which also warms
+     up the caches. */
+  for(batch = 1; batch < MAX_BATCH; batch *= 2) {
+    if(run_batch(b, &i, batch) >= MICROBENCH_BATCH_NSEC) {
+      break;
+    }
+  }
+
+  for(unsigned s = 0; s < MICROBENCH_SAMPLES; s++) {
+    samples[s] = run_batch(b, &i, batch);
+    total += samples[s];
+  }
+
+  if(b->teardown != NULL) {
+    b->teardown();
+  }
+
+  qsort(samples, MICROBENCH_SAMPLES, sizeof(samples[0]), compare_samples);
+  printf(MICROBENCH_PREFIX "{\"name\":\"%s\",\"batch\":%lu,\"samples\":%u,"
+         "\"ops_per_sec\":%.0f,\"batch_p50_ns\":%.1f,"
+         "\"batch_p90_ns\":%.1f,\"batch_p99_ns\":%.1f,"
+         "\"batch_max_ns\":%.1f}\n",
+         b->name, batch, MICROBENCH_SAMPLES,
+         (double)MICROBENCH_SAMPLES * batch * 1000000000 / total,
+         percentile(50, batch), percentile(90, batch), percentile(99, batch),
+         percentile(100, batch));
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(microbench_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf(MICROBENCH_PREFIX "{\"version\":\"%s\",\"compiler\":\"%s\","
+         "\"samples\":%u,\"batch_ns\":%u}\n",
+         CONTIKI_VERSION_STRING, __VERSION__, MICROBENCH_SAMPLES,
+         MICROBENCH_BATCH_NSEC);
+
+  microbench_lib();
+  microbench_net();
+  microbench_crypto();
+
+  printf(MICROBENCH_PREFIX "{\"done\":true}\n");
+  exit(EXIT_SUCCESS);
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         A small harness for timing library and network stack operations
+ *         on the native platform.
+ *
+ *         Every benchmark runs one operation in batches that are large
+ *         enough to be timed accurately, and reports the throughput and
+ *         the percentiles of the mean time per operation of the batches
+ *         as one line of JSON.
+ */
+
+#ifndef MICROBENCH_H_
+#define MICROBENCH_H_
+
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------*/
+/* The number of timed batches per benchmark. */
+#ifdef MICROBENCH_CONF_SAMPLES
+#define MICROBENCH_SAMPLES MICROBENCH_CONF_SAMPLES
+#else
+#define MICROBENCH_SAMPLES 2000
+#endif
+
+/* The shortest duration of a batch, in nanoseconds. Shorter batches are
+   dominated by the overhead of reading the clock. */
+#ifdef MICROBENCH_CONF_BATCH_NSEC
+#define MICROBENCH_BATCH_NSEC MICROBENCH_CONF_BATCH_NSEC
+#else
+#define MICROBENCH_BATCH_NSEC 10000
+#endif
+
+/* The prefix of every result line. */
+#define MICROBENCH_PREFIX "=bench= "
+/*---------------------------------------------------------------------------*/
+struct microbench {
+  /* The name, as "group/operation". */
+  const char *name;
+  /* Called before the timed batches, if not NULL. */
+  void (*setup)(void);
+  /* Performs one operation. i counts the operations from zero. */
+  void (*op)(uint32_t i);
+  /* Called after the timed batches, if not NULL. */
+  void (*teardown)(void);
+};
+
+/* Results that are stored here cannot be optimized away. */
+extern volatile uintptr_t microbench_sink;
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Runs a benchmark and prints its result, unless the benchmark
+ *        was not selected on the command line.
+ * \param b The benchmark.
+ */
+void microbench_run(const struct microbench *b);
+
+/**
+ * \brief Runs the benchmarks of a group.
+ */
+void microbench_lib(void);
+void microbench_net(void);
+void microbench_crypto(void);
+/*---------------------------------------------------------------------------*/
+#endif /* MICROBENCH_H_ */
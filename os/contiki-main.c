@@ -91,6 +91,10 @@ main(void)
 
   platform_init_stage_two();
 
+#if LOG_BINARY
+  log_binary_init();
+#endif /* LOG_BINARY */
+
 #if QUEUEBUF_ENABLED
   queuebuf_init();
 #endif /* QUEUEBUF_ENABLED */
@@ -65,31 +65,21 @@ set_iv(uint8_t *iv,
   iv[15] = counter;
 }
 /*---------------------------------------------------------------------------*/
-/* XORs the block m[pos] ... m[pos + 15] with K_{counter} */
 static void
-ctr_step(const uint8_t *nonce,
-    uint16_t pos,
-    uint8_t *m_and_result, uint16_t m_len,
-    uint16_t counter)
+xor_block(uint8_t *dst, const uint8_t *src, uint_fast8_t len)
 {
-  uint8_t a[AES_128_BLOCK_SIZE];
-
-  set_iv(a, CCM_STAR_ENCRYPTION_FLAGS, nonce, counter);
-  AES_128.encrypt(a);
-
-  for(uint_fast8_t i = 0; (pos + i < m_len) && (i < AES_128_BLOCK_SIZE); i++) {
-    m_and_result[pos + i] ^= a[i];
+  for(uint_fast8_t i = 0; i < len; i++) {
+    dst[i] ^= src[i];
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Starts the CBC-MAC in x and authenticates a */
 static void
-mic(const uint8_t *nonce,
-    const uint8_t *m, uint16_t m_len,
+mic_start(const uint8_t *nonce,
     const uint8_t *a, uint16_t a_len,
-    uint8_t *result, uint8_t mic_len)
+    uint16_t m_len, uint8_t mic_len,
+    uint8_t *x)
 {
-  uint8_t x[AES_128_BLOCK_SIZE];
-
   set_iv(x, CCM_STAR_AUTH_FLAGS(a_len, mic_len), nonce, m_len);
   AES_128.encrypt(x);
 
@@ -113,32 +103,6 @@ mic(const uint8_t *nonce,
       AES_128.encrypt(x);
     }
   }
-
-  if(m_len) {
-    /* 32-bit pos to reach the end of the loop if m_len is large */
-    for(uint32_t pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
-      for(uint_fast8_t i = 0;
-          (pos + i < m_len) && (i < AES_128_BLOCK_SIZE);
-          i++) {
-        x[i] ^= m[pos + i];
-      }
-      AES_128.encrypt(x);
-    }
-  }
-
-  ctr_step(nonce, 0, x, AES_128_BLOCK_SIZE, 0);
-
-  memcpy(result, x, mic_len);
-}
-/*---------------------------------------------------------------------------*/
-static void
-ctr(const uint8_t *nonce, uint8_t *m, uint16_t m_len)
-{
-  uint16_t counter = 1;
-  /* 32-bit pos to reach the end of the loop if m_len is large */
-  for(uint32_t pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
-    ctr_step(nonce, pos, m, m_len, counter++);
-  }
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -154,25 +118,46 @@ aead(const uint8_t* nonce,
     uint8_t *result, uint8_t mic_len,
     int forward)
 {
+  uint8_t x[AES_128_BLOCK_SIZE];
+  uint8_t iv[AES_128_BLOCK_SIZE];
+  uint8_t key_stream[AES_128_BLOCK_SIZE];
+  uint16_t counter = 1;
+
   if(!MIC_LEN_VALID(mic_len)) {
     return;
   }
 
-  if(!forward) {
-    /* decrypt */
-    ctr(nonce, m, m_len);
-  }
-
-  mic(nonce,
-      m, m_len,
-      a, a_len,
-      result,
-      mic_len);
+  mic_start(nonce, a, a_len, m_len, mic_len, x);
+  set_iv(iv, CCM_STAR_ENCRYPTION_FLAGS, nonce, 0);
 
-  if(forward) {
-    /* encrypt */
-    ctr(nonce, m, m_len);
+  /* Each block of m is authenticated and encrypted, or decrypted and
+     authenticated, in the same pass. The CBC-MAC always covers the
+     plaintext. */
+  /* 32-bit pos to reach the end of the loop if m_len is large */
+  for(uint32_t pos = 0; pos < m_len; pos += AES_128_BLOCK_SIZE) {
+    uint_fast8_t len = m_len - pos < AES_128_BLOCK_SIZE
+        ? m_len - pos : AES_128_BLOCK_SIZE;
+
+    memcpy(key_stream, iv, AES_128_BLOCK_SIZE);
+    key_stream[14] = counter >> 8;
+    key_stream[15] = counter;
+    counter++;
+    AES_128.encrypt(key_stream);
+
+    if(forward) {
+      xor_block(x, m + pos, len);
+      xor_block(m + pos, key_stream, len);
+    } else {
+      xor_block(m + pos, key_stream, len);
+      xor_block(x, m + pos, len);
+    }
+    AES_128.encrypt(x);
   }
+
+  /* The MIC is encrypted with K_0 */
+  AES_128.encrypt(iv);
+  xor_block(x, iv, mic_len);
+  memcpy(result, x, mic_len);
 }
 /*---------------------------------------------------------------------------*/
 const struct ccm_star_driver ccm_star_driver = {
@@ -41,35 +41,97 @@
  *
  */
 
+#include "lib/crc16.h"
+
+#include <stdint.h>
+
+#include "lib/crc16-tables.h"
+
 /* CITT CRC16 polynomial ^16 + ^12 + ^5 + 1 */
 /*---------------------------------------------------------------------------*/
+/* IEEE 802.15.4: the bits of each byte are processed least significant
+   first. */
 unsigned short
 crc16_add(unsigned char b, unsigned short acc)
 {
-  /*
-    acc  = (unsigned char)(acc >> 8) | (acc << 8);
-    acc ^= b;
-    acc ^= (unsigned char)(acc & 0xff) >> 4;
-    acc ^= (acc << 8) << 4;
-    acc ^= ((acc & 0xff) << 4) << 1;
-  */
-
+#if CRC16_TABLE == CRC16_TABLE_SMALL
+  acc = (acc >> 4) ^ crc16_table[(acc ^ b) & 0xf];
+  acc = (acc >> 4) ^ crc16_table[(acc ^ (b >> 4)) & 0xf];
+#elif CRC16_TABLE != CRC16_TABLE_NONE
+  acc = (acc >> 8) ^ crc16_table[0][(acc ^ b) & 0xff];
+#else
   acc ^= b;
   acc  = (acc >> 8) | (acc << 8);
   acc ^= (acc & 0xff00) << 4;
   acc ^= (acc >> 8) >> 4;
   acc ^= (acc & 0xff00) >> 5;
+#endif
   return acc;
 }
 /*---------------------------------------------------------------------------*/
 unsigned short
 crc16_data(const unsigned char *data, int len, unsigned short acc)
 {
-  int i;
-  
-  for(i = 0; i < len; ++i) {
-    acc = crc16_add(*data, acc);
-    ++data;
+#if CRC16_TABLE == CRC16_TABLE_SLICE_BY_8
+  for(; len >= 8; len -= 8, data += 8) {
+    acc ^= data[0] | (data[1] << 8);
+    acc = crc16_table[7][acc & 0xff] ^ crc16_table[6][acc >> 8]
+      ^ crc16_table[5][data[2]] ^ crc16_table[4][data[3]]
+      ^ crc16_table[3][data[4]] ^ crc16_table[2][data[5]]
+      ^ crc16_table[1][data[6]] ^ crc16_table[0][data[7]];
+  }
+#elif CRC16_TABLE == CRC16_TABLE_SLICE_BY_4
+  for(; len >= 4; len -= 4, data += 4) {
+    acc ^= data[0] | (data[1] << 8);
+    acc = crc16_table[3][acc & 0xff] ^ crc16_table[2][acc >> 8]
+      ^ crc16_table[1][data[2]] ^ crc16_table[0][data[3]];
+  }
+#endif
+  for(; len > 0; len--) {
+    acc = crc16_add(*data++, acc);
+  }
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+/* CCITT: the bits of each byte are processed most significant first. */
+unsigned short
+crc16_ccitt_add(unsigned char b, unsigned short acc)
+{
+#if CRC16_TABLE == CRC16_TABLE_SMALL
+  acc = (acc << 4) ^ crc16_ccitt_table[((acc >> 12) ^ (b >> 4)) & 0xf];
+  acc = (acc << 4) ^ crc16_ccitt_table[((acc >> 12) ^ b) & 0xf];
+#elif CRC16_TABLE != CRC16_TABLE_NONE
+  acc = (acc << 8) ^ crc16_ccitt_table[0][((acc >> 8) ^ b) & 0xff];
+#else
+  acc  = (unsigned char)(acc >> 8) | (acc << 8);
+  acc ^= b;
+  acc ^= (unsigned char)(acc & 0xff) >> 4;
+  acc ^= (acc << 8) << 4;
+  acc ^= ((acc & 0xff) << 4) << 1;
+#endif
+  return acc;
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+crc16_ccitt_data(const unsigned char *data, int len, unsigned short acc)
+{
+#if CRC16_TABLE == CRC16_TABLE_SLICE_BY_8
+  for(; len >= 8; len -= 8, data += 8) {
+    acc ^= (data[0] << 8) | data[1];
+    acc = crc16_ccitt_table[7][acc >> 8] ^ crc16_ccitt_table[6][acc & 0xff]
+      ^ crc16_ccitt_table[5][data[2]] ^ crc16_ccitt_table[4][data[3]]
+      ^ crc16_ccitt_table[3][data[4]] ^ crc16_ccitt_table[2][data[5]]
+      ^ crc16_ccitt_table[1][data[6]] ^ crc16_ccitt_table[0][data[7]];
+  }
+#elif CRC16_TABLE == CRC16_TABLE_SLICE_BY_4
+  for(; len >= 4; len -= 4, data += 4) {
+    acc ^= (data[0] << 8) | data[1];
+    acc = crc16_ccitt_table[3][acc >> 8] ^ crc16_ccitt_table[2][acc & 0xff]
+      ^ crc16_ccitt_table[1][data[2]] ^ crc16_ccitt_table[0][data[3]];
+  }
+#endif
+  for(; len > 0; len--) {
+    acc = crc16_ccitt_add(*data++, acc);
   }
   return acc;
 }
@@ -55,6 +55,23 @@
 #ifndef CRC16_H_
 #define CRC16_H_
 
+#include "contiki.h"
+
+/* The lookup tables used by crc16_data() and crc16_ccitt_data(). Larger
+   tables process more bytes per step, at the cost of ROM. Without a
+   table, each byte takes a few shifts and XORs. */
+#define CRC16_TABLE_NONE       0  /* No table */
+#define CRC16_TABLE_SLICE_BY_1 1  /* One byte per step, 512 bytes */
+#define CRC16_TABLE_SLICE_BY_4 4  /* Four bytes per step, 2 KiB */
+#define CRC16_TABLE_SLICE_BY_8 8  /* Eight bytes per step, 4 KiB */
+#define CRC16_TABLE_SMALL      16 /* Half a byte per step, 32 bytes */
+
+#ifdef CRC16_CONF_TABLE
+#define CRC16_TABLE CRC16_CONF_TABLE
+#else /* CRC16_CONF_TABLE */
+#define CRC16_TABLE CRC16_TABLE_NONE
+#endif /* CRC16_CONF_TABLE */
+
 /**
  * \brief      Update an accumulated CRC16 checksum with one byte.
  * \param b    The byte to be added to the checksum
@@ -65,10 +82,11 @@
  *             with one byte. It can be used as a running checksum, or
  *             to checksum an entire data block.
  *
- *             \note The algorithm used in this implementation is
- *             tailored for a running checksum and does not perform as
- *             well as a table-driven algorithm when checksumming an
- *             entire data block.
+ *             \note Unless CRC16_CONF_TABLE selects a table, the
+ *             algorithm used in this implementation is tailored for
+ *             a running checksum and does not perform as well as a
+ *             table-driven algorithm when checksumming an entire
+ *             data block.
  *
  */
 unsigned short crc16_add(unsigned char b, unsigned short crc);
@@ -82,14 +100,38 @@ unsigned short crc16_add(unsigned char b, unsigned short crc);
  *
  *             This function calculates the CRC16 checksum of a data area.
  *
- *             \note The algorithm used in this implementation is
- *             tailored for a running checksum and does not perform as
- *             well as a table-driven algorithm when checksumming an
- *             entire data block.
+ *             \note CRC16_CONF_TABLE selects a table-driven algorithm,
+ *             which processes up to eight bytes per step.
  */
 unsigned short crc16_data(const unsigned char *data, int datalen,
 			  unsigned short acc);
 
+/**
+ * \brief      Update an accumulated CCITT CRC16 checksum with one byte.
+ * \param b    The byte to be added to the checksum
+ * \param crc  The accumulated CRC that is to be updated.
+ * \return     The updated CRC checksum.
+ *
+ *             Unlike crc16_add(), which computes the CRC of IEEE
+ *             802.15.4 with the bits of each byte in reverse order,
+ *             this processes the most significant bit of each byte
+ *             first, as CRC-16/XMODEM and CRC-16/CCITT-FALSE do.
+ */
+unsigned short crc16_ccitt_add(unsigned char b, unsigned short crc);
+
+/**
+ * \brief      Calculate the CCITT CRC16 over a data area
+ * \param data Pointer to the data
+ * \param datalen The length of the data
+ * \param acc  The accumulated CRC that is to be updated (or zero).
+ * \return     The CRC16 checksum.
+ *
+ *             This is the CRC of crc16_ccitt_add() over a data area,
+ *             with the table selected by CRC16_CONF_TABLE.
+ */
+unsigned short crc16_ccitt_data(const unsigned char *data, int datalen,
+                                unsigned short acc);
+
 #endif /* CRC16_H_ */
 
 /** @} */
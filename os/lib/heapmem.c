@@ -104,6 +104,62 @@
 #define ALIGN(size)						\
   (((size) + (HEAPMEM_ALIGNMENT - 1)) & ~(HEAPMEM_ALIGNMENT - 1))
 
+/*
+ * The HEAPMEM_CONF_TLSF parameter selects how free chunks are
+ * managed. By default, all free chunks are kept on a single list,
+ * which is searched for a best fit within CHUNK_SEARCH_MAX chunks and
+ * defragmented lazily. When HEAPMEM_CONF_TLSF is set, free chunks are
+ * instead segregated into size classes in the manner of the
+ * Two-Level Segregated Fit (TLSF) allocator: a first level of
+ * power-of-two classes, each subdivided into 2^HEAPMEM_CONF_TLSF_SL_BITS
+ * linear classes. Two levels of bitmaps make it possible to find a
+ * suitable free chunk in constant time, and free chunks are
+ * immediately coalesced with their neighbors, which bounds the
+ * fragmentation of the heap. The cost is one additional pointer in
+ * each chunk and a table of free list heads.
+ */
+#ifdef HEAPMEM_CONF_TLSF
+#define HEAPMEM_TLSF HEAPMEM_CONF_TLSF
+#else
+#define HEAPMEM_TLSF 0
+#endif /* HEAPMEM_CONF_TLSF */
+
+#if HEAPMEM_TLSF
+#ifdef HEAPMEM_CONF_TLSF_SL_BITS
+#define SL_BITS HEAPMEM_CONF_TLSF_SL_BITS
+#else
+#define SL_BITS 3
+#endif /* HEAPMEM_CONF_TLSF_SL_BITS */
+
+#if SL_BITS < 1 || SL_BITS > 5
+#error HEAPMEM_CONF_TLSF_SL_BITS must be in the range [1, 5].
+#endif
+
+#define SL_COUNT (1 << SL_BITS)
+
+/* Chunks smaller than SMALL_SIZE are kept in first-level class 0, which
+   is divided into SL_COUNT classes of HEAPMEM_ALIGNMENT bytes each. */
+#define SMALL_SIZE (SL_COUNT * HEAPMEM_ALIGNMENT)
+
+/* The number of first-level classes that is needed to cover the arena. */
+#define FL_FITS(n) (HEAPMEM_ARENA_SIZE < ((size_t)SMALL_SIZE << (n)))
+#define FL_COUNT                                                         \
+  (FL_FITS(0) ? 1 : FL_FITS(1) ? 2 : FL_FITS(2) ? 3 : FL_FITS(3) ? 4 :   \
+   FL_FITS(4) ? 5 : FL_FITS(5) ? 6 : FL_FITS(6) ? 7 : FL_FITS(7) ? 8 :   \
+   FL_FITS(8) ? 9 : FL_FITS(9) ? 10 : FL_FITS(10) ? 11 :                 \
+   FL_FITS(11) ? 12 : FL_FITS(12) ? 13 : FL_FITS(13) ? 14 :              \
+   FL_FITS(14) ? 15 : FL_FITS(15) ? 16 : FL_FITS(16) ? 17 :              \
+   FL_FITS(17) ? 18 : FL_FITS(18) ? 19 : FL_FITS(19) ? 20 :              \
+   FL_FITS(20) ? 21 : FL_FITS(21) ? 22 : FL_FITS(22) ? 23 :              \
+   FL_FITS(23) ? 24 : 25)
+
+/* Index of the most significant set bit. */
+#define FLS(x) ((unsigned)(8 * sizeof(unsigned long) - 1) - \
+                (unsigned)__builtin_clzl((unsigned long)(x)))
+/* Index of the least significant set bit. */
+#define FFS(x) ((unsigned)__builtin_ctz(x))
+#endif /* HEAPMEM_TLSF */
+
 /* Macros for chunk iteration. */
 #define NEXT_CHUNK(chunk)						\
   ((chunk_t *)((char *)(chunk) + sizeof(chunk_t) + (chunk)->size))
@@ -158,11 +214,16 @@ static struct heapmem_zone zones[HEAPMEM_MAX_ZONES] = {
 /*
  * We use a double-linked list of chunks, with a slight space overhead
  * compared to a single-linked list, but with the advantage of having
- * much faster list removals.
+ * much faster list removals. The chunk header is aligned so that the
+ * data that follows it is aligned as well.
  */
-typedef struct chunk {
+typedef struct CC_ALIGN(HEAPMEM_ALIGNMENT) chunk {
   struct chunk *prev;
   struct chunk *next;
+#if HEAPMEM_TLSF
+  /* The chunk that precedes this one in memory, if any. */
+  struct chunk *prev_phys;
+#endif
   size_t size;
   uint8_t flags;
   heapmem_zone_t zone;
@@ -178,7 +239,15 @@ static char heap_base[HEAPMEM_ARENA_SIZE] CC_ALIGN(HEAPMEM_ALIGNMENT);
 static size_t heap_usage;
 static size_t max_heap_usage;
 
+#if HEAPMEM_TLSF
+static chunk_t *free_lists[FL_COUNT][SL_COUNT];
+static uint32_t fl_bitmap;
+static uint32_t sl_bitmap[FL_COUNT];
+/* The chunk that is located at the end of the heap footprint. */
+static chunk_t *last_chunk;
+#else
 static chunk_t *free_list;
+#endif /* HEAPMEM_TLSF */
 
 #define IN_HEAP(ptr) ((ptr) != NULL && \
                      (char *)(ptr) >= (char *)heap_base) && \
@@ -202,6 +271,108 @@ extend_space(size_t size)
   return old_usage;
 }
 
+#if HEAPMEM_TLSF
+/* mapping: Determine the size class of a chunk of the given size. */
+static void
+mapping(size_t size, unsigned *fl, unsigned *sl)
+{
+  if(size < SMALL_SIZE) {
+    *fl = 0;
+    *sl = size / HEAPMEM_ALIGNMENT;
+  } else {
+    unsigned msb = FLS(size);
+    *fl = msb - FLS(SMALL_SIZE) + 1;
+    *sl = (size >> (msb - SL_BITS)) & (SL_COUNT - 1);
+  }
+}
+
+/* set_prev_phys: Make the chunk following a chunk in memory refer
+   back to it. */
+static void
+set_prev_phys(chunk_t * const chunk)
+{
+  if(IS_LAST_CHUNK(chunk)) {
+    last_chunk = chunk;
+  } else {
+    NEXT_CHUNK(chunk)->prev_phys = chunk;
+  }
+}
+
+/* insert_free_chunk: Put a chunk on the free list of its size class. */
+static void
+insert_free_chunk(chunk_t * const chunk)
+{
+  unsigned fl, sl;
+
+  mapping(chunk->size, &fl, &sl);
+  chunk->prev = NULL;
+  chunk->next = free_lists[fl][sl];
+  if(chunk->next != NULL) {
+    chunk->next->prev = chunk;
+  }
+  free_lists[fl][sl] = chunk;
+  fl_bitmap |= 1UL << fl;
+  sl_bitmap[fl] |= 1UL << sl;
+}
+
+/* remove_chunk_from_free_list: Remove a chunk from the free list of
+   its size class. */
+static void
+remove_chunk_from_free_list(chunk_t * const chunk)
+{
+  unsigned fl, sl;
+
+  mapping(chunk->size, &fl, &sl);
+  if(chunk->next != NULL) {
+    chunk->next->prev = chunk->prev;
+  }
+  if(chunk->prev != NULL) {
+    chunk->prev->next = chunk->next;
+  } else {
+    free_lists[fl][sl] = chunk->next;
+    if(free_lists[fl][sl] == NULL) {
+      sl_bitmap[fl] &= ~(1UL << sl);
+      if(sl_bitmap[fl] == 0) {
+        fl_bitmap &= ~(1UL << fl);
+      }
+    }
+  }
+}
+
+/* free_chunk: Mark a chunk as being free, coalesce it with its free
+   neighbors, and put it on the free list. */
+static void
+free_chunk(chunk_t *chunk)
+{
+  chunk->flags &= ~CHUNK_FLAG_ALLOCATED;
+
+  if(!IS_LAST_CHUNK(chunk)) {
+    chunk_t *next = NEXT_CHUNK(chunk);
+    if(CHUNK_FREE(next)) {
+      remove_chunk_from_free_list(next);
+      chunk->size += sizeof(chunk_t) + next->size;
+    }
+  }
+
+  if(chunk->prev_phys != NULL && CHUNK_FREE(chunk->prev_phys)) {
+    chunk_t *prev = chunk->prev_phys;
+    remove_chunk_from_free_list(prev);
+    prev->size += sizeof(chunk_t) + chunk->size;
+    chunk = prev;
+  }
+
+  if(IS_LAST_CHUNK(chunk)) {
+    /* Release the chunk back into the wilderness. */
+    heap_usage -= sizeof(chunk_t) + chunk->size;
+    last_chunk = chunk->prev_phys;
+  } else {
+    NEXT_CHUNK(chunk)->prev_phys = chunk;
+    insert_free_chunk(chunk);
+  }
+}
+#else /* HEAPMEM_TLSF */
+#define set_prev_phys(chunk)
+
 /* free_chunk: Mark a chunk as being free, and put it on the free list. */
 static void
 free_chunk(chunk_t * const chunk)
@@ -240,6 +411,7 @@ remove_chunk_from_free_list(chunk_t * const chunk)
     chunk->next->prev = chunk->prev;
   }
 }
+#endif /* HEAPMEM_TLSF */
 
 /*
  * split_chunk: When allocating a chunk, we may have found one that is
@@ -255,6 +427,10 @@ split_chunk(chunk_t * const chunk, size_t offset)
     chunk_t *new_chunk = (chunk_t *)(GET_PTR(chunk) + offset);
     new_chunk->size = chunk->size - sizeof(chunk_t) - offset;
     new_chunk->flags = 0;
+#if HEAPMEM_TLSF
+    new_chunk->prev_phys = chunk;
+    set_prev_phys(new_chunk);
+#endif
     free_chunk(new_chunk);
 
     chunk->size = offset;
@@ -274,8 +450,50 @@ coalesce_chunks(chunk_t *chunk)
     LOG_DBG("Coalesce chunk of %zu bytes\n", next->size);
     remove_chunk_from_free_list(next);
   }
+  set_prev_phys(chunk);
 }
 
+#if HEAPMEM_TLSF
+/* get_free_chunk: Find a free chunk in the smallest size class that
+   is guaranteed to satisfy an allocation request. */
+static chunk_t *
+get_free_chunk(const size_t size)
+{
+  unsigned fl, sl;
+
+  /* Round the size up to the next class boundary, so that any chunk
+     in the class that is found is large enough. */
+  if(size < SMALL_SIZE) {
+    mapping(size, &fl, &sl);
+  } else {
+    mapping(size + ((size_t)1 << (FLS(size) - SL_BITS)) - 1, &fl, &sl);
+  }
+
+  if(fl >= FL_COUNT) {
+    return NULL;
+  }
+
+  uint32_t sl_map = sl_bitmap[fl] & (~0UL << sl);
+  if(sl_map == 0) {
+    uint32_t fl_map = fl + 1 < 32 ? fl_bitmap & (~0UL << (fl + 1)) : 0;
+    if(fl_map == 0) {
+      return NULL;
+    }
+    fl = FFS(fl_map);
+    sl_map = sl_bitmap[fl];
+  }
+  sl = FFS(sl_map);
+
+  chunk_t *chunk = free_lists[fl][sl];
+  remove_chunk_from_free_list(chunk);
+  /* Mark the chunk as allocated so that the remainder after splitting
+     is not coalesced with it. */
+  chunk->flags = CHUNK_FLAG_ALLOCATED;
+  split_chunk(chunk, size);
+
+  return chunk;
+}
+#else /* HEAPMEM_TLSF */
 /* defrag_chunks: Scan the free list for chunks that can be coalesced,
    and stop within a bounded time. */
 static void
@@ -329,6 +547,7 @@ get_free_chunk(const size_t size)
 
   return best;
 }
+#endif /* HEAPMEM_TLSF */
 
 /*
  * heapmem_zone_register: Register a new zone, which is essentially a
@@ -414,6 +633,10 @@ heapmem_zone_alloc(heapmem_zone_t zone, size_t size)
       return NULL;
     }
     chunk->size = size;
+#if HEAPMEM_TLSF
+    chunk->prev_phys = last_chunk;
+    last_chunk = chunk;
+#endif
   }
 
   chunk->flags = CHUNK_FLAG_ALLOCATED;
@@ -627,7 +850,10 @@ heapmem_stats(heapmem_stats_t *stats)
       stats->allocated += chunk->size;
       stats->overhead += sizeof(chunk_t);
     } else {
+#if !HEAPMEM_TLSF
+      /* Free chunks are always coalesced in TLSF mode. */
       coalesce_chunks(chunk);
+#endif
       stats->available += chunk->size;
     }
   }
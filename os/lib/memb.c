@@ -47,35 +47,129 @@
 #include "contiki.h"
 #include "lib/memb.h"
 
+#if MEMB_STATS
+/* All memory blocks that have been initialized. */
+static struct memb *memb_list;
+#endif /* MEMB_STATS */
+/*---------------------------------------------------------------------------*/
+#if MEMB_BITMAP
+#define BITMAP_WORDS(m) (((m)->num + MEMB_BITMAP_BITS - 1) / MEMB_BITMAP_BITS)
+#define BLOCK_IS_USED(m, i) \
+  (((m)->used[(i) / MEMB_BITMAP_BITS] >> ((i) % MEMB_BITMAP_BITS)) & 1)
+#define SET_BLOCK_USED(m, i) \
+  ((m)->used[(i) / MEMB_BITMAP_BITS] |= (memb_bitmap_t)1 << ((i) % MEMB_BITMAP_BITS))
+#define SET_BLOCK_FREE(m, i) \
+  ((m)->used[(i) / MEMB_BITMAP_BITS] &= ~((memb_bitmap_t)1 << ((i) % MEMB_BITMAP_BITS)))
+#endif /* MEMB_BITMAP */
 /*---------------------------------------------------------------------------*/
 void
 memb_init(struct memb *m)
 {
+#if MEMB_BITMAP
+  memset(m->used, 0, BITMAP_WORDS(m) * sizeof(memb_bitmap_t));
+#else
   memset(m->used, 0, m->num);
+#endif /* MEMB_BITMAP */
   memset(m->mem, 0, m->size * m->num);
+
+#if MEMB_STATS
+  memset(&m->stats, 0, sizeof(m->stats));
+  for(struct memb *other = memb_list; other != NULL; other = other->next) {
+    if(other == m) {
+      /* The block has been initialized before. */
+      return;
+    }
+  }
+  m->next = memb_list;
+  memb_list = m;
+#endif /* MEMB_STATS */
 }
 /*---------------------------------------------------------------------------*/
-void *
-memb_alloc(struct memb *m)
+#if MEMB_BITMAP
+static int
+find_free_block(struct memb *m)
+{
+  int words = BITMAP_WORDS(m);
+
+  for(int i = 0; i < words; i++) {
+    memb_bitmap_t free_bits = ~m->used[i];
+    if(free_bits != 0) {
+      int index = i * MEMB_BITMAP_BITS +
+        __builtin_ctzl((unsigned long)free_bits);
+      /* The unused bits of the last word are never set, so we must
+         check that the block is within the memory block. */
+      return index < m->num ? index : -1;
+    }
+  }
+  return -1;
+}
+#else /* MEMB_BITMAP */
+static int
+find_free_block(struct memb *m)
 {
   int i;
 
   for(i = 0; i < m->num; ++i) {
     if(m->used[i] == false) {
-      /* If this block was unused, we set the used flag on
-	 and return a pointer to the memory block. */
-      m->used[i] = true;
-      return (void *)((char *)m->mem + (i * m->size));
+      return i;
     }
   }
+  return -1;
+}
+#endif /* MEMB_BITMAP */
+/*---------------------------------------------------------------------------*/
+void *
+memb_alloc(struct memb *m)
+{
+  int i = find_free_block(m);
+
+  if(i < 0) {
+    /* No free block was found, so we return NULL to indicate failure to
+       allocate block. */
+#if MEMB_STATS
+    m->stats.alloc_failures++;
+#endif /* MEMB_STATS */
+    return NULL;
+  }
 
-  /* No free block was found, so we return NULL to indicate failure to
-     allocate block. */
-  return NULL;
+  /* If this block was unused, we set the used flag on
+     and return a pointer to the memory block. */
+#if MEMB_BITMAP
+  SET_BLOCK_USED(m, i);
+#else
+  m->used[i] = true;
+#endif /* MEMB_BITMAP */
+
+#if MEMB_STATS
+  if(++m->stats.allocated > m->stats.max_allocated) {
+    m->stats.max_allocated = m->stats.allocated;
+  }
+#endif /* MEMB_STATS */
+
+  return (void *)((char *)m->mem + (i * m->size));
 }
 /*---------------------------------------------------------------------------*/
-int
-memb_free(struct memb *m, void *ptr)
+#if MEMB_BITMAP
+static int
+free_block(struct memb *m, void *ptr)
+{
+  /* Locate the block directly from its offset in the memory block. */
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+
+  size_t offset = (char *)ptr - (char *)m->mem;
+  int i = offset / m->size;
+  if(offset % m->size != 0 || !BLOCK_IS_USED(m, i)) {
+    return -1;
+  }
+
+  SET_BLOCK_FREE(m, i);
+  return 0;
+}
+#else /* MEMB_BITMAP */
+static int
+free_block(struct memb *m, void *ptr)
 {
   int i;
   char *ptr2;
@@ -96,6 +190,23 @@ memb_free(struct memb *m, void *ptr)
   }
   return -1;
 }
+#endif /* MEMB_BITMAP */
+/*---------------------------------------------------------------------------*/
+int
+memb_free(struct memb *m, void *ptr)
+{
+  int ret = free_block(m, ptr);
+
+#if MEMB_STATS
+  if(ret == 0) {
+    m->stats.allocated--;
+  } else {
+    m->stats.free_failures++;
+  }
+#endif /* MEMB_STATS */
+
+  return ret;
+}
 /*---------------------------------------------------------------------------*/
 int
 memb_inmemb(struct memb *m, void *ptr)
@@ -110,12 +221,41 @@ memb_numfree(struct memb *m)
   int i;
   size_t num_free = 0;
 
+#if MEMB_BITMAP
+  num_free = m->num;
+  for(i = 0; i < BITMAP_WORDS(m); ++i) {
+    num_free -= __builtin_popcountl((unsigned long)m->used[i]);
+  }
+#else
   for(i = 0; i < m->num; ++i) {
     if(m->used[i] == false) {
       ++num_free;
     }
   }
+#endif /* MEMB_BITMAP */
 
   return num_free;
 }
+/*---------------------------------------------------------------------------*/
+#if MEMB_STATS
+void
+memb_stats(struct memb *m, memb_stats_t *stats)
+{
+  *stats = m->stats;
+}
+/*---------------------------------------------------------------------------*/
+void
+memb_stats_reset(struct memb *m)
+{
+  m->stats.max_allocated = m->stats.allocated;
+  m->stats.alloc_failures = 0;
+  m->stats.free_failures = 0;
+}
+/*---------------------------------------------------------------------------*/
+struct memb *
+memb_stats_list_head(void)
+{
+  return memb_list;
+}
+#endif /* MEMB_STATS */
 /** @} */
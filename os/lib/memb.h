@@ -64,9 +64,63 @@
 #define MEMB_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include "sys/cc.h"
 
+/**
+ * When MEMB_CONF_BITMAP is non-zero, the allocation state of the
+ * blocks is kept in a bitmap instead of an array of flags. Blocks
+ * are then allocated by locating the first zero bit with a single
+ * instruction per 32 blocks, and freed in constant time.
+ */
+#ifdef MEMB_CONF_BITMAP
+#define MEMB_BITMAP MEMB_CONF_BITMAP
+#else
+#define MEMB_BITMAP 0
+#endif /* MEMB_CONF_BITMAP */
+
+/**
+ * When MEMB_CONF_STATS is non-zero, each memory block keeps track of
+ * its current and maximum number of allocated blocks, as well as the
+ * number of failed allocations and deallocations. Memory blocks are
+ * registered in a list when initialized with memb_init(), so that
+ * the statistics of all of them can be inspected at runtime.
+ */
+#ifdef MEMB_CONF_STATS
+#define MEMB_STATS MEMB_CONF_STATS
+#else
+#define MEMB_STATS 0
+#endif /* MEMB_CONF_STATS */
+
+#if MEMB_BITMAP
+typedef uint32_t memb_bitmap_t;
+#define MEMB_BITMAP_BITS 32
+#define MEMB_USED_DECLARE(name, num) \
+        static memb_bitmap_t CC_CONCAT(name,_memb_used) \
+          [((num) + MEMB_BITMAP_BITS - 1) / MEMB_BITMAP_BITS]
+#else
+#define MEMB_USED_DECLARE(name, num) \
+        static bool CC_CONCAT(name,_memb_used)[num]
+#endif /* MEMB_BITMAP */
+
+#if MEMB_STATS
+typedef struct memb_stats {
+  /** The number of blocks that are currently allocated. */
+  unsigned short allocated;
+  /** The highest number of blocks that have been allocated at once. */
+  unsigned short max_allocated;
+  /** The number of allocations that failed because the block was full. */
+  unsigned short alloc_failures;
+  /** The number of attempts to free a block that was not allocated. */
+  unsigned short free_failures;
+} memb_stats_t;
+
+#define MEMB_STATS_INIT(name) , #name, NULL, { 0 }
+#else
+#define MEMB_STATS_INIT(name)
+#endif /* MEMB_STATS */
+
 /**
  * Declare a memory block.
  *
@@ -89,17 +143,27 @@ MEMB(connections, struct connection, 16);
  *
  */
 #define MEMB(name, structure, num) \
-        static bool CC_CONCAT(name,_memb_used)[num]; \
+        MEMB_USED_DECLARE(name, num); \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_used), \
-                                          (void *)CC_CONCAT(name,_memb_mem)}
+                                          (void *)CC_CONCAT(name,_memb_mem) \
+                                          MEMB_STATS_INIT(name)}
 
 struct memb {
   unsigned short size;
   unsigned short num;
+#if MEMB_BITMAP
+  memb_bitmap_t *used;
+#else
   bool *used;
+#endif /* MEMB_BITMAP */
   void *mem;
+#if MEMB_STATS
+  const char *name;
+  struct memb *next;
+  memb_stats_t stats;
+#endif /* MEMB_STATS */
 };
 
 /**
@@ -150,6 +214,31 @@ int memb_inmemb(struct memb *m, void *ptr);
  */
 size_t memb_numfree(struct memb *m);
 
+#if MEMB_STATS
+/**
+ * Get the allocation statistics of a memory block.
+ *
+ * \param m A set of memory blocks previously declared with MEMB().
+ *
+ * \param stats A pointer to a structure that will hold the statistics.
+ */
+void memb_stats(struct memb *m, memb_stats_t *stats);
+
+/**
+ * Reset the high-water mark and the failure counters of a memory block.
+ *
+ * \param m A set of memory blocks previously declared with MEMB().
+ */
+void memb_stats_reset(struct memb *m);
+
+/**
+ * Get the first memory block that has been initialized.
+ *
+ * \return The first memory block, or NULL if none has been initialized.
+ */
+struct memb *memb_stats_list_head(void);
+#endif /* MEMB_STATS */
+
 /** @} */
 /** @} */
 
@@ -44,82 +44,123 @@
 
 #include <string.h>
 #include "lib/ringbufindex.h"
+#include "sys/memory-barrier.h"
+
+/* The producer writes only ->put_ptr and the consumer only ->get_ptr.
+   The producer publishes elements with a barrier between writing them
+   and advancing ->put_ptr, and the consumer releases them with a barrier
+   between reading them and advancing ->get_ptr. */
 
 /* Initialize a ring buffer. The size must be a power of two */
 void
-ringbufindex_init(struct ringbufindex *r, uint8_t size)
+ringbufindex_init(struct ringbufindex *r, uint16_t size)
 {
   r->mask = size - 1;
   r->put_ptr = 0;
   r->get_ptr = 0;
 }
+/* The number of elements, from a single read of each pointer */
+static uint16_t
+elements(const struct ringbufindex *r, uint16_t put_ptr, uint16_t get_ptr)
+{
+  return (put_ptr - get_ptr) & r->mask;
+}
 /* Put one element to the ring buffer */
 int
 ringbufindex_put(struct ringbufindex *r)
 {
-  /* Check if buffer is full. If it is full, return 0 to indicate that
-     the element was not inserted.
-
-     XXX: there is a potential risk for a race condition here, because
-     the ->get_ptr field may be written concurrently by the
-     ringbufindex_get() function. To avoid this, access to ->get_ptr must
-     be atomic. We use an uint8_t type, which makes access atomic on
-     most platforms, but C does not guarantee this.
-   */
-  if(((r->put_ptr - r->get_ptr) & r->mask) == r->mask) {
-    return 0;
-  }
-  r->put_ptr = (r->put_ptr + 1) & r->mask;
-  return 1;
+  return ringbufindex_put_n(r, 1);
 }
 /* Check if there is space to put an element.
  * Return the index where the next element is to be added */
 int
 ringbufindex_peek_put(const struct ringbufindex *r)
 {
-  /* Check if there are bytes in the buffer. If so, we return the
-     first one. If there are no bytes left, we return -1.
-   */
-  if(((r->put_ptr - r->get_ptr) & r->mask) == r->mask) {
-    return -1;
-  }
-  return r->put_ptr;
+  uint16_t n = 1;
+
+  return ringbufindex_peek_put_n(r, &n);
 }
 /* Remove the first element and return its index */
 int
 ringbufindex_get(struct ringbufindex *r)
 {
-  int get_ptr;
+  uint16_t get_ptr = r->get_ptr;
 
-  /* Check if there are bytes in the buffer. If so, we return the
-     first one and increase the pointer. If there are no bytes left, we
-     return -1.
-
-     XXX: there is a potential risk for a race condition here, because
-     the ->put_ptr field may be written concurrently by the
-     ringbufindex_put() function. To avoid this, access to ->get_ptr must
-     be atomic. We use an uint8_t type, which makes access atomic on
-     most platforms, but C does not guarantee this.
-   */
-  if(((r->put_ptr - r->get_ptr) & r->mask) != 0) {
-    get_ptr = r->get_ptr;
-    r->get_ptr = (r->get_ptr + 1) & r->mask;
-    return get_ptr;
-  } else {
+  if(!ringbufindex_get_n(r, 1)) {
     return -1;
   }
+  return get_ptr;
 }
 /* Return the index of the first element
  * (which will be removed if calling ringbufindex_get) */
 int
 ringbufindex_peek_get(const struct ringbufindex *r)
 {
-  /* Check if there are bytes in the buffer. If so, we return the
-     first one. If there are no bytes left, we return -1.
-   */
-  if(((r->put_ptr - r->get_ptr) & r->mask) != 0) {
-    return r->get_ptr;
-  } else {
-    return -1;
+  uint16_t n = 1;
+
+  return ringbufindex_peek_get_n(r, &n);
+}
+/* Reserve up to *n contiguous free slots */
+int
+ringbufindex_peek_put_n(const struct ringbufindex *r, uint16_t *n)
+{
+  uint16_t put_ptr = r->put_ptr;
+  uint16_t count = r->mask - elements(r, put_ptr, r->get_ptr);
+
+  /* Stop at the end of the array. */
+  if(count > r->mask + 1 - put_ptr) {
+    count = r->mask + 1 - put_ptr;
+  }
+  if(count > *n) {
+    count = *n;
+  }
+  *n = count;
+  return count > 0 ? put_ptr : -1;
+}
+/* Put n elements that have been written to the reserved slots */
+int
+ringbufindex_put_n(struct ringbufindex *r, uint16_t n)
+{
+  uint16_t put_ptr = r->put_ptr;
+
+  if(n > r->mask - elements(r, put_ptr, r->get_ptr)) {
+    return 0;
   }
+  /* Make the elements visible before the consumer can see them. */
+  memory_barrier();
+  r->put_ptr = (put_ptr + n) & r->mask;
+  return 1;
+}
+/* Return the index of the first of up to *n contiguous elements */
+int
+ringbufindex_peek_get_n(const struct ringbufindex *r, uint16_t *n)
+{
+  uint16_t get_ptr = r->get_ptr;
+  uint16_t count = elements(r, r->put_ptr, get_ptr);
+
+  /* Stop at the end of the array. */
+  if(count > r->mask + 1 - get_ptr) {
+    count = r->mask + 1 - get_ptr;
+  }
+  if(count > *n) {
+    count = *n;
+  }
+  *n = count;
+  /* Read the elements only after reading ->put_ptr. */
+  memory_barrier();
+  return count > 0 ? get_ptr : -1;
+}
+/* Remove the first n elements */
+int
+ringbufindex_get_n(struct ringbufindex *r, uint16_t n)
+{
+  uint16_t get_ptr = r->get_ptr;
+
+  if(n > elements(r, r->put_ptr, get_ptr)) {
+    return 0;
+  }
+  /* Finish reading the elements before the producer can reuse them. */
+  memory_barrier();
+  r->get_ptr = (get_ptr + n) & r->mask;
+  return 1;
 }
@@ -43,17 +43,18 @@
 #include "contiki.h"
 
 struct ringbufindex {
-  uint8_t mask;
-  /* These must be 8-bit quantities to avoid race conditions. */
-  uint8_t put_ptr, get_ptr;
+  uint16_t mask;
+  /* These are read and written with single accesses by all supported
+     CPUs, so that one context can put while another one gets. */
+  uint16_t put_ptr, get_ptr;
 };
 
 /**
  * \brief Initialize a ring buffer. The size must be a power of two
  * \param r Pointer to ringbufindex
- * \param size Size of ring buffer
+ * \param size Size of ring buffer, at most 32768
  */
-void ringbufindex_init(struct ringbufindex *r, uint8_t size);
+void ringbufindex_init(struct ringbufindex *r, uint16_t size);
 
 /**
  * \brief Put one element to the ring buffer
@@ -88,6 +89,48 @@ int ringbufindex_get(struct ringbufindex *r);
  */
 int ringbufindex_peek_get(const struct ringbufindex *r);
 
+/**
+ * \brief Reserve contiguous space to put up to n elements. The elements
+ *        are added by ringbufindex_put_n once they have been written.
+ * \param r Pointer to ringbufindex
+ * \param n The number of elements to reserve. Set to the number of
+ *          elements reserved, which is less if the free space is smaller
+ *          or wraps around the end of the ring buffer.
+ * \retval >= 0 The index where the first element is to be added.
+ * \retval -1 Failure; the ring buffer is full
+ */
+int ringbufindex_peek_put_n(const struct ringbufindex *r, uint16_t *n);
+
+/**
+ * \brief Put n elements to the ring buffer at once
+ * \param r Pointer to ringbufindex
+ * \param n The number of elements
+ * \retval 0 Failure; there is not space for n elements
+ * \retval 1 Success; the elements are added
+ */
+int ringbufindex_put_n(struct ringbufindex *r, uint16_t n);
+
+/**
+ * \brief Return the index of the first of up to n contiguous elements,
+ *        which will be removed by calling ringbufindex_get_n.
+ * \param r Pointer to ringbufindex
+ * \param n The number of elements wanted. Set to the number of elements
+ *          available, which is less if the ring buffer holds fewer or
+ *          they wrap around the end of the ring buffer.
+ * \retval >= 0 The index of the first element
+ * \retval -1 No element in the ring buffer
+ */
+int ringbufindex_peek_get_n(const struct ringbufindex *r, uint16_t *n);
+
+/**
+ * \brief Remove the first n elements at once
+ * \param r Pointer to ringbufindex
+ * \param n The number of elements
+ * \retval 0 Failure; there are fewer than n elements
+ * \retval 1 Success; the elements are removed
+ */
+int ringbufindex_get_n(struct ringbufindex *r, uint16_t n);
+
 /**
  * \brief Return the ring buffer size
  * \param r Pinter to ringbufindex
@@ -120,7 +120,8 @@ PROCESS_THREAD(sensors_process, ev, data)
       events = 0;
       for(i = 0; i < num_sensors; ++i) {
 	if(sensors_flags[i] & FLAG_CHANGED) {
-	  if(process_post(PROCESS_BROADCAST, sensors_event, (void *)sensors[i]) == PROCESS_ERR_OK) {
+	  if(process_post_prio(PROCESS_BROADCAST, sensors_event, (void *)sensors[i],
+                               PROCESS_PRIO_LOW) == PROCESS_ERR_OK) {
 	    PROCESS_WAIT_EVENT_UNTIL(ev == sensors_event);
 	  }
 	  sensors_flags[i] &= ~FLAG_CHANGED;
@@ -167,7 +167,7 @@ static sha_256_checkpoint_t checkpoint;
  * the 512-bit input block to produce a new state.
  */
 static void
-transform(const uint8_t block[static SHA_256_BLOCK_SIZE])
+transform_block(const uint8_t block[static SHA_256_BLOCK_SIZE])
 {
   uint32_t W[64];
   uint32_t S[8];
@@ -225,6 +225,23 @@ transform(const uint8_t block[static SHA_256_BLOCK_SIZE])
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Transforms consecutive blocks, with the platform's implementation if it
+   has one. */
+static void
+transform(const uint8_t *blocks, size_t count)
+{
+#ifdef SHA_256_CONF_ARCH_TRANSFORM
+  if(SHA_256_CONF_ARCH_TRANSFORM(checkpoint.state, blocks, count)) {
+    return;
+  }
+#endif /* SHA_256_CONF_ARCH_TRANSFORM */
+
+  for(; count > 0; count--) {
+    transform_block(blocks);
+    blocks += SHA_256_BLOCK_SIZE;
+  }
+}
+/*---------------------------------------------------------------------------*/
 /* Add padding and terminating bit-count. */
 static void
 sha_256_pad(void)
@@ -243,7 +260,7 @@ sha_256_pad(void)
   } else {
     /* Finish the current block and mix. */
     memcpy(&checkpoint.buf[checkpoint.buf_len], PAD, SHA_256_BLOCK_SIZE - checkpoint.buf_len);
-    transform(checkpoint.buf);
+    transform(checkpoint.buf, 1);
 
     /* The start of the final block is all zeroes. */
     memset(&checkpoint.buf[0], 0, 56);
@@ -253,7 +270,7 @@ sha_256_pad(void)
   be64enc(&checkpoint.buf[56], checkpoint.bit_count);
 
   /* Mix in the final block. */
-  transform(checkpoint.buf);
+  transform(checkpoint.buf, 1);
 }
 /*---------------------------------------------------------------------------*/
 /* SHA-256 initialization. Begins a SHA-256 operation. */
@@ -298,17 +315,15 @@ update(const uint8_t *data, size_t len)
   memcpy(&checkpoint.buf[checkpoint.buf_len],
       data,
       SHA_256_BLOCK_SIZE - checkpoint.buf_len);
-  transform(checkpoint.buf);
+  transform(checkpoint.buf, 1);
   data += SHA_256_BLOCK_SIZE - checkpoint.buf_len;
   len -= SHA_256_BLOCK_SIZE - checkpoint.buf_len;
   checkpoint.buf_len = 0;
 
   /* Perform complete blocks */
-  while(len >= 64) {
-    transform(data);
-    data += SHA_256_BLOCK_SIZE;
-    len -= SHA_256_BLOCK_SIZE;
-  }
+  transform(data, len / SHA_256_BLOCK_SIZE);
+  data += len - len % SHA_256_BLOCK_SIZE;
+  len %= SHA_256_BLOCK_SIZE;
 
   /* Copy left over data into buffer */
   memcpy(checkpoint.buf, data, len);
@@ -353,47 +368,106 @@ sha_256_hash(const uint8_t *data, size_t len,
   SHA_256.finalize(digest);
 }
 /*---------------------------------------------------------------------------*/
+/*
+ * Starts a hash session with the inner (0x36) or outer (0x5c) key pad. The
+ * key must be at most SHA_256_BLOCK_SIZE bytes long.
+ */
 static void
-hmac_over_data_chunks(const uint8_t *key, size_t key_len,
-    struct data_chunk *chunks, uint_fast8_t chunks_count,
-    uint8_t hmac[static SHA_256_DIGEST_LENGTH])
+start_with_key_pad(const uint8_t *key, size_t key_len, uint8_t pad_byte)
 {
-  uint8_t hashed_key[SHA_256_DIGEST_LENGTH];
-  uint8_t ipad[SHA_256_BLOCK_SIZE];
-  uint8_t opad[SHA_256_BLOCK_SIZE];
+  uint8_t pad[SHA_256_BLOCK_SIZE];
   uint_fast8_t i;
-  uint_fast8_t j;
 
-  if(key_len > SHA_256_BLOCK_SIZE) {
-    SHA_256.hash(key, key_len, hashed_key);
-    key_len = SHA_256_DIGEST_LENGTH;
-    key = hashed_key;
-  }
   for(i = 0; i < key_len; i++) {
-    ipad[i] = key[i] ^ 0x36;
-    opad[i] = key[i] ^ 0x5c;
+    pad[i] = key[i] ^ pad_byte;
   }
   for(; i < SHA_256_BLOCK_SIZE; i++) {
-    ipad[i] = 0x36;
-    opad[i] = 0x5c;
+    pad[i] = pad_byte;
   }
-
   SHA_256.init();
-  SHA_256.update(ipad, SHA_256_BLOCK_SIZE);
+  SHA_256.update(pad, SHA_256_BLOCK_SIZE);
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_with_chunks(const struct data_chunk *chunks, uint_fast8_t chunks_count)
+{
+  uint_fast8_t j;
+
   for(j = 0; j < chunks_count; j++) {
     if(chunks[j].data && chunks[j].data_len) {
       SHA_256.update(chunks[j].data, chunks[j].data_len);
     }
   }
+}
+/*---------------------------------------------------------------------------*/
+static void
+hmac_over_data_chunks(const uint8_t *key, size_t key_len,
+    const struct data_chunk *chunks, uint_fast8_t chunks_count,
+    uint8_t hmac[static SHA_256_DIGEST_LENGTH])
+{
+  uint8_t hashed_key[SHA_256_DIGEST_LENGTH];
+
+  if(key_len > SHA_256_BLOCK_SIZE) {
+    SHA_256.hash(key, key_len, hashed_key);
+    key_len = SHA_256_DIGEST_LENGTH;
+    key = hashed_key;
+  }
+
+  start_with_key_pad(key, key_len, 0x36);
+  update_with_chunks(chunks, chunks_count);
   SHA_256.finalize(hmac);
 
-  SHA_256.init();
-  SHA_256.update(opad, SHA_256_BLOCK_SIZE);
+  start_with_key_pad(key, key_len, 0x5c);
+  SHA_256.update(hmac, SHA_256_DIGEST_LENGTH);
+  SHA_256.finalize(hmac);
+}
+/*---------------------------------------------------------------------------*/
+static void
+hmac_over_data_chunks_with_context(const sha_256_hmac_context_t *context,
+    const struct data_chunk *chunks, uint_fast8_t chunks_count,
+    uint8_t hmac[static SHA_256_DIGEST_LENGTH])
+{
+  SHA_256.restore_checkpoint(&context->inner);
+  update_with_chunks(chunks, chunks_count);
+  SHA_256.finalize(hmac);
+
+  SHA_256.restore_checkpoint(&context->outer);
   SHA_256.update(hmac, SHA_256_DIGEST_LENGTH);
   SHA_256.finalize(hmac);
 }
 /*---------------------------------------------------------------------------*/
 void
+sha_256_hmac_context_init(sha_256_hmac_context_t *context,
+    const uint8_t *key, size_t key_len)
+{
+  uint8_t hashed_key[SHA_256_DIGEST_LENGTH];
+
+  if(key_len > SHA_256_BLOCK_SIZE) {
+    SHA_256.hash(key, key_len, hashed_key);
+    key_len = SHA_256_DIGEST_LENGTH;
+    key = hashed_key;
+  }
+
+  start_with_key_pad(key, key_len, 0x36);
+  SHA_256.create_checkpoint(&context->inner);
+
+  start_with_key_pad(key, key_len, 0x5c);
+  SHA_256.create_checkpoint(&context->outer);
+}
+/*---------------------------------------------------------------------------*/
+void
+sha_256_hmac_with_context(const sha_256_hmac_context_t *context,
+    const uint8_t *data, size_t data_len,
+    uint8_t hmac[static SHA_256_DIGEST_LENGTH])
+{
+  struct data_chunk chunk;
+
+  chunk.data = data;
+  chunk.data_len = data_len;
+  hmac_over_data_chunks_with_context(context, &chunk, 1, hmac);
+}
+/*---------------------------------------------------------------------------*/
+void
 sha_256_hmac(const uint8_t *key, size_t key_len,
     const uint8_t *data, size_t data_len,
     uint8_t hmac[static SHA_256_DIGEST_LENGTH])
@@ -413,8 +487,9 @@ sha_256_hkdf_extract(const uint8_t *salt, size_t salt_len,
   sha_256_hmac(salt, salt_len, ikm, ikm_len, prk);
 }
 /*---------------------------------------------------------------------------*/
-void
-sha_256_hkdf_expand(const uint8_t *prk, size_t prk_len,
+static void
+hkdf_expand(const sha_256_hmac_context_t *context,
+    const uint8_t *prk, size_t prk_len,
     const uint8_t *info, size_t info_len,
     uint8_t *okm, uint_fast16_t okm_len)
 {
@@ -435,9 +510,15 @@ sha_256_hkdf_expand(const uint8_t *prk, size_t prk_len,
   chunks[2].data_len = 1;
 
   for(i = 1; i <= n; i++) {
-    hmac_over_data_chunks(prk, prk_len,
-        chunks + (i == 1), 3 - (i == 1),
-        t_i);
+    if(context) {
+      hmac_over_data_chunks_with_context(context,
+          chunks + (i == 1), 3 - (i == 1),
+          t_i);
+    } else {
+      hmac_over_data_chunks(prk, prk_len,
+          chunks + (i == 1), 3 - (i == 1),
+          t_i);
+    }
     memcpy(okm + ((i - 1) * SHA_256_DIGEST_LENGTH),
         t_i,
         MIN(SHA_256_DIGEST_LENGTH, okm_len));
@@ -446,6 +527,22 @@ sha_256_hkdf_expand(const uint8_t *prk, size_t prk_len,
 }
 /*---------------------------------------------------------------------------*/
 void
+sha_256_hkdf_expand(const uint8_t *prk, size_t prk_len,
+    const uint8_t *info, size_t info_len,
+    uint8_t *okm, uint_fast16_t okm_len)
+{
+  hkdf_expand(NULL, prk, prk_len, info, info_len, okm, okm_len);
+}
+/*---------------------------------------------------------------------------*/
+void
+sha_256_hkdf_expand_with_context(const sha_256_hmac_context_t *context,
+    const uint8_t *info, size_t info_len,
+    uint8_t *okm, uint_fast16_t okm_len)
+{
+  hkdf_expand(context, NULL, 0, info, info_len, okm, okm_len);
+}
+/*---------------------------------------------------------------------------*/
+void
 sha_256_hkdf(const uint8_t *salt, size_t salt_len,
     const uint8_t *ikm, size_t ikm_len,
     const uint8_t *info, size_t info_len,
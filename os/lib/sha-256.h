@@ -43,6 +43,7 @@
 #define SHA_256_H_
 
 #include "contiki.h"
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -62,6 +63,18 @@ typedef struct {
   size_t buf_len;
 } sha_256_checkpoint_t;
 
+/**
+ * Hash sessions that have already absorbed the inner and the outer key pad
+ * of an HMAC key. A context takes 2 * sizeof(sha_256_checkpoint_t), i.e.,
+ * more than 200 bytes, so keep it in static or long-lived memory rather
+ * than on the stack of a constrained device. The functions without a
+ * context need no more than 100 bytes of stack for the key pads.
+ */
+typedef struct {
+  sha_256_checkpoint_t inner;
+  sha_256_checkpoint_t outer;
+} sha_256_hmac_context_t;
+
 /**
  * Structure of SHA-256 drivers.
  */
@@ -125,6 +138,29 @@ void sha_256_hmac(const uint8_t *key, size_t key_len,
     const uint8_t *data, size_t data_len,
     uint8_t hmac[static SHA_256_DIGEST_LENGTH]);
 
+/**
+ * \brief Prepares for computing many HMACs with the same key.
+ * \param context where to store the precomputed key pads
+ * \param key     the key to authenticate with
+ * \param key_len length of key in bytes
+ */
+void sha_256_hmac_context_init(sha_256_hmac_context_t *context,
+    const uint8_t *key, size_t key_len);
+
+/**
+ * \brief Computes HMAC-SHA-256 with a precomputed key.
+ * \param context  the context prepared by sha_256_hmac_context_init
+ * \param data     the data to authenticate
+ * \param data_len length of data in bytes
+ * \param hmac     pointer to where the resulting HMAC shall be stored
+ *
+ *        This saves two of the four SHA-256 blocks that sha_256_hmac
+ *        processes for short messages.
+ */
+void sha_256_hmac_with_context(const sha_256_hmac_context_t *context,
+    const uint8_t *data, size_t data_len,
+    uint8_t hmac[static SHA_256_DIGEST_LENGTH]);
+
 /**
  * \brief Extracts a key as per RFC 5869.
  * \param salt     optional salt value
@@ -150,6 +186,22 @@ void sha_256_hkdf_expand(const uint8_t *prk, size_t prk_len,
       const uint8_t *info, size_t info_len,
       uint8_t *okm, uint_fast16_t okm_len);
 
+/**
+ * \brief Expands a key as per RFC 5869, with a precomputed key.
+ * \param context  the context prepared by sha_256_hmac_context_init with
+ *                 the pseudorandom key
+ * \param info     optional context and application specific information
+ * \param info_len length of info in bytes
+ * \param okm      output keying material
+ * \param okm_len  length of okm in bytes (<= 255 * SHA_256_DIGEST_LENGTH)
+ *
+ *        This saves two SHA-256 blocks per SHA_256_DIGEST_LENGTH bytes of
+ *        output.
+ */
+void sha_256_hkdf_expand_with_context(const sha_256_hmac_context_t *context,
+      const uint8_t *info, size_t info_len,
+      uint8_t *okm, uint_fast16_t okm_len);
+
 /**
  * \brief Performs both extraction and expansion as per RFC 5869.
  * \param salt     optional salt value
@@ -166,6 +218,20 @@ void sha_256_hkdf(const uint8_t *salt, size_t salt_len,
       const uint8_t *info, size_t info_len,
       uint8_t *okm, uint_fast16_t okm_len);
 
+#ifdef SHA_256_CONF_ARCH_TRANSFORM
+/**
+ * \brief Platform-specific SHA-256 compression function.
+ * \param state  the state to transform
+ * \param blocks consecutive input blocks
+ * \param count  number of input blocks
+ * \return       false if the generic implementation shall be used instead,
+ *                e.g., because the CPU lacks the required instructions
+ */
+bool SHA_256_CONF_ARCH_TRANSFORM(
+    uint32_t state[static SHA_256_DIGEST_LENGTH / sizeof(uint32_t)],
+    const uint8_t *blocks, size_t count);
+#endif /* SHA_256_CONF_ARCH_TRANSFORM */
+
 #endif /* SHA_256_H_ */
 
 /** @} */
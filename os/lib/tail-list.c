@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \addtogroup tail-list
+ * @{
+ *
+ * \file
+ *   Implementation of linked lists with a tail pointer
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "lib/tail-list.h"
+/*---------------------------------------------------------------------------*/
+struct list {
+  struct list *next;
+};
+/*---------------------------------------------------------------------------*/
+void
+tail_list_add(tail_list_t list, void *item)
+{
+  ((struct list *)item)->next = NULL;
+
+  if(list->tail == NULL) {
+    list->head = item;
+  } else {
+    ((struct list *)list->tail)->next = item;
+  }
+  list->tail = item;
+  list->length++;
+}
+/*---------------------------------------------------------------------------*/
+void
+tail_list_push(tail_list_t list, void *item)
+{
+  ((struct list *)item)->next = list->head;
+  list->head = item;
+  if(list->tail == NULL) {
+    list->tail = item;
+  }
+  list->length++;
+}
+/*---------------------------------------------------------------------------*/
+void
+tail_list_insert(tail_list_t list, void *previtem, void *newitem)
+{
+  if(previtem == NULL) {
+    tail_list_push(list, newitem);
+  } else {
+    ((struct list *)newitem)->next = ((struct list *)previtem)->next;
+    ((struct list *)previtem)->next = newitem;
+    if(list->tail == previtem) {
+      list->tail = newitem;
+    }
+    list->length++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void *
+tail_list_pop(tail_list_t list)
+{
+  struct list *l = list->head;
+
+  if(l != NULL) {
+    list->head = l->next;
+    if(list->head == NULL) {
+      list->tail = NULL;
+    }
+    l->next = NULL;
+    list->length--;
+  }
+
+  return l;
+}
+/*---------------------------------------------------------------------------*/
+void *
+tail_list_chop(tail_list_t list)
+{
+  struct list *l = list->tail;
+
+  if(l != NULL) {
+    tail_list_remove(list, l);
+  }
+
+  return l;
+}
+/*---------------------------------------------------------------------------*/
+void
+tail_list_remove(tail_list_t list, const void *item)
+{
+  struct list *l, *r;
+
+  r = NULL;
+  for(l = list->head; l != NULL; l = l->next) {
+    if(l == item) {
+      if(r == NULL) {
+        /* First on list */
+        list->head = l->next;
+      } else {
+        /* Not first on list */
+        r->next = l->next;
+      }
+      if(list->tail == l) {
+        list->tail = r;
+      }
+      l->next = NULL;
+      list->length--;
+      return;
+    }
+    r = l;
+  }
+}
+/*---------------------------------------------------------------------------*/
+bool
+tail_list_contains(const_tail_list_t list, const void *item)
+{
+  struct list *l;
+
+  for(l = list->head; l != NULL; l = l->next) {
+    if(l == item) {
+      return true;
+    }
+  }
+  return false;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
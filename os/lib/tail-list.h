@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/** \addtogroup data
+ * @{
+ *
+ * \defgroup tail-list Linked list with a tail pointer
+ *
+ * This library provides a singly-linked list that keeps track of its
+ * last element and of its length. Adding an element to either end of
+ * the list, and retrieving the last element or the length of the
+ * list, therefore takes constant time, whereas the corresponding
+ * operations on a \ref list have to traverse the whole list. The
+ * cost is that each list requires two more words of memory.
+ *
+ * A list is declared using the TAIL_LIST macro, or the
+ * TAIL_LIST_STRUCT macro inside a structure. Elements must be
+ * allocated by the calling code and must be of a C struct
+ * datatype. In this struct, the first field must be a pointer called
+ * \e next. This field will be used by the library to maintain the
+ * list. Application code must not modify this field directly.
+ *
+ * Unlike list_add() and list_push(), the functions that add an
+ * element to this type of list do not search the list for the
+ * element in order to remove it first. Callers must ensure that an
+ * element is not on the list before adding it.
+ *
+ * This library is not safe to be used within an interrupt context.
+ * @{
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef TAIL_LIST_H_
+#define TAIL_LIST_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "lib/list.h"
+
+#include <stdbool.h>
+/*---------------------------------------------------------------------------*/
+struct tail_list {
+  void *head;
+  void *tail;
+  unsigned short length;
+};
+
+/**
+ * The linked list type.
+ */
+typedef struct tail_list *tail_list_t;
+
+/**
+ * The non-modifiable linked list type.
+ */
+typedef const struct tail_list *const_tail_list_t;
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Declare a linked list with a tail pointer.
+ * \param name The name of the list.
+ */
+#define TAIL_LIST(name) \
+  static struct tail_list LIST_CONCAT(name,_tail_list); \
+  static tail_list_t name = &LIST_CONCAT(name,_tail_list)
+
+/**
+ * \brief Declare a linked list with a tail pointer inside a structure.
+ * \param name The name of the list.
+ *
+ * The list must be initialized with TAIL_LIST_STRUCT_INIT() before
+ * it is used.
+ */
+#define TAIL_LIST_STRUCT(name) \
+  struct tail_list LIST_CONCAT(name,_tail_list); \
+  tail_list_t name
+
+/**
+ * \brief Initialize a linked list that is part of a structure.
+ * \param struct_ptr A pointer to the struct
+ * \param name The name of the list.
+ */
+#define TAIL_LIST_STRUCT_INIT(struct_ptr, name)                              \
+  do {                                                                       \
+    (struct_ptr)->name = &((struct_ptr)->LIST_CONCAT(name,_tail_list));      \
+    tail_list_init((struct_ptr)->name);                                      \
+  } while(0)
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief Initialize a list.
+ * \param list The list.
+ */
+static inline void
+tail_list_init(tail_list_t list)
+{
+  list->head = list->tail = NULL;
+  list->length = 0;
+}
+
+/**
+ * \brief Get the first element of a list.
+ * \param list The list.
+ * \return A pointer to the first element, or NULL if the list is empty.
+ */
+static inline void *
+tail_list_head(const_tail_list_t list)
+{
+  return list->head;
+}
+
+/**
+ * \brief Get the last element of a list.
+ * \param list The list.
+ * \return A pointer to the last element, or NULL if the list is empty.
+ */
+static inline void *
+tail_list_tail(const_tail_list_t list)
+{
+  return list->tail;
+}
+
+/**
+ * \brief Get the number of elements on a list.
+ * \param list The list.
+ * \return The length of the list.
+ */
+static inline int
+tail_list_length(const_tail_list_t list)
+{
+  return list->length;
+}
+
+/**
+ * \brief Get the element following an element on a list.
+ * \param item A list element.
+ * \return The next element, or NULL if there are no more elements.
+ */
+static inline void *
+tail_list_item_next(const void *item)
+{
+  return list_item_next(item);
+}
+
+/**
+ * \brief Add an element to the end of a list.
+ * \param list The list.
+ * \param item The element, which must not already be on the list.
+ */
+void tail_list_add(tail_list_t list, void *item);
+
+/**
+ * \brief Add an element to the start of a list.
+ * \param list The list.
+ * \param item The element, which must not already be on the list.
+ */
+void tail_list_push(tail_list_t list, void *item);
+
+/**
+ * \brief Insert an element after another element on a list.
+ * \param list The list.
+ * \param previtem The element after which the new element is inserted,
+ *                 or NULL to insert the new element at the start.
+ * \param newitem The element, which must not already be on the list.
+ */
+void tail_list_insert(tail_list_t list, void *previtem, void *newitem);
+
+/**
+ * \brief Remove the first element of a list.
+ * \param list The list.
+ * \return The removed element, or NULL if the list was empty.
+ */
+void *tail_list_pop(tail_list_t list);
+
+/**
+ * \brief Remove the last element of a list.
+ * \param list The list.
+ * \return The removed element, or NULL if the list was empty.
+ *
+ * This function traverses the list to find the new last element.
+ */
+void *tail_list_chop(tail_list_t list);
+
+/**
+ * \brief Remove an element from a list.
+ * \param list The list.
+ * \param item The element to remove. Nothing happens if the element is
+ *             not on the list.
+ */
+void tail_list_remove(tail_list_t list, const void *item);
+
+/**
+ * \brief Check whether a list contains an element.
+ * \param list The list.
+ * \param item The element.
+ * \retval true The list contains the element
+ * \retval false The list does not contain the element
+ */
+bool tail_list_contains(const_tail_list_t list, const void *item);
+/*---------------------------------------------------------------------------*/
+#endif /* TAIL_LIST_H_ */
+/*---------------------------------------------------------------------------*/
+/**
+ * @}
+ * @}
+ */
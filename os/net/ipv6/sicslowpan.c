@@ -73,6 +73,9 @@
 #include "net/netstack.h"
 #include "net/packetbuf.h"
 #include "net/queuebuf.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+#include "sys/ctimer.h"
 
 #include "net/routing/routing.h"
 
@@ -95,6 +98,12 @@
 #define PACKETBUF_FRAG_TAG           2   /* 16 bit */
 #define PACKETBUF_FRAG_OFFSET        4   /* 8 bit */
 
+#define PACKETBUF_RFRAG_DISPATCH     0   /* 8 bit */
+#define PACKETBUF_RFRAG_TAG          1   /* 8 bit */
+#define PACKETBUF_RFRAG_SEQ_SIZE     2   /* 16 bit */
+#define PACKETBUF_RFRAG_OFFSET       4   /* 16 bit */
+#define PACKETBUF_RFRAG_ACK_BITMAP   2   /* 32 bit */
+
 /* define the buffer as a byte array */
 #define PACKETBUF_IPHC_BUF              ((uint8_t *)(packetbuf_ptr + packetbuf_hdr_len))
 #define PACKETBUF_PAYLOAD_END           ((uint8_t *)(packetbuf_ptr + mac_max_payload))
@@ -189,6 +198,13 @@ static int mac_max_payload;
  */
 static uint8_t curr_page;
 
+/**
+ * The length of the 6lowpan packet at packetbuf_ptr that is being
+ * uncompressed: the received frame, or a datagram reassembled from
+ * recoverable fragments (RFC 8931).
+ */
+static uint16_t input_len;
+
 /**
  * the result of the last transmitted fragment
  */
@@ -202,6 +218,14 @@ static int last_tx_status;
 #if SICSLOWPAN_CONF_FRAG
 static uint16_t my_tag;
 
+#if SICSLOWPAN_FRAG_FORWARD && !SICSLOWPAN_REASS_DIRECT
+#error SICSLOWPAN_CONF_FRAG_FORWARD requires SICSLOWPAN_CONF_REASS_DIRECT.
+#endif
+
+#if SICSLOWPAN_RFRAG && !SICSLOWPAN_REASS_DIRECT
+#error SICSLOWPAN_CONF_RFRAG requires SICSLOWPAN_CONF_REASS_DIRECT.
+#endif
+
 /** The total length of the IPv6 packet in the sicslowpan_buf. */
 
 /* This needs to be defined in NBR / Nodes depending on available RAM   */
@@ -236,6 +260,404 @@ static uint16_t my_tag;
 #error Too large SICSLOWPAN_FRAGMENT_SIZE set.
 #endif
 
+#if SICSLOWPAN_REASS_DIRECT
+/* The size of the buffer that each datagram is reassembled in */
+#ifdef SICSLOWPAN_CONF_REASS_BUF_SIZE
+#define SICSLOWPAN_REASS_BUF_SIZE SICSLOWPAN_CONF_REASS_BUF_SIZE
+#else
+#define SICSLOWPAN_REASS_BUF_SIZE UIP_BUFSIZE
+#endif
+
+/* Complete datagrams are moved into uip_buf */
+#if SICSLOWPAN_REASS_BUF_SIZE > UIP_BUFSIZE
+#error SICSLOWPAN_REASS_BUF_SIZE must not exceed UIP_BUFSIZE.
+#endif
+
+#if SICSLOWPAN_FRAG_FORWARD
+/* The number of datagrams that can be forwarded concurrently */
+#ifdef SICSLOWPAN_CONF_VRB_ENTRIES
+#define SICSLOWPAN_VRB_ENTRIES SICSLOWPAN_CONF_VRB_ENTRIES
+#else
+#define SICSLOWPAN_VRB_ENTRIES 4
+#endif
+
+/* Forwarded datagrams are at most one link MTU long */
+#define SICSLOWPAN_VRB_UNITS ((UIP_LINK_MTU + 7) / 8)
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+
+#if SICSLOWPAN_RFRAG
+/* The number of datagrams that can wait for an RFRAG-ACK */
+#ifdef SICSLOWPAN_CONF_RFRAG_TX_ENTRIES
+#define SICSLOWPAN_RFRAG_TX_ENTRIES SICSLOWPAN_CONF_RFRAG_TX_ENTRIES
+#else
+#define SICSLOWPAN_RFRAG_TX_ENTRIES 1
+#endif
+
+/* How long to wait for an RFRAG-ACK before asking for one again */
+#ifdef SICSLOWPAN_CONF_RFRAG_ACK_TIMEOUT
+#define SICSLOWPAN_RFRAG_ACK_TIMEOUT SICSLOWPAN_CONF_RFRAG_ACK_TIMEOUT
+#else
+#define SICSLOWPAN_RFRAG_ACK_TIMEOUT (CLOCK_SECOND / 2)
+#endif
+
+/* How many times fragments are sent again before the datagram is
+   aborted */
+#ifdef SICSLOWPAN_CONF_RFRAG_MAX_RETRIES
+#define SICSLOWPAN_RFRAG_MAX_RETRIES SICSLOWPAN_CONF_RFRAG_MAX_RETRIES
+#else
+#define SICSLOWPAN_RFRAG_MAX_RETRIES 3
+#endif
+
+/* Room left in the first fragment for the compressed header to grow
+   when the datagram is forwarded, such as by an inline hop limit */
+#define SICSLOWPAN_RFRAG_HEADROOM 4
+
+/* The bit of a fragment in an RFRAG-ACK bitmap, the first fragment
+   being the most significant one */
+#define RFRAG_BIT(seq) (0x80000000UL >> (seq))
+#endif /* SICSLOWPAN_RFRAG */
+
+/* Reception is tracked in units of 8 bytes, like fragment offsets */
+#define SICSLOWPAN_REASS_UNITS ((SICSLOWPAN_REASS_BUF_SIZE + 7) / 8)
+
+/* A datagram being reassembled */
+struct sicslowpan_reass {
+  struct sicslowpan_reass *next;
+  /** The source address of the fragments being merged */
+  linkaddr_t sender;
+  /** The tag in the fragments being merged */
+  uint16_t tag;
+  /** Total length of the datagram */
+  uint16_t len;
+  /** Number of 8-byte units received so far */
+  uint16_t received_units;
+  /** Reassembly %process %timer. */
+  struct timer reass_timer;
+  /** One bit for each 8-byte unit of the datagram that has been received */
+  uint8_t received[(SICSLOWPAN_REASS_UNITS + 7) / 8];
+#if SICSLOWPAN_RFRAG
+  /** Whether the datagram comes in recoverable fragments. The buffer
+      then holds the compressed datagram, and len is 0 until the first
+      fragment tells it. */
+  bool rfrag;
+  /** One bit for each recoverable fragment received */
+  uint32_t rfrag_bitmap;
+  /** Number of bytes received in recoverable fragments */
+  uint16_t rfrag_received;
+#endif /* SICSLOWPAN_RFRAG */
+  /** The datagram, with the header uncompressed */
+  uint8_t buf[SICSLOWPAN_REASS_BUF_SIZE];
+};
+
+MEMB(reass_memb, struct sicslowpan_reass, SICSLOWPAN_REASS_CONTEXTS);
+/* The datagrams being reassembled, oldest first */
+LIST(reass_list);
+static sicslowpan_reass_stats_t reass_stats;
+
+/*---------------------------------------------------------------------------*/
+static void
+reass_free(struct sicslowpan_reass *r)
+{
+  list_remove(reass_list, r);
+  memb_free(&reass_memb, r);
+}
+/*---------------------------------------------------------------------------*/
+/* Drop the datagrams that were not completed in time. They all live
+   equally long, so the expired ones are at the head of the list. */
+static void
+reass_timeout(void)
+{
+  struct sicslowpan_reass *r;
+
+  while((r = list_head(reass_list)) != NULL &&
+        timer_expired(&r->reass_timer)) {
+    LOG_WARN("reassembly: timeout - tag: %d\n", r->tag);
+    reass_free(r);
+    reass_stats.timed_out++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct sicslowpan_reass *
+reass_find(const linkaddr_t *sender, uint16_t tag, bool rfrag)
+{
+  struct sicslowpan_reass *r;
+
+  for(r = list_head(reass_list); r != NULL; r = list_item_next(r)) {
+#if SICSLOWPAN_RFRAG
+    /* RFC 4944 and recoverable fragments have separate tags */
+    if(r->rfrag != rfrag) {
+      continue;
+    }
+#endif /* SICSLOWPAN_RFRAG */
+    if(r->tag == tag && linkaddr_cmp(&r->sender, sender)) {
+      return r;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Allocate a buffer for a new datagram. If all are in use and evict is
+   set, the oldest datagram is dropped to make room. */
+static struct sicslowpan_reass *
+reass_alloc(const linkaddr_t *sender, uint16_t tag, uint16_t len, bool evict)
+{
+  struct sicslowpan_reass *r;
+
+  reass_timeout();
+  r = memb_alloc(&reass_memb);
+  if(r == NULL) {
+    if(!evict) {
+      LOG_WARN("reassembly: no free buffer for tag: %d\n", tag);
+      reass_stats.dropped++;
+      return NULL;
+    }
+    /* Make room by dropping the oldest datagram */
+    r = list_pop(reass_list);
+    if(r == NULL) {
+      return NULL;
+    }
+    LOG_WARN("reassembly: evicting tag: %d for tag: %d\n", r->tag, tag);
+    reass_stats.evicted++;
+  }
+
+  linkaddr_copy(&r->sender, sender);
+  r->tag = tag;
+  r->len = len;
+  r->received_units = 0;
+  memset(r->received, 0, sizeof(r->received));
+#if SICSLOWPAN_RFRAG
+  r->rfrag = false;
+  r->rfrag_bitmap = 0;
+  r->rfrag_received = 0;
+#endif /* SICSLOWPAN_RFRAG */
+  timer_set(&r->reass_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+  list_add(reass_list, r);
+  reass_stats.started++;
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+/* Find the datagram that the fragment in packetbuf belongs to, or
+   allocate a buffer for it. Any fragment can start a reassembly, but
+   only a first fragment may evict another datagram. A subsequent
+   fragment that arrives first could otherwise take the buffer of a
+   datagram that is about to complete. */
+static struct sicslowpan_reass *
+reass_lookup(uint16_t tag, uint16_t frag_size, bool first)
+{
+  const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  struct sicslowpan_reass *r;
+
+  r = reass_find(sender, tag, false);
+  if(r != NULL) {
+    if(r->len != frag_size) {
+      LOG_WARN("reassembly: size mismatch - tag: %d\n", tag);
+      reass_stats.dropped++;
+      return NULL;
+    }
+    return r;
+  }
+
+  if(frag_size == 0 || frag_size > SICSLOWPAN_REASS_BUF_SIZE) {
+    LOG_WARN("reassembly: unacceptable size %d - tag: %d\n", frag_size, tag);
+    reass_stats.dropped++;
+    return NULL;
+  }
+
+  return reass_alloc(sender, tag, frag_size, first);
+}
+/*---------------------------------------------------------------------------*/
+/* Whether no fragment of a datagram has been placed in its buffer yet */
+static bool
+reass_empty(const struct sicslowpan_reass *r)
+{
+#if SICSLOWPAN_RFRAG
+  if(r->rfrag) {
+    return r->rfrag_bitmap == 0;
+  }
+#endif /* SICSLOWPAN_RFRAG */
+  return r->received_units == 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Drop a bad fragment of a datagram. A bad first fragment drops the
+   datagram, as does any fragment that was to start it. */
+static void
+reass_drop_fragment(struct sicslowpan_reass *r, bool first)
+{
+  if(r == NULL) {
+    return;
+  }
+  reass_stats.dropped++;
+  if(first || reass_empty(r)) {
+    reass_free(r);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Set the bits of the 8-byte units that len bytes at offset cover in a
+   datagram of datagram_len bytes, and return how many were not set. */
+static uint16_t
+units_set(uint8_t *units, uint16_t datagram_len, uint16_t offset, uint16_t len)
+{
+  uint16_t unit;
+  uint16_t end;
+  uint16_t new_units;
+
+  /* Only the last fragment may end in the middle of a unit */
+  end = offset + len >= datagram_len ?
+    (datagram_len + 7) / 8 : (offset + len) / 8;
+  new_units = 0;
+  for(unit = offset / 8; unit < end; unit++) {
+    if(!(units[unit / 8] & (1 << (unit % 8)))) {
+      units[unit / 8] |= 1 << (unit % 8);
+      new_units++;
+    }
+  }
+  return new_units;
+}
+/*---------------------------------------------------------------------------*/
+/* Record that len bytes at offset have been placed in the buffer, and
+   return true if the datagram is complete. */
+static bool
+reass_add(struct sicslowpan_reass *r, uint16_t offset, uint16_t len)
+{
+  uint16_t new_units;
+
+  new_units = units_set(r->received, r->len, offset, len);
+  if(new_units == 0) {
+    reass_stats.duplicates++;
+  }
+  r->received_units += new_units;
+
+  return r->received_units == (r->len + 7) / 8;
+}
+/*---------------------------------------------------------------------------*/
+/* Move a complete datagram into uip */
+static void
+reass_deliver(struct sicslowpan_reass *r)
+{
+  memcpy((uint8_t *)UIP_IP_BUF, r->buf, r->len);
+  reass_free(r);
+  reass_stats.completed++;
+}
+#if SICSLOWPAN_RFRAG
+/*---------------------------------------------------------------------------*/
+/* Give a datagram that is still making progress a new lifetime. It then
+   lives the longest, so it moves to the tail of the list. */
+static void
+reass_refresh(struct sicslowpan_reass *r)
+{
+  timer_restart(&r->reass_timer);
+  list_remove(reass_list, r);
+  list_add(reass_list, r);
+}
+#endif /* SICSLOWPAN_RFRAG */
+/*---------------------------------------------------------------------------*/
+#if SICSLOWPAN_FRAG_FORWARD
+/* A virtual reassembly buffer, which tells where to forward the fragments
+   of a datagram */
+struct sicslowpan_vrb {
+  struct sicslowpan_vrb *next;
+  /** The previous hop, and the tag that it uses for the datagram */
+  linkaddr_t sender;
+  uint16_t tag;
+  /** The next hop, and the tag that we use for the datagram */
+  linkaddr_t nexthop;
+  uint16_t out_tag;
+  /** Total length of the datagram */
+  uint16_t len;
+  /** Number of 8-byte units of the datagram forwarded so far */
+  uint16_t forwarded_units;
+  /** Forwarding %timer */
+  struct timer vrb_timer;
+  /** One bit for each 8-byte unit of the datagram that has been forwarded */
+  uint8_t forwarded[(SICSLOWPAN_VRB_UNITS + 7) / 8];
+#if SICSLOWPAN_RFRAG
+  /** Whether the datagram comes in recoverable fragments */
+  bool rfrag;
+  /** How much the compressed header grew when it was forwarded. The
+      offsets of the recoverable fragments that follow the first one
+      are shifted by as much. */
+  int16_t offset_delta;
+#endif /* SICSLOWPAN_RFRAG */
+};
+
+MEMB(vrb_memb, struct sicslowpan_vrb, SICSLOWPAN_VRB_ENTRIES);
+/* The datagrams being forwarded, oldest first */
+LIST(vrb_list);
+/*---------------------------------------------------------------------------*/
+static void
+vrb_free(struct sicslowpan_vrb *v)
+{
+  list_remove(vrb_list, v);
+  memb_free(&vrb_memb, v);
+}
+/*---------------------------------------------------------------------------*/
+static struct sicslowpan_vrb *
+vrb_find(const linkaddr_t *sender, uint16_t tag, bool rfrag)
+{
+  struct sicslowpan_vrb *v;
+
+  for(v = list_head(vrb_list); v != NULL; v = list_item_next(v)) {
+#if SICSLOWPAN_RFRAG
+    if(v->rfrag != rfrag) {
+      continue;
+    }
+#endif /* SICSLOWPAN_RFRAG */
+    if(v->tag == tag && linkaddr_cmp(&v->sender, sender)) {
+      return v;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static struct sicslowpan_vrb *
+vrb_alloc(void)
+{
+  struct sicslowpan_vrb *v;
+
+  /* Drop the entries of datagrams that were not forwarded completely in
+     time. As for reassembly, these are at the head of the list. */
+  while((v = list_head(vrb_list)) != NULL && timer_expired(&v->vrb_timer)) {
+    LOG_WARN("forwarding: timeout - tag: %d\n", v->tag);
+    vrb_free(v);
+  }
+
+  v = memb_alloc(&vrb_memb);
+  if(v != NULL) {
+    v->forwarded_units = 0;
+    memset(v->forwarded, 0, sizeof(v->forwarded));
+#if SICSLOWPAN_RFRAG
+    v->rfrag = false;
+    v->offset_delta = 0;
+#endif /* SICSLOWPAN_RFRAG */
+    timer_set(&v->vrb_timer, SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16);
+    list_add(vrb_list, v);
+  }
+  return v;
+}
+#if SICSLOWPAN_RFRAG
+/*---------------------------------------------------------------------------*/
+static void
+vrb_refresh(struct sicslowpan_vrb *v)
+{
+  timer_restart(&v->vrb_timer);
+  list_remove(vrb_list, v);
+  list_add(vrb_list, v);
+}
+#endif /* SICSLOWPAN_RFRAG */
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+/*---------------------------------------------------------------------------*/
+void
+sicslowpan_reass_stats(sicslowpan_reass_stats_t *stats)
+{
+  memcpy(stats, &reass_stats, sizeof(*stats));
+}
+/*---------------------------------------------------------------------------*/
+void
+sicslowpan_reass_stats_reset(void)
+{
+  memset(&reass_stats, 0, sizeof(reass_stats));
+}
+#else /* SICSLOWPAN_REASS_DIRECT */
 /* Assuming that the worst growth for uncompression is 38 bytes */
 #define SICSLOWPAN_FIRST_FRAGMENT_SIZE (SICSLOWPAN_FRAGMENT_SIZE + 38)
 
@@ -446,6 +868,7 @@ copy_frags2uip(int context)
 
   return true;
 }
+#endif /* SICSLOWPAN_REASS_DIRECT */
 #endif /* SICSLOWPAN_CONF_FRAG */
 
 /* -------------------------------------------------------------------------- */
@@ -504,11 +927,24 @@ set_packet_attrs(void)
  *  @{
  */
 
-/** Addresses contexts for IPHC. */
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 16
+#error SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS must not exceed 16.
+#endif
+
+/** Addresses contexts for IPHC, indexed by their number. */
 #if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
 static struct sicslowpan_addr_context
 addr_contexts[SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS];
-#endif
+
+#if SICSLOWPAN_ADDR_CONTEXT_INDEX
+/* Twice as many hash buckets as contexts, each holding the number of the
+   first context in it plus one, or 0 if it is empty */
+#define CONTEXT_HASH_SIZE 32
+static uint8_t context_hash_buckets[CONTEXT_HASH_SIZE];
+/* The next context in the same bucket, in the same way */
+static uint8_t context_hash_next[SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS];
+#endif /* SICSLOWPAN_ADDR_CONTEXT_INDEX */
+#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
 
 /** pointer to the byte where to write next inline field. */
 static uint8_t *iphc_ptr;
@@ -546,6 +982,56 @@ static const uint8_t ttl_values[] = {0, 1, 64, 255};
 /*--------------------------------------------------------------------*/
 /** \name IPHC related functions
  * @{                                                                 */
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 && SICSLOWPAN_ADDR_CONTEXT_INDEX
+/*--------------------------------------------------------------------*/
+/* Get the hash bucket of a 64-bit prefix */
+static unsigned
+context_hash_bucket(const uint8_t *prefix)
+{
+  /* FNV-1a over all bytes of the prefix */
+  uint32_t hash = 2166136261UL;
+  for(int i = 0; i < 8; i++) {
+    hash = (hash ^ prefix[i]) * 16777619UL;
+  }
+  return (hash ^ (hash >> 16)) & (CONTEXT_HASH_SIZE - 1);
+}
+/*--------------------------------------------------------------------*/
+static void
+context_hash_insert(uint8_t number)
+{
+  unsigned bucket = context_hash_bucket(addr_contexts[number].prefix);
+  context_hash_next[number] = context_hash_buckets[bucket];
+  context_hash_buckets[bucket] = number + 1;
+}
+/*--------------------------------------------------------------------*/
+static void
+context_hash_remove(uint8_t number)
+{
+  uint8_t *l;
+  for(l = &context_hash_buckets[context_hash_bucket(addr_contexts[number].prefix)];
+      *l != 0; l = &context_hash_next[*l - 1]) {
+    if(*l == number + 1) {
+      *l = context_hash_next[number];
+      return;
+    }
+  }
+}
+#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 && SICSLOWPAN_ADDR_CONTEXT_INDEX */
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+/*--------------------------------------------------------------------*/
+/* Check that a context has not expired, and remove it if it has */
+static bool
+addr_context_valid(struct sicslowpan_addr_context *context)
+{
+  if(context->expiration != 0 &&
+     (long)(clock_seconds() - context->expiration) >= 0) {
+    LOG_INFO("address context %u expired\n", context->number);
+    sicslowpan_addr_context_rm(context->number);
+    return false;
+  }
+  return true;
+}
+#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
 /*--------------------------------------------------------------------*/
 /** \brief find the context corresponding to prefix ipaddr */
 static struct sicslowpan_addr_context*
@@ -553,11 +1039,22 @@ addr_context_lookup_by_prefix(uip_ipaddr_t *ipaddr)
 {
 /* Remove code to avoid warnings and save flash if no context is used */
 #if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+  struct sicslowpan_addr_context *context;
+#if SICSLOWPAN_ADDR_CONTEXT_INDEX
+  uint8_t i;
+  for(i = context_hash_buckets[context_hash_bucket(ipaddr->u8)];
+      i != 0; i = context_hash_next[i - 1]) {
+    context = &addr_contexts[i - 1];
+#else /* SICSLOWPAN_ADDR_CONTEXT_INDEX */
   int i;
   for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
-    if((addr_contexts[i].used == 1) &&
-       uip_ipaddr_prefixcmp(&addr_contexts[i].prefix, ipaddr, 64)) {
-      return &addr_contexts[i];
+    context = &addr_contexts[i];
+#endif /* SICSLOWPAN_ADDR_CONTEXT_INDEX */
+    /* An expired context is removed, and another one may still match */
+    if((context->used == 1) && !context->decompress_only &&
+       uip_ipaddr_prefixcmp(&context->prefix, ipaddr, 64) &&
+       addr_context_valid(context)) {
+      return context;
     }
   }
 #endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
@@ -569,16 +1066,91 @@ static struct sicslowpan_addr_context*
 addr_context_lookup_by_number(uint8_t number)
 {
 /* Remove code to avoid warnings and save flash if no context is used */
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+  if(number < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS &&
+     addr_contexts[number].used == 1 &&
+     addr_context_valid(&addr_contexts[number])) {
+    return &addr_contexts[number];
+  }
+#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
+  return NULL;
+}
+/*--------------------------------------------------------------------*/
+int
+sicslowpan_addr_context_set(uint8_t number, const uip_ipaddr_t *prefix,
+                            uint8_t prefix_len, bool compress,
+                            unsigned long lifetime)
+{
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+  struct sicslowpan_addr_context *context;
+  uip_ipaddr_t masked;
+
+  /* Only the 64-bit prefix is kept. Longer contexts would also replace
+     bits of the IID when decompressing (RFC 6282, Section 3.1.1). */
+  if(number >= SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS ||
+     prefix_len == 0 || prefix_len > 64) {
+    return 0;
+  }
+
+  /* Keep the prefix with the bits beyond its length cleared */
+  memset(&masked, 0, sizeof(masked));
+  memcpy(&masked, prefix, (prefix_len + 7) / 8);
+  if(prefix_len < 64 && prefix_len % 8 != 0) {
+    masked.u8[prefix_len / 8] &= 0xff << (8 - prefix_len % 8);
+  }
+
+  sicslowpan_addr_context_rm(number);
+  context = &addr_contexts[number];
+  context->used = 1;
+  context->number = number;
+  memcpy(context->prefix, &masked, sizeof(context->prefix));
+  context->decompress_only = !compress;
+  context->expiration = lifetime != 0 ? clock_seconds() + lifetime : 0;
+#if SICSLOWPAN_ADDR_CONTEXT_INDEX
+  context_hash_insert(number);
+#endif /* SICSLOWPAN_ADDR_CONTEXT_INDEX */
+
+  LOG_INFO("address context %u: ", number);
+  LOG_INFO_6ADDR(&masked);
+  LOG_INFO_("/%u%s, lifetime %lu\n", prefix_len,
+            compress ? "" : " (decompression only)", lifetime);
+  return 1;
+#else /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
+  return 0;
+#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
+}
+/*--------------------------------------------------------------------*/
+void
+sicslowpan_addr_context_rm(uint8_t number)
+{
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
+  if(number >= SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS ||
+     addr_contexts[number].used == 0) {
+    return;
+  }
+#if SICSLOWPAN_ADDR_CONTEXT_INDEX
+  context_hash_remove(number);
+#endif /* SICSLOWPAN_ADDR_CONTEXT_INDEX */
+  memset(&addr_contexts[number], 0, sizeof(addr_contexts[number]));
+#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
+}
+/*--------------------------------------------------------------------*/
+const struct sicslowpan_addr_context *
+sicslowpan_addr_context_get(uint8_t number)
+{
+  return addr_context_lookup_by_number(number);
+}
+/*--------------------------------------------------------------------*/
+void
+sicslowpan_addr_context_stats_reset(void)
+{
 #if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0
   int i;
   for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
-    if((addr_contexts[i].used == 1) &&
-       addr_contexts[i].number == number) {
-      return &addr_contexts[i];
-    }
+    addr_contexts[i].compressed = 0;
+    addr_contexts[i].decompressed = 0;
   }
 #endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
-  return NULL;
 }
 /*--------------------------------------------------------------------*/
 static uint8_t
@@ -626,7 +1198,7 @@ uncompress_addr(uip_ipaddr_t *ipaddr, uint8_t const prefix[],
     memset(&ipaddr->u8[prefcount], 0, 16 - (prefcount + postcount));
   }
   if(postcount > 0) {
-    if((iphc_ptr - packetbuf_ptr) + postcount > packetbuf_datalen()) {
+    if((iphc_ptr - packetbuf_ptr) + postcount > input_len) {
       LOG_WARN("Insufficient packet data to decompress IP address\n");
       return false;
     }
@@ -837,6 +1409,7 @@ compress_hdr_iphc(void)
            source_context->number);
     iphc1 |= SICSLOWPAN_IPHC_CID | SICSLOWPAN_IPHC_SAC;
     PACKETBUF_IPHC_BUF[2] |= source_context->number << 4;
+    source_context->compressed++;
     /* compession compare with this nodes address (source) */
 
     iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_SAM_BIT,
@@ -888,6 +1461,7 @@ compress_hdr_iphc(void)
       /* elide the prefix */
       iphc1 |= SICSLOWPAN_IPHC_DAC;
       PACKETBUF_IPHC_BUF[2] |= destination_context->number;
+      destination_context->compressed++;
       /* compession compare with link adress (destination) */
 
       iphc1 |= compress_addr_64(SICSLOWPAN_IPHC_DAM_BIT,
@@ -1091,7 +1665,7 @@ uncompress_hdr_iphc(uint8_t *buf, uint16_t buf_size, uint16_t ip_len)
   }
 
   /* at least two byte will be used for the encoding */
-  cmpr_len = packetbuf_datalen();
+  cmpr_len = input_len;
   if(cmpr_len < packetbuf_hdr_len + 2) {
     return false;
   }
@@ -1183,6 +1757,7 @@ uncompress_hdr_iphc(uint8_t *buf, uint16_t buf_size, uint16_t ip_len)
         LOG_ERR("uncompression: error source context not found\n");
         return false;
       }
+      source_context->decompressed++;
     } else {
       source_context = NULL;
     }
@@ -1242,6 +1817,7 @@ uncompress_hdr_iphc(uint8_t *buf, uint16_t buf_size, uint16_t ip_len)
         LOG_ERR("uncompression: error destination context not found\n");
         return false;
       }
+      destination_context->decompressed++;
       if(!uncompress_addr(&SICSLOWPAN_IP_BUF(buf)->destipaddr,
                           destination_context->prefix,
                           unc_ctxconf[tmp],
@@ -1415,7 +1991,7 @@ uncompress_hdr_iphc(uint8_t *buf, uint16_t buf_size, uint16_t ip_len)
     }
 
     /* length field in UDP header (8 byte header + payload) */
-    udp_len = 8 + packetbuf_datalen() - (iphc_ptr - packetbuf_ptr);
+    udp_len = 8 + input_len - (iphc_ptr - packetbuf_ptr);
     udp_buf->udplen = UIP_HTONS(ip_len == 0 ? udp_len :
                                 ip_len - UIP_IPH_LEN - ext_hdr_len);
     LOG_DBG("uncompression: UDP length: %u (ext: %u) ip_len: %d udp_len: %d\n",
@@ -1428,9 +2004,9 @@ uncompress_hdr_iphc(uint8_t *buf, uint16_t buf_size, uint16_t ip_len)
 
   /* IP length field. */
   if(ip_len == 0) {
-    int len = packetbuf_datalen() - packetbuf_hdr_len + uncomp_hdr_len - UIP_IPH_LEN;
+    int len = input_len - packetbuf_hdr_len + uncomp_hdr_len - UIP_IPH_LEN;
     LOG_DBG("uncompression: IP payload length: %d. %u - %u + %u - %u\n", len,
-           packetbuf_datalen(), packetbuf_hdr_len, uncomp_hdr_len, UIP_IPH_LEN);
+           input_len, packetbuf_hdr_len, uncomp_hdr_len, UIP_IPH_LEN);
 
     /* This is not a fragmented packet */
     SICSLOWPAN_IP_BUF(buf)->len[0] = len >> 8;
@@ -1572,36 +2148,41 @@ send_packet(void)
 }
 #if SICSLOWPAN_CONF_FRAG
 /*--------------------------------------------------------------------*/
+/* The packetbuf attributes of the datagram being fragmented. The MAC
+ * layer may change the attributes and the content of packetbuf when a
+ * fragment is sent, so they are restored before the next fragment. */
+static struct packetbuf_attr frag_attrs[PACKETBUF_NUM_ATTRS];
+static struct packetbuf_addr frag_addrs[PACKETBUF_NUM_ADDRS];
+/*--------------------------------------------------------------------*/
 /**
  * \brief This function is called by the 6lowpan code to copy a fragment's
  * payload from uIP and send it down the stack.
  * \param uip_offset the offset in the uIP buffer where to copy the payload from
- * \param dest the link layer destination address of the packet
  * \return 1 if success, 0 otherwise
+ *
+ * The fragment header must be set before every call, as the MAC layer
+ * may overwrite it. The payload is copied straight from uip_buf, and
+ * only the attributes are saved and restored around the transmission.
  */
 static int
 fragment_copy_payload_and_send(uint16_t uip_offset)
 {
-  struct queuebuf *q;
-
   /* Now copy fragment payload from uip_buf */
   memcpy(packetbuf_ptr + packetbuf_hdr_len,
          (uint8_t *)UIP_IP_BUF + uip_offset, packetbuf_payload_len);
   packetbuf_set_datalen(packetbuf_payload_len + packetbuf_hdr_len);
 
-  /* Backup packetbuf to queuebuf. Enables preserving attributes for all framgnets */
-  q = queuebuf_new_from_packetbuf();
-  if(q == NULL) {
-    LOG_WARN("output: could not allocate queuebuf, dropping fragment\n");
-    return 0;
-  }
+  /* Save the attributes, which are the same for all fragments */
+  packetbuf_attr_copyto(frag_attrs, frag_addrs);
 
   /* Send fragment */
   send_packet();
 
-  /* Restore packetbuf from queuebuf */
-  queuebuf_to_packetbuf(q);
-  queuebuf_free(q);
+  /* Restore the attributes, and the start of packetbuf that the
+     fragment headers are written to */
+  packetbuf_clear();
+  packetbuf_attr_copyfrom(frag_attrs, frag_addrs);
+  packetbuf_ptr = packetbuf_dataptr();
 
   /* Check tx result. */
   if((last_tx_status == MAC_TX_COLLISION) ||
@@ -1613,43 +2194,42 @@ fragment_copy_payload_and_send(uint16_t uip_offset)
 }
 #endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
-/** \brief Take an IP packet and format it to be sent on an 802.15.4
- *  network using 6lowpan.
- *  \param localdest The MAC address of the destination
- *
- *  The IP packet is initially in uip_buf. Its header is compressed
- *  and if necessary it is fragmented. The resulting
- *  packet/fragments are put in packetbuf and delivered to the 802.15.4
- *  MAC.
- */
-static uint8_t
-output(const linkaddr_t *localdest)
+/* Compress the headers of the datagram in uip_buf into packetbuf */
+static int
+compress_hdr(void)
 {
-  int frag_needed;
-
-  /* init */
-  uncomp_hdr_len = 0;
-  packetbuf_hdr_len = 0;
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
+  compress_hdr_ipv6();
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
+#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_6LORH
+  /* Add 6LoRH headers before IPHC. Only needed on routed traffic
+  (non link-local). */
+  if(!uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr)) {
+    add_paging_dispatch(1);
+    add_6lorh_hdr();
+  }
+#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_6LORH */
+#if SICSLOWPAN_COMPRESSION >= SICSLOWPAN_COMPRESSION_IPHC
+  if(compress_hdr_iphc() == 0) {
+    /* Warning should already be issued by function above */
+    return 0;
+  }
+#endif /* SICSLOWPAN_COMPRESSION >= SICSLOWPAN_COMPRESSION_IPHC */
+  return 1;
+}
+/*--------------------------------------------------------------------*/
+/* Set the packetbuf attributes of a frame to localdest from those of
+   the datagram in uipbuf */
+static void
+set_frame_attrs(const linkaddr_t *localdest)
+{
+  /* copy over the retransmission count from uipbuf attributes */
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
+                     uipbuf_get_attr(UIPBUF_ATTR_MAX_MAC_TRANSMISSIONS));
 
-  /* reset packetbuf buffer */
-  packetbuf_clear();
-  packetbuf_ptr = packetbuf_dataptr();
-
-  if(callback) {
-    /* call the attribution when the callback comes, but set attributes
-       here ! */
-    set_packet_attrs();
-  }
-
-  LOG_INFO("output: sending IPv6 packet with len %d\n", uip_len);
-
-  /* copy over the retransmission count from uipbuf attributes */
-  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
-                     uipbuf_get_attr(UIPBUF_ATTR_MAX_MAC_TRANSMISSIONS));
-
-  /* Copy destination address to packetbuf */
-  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER,
-      localdest ? localdest : &linkaddr_null);
+  /* Copy destination address to packetbuf */
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER,
+      localdest ? localdest : &linkaddr_null);
 
 #if LLSEC802154_USES_AUX_HEADER
   /* copy LLSEC level */
@@ -1660,6 +2240,279 @@ output(const linkaddr_t *localdest)
     uipbuf_get_attr(UIPBUF_ATTR_LLSEC_KEY_ID));
 #endif /* LLSEC802154_USES_EXPLICIT_KEYS */
 #endif /*  LLSEC802154_USES_AUX_HEADER */
+}
+/*--------------------------------------------------------------------*/
+/* Keep the link-layer security attributes of the frame in packetbuf
+   with the datagram in uipbuf */
+static void
+get_frame_attrs(void)
+{
+#if LLSEC802154_USES_AUX_HEADER
+  uipbuf_set_attr(UIPBUF_ATTR_LLSEC_LEVEL,
+    packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL));
+#if LLSEC802154_USES_EXPLICIT_KEYS
+  uipbuf_set_attr(UIPBUF_ATTR_LLSEC_KEY_ID,
+    packetbuf_attr(PACKETBUF_ATTR_KEY_INDEX));
+#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
+#endif /*  LLSEC802154_USES_AUX_HEADER */
+}
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_RFRAG
+/*--------------------------------------------------------------------*/
+/* A datagram sent in recoverable fragments, which is kept until the
+ * receiver acknowledges it */
+struct sicslowpan_rfrag_tx {
+  struct sicslowpan_rfrag_tx *next;
+  /** The receiver of the fragments, and the tag of the datagram */
+  linkaddr_t receiver;
+  uint8_t tag;
+  /** Number of fragments */
+  uint8_t count;
+  /** Number of times that fragments were sent again */
+  uint8_t retries;
+  /** Size of the first fragment, and of the others but the last one */
+  uint16_t first_len;
+  uint16_t frag_len;
+  /** Length of the compressed datagram */
+  uint16_t len;
+  /** Waits for an RFRAG-ACK */
+  struct ctimer ack_timer;
+  /** The packetbuf attributes of the fragments */
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+  /** The datagram, with the header compressed */
+  uint8_t buf[UIP_BUFSIZE];
+};
+
+MEMB(rfrag_tx_memb, struct sicslowpan_rfrag_tx, SICSLOWPAN_RFRAG_TX_ENTRIES);
+LIST(rfrag_tx_list);
+/* The tag of the next datagram sent or forwarded in recoverable
+   fragments */
+static uint8_t rfrag_tag;
+/*--------------------------------------------------------------------*/
+static void
+rfrag_tx_free(struct sicslowpan_rfrag_tx *t)
+{
+  ctimer_stop(&t->ack_timer);
+  list_remove(rfrag_tx_list, t);
+  memb_free(&rfrag_tx_memb, t);
+}
+/*--------------------------------------------------------------------*/
+/* Send fragment seq of a datagram, with an RFRAG-ACK request if
+ * ack_request is set. The first fragment carries the size of the
+ * datagram instead of its offset. */
+static void
+rfrag_send(struct sicslowpan_rfrag_tx *t, uint8_t seq, bool ack_request)
+{
+  uint8_t *frame;
+  uint16_t offset;
+  uint16_t size;
+
+  if(seq == 0) {
+    offset = 0;
+    size = MIN(t->first_len, t->len);
+  } else {
+    offset = t->first_len + (seq - 1) * t->frag_len;
+    size = MIN(t->frag_len, t->len - offset);
+  }
+
+  packetbuf_clear();
+  packetbuf_attr_copyfrom(t->attrs, t->addrs);
+  frame = packetbuf_dataptr();
+  frame[PACKETBUF_RFRAG_DISPATCH] = SICSLOWPAN_DISPATCH_RFRAG |
+    (ack_request ? SICSLOWPAN_RFRAG_ACK_REQUEST : 0);
+  frame[PACKETBUF_RFRAG_TAG] = t->tag;
+  SET16(frame, PACKETBUF_RFRAG_SEQ_SIZE, (seq << 10) | size);
+  SET16(frame, PACKETBUF_RFRAG_OFFSET, seq == 0 ? t->len : offset);
+  memcpy(frame + SICSLOWPAN_RFRAG_HDR_LEN, t->buf + offset, size);
+  packetbuf_set_datalen(SICSLOWPAN_RFRAG_HDR_LEN + size);
+
+  LOG_INFO("output: recoverable fragment %u/%u (tag %u, payload %u%s)\n",
+           seq + 1, t->count, t->tag, size, ack_request ? ", ack request" : "");
+  send_packet();
+}
+/*--------------------------------------------------------------------*/
+/* Give up a datagram, and tell the receiver to drop what it has of it
+ * with a fragment whose sequence number, size and offset are 0 */
+static void
+rfrag_abort(struct sicslowpan_rfrag_tx *t)
+{
+  uint8_t *frame;
+
+  LOG_WARN("output: aborting datagram (tag %u)\n", t->tag);
+  packetbuf_clear();
+  packetbuf_attr_copyfrom(t->attrs, t->addrs);
+  frame = packetbuf_dataptr();
+  memset(frame, 0, SICSLOWPAN_RFRAG_HDR_LEN);
+  frame[PACKETBUF_RFRAG_DISPATCH] = SICSLOWPAN_DISPATCH_RFRAG;
+  frame[PACKETBUF_RFRAG_TAG] = t->tag;
+  packetbuf_set_datalen(SICSLOWPAN_RFRAG_HDR_LEN);
+  send_packet();
+
+  reass_stats.aborted++;
+  rfrag_tx_free(t);
+}
+/*--------------------------------------------------------------------*/
+static void rfrag_timeout(void *ptr);
+/*--------------------------------------------------------------------*/
+/* Send the fragments whose bits are set in missing again, and ask for
+ * an RFRAG-ACK with the last of them */
+static void
+rfrag_retry(struct sicslowpan_rfrag_tx *t, uint32_t missing)
+{
+  uint8_t seq;
+  uint8_t last;
+
+  if(++t->retries > SICSLOWPAN_RFRAG_MAX_RETRIES) {
+    rfrag_abort(t);
+    return;
+  }
+  for(last = t->count - 1; !(missing & RFRAG_BIT(last)); last--);
+  for(seq = 0; seq <= last; seq++) {
+    if(missing & RFRAG_BIT(seq)) {
+      rfrag_send(t, seq, seq == last);
+      reass_stats.retransmitted++;
+    }
+  }
+  ctimer_set(&t->ack_timer, SICSLOWPAN_RFRAG_ACK_TIMEOUT, rfrag_timeout, t);
+}
+/*--------------------------------------------------------------------*/
+/* No RFRAG-ACK came: ask for one again with the last fragment */
+static void
+rfrag_timeout(void *ptr)
+{
+  struct sicslowpan_rfrag_tx *t = ptr;
+
+  LOG_INFO("output: no RFRAG-ACK (tag %u)\n", t->tag);
+  rfrag_retry(t, RFRAG_BIT(t->count - 1));
+}
+/*--------------------------------------------------------------------*/
+/* Process an RFRAG-ACK for a datagram that we sent. Returns false if
+ * the datagram is not known. */
+static bool
+rfrag_tx_ack(const linkaddr_t *sender, uint8_t tag, uint32_t bitmap)
+{
+  struct sicslowpan_rfrag_tx *t;
+  uint32_t sent;
+
+  for(t = list_head(rfrag_tx_list); t != NULL; t = list_item_next(t)) {
+    if(t->tag == tag && linkaddr_cmp(&t->receiver, sender)) {
+      break;
+    }
+  }
+  if(t == NULL) {
+    return false;
+  }
+
+  if(bitmap == SICSLOWPAN_RFRAG_BITMAP_FULL) {
+    LOG_INFO("output: datagram acknowledged (tag %u)\n", tag);
+    rfrag_tx_free(t);
+  } else if(bitmap == SICSLOWPAN_RFRAG_BITMAP_NULL) {
+    LOG_WARN("output: datagram aborted by the receiver (tag %u)\n", tag);
+    reass_stats.aborted++;
+    rfrag_tx_free(t);
+  } else {
+    sent = t->count == SICSLOWPAN_RFRAG_MAX_FRAGMENTS ?
+      SICSLOWPAN_RFRAG_BITMAP_FULL : ~(SICSLOWPAN_RFRAG_BITMAP_FULL >> t->count);
+    if((sent & ~bitmap) == 0) {
+      /* With all the fragments, the receiver answers FULL: this is a
+         stale RFRAG-ACK */
+      return true;
+    }
+    rfrag_retry(t, sent & ~bitmap);
+  }
+  return true;
+}
+/*--------------------------------------------------------------------*/
+/* Send the datagram in uip_buf, whose header is compressed in
+ * packetbuf, in recoverable fragments. Returns false if RFC 4944
+ * fragments are to be sent instead. */
+static bool
+rfrag_output(const linkaddr_t *localdest)
+{
+  struct sicslowpan_rfrag_tx *t;
+  uint16_t len;
+  uint16_t first_len;
+  uint16_t frag_len;
+  uint16_t count;
+  uint8_t seq;
+
+  if(localdest == NULL || linkaddr_cmp(localdest, &linkaddr_null)) {
+    /* No one acknowledges broadcast fragments */
+    return false;
+  }
+
+  /* The compressed header must be in the first fragment, for the nodes
+     that forward it */
+  if(mac_max_payload <= SICSLOWPAN_RFRAG_HDR_LEN + SICSLOWPAN_RFRAG_HEADROOM +
+     packetbuf_hdr_len) {
+    return false;
+  }
+  len = packetbuf_hdr_len + uip_len - uncomp_hdr_len;
+  frag_len = MIN(mac_max_payload - SICSLOWPAN_RFRAG_HDR_LEN,
+                 SICSLOWPAN_RFRAG_MAX_SIZE);
+  first_len = frag_len - SICSLOWPAN_RFRAG_HEADROOM;
+  count = 1 + (len - first_len + frag_len - 1) / frag_len;
+  if(len > UIP_BUFSIZE || count > SICSLOWPAN_RFRAG_MAX_FRAGMENTS) {
+    return false;
+  }
+
+  t = memb_alloc(&rfrag_tx_memb);
+  if(t == NULL) {
+    LOG_WARN("output: no buffer for recoverable fragments\n");
+    return false;
+  }
+  memcpy(t->buf, packetbuf_ptr, packetbuf_hdr_len);
+  memcpy(t->buf + packetbuf_hdr_len, (uint8_t *)UIP_IP_BUF + uncomp_hdr_len,
+         uip_len - uncomp_hdr_len);
+  linkaddr_copy(&t->receiver, localdest);
+  t->tag = rfrag_tag++;
+  t->len = len;
+  t->first_len = first_len;
+  t->frag_len = frag_len;
+  t->count = count;
+  t->retries = 0;
+  packetbuf_attr_copyto(t->attrs, t->addrs);
+  list_add(rfrag_tx_list, t);
+
+  for(seq = 0; seq < t->count; seq++) {
+    rfrag_send(t, seq, seq == t->count - 1);
+  }
+  ctimer_set(&t->ack_timer, SICSLOWPAN_RFRAG_ACK_TIMEOUT, rfrag_timeout, t);
+  return true;
+}
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_RFRAG */
+/*--------------------------------------------------------------------*/
+/** \brief Take an IP packet and format it to be sent on an 802.15.4
+ *  network using 6lowpan.
+ *  \param localdest The MAC address of the destination
+ *
+ *  The IP packet is initially in uip_buf. Its header is compressed
+ *  and if necessary it is fragmented. The resulting
+ *  packet/fragments are put in packetbuf and delivered to the 802.15.4
+ *  MAC.
+ */
+static uint8_t
+output(const linkaddr_t *localdest)
+{
+  int frag_needed;
+
+  /* init */
+  uncomp_hdr_len = 0;
+  packetbuf_hdr_len = 0;
+
+  /* reset packetbuf buffer */
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+
+  if(callback) {
+    /* call the attribution when the callback comes, but set attributes
+       here ! */
+    set_packet_attrs();
+  }
+
+  LOG_INFO("output: sending IPv6 packet with len %d\n", uip_len);
+
+  set_frame_attrs(localdest);
 
   /* Calculate NETSTACK_FRAMER's header length, that will be added in the NETSTACK_MAC */
   mac_max_payload = NETSTACK_MAC.max_payload();
@@ -1671,23 +2524,9 @@ output(const linkaddr_t *localdest)
   }
 
   /* Try to compress the headers */
-#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6
-  compress_hdr_ipv6();
-#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPV6 */
-#if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_6LORH
-  /* Add 6LoRH headers before IPHC. Only needed on routed traffic
-  (non link-local). */
-  if(!uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr)) {
-    add_paging_dispatch(1);
-    add_6lorh_hdr();
-  }
-#endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_6LORH */
-#if SICSLOWPAN_COMPRESSION >= SICSLOWPAN_COMPRESSION_IPHC
-  if(compress_hdr_iphc() == 0) {
-    /* Warning should already be issued by function above */
+  if(compress_hdr() == 0) {
     return 0;
   }
-#endif /* SICSLOWPAN_COMPRESSION >= SICSLOWPAN_COMPRESSION_IPHC */
 
   /* Use the mac_max_payload to understand what is the max payload in a MAC
    * packet. We calculate it here only to make a better decision of whether
@@ -1701,6 +2540,11 @@ output(const linkaddr_t *localdest)
 
   if(frag_needed) {
 #if SICSLOWPAN_CONF_FRAG
+#if SICSLOWPAN_RFRAG
+    if(rfrag_output(localdest)) {
+      return 1;
+    }
+#endif /* SICSLOWPAN_RFRAG */
     /* Number of bytes processed. */
     uint16_t processed_ip_out_len;
     uint16_t frag_tag;
@@ -1779,10 +2623,8 @@ output(const linkaddr_t *localdest)
 
     /* Now prepare for subsequent fragments. */
 
-    /* FRAGN header: tag was already set at FRAG1. Now set dispatch for all FRAGN */
+    /* FRAGN header: dispatch and tag are the same for all FRAGN */
     packetbuf_hdr_len = SICSLOWPAN_FRAGN_HDR_LEN;
-    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
-          ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len));
 
     /* Keep track of the total length of data sent */
     processed_ip_out_len = uncomp_hdr_len + packetbuf_payload_len;
@@ -1790,7 +2632,10 @@ output(const linkaddr_t *localdest)
     /* Create and send subsequent fragments. */
     while(processed_ip_out_len < uip_len) {
       curr_frag++;
-      /* FRAGN header: set offset for this fragment */
+      /* FRAGN header: set dispatch, tag and offset for this fragment */
+      SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+            ((SICSLOWPAN_DISPATCH_FRAGN << 8) | uip_len));
+      SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, frag_tag);
       PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = processed_ip_out_len >> 3;
 
       /* Calculate fragment len */
@@ -1837,6 +2682,727 @@ output(const linkaddr_t *localdest)
   return 1;
 }
 
+/*--------------------------------------------------------------------*/
+/* Uncompress the headers of the 6lowpan packet at packetbuf_ptr into
+ * buffer, updating packetbuf_hdr_len and uncomp_hdr_len. ip_len is the
+ * size of the datagram for a first fragment, 0 otherwise. */
+static bool
+uncompress_hdr(uint8_t *buffer, uint16_t buffer_size, uint16_t ip_len)
+{
+  /* First, process 6LoRH headers */
+  curr_page = 0;
+  digest_paging_dispatch();
+  if(curr_page == 1) {
+    LOG_INFO("input: page 1, 6LoRH\n");
+    digest_6lorh_hdr();
+  } else if (curr_page > 1) {
+    LOG_ERR("input: page %u not supported\n", curr_page);
+    return false;
+  }
+
+  /* Process next dispatch and headers */
+  if(SICSLOWPAN_COMPRESSION > SICSLOWPAN_COMPRESSION_IPV6 &&
+     (PACKETBUF_6LO_PTR[PACKETBUF_6LO_DISPATCH] & SICSLOWPAN_DISPATCH_IPHC_MASK) == SICSLOWPAN_DISPATCH_IPHC) {
+    LOG_DBG("uncompression: IPHC dispatch\n");
+    if(uncompress_hdr_iphc(buffer, buffer_size, ip_len) == false) {
+      LOG_ERR("input: failed to decompress IPHC packet\n");
+      return false;
+    }
+  } else if(PACKETBUF_6LO_PTR[PACKETBUF_6LO_DISPATCH] == SICSLOWPAN_DISPATCH_IPV6) {
+    LOG_DBG("uncompression: IPV6 dispatch\n");
+    packetbuf_hdr_len += SICSLOWPAN_IPV6_HDR_LEN;
+
+    /* Put uncompressed IP header in sicslowpan_buf. */
+    memcpy(buffer, packetbuf_ptr + packetbuf_hdr_len, UIP_IPH_LEN);
+
+    /* Update uncomp_hdr_len and packetbuf_hdr_len. */
+    packetbuf_hdr_len += UIP_IPH_LEN;
+    uncomp_hdr_len += UIP_IPH_LEN;
+  } else {
+    LOG_ERR("uncompression: unknown dispatch: 0x%02x, or IPHC disabled\n",
+             PACKETBUF_6LO_PTR[PACKETBUF_6LO_DISPATCH] & SICSLOWPAN_DISPATCH_IPHC_MASK);
+    return false;
+  }
+  return true;
+}
+
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARD
+/*--------------------------------------------------------------------*/
+/* What became of a first fragment that was offered for forwarding */
+enum {
+  FORWARD_NONE, /* Not forwarded, the datagram is to be reassembled */
+  FORWARD_DONE, /* Forwarded, or a duplicate of a forwarded fragment */
+  FORWARD_DROP, /* Dropped, with the rest of the datagram */
+};
+/*--------------------------------------------------------------------*/
+/* Find the link-layer address of the next hop of the datagram whose
+ * first fragment is in uip_buf, if the datagram can be forwarded
+ * without the IP layer. This takes the same decisions as uip6.c and
+ * tcpip.c. Datagrams with a routing header, or with other hop-by-hop
+ * options than the RPL option, are left to the IP layer. */
+static const linkaddr_t *
+forward_nexthop(int *rpl_opt_offset)
+{
+  const uip_ipaddr_t *nexthop;
+  uip_ds6_route_t *route;
+  uip_ds6_nbr_t *nbr;
+  uint8_t *next_header;
+  uint8_t protocol;
+
+  if(!UIP_CONF_ROUTER || NETSTACK_ROUTING.node_is_root()) {
+    /* The root may have to change the extension headers */
+    return NULL;
+  }
+  if(uip_ds6_is_my_addr(&UIP_IP_BUF->destipaddr) ||
+     uip_ds6_is_my_maddr(&UIP_IP_BUF->destipaddr) ||
+     uip_ds6_is_my_addr(&UIP_IP_BUF->srcipaddr) ||
+     uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_linklocal(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_loopback(&UIP_IP_BUF->destipaddr) ||
+     uip_is_addr_linklocal(&UIP_IP_BUF->srcipaddr) ||
+     uip_is_addr_unspecified(&UIP_IP_BUF->srcipaddr) ||
+     UIP_IP_BUF->ttl <= 1) {
+    return NULL;
+  }
+
+  *rpl_opt_offset = 0;
+  for(next_header = uipbuf_get_next_header(uip_buf, uip_len, &protocol, true);
+      next_header != NULL && uip_is_proto_ext_hdr(protocol);
+      next_header = uipbuf_get_next_header(next_header, uip_len - (next_header - uip_buf), &protocol, false)) {
+    if(protocol == UIP_PROTO_ROUTING) {
+      return NULL;
+    }
+    if(protocol == UIP_PROTO_HBHO) {
+      int offset = 2;
+      int end = (((struct uip_ext_hdr *)next_header)->len << 3) + 8;
+
+      if(next_header != UIP_IP_PAYLOAD(0)) {
+        return NULL;
+      }
+      while(offset < end) {
+        if(next_header[offset] == UIP_EXT_HDR_OPT_PAD1) {
+          offset++;
+          continue;
+        }
+        if(offset + 2 > end) {
+          return NULL;
+        }
+        if(next_header[offset] == UIP_EXT_HDR_OPT_RPL) {
+          *rpl_opt_offset = offset;
+        } else if(next_header[offset] != UIP_EXT_HDR_OPT_PADN) {
+          return NULL;
+        }
+        offset += 2 + next_header[offset + 1];
+      }
+    }
+  }
+  if(next_header == NULL) {
+    /* The headers are not all in the first fragment */
+    return NULL;
+  }
+
+  if(uip_ds6_is_addr_onlink(&UIP_IP_BUF->destipaddr)) {
+    nexthop = &UIP_IP_BUF->destipaddr;
+  } else if((route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr)) != NULL) {
+    nexthop = uip_ds6_route_nexthop(route);
+  } else {
+    nexthop = uip_ds6_defrt_choose();
+  }
+  nbr = nexthop != NULL ? uip_ds6_nbr_lookup(nexthop) : NULL;
+  if(nbr == NULL || nbr->state == NBR_INCOMPLETE) {
+    /* The IP layer resolves the address */
+    return NULL;
+  }
+  return (const linkaddr_t *)uip_ds6_nbr_get_ll(nbr);
+}
+/*--------------------------------------------------------------------*/
+/* Update the header of the datagram in uip_buf as the IP layer does when
+ * it forwards the datagram. The header must keep its length. */
+static bool
+forward_update_hdr(int rpl_opt_offset)
+{
+  uint16_t len = uip_len;
+
+  UIP_IP_BUF->ttl--;
+  if(rpl_opt_offset > 0 &&
+     !NETSTACK_ROUTING.ext_header_hbh_update(UIP_IP_PAYLOAD(0), rpl_opt_offset)) {
+    return false;
+  }
+  return NETSTACK_ROUTING.ext_header_update() && uip_len == len;
+}
+/*--------------------------------------------------------------------*/
+/* Forward the first fragment of a datagram, which is in uip_buf with its
+ * header uncompressed, and keep a virtual reassembly buffer that tells
+ * where the rest of the datagram goes (RFC 8930). The header is updated
+ * as the IP layer would and compressed again. If it then no longer fits
+ * in one frame, the end of the fragment is sent in a FRAGN, so that the
+ * offsets of the fragments that follow stay the same. */
+static int
+forward_first_fragment(uint16_t tag, uint16_t frag_size)
+{
+  const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  const linkaddr_t *nexthop;
+  struct sicslowpan_vrb *v;
+  uint16_t first_len;
+  uint16_t processed_len;
+  int rpl_opt_offset;
+
+  v = vrb_find(sender, tag, false);
+  if(v != NULL) {
+    LOG_INFO("forwarding: duplicate first fragment - tag: %d\n", tag);
+    reass_stats.duplicates++;
+    return FORWARD_DONE;
+  }
+
+  /* If fragments of the datagram have been received before the first
+     one, the whole datagram is reassembled instead */
+  if(frag_size > UIP_LINK_MTU || reass_find(sender, tag, false) != NULL ||
+     (nexthop = forward_nexthop(&rpl_opt_offset)) == NULL) {
+    return FORWARD_NONE;
+  }
+
+  v = vrb_alloc();
+  if(v == NULL) {
+    return FORWARD_NONE;
+  }
+  linkaddr_copy(&v->sender, sender);
+  v->tag = tag;
+  v->len = frag_size;
+  first_len = uip_len;
+
+  if(!forward_update_hdr(rpl_opt_offset)) {
+    LOG_WARN("forwarding: dropping - tag: %d\n", tag);
+    /* The fragments that follow are dropped */
+    linkaddr_copy(&v->nexthop, &linkaddr_null);
+    reass_stats.dropped++;
+    return FORWARD_DROP;
+  }
+  linkaddr_copy(&v->nexthop, nexthop);
+  v->out_tag = my_tag++;
+
+  get_frame_attrs();
+  uncomp_hdr_len = 0;
+  packetbuf_hdr_len = 0;
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  set_frame_attrs(&v->nexthop);
+
+  mac_max_payload = NETSTACK_MAC.max_payload();
+  if(mac_max_payload <= 0 || compress_hdr() == 0 ||
+     packetbuf_hdr_len + SICSLOWPAN_FRAG1_HDR_LEN + 8 > mac_max_payload) {
+    LOG_WARN("forwarding: cannot send the header - tag: %d\n", tag);
+    linkaddr_copy(&v->nexthop, &linkaddr_null);
+    reass_stats.dropped++;
+    return FORWARD_DROP;
+  }
+
+  last_tx_status = MAC_TX_OK;
+
+  /* Move IPHC/IPv6 header to make room for FRAG1 header */
+  memmove(packetbuf_ptr + SICSLOWPAN_FRAG1_HDR_LEN, packetbuf_ptr, packetbuf_hdr_len);
+  packetbuf_hdr_len += SICSLOWPAN_FRAG1_HDR_LEN;
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+        ((SICSLOWPAN_DISPATCH_FRAG1 << 8) | frag_size));
+  SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, v->out_tag);
+
+  packetbuf_payload_len = first_len - uncomp_hdr_len;
+  if(packetbuf_hdr_len + packetbuf_payload_len > mac_max_payload) {
+    packetbuf_payload_len = ((uncomp_hdr_len + mac_max_payload - packetbuf_hdr_len) & 0xfff8) - uncomp_hdr_len;
+  }
+  LOG_INFO("forwarding: first fragment (tag %d -> %d, payload %d)\n",
+           tag, v->out_tag, packetbuf_payload_len);
+  if(fragment_copy_payload_and_send(uncomp_hdr_len) == 0) {
+    linkaddr_copy(&v->nexthop, &linkaddr_null);
+    reass_stats.dropped++;
+    return FORWARD_DROP;
+  }
+
+  /* The rest of the fragment, if it did not fit */
+  packetbuf_hdr_len = SICSLOWPAN_FRAGN_HDR_LEN;
+  processed_len = uncomp_hdr_len + packetbuf_payload_len;
+  while(processed_len < first_len) {
+    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE,
+          ((SICSLOWPAN_DISPATCH_FRAGN << 8) | frag_size));
+    SET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_TAG, v->out_tag);
+    PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] = processed_len >> 3;
+    packetbuf_payload_len = MIN(first_len - processed_len,
+                                (mac_max_payload - SICSLOWPAN_FRAGN_HDR_LEN) & 0xfff8);
+    if(fragment_copy_payload_and_send(processed_len) == 0) {
+      linkaddr_copy(&v->nexthop, &linkaddr_null);
+      reass_stats.dropped++;
+      return FORWARD_DROP;
+    }
+    processed_len += packetbuf_payload_len;
+  }
+
+  v->forwarded_units = units_set(v->forwarded, v->len, 0, first_len);
+  if(v->forwarded_units == (v->len + 7) / 8) {
+    vrb_free(v);
+  }
+  reass_stats.forwarded++;
+  uipbuf_clear();
+  return FORWARD_DONE;
+}
+/*--------------------------------------------------------------------*/
+/* Forward a subsequent fragment, in packetbuf, if its datagram has a
+ * virtual reassembly buffer. Only the tag is changed. Returns false if
+ * the fragment is to be reassembled. */
+static bool
+forward_fragment(uint16_t tag, uint16_t frag_size)
+{
+  struct sicslowpan_vrb *v;
+  uint8_t *frame;
+  uint16_t offset;
+  uint16_t len;
+  uint16_t new_units;
+
+  v = vrb_find(packetbuf_addr(PACKETBUF_ADDR_SENDER), tag, false);
+  if(v == NULL) {
+    return false;
+  }
+  if(linkaddr_cmp(&v->nexthop, &linkaddr_null)) {
+    /* The datagram is being dropped */
+    return true;
+  }
+  len = packetbuf_datalen();
+  offset = PACKETBUF_FRAG_PTR[PACKETBUF_FRAG_OFFSET] << 3;
+  if(v->len != frag_size || len < SICSLOWPAN_FRAGN_HDR_LEN ||
+     offset + len - SICSLOWPAN_FRAGN_HDR_LEN > v->len) {
+    LOG_WARN("forwarding: bad fragment - tag: %d\n", tag);
+    reass_stats.dropped++;
+    return true;
+  }
+
+  /* Resend the frame as it is, from the start of packetbuf */
+  get_frame_attrs();
+  frame = packetbuf_dataptr();
+  packetbuf_clear();
+  memmove(packetbuf_dataptr(), frame, len);
+  packetbuf_set_datalen(len);
+  set_frame_attrs(&v->nexthop);
+  SET16((uint8_t *)packetbuf_dataptr(), PACKETBUF_FRAG_TAG, v->out_tag);
+
+  LOG_INFO("forwarding: fragment (tag %d -> %d, payload %d)\n",
+           tag, v->out_tag, len - SICSLOWPAN_FRAGN_HDR_LEN);
+  send_packet();
+
+  /* A retransmitted fragment is forwarded again, but only the units
+     that have not been forwarded before bring the datagram closer to
+     completion */
+  new_units = units_set(v->forwarded, v->len, offset,
+                        len - SICSLOWPAN_FRAGN_HDR_LEN);
+  if(new_units == 0) {
+    reass_stats.duplicates++;
+  }
+  v->forwarded_units += new_units;
+  if(v->forwarded_units == (v->len + 7) / 8) {
+    vrb_free(v);
+  }
+  return true;
+}
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_FRAG_FORWARD */
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_RFRAG
+/*--------------------------------------------------------------------*/
+/* The last datagram reassembled from recoverable fragments. If its
+ * RFRAG-ACK is lost, the sender asks again and is told that the
+ * datagram is complete. */
+static linkaddr_t rfrag_done_sender;
+static uint8_t rfrag_done_tag;
+/*--------------------------------------------------------------------*/
+/* Send an RFRAG-ACK for the datagram that dest sends with tag */
+static void
+rfrag_send_ack(const linkaddr_t *dest, uint8_t tag, uint32_t bitmap)
+{
+  uint8_t *frame;
+
+  get_frame_attrs();
+  packetbuf_clear();
+  set_frame_attrs(dest);
+  frame = packetbuf_dataptr();
+  frame[PACKETBUF_RFRAG_DISPATCH] = SICSLOWPAN_DISPATCH_RFRAG_ACK;
+  frame[PACKETBUF_RFRAG_TAG] = tag;
+  SET16(frame, PACKETBUF_RFRAG_ACK_BITMAP, bitmap >> 16);
+  SET16(frame, PACKETBUF_RFRAG_ACK_BITMAP + 2, bitmap & 0xffff);
+  packetbuf_set_datalen(SICSLOWPAN_RFRAG_ACK_LEN);
+
+  LOG_INFO("output: RFRAG-ACK (tag %u, bitmap 0x%08lx)\n",
+           tag, (unsigned long)bitmap);
+  send_packet();
+}
+#if SICSLOWPAN_FRAG_FORWARD
+/*--------------------------------------------------------------------*/
+/* Drop a datagram that cannot be forwarded, with the fragments that
+ * follow, and tell the previous hop to abort it */
+static void
+rfrag_forward_drop(struct sicslowpan_vrb *v)
+{
+  LOG_WARN("forwarding: dropping - tag: %d\n", v->tag);
+  linkaddr_copy(&v->nexthop, &linkaddr_null);
+  reass_stats.dropped++;
+  rfrag_send_ack(&v->sender, v->tag, SICSLOWPAN_RFRAG_BITMAP_NULL);
+  uipbuf_clear();
+}
+/*--------------------------------------------------------------------*/
+/* Forward the first recoverable fragment of a datagram, in packetbuf,
+ * if the datagram is not for us. Its header is uncompressed, updated
+ * as the IP layer would and compressed again. The fragments that
+ * follow keep their size, and their offsets are shifted by as much as
+ * the header changed. Returns false if the datagram is to be
+ * reassembled. */
+static bool
+rfrag_forward_first(const linkaddr_t *sender, uint8_t tag, uint16_t size,
+                    uint16_t datagram_len)
+{
+  const linkaddr_t *nexthop;
+  struct sicslowpan_vrb *v;
+  uint8_t *frame;
+  uint8_t ack_request;
+  uint16_t payload_len;
+  uint16_t first_len;
+  int hdr_len;
+  int rpl_opt_offset;
+
+  v = vrb_find(sender, tag, true);
+  if(v == NULL && reass_find(sender, tag, true) != NULL) {
+    /* Fragments of the datagram came before the first one */
+    return false;
+  }
+  if(v != NULL && linkaddr_cmp(&v->nexthop, &linkaddr_null)) {
+    /* The datagram is being dropped */
+    return true;
+  }
+  ack_request = packetbuf_ptr[PACKETBUF_RFRAG_DISPATCH] & SICSLOWPAN_RFRAG_ACK_REQUEST;
+
+  /* Uncompress the header into uip_buf, followed by the rest of the
+     fragment */
+  input_len = SICSLOWPAN_RFRAG_HDR_LEN + size;
+  packetbuf_hdr_len = SICSLOWPAN_RFRAG_HDR_LEN;
+  uncomp_hdr_len = 0;
+  if(!uncompress_hdr((uint8_t *)UIP_IP_BUF, UIP_BUFSIZE, 0) ||
+     packetbuf_hdr_len > input_len ||
+     uncomp_hdr_len + input_len - packetbuf_hdr_len > UIP_BUFSIZE) {
+    uip_len = 0;
+    return false;
+  }
+  hdr_len = packetbuf_hdr_len - SICSLOWPAN_RFRAG_HDR_LEN;
+  payload_len = input_len - packetbuf_hdr_len;
+  memcpy((uint8_t *)UIP_IP_BUF + uncomp_hdr_len,
+         packetbuf_ptr + packetbuf_hdr_len, payload_len);
+  uip_len = first_len = uncomp_hdr_len + payload_len;
+
+  nexthop = forward_nexthop(&rpl_opt_offset);
+  if(v == NULL) {
+    if(nexthop == NULL || (v = vrb_alloc()) == NULL) {
+      uip_len = 0;
+      return false;
+    }
+    linkaddr_copy(&v->sender, sender);
+    v->tag = tag;
+    v->rfrag = true;
+    v->len = datagram_len;
+    linkaddr_copy(&v->nexthop, nexthop);
+    v->out_tag = rfrag_tag++;
+    reass_stats.forwarded++;
+  } else {
+    /* The first fragment was sent again */
+    reass_stats.duplicates++;
+  }
+
+  if(nexthop == NULL || !forward_update_hdr(rpl_opt_offset)) {
+    rfrag_forward_drop(v);
+    return true;
+  }
+
+  get_frame_attrs();
+  uncomp_hdr_len = 0;
+  packetbuf_hdr_len = 0;
+  packetbuf_clear();
+  packetbuf_ptr = packetbuf_dataptr();
+  set_frame_attrs(&v->nexthop);
+
+  mac_max_payload = NETSTACK_MAC.max_payload();
+  if(mac_max_payload <= 0 || compress_hdr() == 0 ||
+     SICSLOWPAN_RFRAG_HDR_LEN + packetbuf_hdr_len + first_len - uncomp_hdr_len > mac_max_payload ||
+     packetbuf_hdr_len + first_len - uncomp_hdr_len > SICSLOWPAN_RFRAG_MAX_SIZE) {
+    LOG_WARN("forwarding: cannot send the header - tag: %d\n", tag);
+    rfrag_forward_drop(v);
+    return true;
+  }
+  v->offset_delta = packetbuf_hdr_len - hdr_len;
+  size = packetbuf_hdr_len + first_len - uncomp_hdr_len;
+
+  /* Make room for the RFRAG header, and add the payload */
+  frame = packetbuf_ptr;
+  memmove(frame + SICSLOWPAN_RFRAG_HDR_LEN, frame, packetbuf_hdr_len);
+  memcpy(frame + SICSLOWPAN_RFRAG_HDR_LEN + packetbuf_hdr_len,
+         (uint8_t *)UIP_IP_BUF + uncomp_hdr_len, first_len - uncomp_hdr_len);
+  frame[PACKETBUF_RFRAG_DISPATCH] = SICSLOWPAN_DISPATCH_RFRAG | ack_request;
+  frame[PACKETBUF_RFRAG_TAG] = v->out_tag;
+  SET16(frame, PACKETBUF_RFRAG_SEQ_SIZE, size);
+  SET16(frame, PACKETBUF_RFRAG_OFFSET, datagram_len + v->offset_delta);
+  packetbuf_set_datalen(SICSLOWPAN_RFRAG_HDR_LEN + size);
+
+  LOG_INFO("forwarding: first recoverable fragment (tag %u -> %u, payload %u)\n",
+           tag, v->out_tag, size);
+  send_packet();
+  vrb_refresh(v);
+  uipbuf_clear();
+  return true;
+}
+/*--------------------------------------------------------------------*/
+/* Forward a recoverable fragment, in packetbuf, if its datagram is
+ * forwarded. The tag is changed, and the offset shifted by as much as
+ * the compressed header changed. An abort is forwarded, and ends the
+ * datagram. Returns false if the fragment is to be reassembled. */
+static bool
+rfrag_forward(const linkaddr_t *sender, uint8_t tag, uint8_t seq,
+              uint16_t size, uint16_t offset)
+{
+  struct sicslowpan_vrb *v;
+  uint8_t *frame;
+  uint16_t len;
+
+  if(seq == 0 && offset != 0) {
+    return rfrag_forward_first(sender, tag, size, offset);
+  }
+
+  v = vrb_find(sender, tag, true);
+  if(v == NULL) {
+    return false;
+  }
+  if(linkaddr_cmp(&v->nexthop, &linkaddr_null)) {
+    /* The datagram is being dropped */
+    if(offset == 0) {
+      vrb_free(v);
+    }
+    return true;
+  }
+
+  /* Resend the frame from the start of packetbuf */
+  len = SICSLOWPAN_RFRAG_HDR_LEN + size;
+  get_frame_attrs();
+  frame = packetbuf_dataptr();
+  packetbuf_clear();
+  memmove(packetbuf_dataptr(), frame, len);
+  packetbuf_set_datalen(len);
+  set_frame_attrs(&v->nexthop);
+  frame = packetbuf_dataptr();
+  frame[PACKETBUF_RFRAG_TAG] = v->out_tag;
+  if(offset != 0) {
+    SET16(frame, PACKETBUF_RFRAG_OFFSET, offset + v->offset_delta);
+  }
+
+  LOG_INFO("forwarding: recoverable fragment %u (tag %u -> %u, payload %u)\n",
+           seq + 1, tag, v->out_tag, size);
+  send_packet();
+
+  if(offset == 0) {
+    /* Aborted by the sender */
+    vrb_free(v);
+  } else {
+    vrb_refresh(v);
+  }
+  return true;
+}
+/*--------------------------------------------------------------------*/
+/* Relay an RFRAG-ACK from the next hop of a forwarded datagram to the
+ * previous hop. Returns false if no datagram is forwarded with the tag.
+ * The virtual reassembly buffer is kept after a FULL bitmap, in case
+ * the previous hop did not get it and asks again. */
+static bool
+rfrag_forward_ack(const linkaddr_t *sender, uint8_t tag, uint32_t bitmap)
+{
+  struct sicslowpan_vrb *v;
+  linkaddr_t prev;
+  uint8_t prev_tag;
+
+  for(v = list_head(vrb_list); v != NULL; v = list_item_next(v)) {
+    if(v->rfrag && v->out_tag == tag && linkaddr_cmp(&v->nexthop, sender)) {
+      break;
+    }
+  }
+  if(v == NULL) {
+    return false;
+  }
+
+  linkaddr_copy(&prev, &v->sender);
+  prev_tag = v->tag;
+  if(bitmap == SICSLOWPAN_RFRAG_BITMAP_NULL) {
+    vrb_free(v);
+  } else {
+    vrb_refresh(v);
+  }
+  rfrag_send_ack(&prev, prev_tag, bitmap);
+  return true;
+}
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+/*--------------------------------------------------------------------*/
+/* Process a recoverable fragment, in packetbuf. Returns the buffer of
+ * its datagram once the datagram is complete. An RFRAG-ACK is sent if
+ * the fragment asks for one. */
+static struct sicslowpan_reass *
+rfrag_input(void)
+{
+  linkaddr_t sender;
+  struct sicslowpan_reass *r;
+  uint8_t *frame = PACKETBUF_FRAG_PTR;
+  uint8_t tag;
+  uint8_t seq;
+  uint16_t size;
+  uint16_t offset;
+  bool ack_request;
+  bool complete;
+
+  if(packetbuf_datalen() < SICSLOWPAN_RFRAG_HDR_LEN) {
+    LOG_WARN("input: recoverable fragment too short\n");
+    return NULL;
+  }
+  linkaddr_copy(&sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  ack_request = frame[PACKETBUF_RFRAG_DISPATCH] & SICSLOWPAN_RFRAG_ACK_REQUEST;
+  tag = frame[PACKETBUF_RFRAG_TAG];
+  seq = (GET16(frame, PACKETBUF_RFRAG_SEQ_SIZE) >> 10) & 0x1f;
+  size = GET16(frame, PACKETBUF_RFRAG_SEQ_SIZE) & SICSLOWPAN_RFRAG_MAX_SIZE;
+  offset = GET16(frame, PACKETBUF_RFRAG_OFFSET);
+  if(SICSLOWPAN_RFRAG_HDR_LEN + size > packetbuf_datalen()) {
+    LOG_WARN("input: recoverable fragment size %u exceeds the frame\n", size);
+    reass_stats.dropped++;
+    return NULL;
+  }
+
+  LOG_INFO("input: recoverable fragment %u (tag %u, payload %u, offset %u)\n",
+           seq + 1, tag, size, offset);
+
+#if SICSLOWPAN_FRAG_FORWARD
+  if(rfrag_forward(&sender, tag, seq, size, offset)) {
+    return NULL;
+  }
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+
+  r = reass_find(&sender, tag, true);
+  if(offset == 0) {
+    /* The sender gave up the datagram */
+    if(r != NULL) {
+      LOG_WARN("input: datagram aborted (tag %u)\n", tag);
+      reass_free(r);
+      reass_stats.dropped++;
+    }
+    return NULL;
+  }
+
+  if(r == NULL) {
+    if(tag == rfrag_done_tag && linkaddr_cmp(&sender, &rfrag_done_sender)) {
+      /* The RFRAG-ACK of a complete datagram was lost */
+      reass_stats.duplicates++;
+      if(ack_request) {
+        rfrag_send_ack(&sender, tag, SICSLOWPAN_RFRAG_BITMAP_FULL);
+      }
+      return NULL;
+    }
+    r = reass_alloc(&sender, tag, 0, seq == 0);
+    if(r == NULL) {
+      return NULL;
+    }
+    r->rfrag = true;
+  }
+
+  if(seq == 0) {
+    /* The offset field of the first fragment has the datagram size */
+    if(offset > SICSLOWPAN_REASS_BUF_SIZE || (r->len != 0 && r->len != offset)) {
+      LOG_WARN("input: unacceptable datagram size %u (tag %u)\n", offset, tag);
+      reass_free(r);
+      reass_stats.dropped++;
+      rfrag_send_ack(&sender, tag, SICSLOWPAN_RFRAG_BITMAP_NULL);
+      return NULL;
+    }
+    r->len = offset;
+    offset = 0;
+  }
+  if(offset + size > (r->len != 0 ? r->len : SICSLOWPAN_REASS_BUF_SIZE)) {
+    LOG_WARN("input: recoverable fragment out of range (tag %u)\n", tag);
+    reass_drop_fragment(r, false);
+    return NULL;
+  }
+
+  if(r->rfrag_bitmap & RFRAG_BIT(seq)) {
+    reass_stats.duplicates++;
+  } else {
+    memcpy(r->buf + offset, frame + SICSLOWPAN_RFRAG_HDR_LEN, size);
+    r->rfrag_bitmap |= RFRAG_BIT(seq);
+    r->rfrag_received += size;
+    reass_refresh(r);
+  }
+
+  complete = r->len != 0 && r->rfrag_received >= r->len;
+  if(ack_request) {
+    rfrag_send_ack(&sender, tag,
+                   complete ? SICSLOWPAN_RFRAG_BITMAP_FULL : r->rfrag_bitmap);
+  }
+  if(!complete) {
+    return NULL;
+  }
+  linkaddr_copy(&rfrag_done_sender, &sender);
+  rfrag_done_tag = tag;
+  return r;
+}
+/*--------------------------------------------------------------------*/
+/* Process an RFRAG-ACK, in packetbuf */
+static void
+rfrag_ack_input(void)
+{
+  linkaddr_t sender;
+  uint8_t tag;
+  uint32_t bitmap;
+
+  if(packetbuf_datalen() < SICSLOWPAN_RFRAG_ACK_LEN) {
+    LOG_WARN("input: RFRAG-ACK too short\n");
+    return;
+  }
+  linkaddr_copy(&sender, packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  tag = PACKETBUF_FRAG_PTR[PACKETBUF_RFRAG_TAG];
+  bitmap = (uint32_t)GET16(PACKETBUF_FRAG_PTR, PACKETBUF_RFRAG_ACK_BITMAP) << 16 |
+    GET16(PACKETBUF_FRAG_PTR, PACKETBUF_RFRAG_ACK_BITMAP + 2);
+  LOG_INFO("input: RFRAG-ACK (tag %u, bitmap 0x%08lx)\n",
+           tag, (unsigned long)bitmap);
+
+  if(rfrag_tx_ack(&sender, tag, bitmap)) {
+    return;
+  }
+#if SICSLOWPAN_FRAG_FORWARD
+  if(rfrag_forward_ack(&sender, tag, bitmap)) {
+    return;
+  }
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+  LOG_INFO("input: RFRAG-ACK for an unknown datagram (tag %u)\n", tag);
+}
+/*--------------------------------------------------------------------*/
+/* Uncompress a datagram reassembled from recoverable fragments into
+ * uip_buf, as if it had come in one frame, and free its buffer */
+static bool
+rfrag_uncompress(struct sicslowpan_reass *r)
+{
+  bool ok;
+
+  packetbuf_ptr = r->buf;
+  input_len = r->len;
+  packetbuf_hdr_len = 0;
+  uncomp_hdr_len = 0;
+  ok = uncompress_hdr((uint8_t *)UIP_IP_BUF, UIP_BUFSIZE, 0) &&
+    packetbuf_hdr_len <= r->len &&
+    uncomp_hdr_len + r->len - packetbuf_hdr_len <= UIP_BUFSIZE;
+  if(ok) {
+    memcpy((uint8_t *)UIP_IP_BUF + uncomp_hdr_len, r->buf + packetbuf_hdr_len,
+           r->len - packetbuf_hdr_len);
+    uip_len = uncomp_hdr_len + r->len - packetbuf_hdr_len;
+    reass_stats.completed++;
+  } else {
+    LOG_ERR("input: cannot uncompress the datagram (tag %d)\n", r->tag);
+    reass_stats.dropped++;
+  }
+  packetbuf_ptr = packetbuf_dataptr();
+  reass_free(r);
+  return ok;
+}
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_RFRAG */
 /*--------------------------------------------------------------------*/
 /** \brief Process a received 6lowpan packet.
  *
@@ -1861,7 +3427,11 @@ input(void)
 
 #if SICSLOWPAN_CONF_FRAG
   uint8_t is_fragment = 0;
+#if SICSLOWPAN_REASS_DIRECT
+  struct sicslowpan_reass *reass = NULL;
+#else /* SICSLOWPAN_REASS_DIRECT */
   int8_t frag_context = 0;
+#endif /* SICSLOWPAN_REASS_DIRECT */
 
   /* tag of the fragment */
   uint16_t frag_tag = 0;
@@ -1877,6 +3447,7 @@ input(void)
 
   /* The MAC puts the 15.4 payload inside the packetbuf data buffer */
   packetbuf_ptr = packetbuf_dataptr();
+  input_len = packetbuf_datalen();
 
   if(packetbuf_datalen() == 0) {
     LOG_WARN("input: empty packet\n");
@@ -1898,6 +3469,26 @@ input(void)
 
 #if SICSLOWPAN_CONF_FRAG
 
+#if SICSLOWPAN_RFRAG
+  switch(PACKETBUF_FRAG_PTR[PACKETBUF_RFRAG_DISPATCH] & SICSLOWPAN_DISPATCH_RFRAG_MASK) {
+    case SICSLOWPAN_DISPATCH_RFRAG:
+      reass = rfrag_input();
+      if(reass == NULL || !rfrag_uncompress(reass)) {
+        return;
+      }
+      /* The datagram is in uip_buf */
+      frag_size = uip_len;
+      is_fragment = 1;
+      last_fragment = 1;
+      goto deliver;
+    case SICSLOWPAN_DISPATCH_RFRAG_ACK:
+      rfrag_ack_input();
+      return;
+    default:
+      break;
+  }
+#endif /* SICSLOWPAN_RFRAG */
+
   /*
    * Since we don't support the mesh and broadcast header, the first header
    * we look for is the fragmentation header
@@ -1914,6 +3505,22 @@ input(void)
       LOG_INFO("input: received first element of a fragmented packet (tag %d, len %d)\n",
              frag_tag, frag_size);
 
+#if SICSLOWPAN_FRAG_FORWARD
+      /* The header is uncompressed into uip_buf, to find out whether the
+         datagram is to be forwarded or reassembled */
+      break;
+#elif SICSLOWPAN_REASS_DIRECT
+      /* The header is uncompressed straight into the datagram */
+      reass = reass_lookup(frag_tag, frag_size, true);
+
+      if(reass == NULL) {
+        LOG_ERR("input: failed to allocate new reassembly context\n");
+        return;
+      }
+
+      buffer = reass->buf;
+      buffer_size = SICSLOWPAN_REASS_BUF_SIZE;
+#else /* SICSLOWPAN_REASS_DIRECT */
       /* Add the fragment to the fragmentation context */
       frag_context = add_fragment(frag_tag, frag_size, frag_offset);
 
@@ -1924,6 +3531,7 @@ input(void)
 
       buffer = frag_info[frag_context].first_frag;
       buffer_size = SICSLOWPAN_FIRST_FRAGMENT_SIZE;
+#endif /* SICSLOWPAN_REASS_DIRECT */
       break;
     case SICSLOWPAN_DISPATCH_FRAGN:
       /*
@@ -1935,6 +3543,28 @@ input(void)
       frag_size = GET16(PACKETBUF_FRAG_PTR, PACKETBUF_FRAG_DISPATCH_SIZE) & 0x07ff;
       packetbuf_hdr_len += SICSLOWPAN_FRAGN_HDR_LEN;
 
+#if SICSLOWPAN_REASS_DIRECT
+#if SICSLOWPAN_FRAG_FORWARD
+      if(forward_fragment(frag_tag, frag_size)) {
+        return;
+      }
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+      reass = reass_lookup(frag_tag, frag_size, false);
+
+      if(reass == NULL) {
+        LOG_ERR("input: failed to allocate reassembly context (tag %d)\n", frag_tag);
+        return;
+      }
+      if((frag_offset << 3) >= reass->len) {
+        LOG_ERR("input: fragment offset out of range (tag %d)\n", frag_tag);
+        reass_drop_fragment(reass, false);
+        return;
+      }
+
+      /* The payload is copied to its place in the datagram below */
+      buffer = reass->buf + (frag_offset << 3);
+      buffer_size = SICSLOWPAN_REASS_BUF_SIZE - (frag_offset << 3);
+#else /* SICSLOWPAN_REASS_DIRECT */
       /* Add the fragment to the fragmentation context (this will also
          copy the payload) */
       frag_context = add_fragment(frag_tag, frag_size, frag_offset);
@@ -1951,6 +3581,7 @@ input(void)
       if(frag_info[frag_context].reassembled_len >= frag_size) {
         last_fragment = 1;
       }
+#endif /* SICSLOWPAN_REASS_DIRECT */
       is_fragment = 1;
       break;
     default:
@@ -1963,38 +3594,10 @@ input(void)
   }
 #endif /* SICSLOWPAN_CONF_FRAG */
 
-  /* First, process 6LoRH headers */
-  curr_page = 0;
-  digest_paging_dispatch();
-  if(curr_page == 1) {
-    LOG_INFO("input: page 1, 6LoRH\n");
-    digest_6lorh_hdr();
-  } else if (curr_page > 1) {
-    LOG_ERR("input: page %u not supported\n", curr_page);
-    return;
-  }
-
-  /* Process next dispatch and headers */
-  if(SICSLOWPAN_COMPRESSION > SICSLOWPAN_COMPRESSION_IPV6 &&
-     (PACKETBUF_6LO_PTR[PACKETBUF_6LO_DISPATCH] & SICSLOWPAN_DISPATCH_IPHC_MASK) == SICSLOWPAN_DISPATCH_IPHC) {
-    LOG_DBG("uncompression: IPHC dispatch\n");
-    if(uncompress_hdr_iphc(buffer, buffer_size, frag_size) == false) {
-      LOG_ERR("input: failed to decompress IPHC packet\n");
-      return;
-    }
-  } else if(PACKETBUF_6LO_PTR[PACKETBUF_6LO_DISPATCH] == SICSLOWPAN_DISPATCH_IPV6) {
-    LOG_DBG("uncompression: IPV6 dispatch\n");
-    packetbuf_hdr_len += SICSLOWPAN_IPV6_HDR_LEN;
-
-    /* Put uncompressed IP header in sicslowpan_buf. */
-    memcpy(buffer, packetbuf_ptr + packetbuf_hdr_len, UIP_IPH_LEN);
-
-    /* Update uncomp_hdr_len and packetbuf_hdr_len. */
-    packetbuf_hdr_len += UIP_IPH_LEN;
-    uncomp_hdr_len += UIP_IPH_LEN;
-  } else {
-    LOG_ERR("uncompression: unknown dispatch: 0x%02x, or IPHC disabled\n",
-             PACKETBUF_6LO_PTR[PACKETBUF_6LO_DISPATCH] & SICSLOWPAN_DISPATCH_IPHC_MASK);
+  if(!uncompress_hdr(buffer, buffer_size, frag_size)) {
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_DIRECT
+    reass_drop_fragment(reass, true);
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_DIRECT */
     return;
   }
 
@@ -2008,16 +3611,19 @@ input(void)
    * and packetbuf_hdr_len are non 0, frag_offset is.
    * If this is a subsequent fragment, this is the contrary.
    */
-  if(packetbuf_datalen() < packetbuf_hdr_len) {
+  if(input_len < packetbuf_hdr_len) {
     LOG_ERR("input: packet dropped due to header > total packet\n");
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_DIRECT
+    reass_drop_fragment(reass, first_fragment);
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_DIRECT */
     return;
   }
-  packetbuf_payload_len = packetbuf_datalen() - packetbuf_hdr_len;
+  packetbuf_payload_len = input_len - packetbuf_hdr_len;
 
 #if SICSLOWPAN_CONF_FRAG
   if(is_fragment) {
     LOG_INFO("input: fragment (tag %d, payload %d, offset %d) -- %u %u\n",
-         frag_tag, packetbuf_payload_len, frag_offset << 3, packetbuf_datalen(), packetbuf_hdr_len);
+         frag_tag, packetbuf_payload_len, frag_offset << 3, input_len, packetbuf_hdr_len);
   }
 #endif /*SICSLOWPAN_CONF_FRAG*/
 
@@ -2026,7 +3632,13 @@ input(void)
     unsigned int req_size = uncomp_hdr_len + (uint16_t)(frag_offset << 3)
         + packetbuf_payload_len;
     if(req_size > sizeof(uip_buf)) {
-#if SICSLOWPAN_CONF_FRAG
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_DIRECT
+      LOG_ERR(
+          "input: packet dropped, minimum required IP_BUF size: %d+%d+%d=%u (current size: %u)\n",
+          uncomp_hdr_len, (uint16_t)(frag_offset << 3),
+          packetbuf_payload_len, req_size, (unsigned)sizeof(uip_buf));
+      reass_drop_fragment(reass, true);
+#elif SICSLOWPAN_CONF_FRAG
       LOG_ERR(
           "input: packet and fragment context %u dropped, minimum required IP_BUF size: %d+%d+%d=%u (current size: %u)\n",
           frag_context,
@@ -2045,6 +3657,9 @@ input(void)
   if(buffer != NULL) {
     if(uncomp_hdr_len + packetbuf_payload_len > buffer_size) {
       LOG_ERR("input: cannot copy the payload into the buffer\n");
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_DIRECT
+      reass_drop_fragment(reass, first_fragment);
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_DIRECT */
       return;
     }
     memcpy((uint8_t *)buffer + uncomp_hdr_len, packetbuf_ptr + packetbuf_hdr_len, packetbuf_payload_len);
@@ -2053,6 +3668,47 @@ input(void)
   /* update processed_ip_in_len if fragment, sicslowpan_len otherwise */
 
 #if SICSLOWPAN_CONF_FRAG
+#if SICSLOWPAN_REASS_DIRECT
+#if SICSLOWPAN_FRAG_FORWARD
+  if(first_fragment) {
+    uip_len = uncomp_hdr_len + packetbuf_payload_len;
+    switch(forward_first_fragment(frag_tag, frag_size)) {
+    case FORWARD_NONE:
+      break;
+    default:
+      return;
+    }
+
+    /* Start reassembling the datagram from the fragment in uip_buf */
+    reass = reass_lookup(frag_tag, frag_size, true);
+    if(reass == NULL) {
+      LOG_ERR("input: failed to allocate new reassembly context\n");
+      return;
+    }
+    if(uip_len > reass->len) {
+      LOG_ERR("input: fragment exceeds the datagram size (tag %d)\n", frag_tag);
+      reass_drop_fragment(reass, true);
+      return;
+    }
+    memcpy(reass->buf, uip_buf, uip_len);
+    uip_len = 0;
+  }
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+  if(reass != NULL) {
+    uint16_t offset = first_fragment ? 0 : frag_offset << 3;
+
+    if(offset + uncomp_hdr_len + packetbuf_payload_len > reass->len) {
+      LOG_ERR("input: fragment exceeds the datagram size (tag %d)\n", frag_tag);
+      reass_drop_fragment(reass, first_fragment);
+      return;
+    }
+    if(!reass_add(reass, offset, uncomp_hdr_len + packetbuf_payload_len)) {
+      return;
+    }
+    last_fragment = 1;
+    reass_deliver(reass);
+  }
+#else /* SICSLOWPAN_REASS_DIRECT */
   if(frag_size > 0) {
     /* Add the size of the header only for the first fragment. */
     if(first_fragment != 0) {
@@ -2069,11 +3725,15 @@ input(void)
       }
     }
   }
+#endif /* SICSLOWPAN_REASS_DIRECT */
 
   /*
    * If we have a full IP packet in sicslowpan_buf, deliver it to
    * the IP stack
    */
+#if SICSLOWPAN_RFRAG
+ deliver:
+#endif /* SICSLOWPAN_RFRAG */
   if(!is_fragment || last_fragment) {
     /* packet is in uip already - just set length */
     if(is_fragment != 0 && last_fragment != 0) {
@@ -2103,18 +3763,11 @@ input(void)
       callback->input_callback();
     }
 
-#if LLSEC802154_USES_AUX_HEADER
     /*
      * Assuming that the last packet in packetbuf is containing
      *  the LLSEC state so that it can be copied to uipbuf.
      */
-    uipbuf_set_attr(UIPBUF_ATTR_LLSEC_LEVEL,
-      packetbuf_attr(PACKETBUF_ATTR_SECURITY_LEVEL));
-#if LLSEC802154_USES_EXPLICIT_KEYS
-    uipbuf_set_attr(UIPBUF_ATTR_LLSEC_KEY_ID,
-      packetbuf_attr(PACKETBUF_ATTR_KEY_INDEX));
-#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
-#endif /*  LLSEC802154_USES_AUX_HEADER */
+    get_frame_attrs();
 
     tcpip_input();
 #if SICSLOWPAN_CONF_FRAG
@@ -2129,6 +3782,18 @@ input(void)
 void
 sicslowpan_init(void)
 {
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_DIRECT
+  memb_init(&reass_memb);
+  list_init(reass_list);
+#if SICSLOWPAN_FRAG_FORWARD
+  memb_init(&vrb_memb);
+  list_init(vrb_list);
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+#if SICSLOWPAN_RFRAG
+  memb_init(&rfrag_tx_memb);
+  list_init(rfrag_tx_list);
+#endif /* SICSLOWPAN_RFRAG */
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_DIRECT */
 
 #if SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPHC
 /* Preinitialize any address contexts for better header compression
@@ -2147,30 +3812,71 @@ sicslowpan_init(void)
 #endif
 #endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 */
 
-#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 1
+/* The other contexts are set in the same way, e.g.
+ * #define SICSLOWPAN_CONF_ADDR_CONTEXT_1 {addr_contexts[1].prefix[0]=0xaa;addr_contexts[1].prefix[1]=0xaa;}
+ * and more can be set and updated at runtime with sicslowpan_addr_context_set().
+ */
+#define ADDR_CONTEXT_INIT(n, conf) do { \
+    addr_contexts[n].used = 1;         \
+    addr_contexts[n].number = n;       \
+    conf;                              \
+  } while(0)
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 1 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_1)
+  ADDR_CONTEXT_INIT(1, SICSLOWPAN_CONF_ADDR_CONTEXT_1);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 2 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_2)
+  ADDR_CONTEXT_INIT(2, SICSLOWPAN_CONF_ADDR_CONTEXT_2);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 3 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_3)
+  ADDR_CONTEXT_INIT(3, SICSLOWPAN_CONF_ADDR_CONTEXT_3);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 4 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_4)
+  ADDR_CONTEXT_INIT(4, SICSLOWPAN_CONF_ADDR_CONTEXT_4);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 5 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_5)
+  ADDR_CONTEXT_INIT(5, SICSLOWPAN_CONF_ADDR_CONTEXT_5);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 6 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_6)
+  ADDR_CONTEXT_INIT(6, SICSLOWPAN_CONF_ADDR_CONTEXT_6);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 7 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_7)
+  ADDR_CONTEXT_INIT(7, SICSLOWPAN_CONF_ADDR_CONTEXT_7);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 8 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_8)
+  ADDR_CONTEXT_INIT(8, SICSLOWPAN_CONF_ADDR_CONTEXT_8);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 9 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_9)
+  ADDR_CONTEXT_INIT(9, SICSLOWPAN_CONF_ADDR_CONTEXT_9);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 10 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_10)
+  ADDR_CONTEXT_INIT(10, SICSLOWPAN_CONF_ADDR_CONTEXT_10);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 11 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_11)
+  ADDR_CONTEXT_INIT(11, SICSLOWPAN_CONF_ADDR_CONTEXT_11);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 12 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_12)
+  ADDR_CONTEXT_INIT(12, SICSLOWPAN_CONF_ADDR_CONTEXT_12);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 13 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_13)
+  ADDR_CONTEXT_INIT(13, SICSLOWPAN_CONF_ADDR_CONTEXT_13);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 14 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_14)
+  ADDR_CONTEXT_INIT(14, SICSLOWPAN_CONF_ADDR_CONTEXT_14);
+#endif
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 15 && defined(SICSLOWPAN_CONF_ADDR_CONTEXT_15)
+  ADDR_CONTEXT_INIT(15, SICSLOWPAN_CONF_ADDR_CONTEXT_15);
+#endif
+
+#if SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 && SICSLOWPAN_ADDR_CONTEXT_INDEX
   {
     int i;
-    for(i = 1; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
-#ifdef SICSLOWPAN_CONF_ADDR_CONTEXT_1
-      if (i==1) {
-        addr_contexts[1].used   = 1;
-        addr_contexts[1].number = 1;
-        SICSLOWPAN_CONF_ADDR_CONTEXT_1;
-#ifdef SICSLOWPAN_CONF_ADDR_CONTEXT_2
-      } else if (i==2) {
-        addr_contexts[2].used   = 1;
-        addr_contexts[2].number = 2;
-        SICSLOWPAN_CONF_ADDR_CONTEXT_2;
-#endif
-      } else {
-        addr_contexts[i].used = 0;
+    for(i = 0; i < SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS; i++) {
+      if(addr_contexts[i].used) {
+        context_hash_insert(i);
       }
-#else
-      addr_contexts[i].used = 0;
-#endif /* SICSLOWPAN_CONF_ADDR_CONTEXT_1 */
     }
   }
-#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 1 */
+#endif /* SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS > 0 && SICSLOWPAN_ADDR_CONTEXT_INDEX */
 
 #endif /* SICSLOWPAN_COMPRESSION == SICSLOWPAN_COMPRESSION_IPHC */
 }
@@ -88,6 +88,9 @@
 #define SICSLOWPAN_DISPATCH_FRAG1                   0xc0 /* 11000xxx */
 #define SICSLOWPAN_DISPATCH_FRAGN                   0xe0 /* 11100xxx */
 #define SICSLOWPAN_DISPATCH_FRAG_MASK               0xf8
+#define SICSLOWPAN_DISPATCH_RFRAG                   0xe8 /* 1110100x */
+#define SICSLOWPAN_DISPATCH_RFRAG_ACK               0xea /* 1110101x */
+#define SICSLOWPAN_DISPATCH_RFRAG_MASK              0xfe
 #define SICSLOWPAN_DISPATCH_PAGING                  0xf0 /* 1111xxxx */
 #define SICSLOWPAN_DISPATCH_PAGING_MASK             0xf0
 /** @} */
@@ -188,6 +191,22 @@
 #define SICSLOWPAN_HC1_HC_UDP_HDR_LEN               7
 #define SICSLOWPAN_FRAG1_HDR_LEN                    4
 #define SICSLOWPAN_FRAGN_HDR_LEN                    5
+#define SICSLOWPAN_RFRAG_HDR_LEN                    6
+#define SICSLOWPAN_RFRAG_ACK_LEN                    6
+/** @} */
+
+/**
+ * \name Recoverable fragments (RFC 8931)
+ * @{
+ */
+/* The E flag of an RFRAG, which requests an RFRAG-ACK */
+#define SICSLOWPAN_RFRAG_ACK_REQUEST                0x01
+/* The sequence numbers of the fragments of a datagram */
+#define SICSLOWPAN_RFRAG_MAX_FRAGMENTS              32
+#define SICSLOWPAN_RFRAG_MAX_SIZE                   0x3ff
+/* Acknowledgment bitmaps, with the bit of sequence number 0 first */
+#define SICSLOWPAN_RFRAG_BITMAP_NULL                0x00000000UL
+#define SICSLOWPAN_RFRAG_BITMAP_FULL                0xffffffffUL
 /** @} */
 
 /**
@@ -198,6 +217,15 @@ struct sicslowpan_addr_context {
   uint8_t used; /* possibly use as prefix-length */
   uint8_t number;
   uint8_t prefix[8];
+  /** Set if the context is only used for decompression (the C flag of
+      RFC 6775 is clear) */
+  uint8_t decompress_only;
+  /** The clock_seconds() at which the context expires, 0 if never */
+  unsigned long expiration;
+  /** Addresses compressed with the context */
+  uint32_t compressed;
+  /** Addresses decompressed with the context */
+  uint32_t decompressed;
 };
 
 /**
@@ -296,5 +324,83 @@ struct sicslowpan_nh_compressor {
 
 extern const struct network_driver sicslowpan_driver;
 
+#if SICSLOWPAN_COMPRESSION >= SICSLOWPAN_COMPRESSION_IPHC
+/**
+ * \brief Set an address context for IPHC, as from a 6LoWPAN Context
+ * Option (RFC 6775).
+ * \param number The context identifier, below
+ *        SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS (at most 16).
+ * \param prefix The prefix of the context.
+ * \param prefix_len The length of the prefix in bits, from 1 to 64.
+ *        The context is matched against the first 64 bits of addresses,
+ *        with the bits beyond prefix_len as zeroes.
+ * \param compress Whether the context is used for compression, or only
+ *        for decompression.
+ * \param lifetime The valid lifetime of the context in seconds, or 0 if
+ *        it does not expire.
+ * \return 1 if the context was set, 0 otherwise, e.g., if the context
+ *         is longer than 64 bits.
+ */
+int sicslowpan_addr_context_set(uint8_t number, const uip_ipaddr_t *prefix,
+                                uint8_t prefix_len, bool compress,
+                                unsigned long lifetime);
+
+/**
+ * \brief Remove an address context.
+ * \param number The context identifier.
+ */
+void sicslowpan_addr_context_rm(uint8_t number);
+
+/**
+ * \brief Get an address context, with its hit counters.
+ * \param number The context identifier.
+ * \return The context, or NULL if it is not in use.
+ */
+const struct sicslowpan_addr_context *sicslowpan_addr_context_get(uint8_t number);
+
+/**
+ * \brief Reset the hit counters of all address contexts.
+ */
+void sicslowpan_addr_context_stats_reset(void);
+#endif /* SICSLOWPAN_COMPRESSION >= SICSLOWPAN_COMPRESSION_IPHC */
+
+#if SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_DIRECT
+/**
+ * Statistics of the reassembly of incoming datagrams, see
+ * sicslowpan_reass_stats().
+ */
+typedef struct {
+  /** Datagrams for which a reassembly buffer was allocated */
+  uint32_t started;
+  /** Datagrams that were reassembled completely */
+  uint32_t completed;
+  /** Datagrams dropped because they were not complete in time */
+  uint32_t timed_out;
+  /** Datagrams dropped to make room for a new datagram */
+  uint32_t evicted;
+  /** Fragments that carried no new data */
+  uint32_t duplicates;
+  /** Fragments dropped because they did not fit their datagram */
+  uint32_t dropped;
+  /** Datagrams whose fragments were forwarded without reassembly */
+  uint32_t forwarded;
+  /** Recoverable fragments sent again after an RFRAG-ACK or a timeout */
+  uint32_t retransmitted;
+  /** Datagrams sent in recoverable fragments that were given up */
+  uint32_t aborted;
+} sicslowpan_reass_stats_t;
+
+/**
+ * \brief Get the statistics of the reassembly of incoming datagrams.
+ * \param stats A pointer to an object to copy the statistics to.
+ */
+void sicslowpan_reass_stats(sicslowpan_reass_stats_t *stats);
+
+/**
+ * \brief Reset the statistics of the reassembly of incoming datagrams.
+ */
+void sicslowpan_reass_stats_reset(void);
+#endif /* SICSLOWPAN_CONF_FRAG && SICSLOWPAN_REASS_DIRECT */
+
 #endif /* SICSLOWPAN_H_ */
 /** @} */
@@ -43,6 +43,7 @@
 #include "net/ipv6/uip.h"
 
 #include "lib/list.h"
+#include "lib/tail-list.h"
 #include "lib/memb.h"
 #include "net/nbr-table.h"
 
@@ -79,12 +80,31 @@ MEMB(neighborroutememb, struct uip_ds6_route_neighbor_route, UIP_DS6_ROUTE_NB);
 /* Each route is repressented by a uip_ds6_route_t structure and
    memory for each route is allocated from the routememb memory
    block. These routes are maintained on the routelist. */
-LIST(routelist);
+TAIL_LIST(routelist);
 MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 
 static int num_routes = 0;
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 
+#if UIP_DS6_ROUTE_TRIE
+/* The routes are also indexed by a binary Patricia trie. Each node
+   holds the routes whose prefix is exactly the node's prefix, or no
+   route at all when the node only branches. Branch nodes always have
+   two children, so the trie needs at most two nodes per route. */
+struct route_trie_node {
+  struct route_trie_node *child[2];
+  uip_ds6_route_t *route;
+  uip_ipaddr_t prefix;
+  uint8_t length;
+};
+MEMB(routetriememb, struct route_trie_node, 2 * UIP_DS6_ROUTE_NB);
+static struct route_trie_node *route_trie_root;
+
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+static uint32_t route_lookup_counter;
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+#endif /* UIP_DS6_ROUTE_TRIE */
+
 #endif /* (UIP_MAX_ROUTES != 0) */
 
 /* Default routes are held on the defaultrouterlist and their
@@ -161,13 +181,211 @@ uip_ds6_notification_rm(struct uip_ds6_notification *n)
   list_remove(notificationlist, n);
 }
 #endif
+#if (UIP_MAX_ROUTES != 0) && UIP_DS6_ROUTE_TRIE
+/*---------------------------------------------------------------------------*/
+/* uip_ipaddr_prefixcmp() only compares whole bytes, so routes are
+   keyed on their length rounded down to a byte boundary. This keeps
+   the trie lookups identical to those of the list scan. */
+#define ROUTE_TRIE_KEY_LENGTH(route) ((route)->length & ~7)
+/*---------------------------------------------------------------------------*/
+static int
+addr_bit(const uip_ipaddr_t *addr, uint8_t bit)
+{
+  return (addr->u8[bit >> 3] >> (7 - (bit & 7))) & 1;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+common_prefix_length(const uip_ipaddr_t *a, const uip_ipaddr_t *b,
+                     uint8_t max)
+{
+  uint8_t length;
+  uint8_t diff;
+
+  for(length = 0; length < max; length += 8) {
+    diff = a->u8[length >> 3] ^ b->u8[length >> 3];
+    if(diff != 0) {
+      while((diff & 0x80) == 0) {
+        diff <<= 1;
+        length++;
+      }
+      break;
+    }
+  }
+  return length < max ? length : max;
+}
+/*---------------------------------------------------------------------------*/
+static int
+prefix_matches(const uip_ipaddr_t *addr, const struct route_trie_node *node)
+{
+  return common_prefix_length(addr, &node->prefix, node->length) ==
+    node->length;
+}
+/*---------------------------------------------------------------------------*/
+static struct route_trie_node *
+route_trie_node_alloc(const uip_ipaddr_t *prefix, uint8_t length,
+                      uip_ds6_route_t *route)
+{
+  struct route_trie_node *node;
+
+  node = memb_alloc(&routetriememb);
+  if(node != NULL) {
+    node->child[0] = node->child[1] = NULL;
+    node->route = route;
+    uip_ipaddr_copy(&node->prefix, prefix);
+    node->length = length;
+  }
+  return node;
+}
+/*---------------------------------------------------------------------------*/
+static int
+route_trie_insert(uip_ds6_route_t *route)
+{
+  struct route_trie_node **link;
+  struct route_trie_node *node;
+  struct route_trie_node *branch;
+  struct route_trie_node *leaf;
+  uint8_t length;
+  uint8_t common;
+
+  length = ROUTE_TRIE_KEY_LENGTH(route);
+
+  /* Walk down as long as the node prefixes are prefixes of the route. */
+  common = 0;
+  for(link = &route_trie_root; (node = *link) != NULL;
+      link = &node->child[addr_bit(&route->ipaddr, node->length)]) {
+    common = common_prefix_length(&route->ipaddr, &node->prefix,
+                                  MIN(length, node->length));
+    if(common < node->length) {
+      break;
+    }
+    if(node->length == length) {
+      route->trie_next = node->route;
+      node->route = route;
+      return 1;
+    }
+  }
+
+  route->trie_next = NULL;
+
+  if(node == NULL) {
+    leaf = route_trie_node_alloc(&route->ipaddr, length, route);
+    if(leaf == NULL) {
+      return 0;
+    }
+    *link = leaf;
+    return 1;
+  }
+
+  if(common == length) {
+    /* The route is a prefix of the node: put it above the node. */
+    leaf = route_trie_node_alloc(&route->ipaddr, length, route);
+    if(leaf == NULL) {
+      return 0;
+    }
+    leaf->child[addr_bit(&node->prefix, length)] = node;
+    *link = leaf;
+    return 1;
+  }
+
+  /* The route and the node diverge: join them under a branch node. */
+  branch = route_trie_node_alloc(&route->ipaddr, common, NULL);
+  leaf = route_trie_node_alloc(&route->ipaddr, length, route);
+  if(branch == NULL || leaf == NULL) {
+    memb_free(&routetriememb, branch);
+    memb_free(&routetriememb, leaf);
+    return 0;
+  }
+  branch->child[addr_bit(&route->ipaddr, common)] = leaf;
+  branch->child[addr_bit(&node->prefix, common)] = node;
+  *link = branch;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+route_trie_remove(uip_ds6_route_t *route)
+{
+  struct route_trie_node **link;
+  struct route_trie_node **parent_link;
+  struct route_trie_node *node;
+  uip_ds6_route_t **r;
+  uint8_t length;
+
+  length = ROUTE_TRIE_KEY_LENGTH(route);
+
+  parent_link = NULL;
+  for(link = &route_trie_root;
+      (node = *link) != NULL && node->length < length;
+      link = &node->child[addr_bit(&route->ipaddr, node->length)]) {
+    parent_link = link;
+  }
+
+  if(node == NULL || node->length != length) {
+    return;
+  }
+
+  for(r = &node->route; *r != NULL && *r != route; r = &(*r)->trie_next);
+  if(*r == NULL) {
+    return;
+  }
+  *r = route->trie_next;
+
+  /* Remove the node unless it still holds routes or branches. */
+  if(node->route != NULL ||
+     (node->child[0] != NULL && node->child[1] != NULL)) {
+    return;
+  }
+  *link = node->child[0] != NULL ? node->child[0] : node->child[1];
+  memb_free(&routetriememb, node);
+
+  /* A branch node left with a single child is not needed anymore. */
+  if(parent_link != NULL) {
+    node = *parent_link;
+    if(node->route == NULL &&
+       (node->child[0] == NULL || node->child[1] == NULL)) {
+      *parent_link = node->child[0] != NULL ? node->child[0] : node->child[1];
+      memb_free(&routetriememb, node);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+route_trie_lookup(const uip_ipaddr_t *addr)
+{
+  struct route_trie_node *node;
+  uip_ds6_route_t *found_route;
+  uip_ds6_route_t *r;
+
+  found_route = NULL;
+  for(node = route_trie_root;
+      node != NULL && prefix_matches(addr, node);
+      node = node->child[addr_bit(addr, node->length)]) {
+    if(node->route != NULL) {
+      /* Routes sharing a key may still differ in their length. */
+      found_route = node->route;
+      for(r = found_route->trie_next; r != NULL; r = r->trie_next) {
+        if(r->length > found_route->length) {
+          found_route = r;
+        }
+      }
+    }
+    if(node->length == 128) {
+      break;
+    }
+  }
+  return found_route;
+}
+#endif /* (UIP_MAX_ROUTES != 0) && UIP_DS6_ROUTE_TRIE */
 /*---------------------------------------------------------------------------*/
 void
 uip_ds6_route_init(void)
 {
 #if (UIP_MAX_ROUTES != 0)
   memb_init(&routememb);
-  list_init(routelist);
+  tail_list_init(routelist);
+#if UIP_DS6_ROUTE_TRIE
+  memb_init(&routetriememb);
+  route_trie_root = NULL;
+#endif /* UIP_DS6_ROUTE_TRIE */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 #endif /* (UIP_MAX_ROUTES != 0) */
@@ -226,7 +444,7 @@ uip_ds6_route_t *
 uip_ds6_route_head(void)
 {
 #if (UIP_MAX_ROUTES != 0)
-  return list_head(routelist);
+  return tail_list_head(routelist);
 #else /* (UIP_MAX_ROUTES != 0) */
   return NULL;
 #endif /* (UIP_MAX_ROUTES != 0) */
@@ -237,7 +455,7 @@ uip_ds6_route_next(uip_ds6_route_t *r)
 {
 #if (UIP_MAX_ROUTES != 0)
   if(r != NULL) {
-    uip_ds6_route_t *n = list_item_next(r);
+    uip_ds6_route_t *n = tail_list_item_next(r);
     return n;
   }
 #endif /* (UIP_MAX_ROUTES != 0) */
@@ -275,9 +493,11 @@ uip_ds6_route_t *
 uip_ds6_route_lookup(const uip_ipaddr_t *addr)
 {
 #if (UIP_MAX_ROUTES != 0)
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_TRIE
+  uip_ds6_route_t *r;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_TRIE */
 
   LOG_INFO("Looking up route for ");
   LOG_INFO_6ADDR(addr);
@@ -287,6 +507,9 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     return NULL;
   }
 
+#if UIP_DS6_ROUTE_TRIE
+  found_route = route_trie_lookup(addr);
+#else /* UIP_DS6_ROUTE_TRIE */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -302,6 +525,7 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_TRIE */
 
   if(found_route != NULL) {
     LOG_INFO("Found route: ");
@@ -313,15 +537,25 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     LOG_INFO("No route found\n");
   }
 
-  if(found_route != NULL && found_route != list_head(routelist)) {
+#if UIP_DS6_ROUTE_TRIE
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+  /* Reordering the list would cost a scan per lookup, so the recency
+     is recorded in the route instead. */
+  if(found_route != NULL) {
+    found_route->last_used = ++route_lookup_counter;
+  }
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+#else /* UIP_DS6_ROUTE_TRIE */
+  if(found_route != NULL && found_route != tail_list_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
        the least recently used route will be at the end of the
        list - for fast lookups (assuming multiple packets to the same node). */
 
-    list_remove(routelist, found_route);
-    list_push(routelist, found_route);
+    tail_list_remove(routelist, found_route);
+    tail_list_push(routelist, found_route);
   }
+#endif /* UIP_DS6_ROUTE_TRIE */
 
   return found_route;
 #else /* (UIP_MAX_ROUTES != 0) */
@@ -381,9 +615,20 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
       uip_ds6_route_t *oldest;
       oldest = NULL;
 #if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+#if UIP_DS6_ROUTE_TRIE
+      /* Removing the route that has gone unused for the longest
+         time. The difference to the counter is safe from wrap-around. */
+      for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+        if(oldest == NULL || route_lookup_counter - r->last_used >
+           route_lookup_counter - oldest->last_used) {
+          oldest = r;
+        }
+      }
+#else /* UIP_DS6_ROUTE_TRIE */
       /* Removing the oldest route entry from the route table. The
          least recently used route is the first route on the list. */
-      oldest = list_tail(routelist);
+      oldest = tail_list_tail(routelist);
+#endif /* UIP_DS6_ROUTE_TRIE */
 #endif
       if(oldest == NULL) {
         return NULL;
@@ -421,7 +666,7 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
         LOG_ERR("Add: could not allocate neighbor table entry\n");
         return NULL;
       }
-      LIST_STRUCT_INIT(routes, route_list);
+      TAIL_LIST_STRUCT_INIT(routes, route_list);
 #ifdef NETSTACK_CONF_ROUTING_NEIGHBOR_ADDED_CALLBACK
       NETSTACK_CONF_ROUTING_NEIGHBOR_ADDED_CALLBACK((const linkaddr_t *)nexthop_lladdr);
 #endif
@@ -439,20 +684,21 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
 
     /* add new routes first - assuming that there is a reason to add this
        and that there is a packet coming soon. */
-    list_push(routelist, r);
+    tail_list_push(routelist, r);
 
     nbrr = memb_alloc(&neighborroutememb);
     if(nbrr == NULL) {
       /* This should not happen, as we explicitly deallocated one
          route table entry above. */
       LOG_ERR("Add: could not allocate neighbor route list entry\n");
+      tail_list_remove(routelist, r);
       memb_free(&routememb, r);
       return NULL;
     }
 
     nbrr->route = r;
     /* Add the route to this neighbor */
-    list_add(routes->route_list, nbrr);
+    tail_list_add(routes->route_list, nbrr);
     r->neighbor_routes = routes;
     num_routes++;
 
@@ -465,6 +711,19 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
 
+#if UIP_DS6_ROUTE_TRIE
+  if(!route_trie_insert(r)) {
+    /* This should not happen, as the trie has room for two nodes per
+       route. */
+    LOG_ERR("Add: could not allocate route trie node\n");
+    uip_ds6_route_rm(r);
+    return NULL;
+  }
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+  r->last_used = ++route_lookup_counter;
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+#endif /* UIP_DS6_ROUTE_TRIE */
+
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
 #endif
@@ -508,20 +767,23 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     LOG_INFO_("\n");
 
     /* Remove the route from the route list */
-    list_remove(routelist, route);
+    tail_list_remove(routelist, route);
+#if UIP_DS6_ROUTE_TRIE
+    route_trie_remove(route);
+#endif /* UIP_DS6_ROUTE_TRIE */
 
     /* Find the corresponding neighbor_route and remove it. */
-    for(neighbor_route = list_head(route->neighbor_routes->route_list);
+    for(neighbor_route = tail_list_head(route->neighbor_routes->route_list);
         neighbor_route != NULL && neighbor_route->route != route;
-        neighbor_route = list_item_next(neighbor_route));
+        neighbor_route = tail_list_item_next(neighbor_route));
 
     if(neighbor_route == NULL) {
       LOG_INFO("Rm: neighbor_route was NULL for ");
       LOG_INFO_6ADDR(&route->ipaddr);
       LOG_INFO_("\n");
     }
-    list_remove(route->neighbor_routes->route_list, neighbor_route);
-    if(list_head(route->neighbor_routes->route_list) == NULL) {
+    tail_list_remove(route->neighbor_routes->route_list, neighbor_route);
+    if(tail_list_head(route->neighbor_routes->route_list) == NULL) {
       /* If this was the only route using this neighbor, remove the
          neighbor from the table - this implicitly unlocks nexthop */
 #if LOG_WITH_ANNOTATE
@@ -568,10 +830,10 @@ rm_routelist(struct uip_ds6_route_neighbor_routes *routes)
 
   if(routes != NULL && routes->route_list != NULL) {
     struct uip_ds6_route_neighbor_route *r;
-    r = list_head(routes->route_list);
+    r = tail_list_head(routes->route_list);
     while(r != NULL) {
       uip_ds6_route_rm(r->route);
-      r = list_head(routes->route_list);
+      r = tail_list_head(routes->route_list);
     }
     nbr_table_remove(nbr_routes, routes);
   }
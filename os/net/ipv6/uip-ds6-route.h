@@ -44,6 +44,7 @@
 #include "net/nbr-table.h"
 #include "sys/stimer.h"
 #include "lib/list.h"
+#include "lib/tail-list.h"
 
 #ifdef UIP_CONF_MAX_ROUTES
 
@@ -111,6 +112,16 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB 4
 #endif /* UIP_MAX_ROUTES */
 
+/** \brief Index the routing table with a binary Patricia trie, so that
+    the longest prefix match in uip_ds6_route_lookup() takes time
+    proportional to the prefix length rather than to the number of
+    routes. The index costs up to two trie nodes per route. */
+#ifdef UIP_DS6_ROUTE_CONF_TRIE
+#define UIP_DS6_ROUTE_TRIE UIP_DS6_ROUTE_CONF_TRIE
+#else /* UIP_DS6_ROUTE_CONF_TRIE */
+#define UIP_DS6_ROUTE_TRIE 0
+#endif /* UIP_DS6_ROUTE_CONF_TRIE */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -164,7 +175,7 @@ typedef struct rpl_route_entry {
 /** \brief The neighbor routes hold a list of routing table entries
     that are attached to a specific neihbor. */
 struct uip_ds6_route_neighbor_routes {
-  LIST_STRUCT(route_list);
+  TAIL_LIST_STRUCT(route_list);
 };
 
 /** \brief An entry in the routing table */
@@ -180,6 +191,16 @@ typedef struct uip_ds6_route {
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   UIP_DS6_ROUTE_STATE_TYPE state;
 #endif
+#if UIP_DS6_ROUTE_TRIE
+  /* Next route with the same trie key, which only happens when two
+     routes share their prefix up to a byte boundary. */
+  struct uip_ds6_route *trie_next;
+#if UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
+  /* The lookup counter value when this route was last used. The trie
+     keeps the route list unordered, so recency is tracked here. */
+  uint32_t last_used;
+#endif /* UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
+#endif /* UIP_DS6_ROUTE_TRIE */
   uint8_t length;
 } uip_ds6_route_t;
 
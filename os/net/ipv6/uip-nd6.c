@@ -74,6 +74,9 @@
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/uip-nameserver.h"
+#if UIP_ND6_RA_6CO
+#include "net/ipv6/sicslowpan.h"
+#endif /* UIP_ND6_RA_6CO */
 #include "lib/random.h"
 
 /* Log configuration */
@@ -98,6 +101,7 @@
 #define ND6_OPT_PREFIX_BUF(opt)    ((uip_nd6_opt_prefix_info *)ND6_OPT(opt))
 #define ND6_OPT_MTU_BUF(opt)               ((uip_nd6_opt_mtu *)ND6_OPT(opt))
 #define ND6_OPT_RDNSS_BUF(opt)             ((uip_nd6_opt_dns *)ND6_OPT(opt))
+#define ND6_OPT_6CO_BUF(opt)               ((uip_nd6_opt_6co *)ND6_OPT(opt))
 /** @} */
 
 #if UIP_ND6_SEND_NS || UIP_ND6_SEND_NA || UIP_ND6_SEND_RA || !UIP_CONF_ROUTER
@@ -1034,6 +1038,38 @@ ra_input(void)
       }
       break;
 #endif /* UIP_ND6_RA_RDNSS */
+#if UIP_ND6_RA_6CO
+    case UIP_ND6_OPT_6CO:
+      LOG_DBG("Processing 6CO option in RA\n");
+      {
+        uip_nd6_opt_6co *opt = ND6_OPT_6CO_BUF(nd6_opt_offset);
+        uint8_t cid = opt->flags_cid & UIP_ND6_6CO_CID_MASK;
+
+        if(opt->len < 2 || opt->len > 3 ||
+           opt->context_len > (opt->len - 1) * 64 ||
+           uip_l3_icmp_hdr_len + nd6_opt_offset + (opt->len << 3) > uip_len) {
+          LOG_ERR("6CO option is bad\n");
+          break;
+        }
+        if(opt->lifetime == 0) {
+          sicslowpan_addr_context_rm(cid);
+        } else if(opt->context_len > 64) {
+          /* Contexts that cover IID bits are not supported */
+          LOG_WARN("6CO option with unsupported context length %u\n",
+                   opt->context_len);
+        } else {
+          /* The prefix is 8 or 16 bytes, and the lifetime is in minutes */
+          memset(&ipaddr, 0, sizeof(ipaddr));
+          memcpy(&ipaddr, opt->prefix, (opt->len - 1) * 8);
+          if(!sicslowpan_addr_context_set(cid, &ipaddr, opt->context_len,
+                                          opt->flags_cid & UIP_ND6_6CO_FLAG_C,
+                                          uip_ntohs(opt->lifetime) * 60UL)) {
+            LOG_WARN("6CO option with unsupported context %u\n", cid);
+          }
+        }
+      }
+      break;
+#endif /* UIP_ND6_RA_6CO */
     default:
       LOG_ERR("ND option not supported in RA\n");
       break;
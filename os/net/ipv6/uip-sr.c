@@ -54,10 +54,26 @@
 /* Total number of nodes */
 static int num_nodes;
 
+/* Incremented on every change of the graph topology */
+static uint32_t version;
+
 /* Every known node in the network */
 LIST(nodelist);
 MEMB(nodememb, uip_sr_node_t, UIP_SR_LINK_NUM);
 
+#if UIP_SR_HASH_INDEX
+/* The number of hash buckets: the smallest power of two that keeps the
+ * average chain length at or below one. */
+#define HASH_SIZE_FITS(n) (UIP_SR_LINK_NUM <= (n))
+#define HASH_SIZE                                                       \
+  (HASH_SIZE_FITS(16) ? 16 : HASH_SIZE_FITS(32) ? 32 :                  \
+   HASH_SIZE_FITS(64) ? 64 : HASH_SIZE_FITS(128) ? 128 :                \
+   HASH_SIZE_FITS(256) ? 256 : HASH_SIZE_FITS(512) ? 512 :              \
+   HASH_SIZE_FITS(1024) ? 1024 : 2048)
+#define HASH_MASK (HASH_SIZE - 1)
+static uip_sr_node_t *hash_buckets[HASH_SIZE];
+#endif /* UIP_SR_HASH_INDEX */
+
 /*---------------------------------------------------------------------------*/
 int
 uip_sr_num_nodes(void)
@@ -65,6 +81,47 @@ uip_sr_num_nodes(void)
   return num_nodes;
 }
 /*---------------------------------------------------------------------------*/
+uint32_t
+uip_sr_version(void)
+{
+  return version;
+}
+#if UIP_SR_HASH_INDEX
+/*---------------------------------------------------------------------------*/
+/* Get the hash bucket of a link identifier */
+static unsigned
+hash_bucket(const unsigned char *link_identifier)
+{
+  /* FNV-1a over all bytes of the identifier */
+  uint32_t hash = 2166136261UL;
+  for(int i = 0; i < 8; i++) {
+    hash = (hash ^ link_identifier[i]) * 16777619UL;
+  }
+  return (hash ^ (hash >> 16)) & HASH_MASK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_insert(uip_sr_node_t *node)
+{
+  unsigned bucket = hash_bucket(node->link_identifier);
+  node->hash_next = hash_buckets[bucket];
+  hash_buckets[bucket] = node;
+}
+/*---------------------------------------------------------------------------*/
+static void
+hash_remove(uip_sr_node_t *node)
+{
+  uip_sr_node_t **l;
+  for(l = &hash_buckets[hash_bucket(node->link_identifier)];
+      *l != NULL; l = &(*l)->hash_next) {
+    if(*l == node) {
+      *l = node->hash_next;
+      return;
+    }
+  }
+}
+#endif /* UIP_SR_HASH_INDEX */
+/*---------------------------------------------------------------------------*/
 static int
 node_matches_address(const void *graph, const uip_sr_node_t *node,
                      const uip_ipaddr_t *addr)
@@ -82,7 +139,15 @@ uip_sr_node_t *
 uip_sr_get_node(const void *graph, const uip_ipaddr_t *addr)
 {
   uip_sr_node_t *l;
+#if UIP_SR_HASH_INDEX
+  if(addr == NULL) {
+    return NULL;
+  }
+  for(l = hash_buckets[hash_bucket(((const unsigned char *)addr) + 8)];
+      l != NULL; l = l->hash_next) {
+#else /* UIP_SR_HASH_INDEX */
   for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
+#endif /* UIP_SR_HASH_INDEX */
     /* Compare prefix and node identifier */
     if(node_matches_address(graph, l, addr)) {
       return l;
@@ -120,6 +185,7 @@ uip_sr_expire_parent(const void *graph, const uip_ipaddr_t *child,
     if(l->lifetime > UIP_SR_REMOVAL_DELAY) {
       l->lifetime = UIP_SR_REMOVAL_DELAY;
     }
+    version++;
   }
 }
 /*---------------------------------------------------------------------------*/
@@ -129,7 +195,7 @@ uip_sr_update_node(void *graph, const uip_ipaddr_t *child,
 {
   uip_sr_node_t *child_node = uip_sr_get_node(graph, child);
   uip_sr_node_t *parent_node = uip_sr_get_node(graph, parent);
-  uip_sr_node_t *old_parent_node;
+  uip_sr_node_t *old_parent_node = child_node != NULL ? child_node->parent : NULL;
 
   if(parent != NULL) {
     /* No node for the parent, add one with infinite lifetime */
@@ -155,16 +221,19 @@ uip_sr_update_node(void *graph, const uip_ipaddr_t *child,
     child_node->parent = NULL;
     list_add(nodelist, child_node);
     num_nodes++;
+    memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
+#if UIP_SR_HASH_INDEX
+    hash_insert(child_node);
+#endif /* UIP_SR_HASH_INDEX */
+    version++;
   }
 
   /* Initialize node */
   child_node->graph = graph;
   child_node->lifetime = lifetime;
-  memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
 
   /* Is the node reachable before the update? */
   if(uip_sr_is_addr_reachable(graph, child)) {
-    old_parent_node = child_node->parent;
     /* Update node */
     child_node->parent = parent_node;
     /* Has the node become unreachable? May happen if we create a loop. */
@@ -177,6 +246,9 @@ uip_sr_update_node(void *graph, const uip_ipaddr_t *child,
   } else {
     child_node->parent = parent_node;
   }
+  if(child_node->parent != old_parent_node) {
+    version++;
+  }
 
   LOG_INFO("NS: updating link, child ");
   LOG_INFO_6ADDR(child);
@@ -193,6 +265,10 @@ uip_sr_init(void)
   num_nodes = 0;
   memb_init(&nodememb);
   list_init(nodelist);
+#if UIP_SR_HASH_INDEX
+  memset(hash_buckets, 0, sizeof(hash_buckets));
+#endif /* UIP_SR_HASH_INDEX */
+  version++;
 }
 /*---------------------------------------------------------------------------*/
 uip_sr_node_t *
@@ -235,8 +311,12 @@ uip_sr_periodic(unsigned seconds)
           LOG_INFO_("\n");
         }
         list_remove(nodelist, l);
+#if UIP_SR_HASH_INDEX
+        hash_remove(l);
+#endif /* UIP_SR_HASH_INDEX */
         memb_free(&nodememb, l);
         num_nodes--;
+        version++;
       }
     } else if(l->lifetime != UIP_SR_INFINITE_LIFETIME) {
       l->lifetime = l->lifetime > seconds ? l->lifetime - seconds : 0;
@@ -255,6 +335,10 @@ uip_sr_free_all(void)
     memb_free(&nodememb, l);
     num_nodes--;
   }
+#if UIP_SR_HASH_INDEX
+  memset(hash_buckets, 0, sizeof(hash_buckets));
+#endif /* UIP_SR_HASH_INDEX */
+  version++;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -85,6 +85,16 @@
 
 #define UIP_SR_INFINITE_LIFETIME           0xFFFFFFFF
 
+/* When enabled, nodes are looked up through a hash index of their link
+ * identifier rather than by a linear search of the node list. This costs
+ * a pointer per node and per hash bucket, and is mostly useful at the
+ * root of large non-storing networks. */
+#ifdef UIP_SR_CONF_HASH_INDEX
+#define UIP_SR_HASH_INDEX UIP_SR_CONF_HASH_INDEX
+#else /* UIP_SR_CONF_HASH_INDEX */
+#define UIP_SR_HASH_INDEX 0
+#endif /* UIP_SR_CONF_HASH_INDEX */
+
 /********** Data Structures  **********/
 
 /** \brief A node in a source routing graph, stored at the root and representing
@@ -98,6 +108,10 @@ typedef struct uip_sr_node {
   us with the prefix */
   unsigned char link_identifier[8];
   struct uip_sr_node *parent;
+#if UIP_SR_HASH_INDEX
+  /* Next node in the same hash bucket */
+  struct uip_sr_node *hash_next;
+#endif /* UIP_SR_HASH_INDEX */
 } uip_sr_node_t;
 
 /********** Public functions **********/
@@ -109,6 +123,16 @@ typedef struct uip_sr_node {
  */
 int uip_sr_num_nodes(void);
 
+/**
+ * Tells the version of the graph, which changes whenever a node is
+ * added or removed, a node changes parent, or a link is expired. Paths
+ * computed from the graph remain valid as long as the version does not
+ * change.
+ *
+ * \return The current version of the graph
+ */
+uint32_t uip_sr_version(void);
+
 /**
  * Expires a given child-parent link
  *
@@ -473,11 +473,22 @@ void uip_log(char *msg);
 
 /**
  * If we use IPHC compression, how many address contexts do we support
+ * (at most 16, the number of context identifiers in RFC 6282)
  */
 #ifndef SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS
 #define SICSLOWPAN_CONF_MAX_ADDR_CONTEXTS 1
 #endif
 
+/**
+ * Look up the address contexts for compression through a hash index of
+ * their prefixes, instead of comparing every context
+ */
+#ifdef SICSLOWPAN_CONF_ADDR_CONTEXT_INDEX
+#define SICSLOWPAN_ADDR_CONTEXT_INDEX SICSLOWPAN_CONF_ADDR_CONTEXT_INDEX
+#else
+#define SICSLOWPAN_ADDR_CONTEXT_INDEX 0
+#endif
+
 /**
  * Do we support 6lowpan fragmentation
  */
@@ -485,6 +496,48 @@ void uip_log(char *msg);
 #define SICSLOWPAN_CONF_FRAG  1
 #endif
 
+/**
+ * Reassemble incoming fragments in place, in one buffer per datagram.
+ * Fragments may then arrive in any order. Each of the
+ * SICSLOWPAN_CONF_REASS_CONTEXTS concurrent datagrams takes a buffer of
+ * SICSLOWPAN_CONF_REASS_BUF_SIZE bytes, so this suits border routers
+ * more than constrained nodes.
+ */
+#ifdef SICSLOWPAN_CONF_REASS_DIRECT
+#define SICSLOWPAN_REASS_DIRECT SICSLOWPAN_CONF_REASS_DIRECT
+#else
+#define SICSLOWPAN_REASS_DIRECT 0
+#endif
+
+/**
+ * Forward the fragments of datagrams for other nodes as they arrive,
+ * without reassembling them first (RFC 8930). This requires
+ * SICSLOWPAN_CONF_REASS_DIRECT, which handles the datagrams that are not
+ * forwarded this way.
+ */
+#ifdef SICSLOWPAN_CONF_FRAG_FORWARD
+#define SICSLOWPAN_FRAG_FORWARD SICSLOWPAN_CONF_FRAG_FORWARD
+#else
+#define SICSLOWPAN_FRAG_FORWARD 0
+#endif
+
+/**
+ * Send unicast datagrams that need fragmentation in recoverable
+ * fragments (RFC 8931). The receiver acknowledges them with a bitmap,
+ * and only the missing fragments are sent again. The datagram is kept
+ * until it is acknowledged, in one of SICSLOWPAN_CONF_RFRAG_TX_ENTRIES
+ * buffers of UIP_BUFSIZE bytes. When none is free, or the datagram is
+ * broadcast, RFC 4944 fragments are sent. Recoverable fragments from
+ * other nodes are reassembled, or forwarded with
+ * SICSLOWPAN_CONF_FRAG_FORWARD. This requires
+ * SICSLOWPAN_CONF_REASS_DIRECT.
+ */
+#ifdef SICSLOWPAN_CONF_RFRAG
+#define SICSLOWPAN_RFRAG SICSLOWPAN_CONF_RFRAG
+#else
+#define SICSLOWPAN_RFRAG 0
+#endif
+
 /** @} */
 
 /*------------------------------------------------------------------------------*/
@@ -49,7 +49,7 @@
 #include "sys/clock.h"
 #include "lib/random.h"
 #include "net/netstack.h"
-#include "lib/list.h"
+#include "lib/tail-list.h"
 #include "lib/memb.h"
 #include "lib/assert.h"
 
@@ -102,7 +102,7 @@ struct neighbor_queue {
   struct ctimer transmit_timer;
   uint8_t transmissions;
   uint8_t collisions;
-  LIST_STRUCT(packet_queue);
+  TAIL_LIST_STRUCT(packet_queue);
 };
 
 /* The maximum number of co-existing neighbor queues */
@@ -131,7 +131,7 @@ struct packet_queue {
 MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
 MEMB(packet_memb, struct packet_queue, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
-LIST(neighbor_list);
+TAIL_LIST(neighbor_list);
 
 static void packet_sent(struct neighbor_queue *n,
     struct packet_queue *q,
@@ -142,12 +142,12 @@ static void transmit_from_queue(void *ptr);
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
-  struct neighbor_queue *n = list_head(neighbor_list);
+  struct neighbor_queue *n = tail_list_head(neighbor_list);
   while(n != NULL) {
     if(linkaddr_cmp(&n->addr, addr)) {
       return n;
     }
-    n = list_item_next(n);
+    n = tail_list_item_next(n);
   }
   return NULL;
 }
@@ -171,29 +171,21 @@ send_one_packet(struct neighbor_queue *n, struct packet_queue *q)
 {
   int ret;
   int last_sent_ok = 0;
+  /* The frame was built when the packet was queued: every attempt
+     is transmitted straight from the queuebuf */
+  uint8_t *frame = queuebuf_dataptr(q->buf);
+  int len = queuebuf_datalen(q->buf);
 
-  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
-  packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
-
-#if LLSEC802154_ENABLED
-#if LLSEC802154_USES_EXPLICIT_KEYS
-  /* This should possibly be taken from upper layers in the future */
-  packetbuf_set_attr(PACKETBUF_ATTR_KEY_ID_MODE, CSMA_LLSEC_KEY_ID_MODE);
-#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
-#endif /* LLSEC802154_ENABLED */
-
-  if(csma_security_create_frame() < 0) {
-    /* Failed to allocate space for headers */
-    LOG_ERR("failed to create packet, seqno: %d\n", packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO));
+  if(frame == NULL) {
     ret = MAC_TX_ERR_FATAL;
   } else {
     int is_broadcast;
     uint8_t dsn;
-    dsn = ((uint8_t *)packetbuf_hdrptr())[2] & 0xff;
+    dsn = frame[2] & 0xff;
 
-    NETSTACK_RADIO.prepare(packetbuf_hdrptr(), packetbuf_totlen());
+    NETSTACK_RADIO.prepare(frame, len);
 
-    is_broadcast = packetbuf_holds_broadcast();
+    is_broadcast = linkaddr_cmp(&n->addr, &linkaddr_null);
 
     if(NETSTACK_RADIO.receiving_packet() ||
        (!is_broadcast && NETSTACK_RADIO.pending_packet())) {
@@ -204,7 +196,7 @@ send_one_packet(struct neighbor_queue *n, struct packet_queue *q)
       ret = MAC_TX_COLLISION;
     } else {
 
-      switch(NETSTACK_RADIO.transmit(packetbuf_totlen())) {
+      switch(NETSTACK_RADIO.transmit(len)) {
       case RADIO_TX_OK:
         if(is_broadcast) {
           ret = MAC_TX_OK;
@@ -259,15 +251,16 @@ transmit_from_queue(void *ptr)
 {
   struct neighbor_queue *n = ptr;
   if(n) {
-    struct packet_queue *q = list_head(n->packet_queue);
+    struct packet_queue *q = tail_list_head(n->packet_queue);
     if(q != NULL) {
       LOG_INFO("preparing packet for ");
       LOG_INFO_LLADDR(&n->addr);
       LOG_INFO_(", seqno %u, tx %u, queue %d\n",
         queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO),
-        n->transmissions, list_length(n->packet_queue));
-      /* Send first packet in the neighbor queue */
-      queuebuf_to_packetbuf(q->buf);
+        n->transmissions, tail_list_length(n->packet_queue));
+      /* Send first packet in the neighbor queue. Only its attributes
+         go to packetbuf, for the callbacks. */
+      queuebuf_attr_to_packetbuf(q->buf);
       send_one_packet(n, q);
     }
   }
@@ -298,14 +291,14 @@ free_packet(struct neighbor_queue *n, struct packet_queue *p, int status)
 {
   if(p != NULL) {
     /* Remove packet from queue and deallocate */
-    list_remove(n->packet_queue, p);
+    tail_list_remove(n->packet_queue, p);
 
     queuebuf_free(p->buf);
     memb_free(&metadata_memb, p->ptr);
     memb_free(&packet_memb, p);
     LOG_DBG("free_queued_packet, queue length %d, free packets %zu\n",
-           list_length(n->packet_queue), memb_numfree(&packet_memb));
-    if(list_head(n->packet_queue) != NULL) {
+           tail_list_length(n->packet_queue), memb_numfree(&packet_memb));
+    if(tail_list_head(n->packet_queue) != NULL) {
       /* There is a next packet. We reset current tx information */
       n->transmissions = 0;
       n->collisions = 0;
@@ -314,7 +307,7 @@ free_packet(struct neighbor_queue *n, struct packet_queue *p, int status)
     } else {
       /* This was the last packet in the queue, we free the neighbor */
       ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
+      tail_list_remove(neighbor_list, n);
       memb_free(&neighbor_memb, n);
     }
   }
@@ -447,6 +440,24 @@ csma_output_packet(mac_callback_t sent, void *ptr)
 
   mac_sequence_set_dsn();
   packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_DATAFRAME);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_ACK, 1);
+
+#if LLSEC802154_ENABLED
+#if LLSEC802154_USES_EXPLICIT_KEYS
+  /* This should possibly be taken from upper layers in the future */
+  packetbuf_set_attr(PACKETBUF_ATTR_KEY_ID_MODE, CSMA_LLSEC_KEY_ID_MODE);
+#endif /* LLSEC802154_USES_EXPLICIT_KEYS */
+#endif /* LLSEC802154_ENABLED */
+
+  /* Frame the packet once, before it is queued: retransmissions
+     reuse the frame, with its sequence number and frame counter */
+  if(csma_security_create_frame() < 0) {
+    /* Failed to allocate space for headers */
+    LOG_ERR("failed to create packet, seqno: %d\n", packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO));
+    mac_call_sent_callback(sent, ptr, MAC_TX_ERR_FATAL, 1);
+    return;
+  }
 
   /* Look for the neighbor entry */
   n = neighbor_queue_from_addr(addr);
@@ -459,15 +470,15 @@ csma_output_packet(mac_callback_t sent, void *ptr)
       n->transmissions = 0;
       n->collisions = 0;
       /* Init packet queue for this neighbor */
-      LIST_STRUCT_INIT(n, packet_queue);
+      TAIL_LIST_STRUCT_INIT(n, packet_queue);
       /* Add neighbor to the neighbor list */
-      list_add(neighbor_list, n);
+      tail_list_add(neighbor_list, n);
     }
   }
 
   if(n != NULL) {
     /* Add packet to the neighbor's queue */
-    if(list_length(n->packet_queue) < CSMA_MAX_PACKET_PER_NEIGHBOR) {
+    if(tail_list_length(n->packet_queue) < CSMA_MAX_PACKET_PER_NEIGHBOR) {
       q = memb_alloc(&packet_memb);
       if(q != NULL) {
         q->ptr = memb_alloc(&metadata_memb);
@@ -483,16 +494,16 @@ csma_output_packet(mac_callback_t sent, void *ptr)
             }
             metadata->sent = sent;
             metadata->cptr = ptr;
-            list_add(n->packet_queue, q);
+            tail_list_add(n->packet_queue, q);
 
             LOG_INFO("sending to ");
             LOG_INFO_LLADDR(addr);
             LOG_INFO_(", len %u, seqno %u, queue length %d, free packets %zu\n",
                     packetbuf_datalen(),
                     packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO),
-                    list_length(n->packet_queue), memb_numfree(&packet_memb));
+                    tail_list_length(n->packet_queue), memb_numfree(&packet_memb));
             /* If q is the first packet in the neighbor's queue, send asap */
-            if(list_head(n->packet_queue) == q) {
+            if(tail_list_head(n->packet_queue) == q) {
               schedule_transmission(n);
             }
             return;
@@ -504,8 +515,8 @@ csma_output_packet(mac_callback_t sent, void *ptr)
         LOG_WARN("could not allocate queuebuf, dropping packet\n");
       }
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
-      if(list_length(n->packet_queue) == 0) {
-        list_remove(neighbor_list, n);
+      if(tail_list_length(n->packet_queue) == 0) {
+        tail_list_remove(neighbor_list, n);
         memb_free(&neighbor_memb, n);
       }
     } else {
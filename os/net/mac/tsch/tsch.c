@@ -538,8 +538,9 @@ tsch_tx_process_pending(void)
   /* Loop on accessing (without removing) a pending input packet */
   while((dequeued_index = ringbufindex_peek_get(&dequeued_ringbuf)) != -1) {
     struct tsch_packet *p = dequeued_array[dequeued_index];
-    /* Put packet into packetbuf for packet_sent callback */
-    queuebuf_to_packetbuf(p->qb);
+    /* Put the packet attributes into packetbuf for packet_sent callback.
+       The frame stays in its queuebuf until the packet is freed. */
+    queuebuf_attr_to_packetbuf(p->qb);
     LOG_INFO("packet sent to ");
     LOG_INFO_LLADDR(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
     LOG_INFO_(", seqno %u, status %d, tx %d\n",
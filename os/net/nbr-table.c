@@ -70,6 +70,21 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_HASH_INDEX
+/* The number of slots in the hash index: the smallest power of two
+ * that keeps the load factor at or below one half. */
+#define HASH_SIZE_FITS(n) (2 * NBR_TABLE_MAX_NEIGHBORS <= (n))
+#define HASH_SIZE                                                       \
+  (HASH_SIZE_FITS(16) ? 16 : HASH_SIZE_FITS(32) ? 32 :                  \
+   HASH_SIZE_FITS(64) ? 64 : HASH_SIZE_FITS(128) ? 128 :                \
+   HASH_SIZE_FITS(256) ? 256 : HASH_SIZE_FITS(512) ? 512 :              \
+   HASH_SIZE_FITS(1024) ? 1024 : HASH_SIZE_FITS(2048) ? 2048 :          \
+   HASH_SIZE_FITS(4096) ? 4096 : 8192)
+#define HASH_MASK (HASH_SIZE - 1)
+/* Each slot holds the index of a neighbor plus one, or zero if empty. */
+static uint16_t hash_index[HASH_SIZE];
+#endif /* NBR_TABLE_HASH_INDEX */
+
 /*---------------------------------------------------------------------------*/
 static void remove_key(nbr_table_key_t *key, bool do_free);
 /*---------------------------------------------------------------------------*/
@@ -114,17 +129,89 @@ key_from_item(const nbr_table_t *table, const nbr_table_item_t *item)
 {
   return key_from_index(index_from_item(table, item));
 }
+#if NBR_TABLE_HASH_INDEX
+/*---------------------------------------------------------------------------*/
+/* Get the home slot of a link-layer address in the hash index */
+static unsigned
+hash_slot(const linkaddr_t *lladdr)
+{
+  /* FNV-1a over all bytes of the address */
+  uint32_t hash = 2166136261UL;
+  for(int i = 0; i < LINKADDR_SIZE; i++) {
+    hash = (hash ^ lladdr->u8[i]) * 16777619UL;
+  }
+  return (hash ^ (hash >> 16)) & HASH_MASK;
+}
+/*---------------------------------------------------------------------------*/
+/* Find the slot that holds a link-layer address, or -1 if there is none */
+static int
+hash_find(const linkaddr_t *lladdr)
+{
+  unsigned slot = hash_slot(lladdr);
+  while(hash_index[slot] != 0) {
+    if(linkaddr_cmp(lladdr, &key_from_index(hash_index[slot] - 1)->lladdr)) {
+      return slot;
+    }
+    slot = (slot + 1) & HASH_MASK;
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+/* Add a neighbor to the hash index, once its link-layer address is set */
+static void
+hash_insert(int index)
+{
+  unsigned slot = hash_slot(&key_from_index(index)->lladdr);
+  while(hash_index[slot] != 0) {
+    slot = (slot + 1) & HASH_MASK;
+  }
+  hash_index[slot] = index + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a neighbor from the hash index, before its link-layer address
+ * is changed. The entries that follow it in the same probe sequence
+ * are shifted backward, so that no tombstones are needed. */
+static void
+hash_remove(int index)
+{
+  int found = hash_find(&key_from_index(index)->lladdr);
+  if(found < 0) {
+    return;
+  }
+
+  unsigned hole = found;
+  unsigned slot = hole;
+  for(;;) {
+    slot = (slot + 1) & HASH_MASK;
+    if(hash_index[slot] == 0) {
+      break;
+    }
+    unsigned home = hash_slot(&key_from_index(hash_index[slot] - 1)->lladdr);
+    /* Move the entry into the hole unless its home slot lies
+     * cyclically within (hole, slot]. */
+    if(((slot - home) & HASH_MASK) >= ((slot - hole) & HASH_MASK)) {
+      hash_index[hole] = hash_index[slot];
+      hole = slot;
+    }
+  }
+  hash_index[hole] = 0;
+}
+#endif /* NBR_TABLE_HASH_INDEX */
 /*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
-  nbr_table_key_t *key;
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_HASH_INDEX
+  int slot = hash_find(lladdr);
+  return slot >= 0 ? hash_index[slot] - 1 : -1;
+#else /* NBR_TABLE_HASH_INDEX */
+  nbr_table_key_t *key;
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -133,6 +220,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     key = list_item_next(key);
   }
   return -1;
+#endif /* NBR_TABLE_HASH_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 /* Get bit from "used" or "locked" bitmap */
@@ -183,6 +271,9 @@ remove_key(nbr_table_key_t *key, bool do_free)
   locked_map[index_from_key(key)] = 0;
   /* Remove neighbor from list */
   list_remove(nbr_table_keys, key);
+#if NBR_TABLE_HASH_INDEX
+  hash_remove(index_from_key(key));
+#endif /* NBR_TABLE_HASH_INDEX */
   if(do_free) {
     /* Release the memory */
     memb_free(&neighbor_addr_mem, key);
@@ -430,6 +521,9 @@ nbr_table_add_lladdr(const nbr_table_t *table, const linkaddr_t *lladdr,
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_HASH_INDEX
+    hash_insert(index);
+#endif /* NBR_TABLE_HASH_INDEX */
   }
 
   /* Get item in the current table */
@@ -55,6 +55,16 @@ typedef enum {
 
 #define NBR_TABLE_MAX_NEIGHBORS NBR_TABLE_CONF_MAX_NEIGHBORS
 
+/* When enabled, neighbors are looked up by link-layer address through
+ * an open-addressing hash index rather than by a linear search. This
+ * costs four to eight bytes of RAM per neighbor, and is mostly useful when
+ * NBR_TABLE_MAX_NEIGHBORS is large. */
+#ifdef NBR_TABLE_CONF_HASH_INDEX
+#define NBR_TABLE_HASH_INDEX NBR_TABLE_CONF_HASH_INDEX
+#else /* NBR_TABLE_CONF_HASH_INDEX */
+#define NBR_TABLE_HASH_INDEX 0
+#endif /* NBR_TABLE_CONF_HASH_INDEX */
+
 #ifdef NBR_TABLE_CONF_GC_GET_WORST
 #define NBR_TABLE_GC_GET_WORST NBR_TABLE_CONF_GC_GET_WORST
 #else /* NBR_TABLE_CONF_GC_GET_WORST */
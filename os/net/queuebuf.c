@@ -60,6 +60,7 @@ struct queuebuf {
   int line;
   clock_time_t time;
 #endif /* QUEUEBUF_DEBUG */
+  uint8_t refs;
 #if WITH_SWAP
   enum {IN_RAM, IN_CFS} location;
   union {
@@ -319,6 +320,7 @@ queuebuf_new_from_packetbuf(void)
     buf->line = line;
     buf->time = clock_time();
 #endif /* QUEUEBUF_DEBUG */
+    buf->refs = 1;
     buf->ram_ptr = memb_alloc(&buframmem);
 #if WITH_SWAP
     /* If the allocation failed, store the qbuf in swap files */
@@ -392,10 +394,20 @@ queuebuf_update_from_packetbuf(struct queuebuf *buf)
 #endif
 }
 /*---------------------------------------------------------------------------*/
+struct queuebuf *
+queuebuf_ref(struct queuebuf *buf)
+{
+  if(memb_inmemb(&bufmem, buf) && buf->refs < UINT8_MAX) {
+    buf->refs++;
+    return buf;
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
 void
 queuebuf_free(struct queuebuf *buf)
 {
-  if(memb_inmemb(&bufmem, buf)) {
+  if(memb_inmemb(&bufmem, buf) && --buf->refs == 0) {
 #if WITH_SWAP
     if(buf->location == IN_RAM) {
       memb_free(&buframmem, buf->ram_ptr);
@@ -426,6 +438,16 @@ queuebuf_to_packetbuf(struct queuebuf *b)
   }
 }
 /*---------------------------------------------------------------------------*/
+void
+queuebuf_attr_to_packetbuf(struct queuebuf *b)
+{
+  if(memb_inmemb(&bufmem, b)) {
+    struct queuebuf_data *buframptr = queuebuf_load_to_ram(b);
+    packetbuf_clear();
+    packetbuf_attr_copyfrom(buframptr->attrs, buframptr->addrs);
+  }
+}
+/*---------------------------------------------------------------------------*/
 void *
 queuebuf_dataptr(struct queuebuf *b)
 {
@@ -48,6 +48,12 @@
  *
  * The queuebuf module handles buffers that are queued.
  *
+ * A queuebuf is reference counted. queuebuf_new_from_packetbuf()
+ * returns a buffer holding one reference, queuebuf_ref() adds one
+ * and queuebuf_free() drops one; the buffer is released with its
+ * last reference. A MAC layer can thereby frame a packet once and
+ * transmit every attempt straight from the queued frame.
+ *
  */
 
 #ifndef QUEUEBUF_H_
@@ -106,6 +112,12 @@ void queuebuf_update_attr_from_packetbuf(struct queuebuf *b);
 void queuebuf_update_from_packetbuf(struct queuebuf *b);
 
 void queuebuf_to_packetbuf(struct queuebuf *b);
+/* Clears packetbuf and restores only the attributes and addresses
+   of b, for callbacks that do not need the frame itself */
+void queuebuf_attr_to_packetbuf(struct queuebuf *b);
+/* Adds a reference to b. Returns b, or NULL if it cannot be shared */
+struct queuebuf *queuebuf_ref(struct queuebuf *b);
+/* Drops a reference to b, releasing it with the last one */
 void queuebuf_free(struct queuebuf *b);
 
 void *queuebuf_dataptr(struct queuebuf *b);
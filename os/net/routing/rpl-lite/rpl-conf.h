@@ -406,6 +406,24 @@
 #define RPL_LOOP_ERROR_DROP 0
 #endif /* RPL_CONF_LOOP_ERROR_DROP */
 
+/* The number of destinations for which the root caches the source routing
+ * header of downward packets, so that the header is not rebuilt from the
+ * non-storing graph for every packet. Cached headers are dropped whenever
+ * the graph changes. Set to 0 to disable the cache. */
+#ifdef RPL_CONF_SRH_CACHE_SIZE
+#define RPL_SRH_CACHE_SIZE RPL_CONF_SRH_CACHE_SIZE
+#else /* RPL_CONF_SRH_CACHE_SIZE */
+#define RPL_SRH_CACHE_SIZE 0
+#endif /* RPL_CONF_SRH_CACHE_SIZE */
+
+/* The maximum length of a cached source routing header, in bytes. Longer
+ * headers are built for every packet. */
+#ifdef RPL_CONF_SRH_CACHE_MAX_LEN
+#define RPL_SRH_CACHE_MAX_LEN RPL_CONF_SRH_CACHE_MAX_LEN
+#else /* RPL_CONF_SRH_CACHE_MAX_LEN */
+#define RPL_SRH_CACHE_MAX_LEN 128
+#endif /* RPL_CONF_SRH_CACHE_MAX_LEN */
+
 /** @} */
 
 #endif /* RPL_CONF_H */
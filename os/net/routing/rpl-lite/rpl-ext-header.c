@@ -173,6 +173,92 @@ count_matching_bytes(const void *p1, const void *p2, size_t n)
   }
   return n;
 }
+#if RPL_SRH_CACHE_SIZE > 0
+/*---------------------------------------------------------------------------*/
+/* A source routing header built at the root for a destination. It stays
+ * valid until the version of the non-storing graph changes. */
+struct srh_cache_entry {
+  uip_ipaddr_t destination;
+  uip_ipaddr_t next_hop;
+  uint32_t version;
+  uint8_t len; /* 0 if the entry is unused */
+  uint8_t hdr[RPL_SRH_CACHE_MAX_LEN];
+};
+static struct srh_cache_entry srh_cache[RPL_SRH_CACHE_SIZE];
+static uint8_t srh_cache_next;
+/*---------------------------------------------------------------------------*/
+static struct srh_cache_entry *
+srh_cache_lookup(const uip_ipaddr_t *destination)
+{
+  uint32_t version = uip_sr_version();
+
+  for(int i = 0; i < RPL_SRH_CACHE_SIZE; i++) {
+    if(srh_cache[i].len != 0 && srh_cache[i].version == version &&
+       uip_ipaddr_cmp(&srh_cache[i].destination, destination)) {
+      return &srh_cache[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+srh_cache_add(const uip_ipaddr_t *destination, const uip_ipaddr_t *next_hop,
+              const uint8_t *hdr, uint8_t len)
+{
+  struct srh_cache_entry *e = NULL;
+  uint32_t version = uip_sr_version();
+
+  if(len > RPL_SRH_CACHE_MAX_LEN) {
+    return;
+  }
+
+  /* Reuse a stale entry if there is one, else replace in turn. */
+  for(int i = 0; i < RPL_SRH_CACHE_SIZE; i++) {
+    if(srh_cache[i].len == 0 || srh_cache[i].version != version) {
+      e = &srh_cache[i];
+      break;
+    }
+  }
+  if(e == NULL) {
+    e = &srh_cache[srh_cache_next];
+    srh_cache_next = (srh_cache_next + 1) % RPL_SRH_CACHE_SIZE;
+  }
+
+  uip_ipaddr_copy(&e->destination, destination);
+  uip_ipaddr_copy(&e->next_hop, next_hop);
+  e->version = version;
+  e->len = len;
+  memcpy(e->hdr, hdr, len);
+}
+/*---------------------------------------------------------------------------*/
+/* Inserts a cached source routing header. Returns 1 on success, 0 on
+ * failure. */
+static int
+insert_cached_srh_header(const struct srh_cache_entry *e)
+{
+  struct uip_routing_hdr *rh_hdr = (struct uip_routing_hdr *)UIP_IP_PAYLOAD(0);
+
+  LOG_INFO("SRH using cached header of %u bytes\n", e->len);
+
+  if(uip_len + e->len > UIP_LINK_MTU) {
+    LOG_ERR("packet too long: impossible to add source routing header (%u bytes)\n", e->len);
+    return 0;
+  }
+
+  memmove(uip_buf + UIP_IPH_LEN + uip_ext_len + e->len,
+      uip_buf + UIP_IPH_LEN + uip_ext_len, uip_len - UIP_IPH_LEN);
+  memcpy(rh_hdr, e->hdr, e->len);
+
+  rh_hdr->next = UIP_IP_BUF->proto;
+  UIP_IP_BUF->proto = UIP_PROTO_ROUTING;
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &e->next_hop);
+
+  uipbuf_add_ext_hdr(e->len);
+  uipbuf_set_len_field(UIP_IP_BUF, uip_len - UIP_IPH_LEN);
+
+  return 1;
+}
+#endif /* RPL_SRH_CACHE_SIZE > 0 */
 /*---------------------------------------------------------------------------*/
 /* Used by rpl_ext_header_update to insert a RPL SRH extension header. This
  * is used at the root, to initiate downward routing. Returns 1 on success,
@@ -191,6 +277,9 @@ insert_srh_header(void)
   uip_sr_node_t *root_node;
   uip_sr_node_t *node;
   uip_ipaddr_t node_addr;
+#if RPL_SRH_CACHE_SIZE > 0
+  const struct srh_cache_entry *cached;
+#endif /* RPL_SRH_CACHE_SIZE > 0 */
 
   /* Always insest SRH as first extension header */
   struct uip_routing_hdr *rh_hdr = (struct uip_routing_hdr *)UIP_IP_PAYLOAD(0);
@@ -210,6 +299,13 @@ insert_srh_header(void)
     return 1;
   }
 
+#if RPL_SRH_CACHE_SIZE > 0
+  cached = srh_cache_lookup(&UIP_IP_BUF->destipaddr);
+  if(cached != NULL) {
+    return insert_cached_srh_header(cached);
+  }
+#endif /* RPL_SRH_CACHE_SIZE > 0 */
+
   dest_node = uip_sr_get_node(NULL, &UIP_IP_BUF->destipaddr);
   if(dest_node == NULL) {
     /* The destination is not found, skip SRH insertion */
@@ -305,6 +401,9 @@ insert_srh_header(void)
 
   /* The next hop (i.e. node whose parent is the root) is placed as the current IPv6 destination */
   NETSTACK_ROUTING.get_sr_node_ipaddr(&node_addr, node);
+#if RPL_SRH_CACHE_SIZE > 0
+  srh_cache_add(&UIP_IP_BUF->destipaddr, &node_addr, (uint8_t *)rh_hdr, ext_len);
+#endif /* RPL_SRH_CACHE_SIZE > 0 */
   uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &node_addr);
 
   /* Update the IPv6 length field */
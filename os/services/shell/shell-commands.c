@@ -46,7 +46,9 @@
 #include "shell.h"
 #include "shell-commands.h"
 #include "lib/list.h"
+#include "lib/memb.h"
 #include "sys/log.h"
+#include "sys/energest.h"
 #include "dev/watchdog.h"
 #include "net/ipv6/uip.h"
 #include "net/ipv6/uiplib.h"
@@ -488,6 +490,98 @@ PT_THREAD(cmd_macaddr(struct pt *pt, shell_output_func output, char *args))
 
   PT_END(pt);
 }
+#if MEMB_STATS
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(cmd_memb(struct pt *pt, shell_output_func output, char *args))
+{
+  struct memb *m;
+  memb_stats_t stats;
+
+  PT_BEGIN(pt);
+
+  SHELL_OUTPUT(output, "Memory blocks (used/max/total, failed alloc/free):\n");
+  for(m = memb_stats_list_head(); m != NULL; m = m->next) {
+    memb_stats(m, &stats);
+    SHELL_OUTPUT(output, "-- %s: %u/%u/%u of %u bytes, %u/%u\n",
+                 m->name, stats.allocated, stats.max_allocated, m->num,
+                 m->size, stats.alloc_failures, stats.free_failures);
+  }
+
+  PT_END(pt);
+}
+#endif /* MEMB_STATS */
+#if PROCESS_CONF_ENERGEST
+/*---------------------------------------------------------------------------*/
+static unsigned long
+energest_to_usec(uint64_t time)
+{
+  return (unsigned long)(time * 1000000 / ENERGEST_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(cmd_processes(struct pt *pt, shell_output_func output, char *args))
+{
+  struct process *p;
+
+  PT_BEGIN(pt);
+
+  energest_flush();
+  SHELL_OUTPUT(output, "Processes (calls, events, total ms, max us, CPU permil):\n");
+  for(p = PROCESS_LIST(); p != NULL; p = p->next) {
+    SHELL_OUTPUT(output, "-- %s: %lu, %lu, %lu, %lu, %lu\n",
+                 PROCESS_NAME_STRING(p),
+                 (unsigned long)p->energest.calls,
+                 (unsigned long)p->energest.events,
+                 energest_to_usec(p->energest.time) / 1000,
+                 energest_to_usec(p->energest.max_time),
+                 (unsigned long)(1000 * p->energest.time /
+                                 MAX(energest_type_time(ENERGEST_TYPE_CPU), 1)));
+  }
+
+  PT_END(pt);
+}
+#endif /* PROCESS_CONF_ENERGEST */
+#if PROCESS_CONF_HISTOGRAMS
+/*---------------------------------------------------------------------------*/
+static void
+output_histogram(shell_output_func output, const char *name,
+                 const process_histogram_t *h)
+{
+  char buf[160];
+
+  process_histogram_snprint(buf, sizeof(buf), h);
+  SHELL_OUTPUT(output, "-- %s (max %lu): %s\n", name,
+               (unsigned long)h->max, buf);
+}
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(cmd_event_loop(struct pt *pt, shell_output_func output, char *args))
+{
+  const process_histograms_t *h;
+  char *next_args;
+
+  PT_BEGIN(pt);
+
+  SHELL_ARGS_INIT(args, next_args);
+  SHELL_ARGS_NEXT(args, next_args);
+
+  h = process_get_histograms();
+  SHELL_OUTPUT(output, "Event loop histograms (%lu rtimer ticks per second):\n",
+               (unsigned long)RTIMER_SECOND);
+  output_histogram(output, "Event latency", &h->event_latency);
+  output_histogram(output, "Poll latency", &h->poll_latency);
+  output_histogram(output, "Run interval", &h->run_interval);
+  output_histogram(output, "Queue depth", &h->queue_depth);
+
+  if(args != NULL && !strcmp(args, "reset")) {
+    process_histograms_reset();
+    SHELL_OUTPUT(output, "Histograms reset\n");
+  }
+
+  PT_END(pt);
+}
+#endif /* PROCESS_CONF_HISTOGRAMS */
 #if NETSTACK_CONF_WITH_IPV6
 /*---------------------------------------------------------------------------*/
 static
@@ -998,6 +1092,15 @@ const struct shell_command_t builtin_shell_commands[] = {
   { "reboot",               cmd_reboot,               "'> reboot': Reboot the board by watchdog_reboot()" },
   { "log",                  cmd_log,                  "'> log module level': Sets log level (0--4) for a given module (or \"all\"). For module \"mac\", level 4 also enables per-slot logging." },
   { "mac-addr",             cmd_macaddr,               "'> mac-addr': Shows the node's MAC address" },
+#if MEMB_STATS
+  { "memb",                 cmd_memb,                 "'> memb': Shows the usage of all memory blocks" },
+#endif /* MEMB_STATS */
+#if PROCESS_CONF_ENERGEST
+  { "processes",            cmd_processes,            "'> processes': Shows the CPU time used by each running process" },
+#endif /* PROCESS_CONF_ENERGEST */
+#if PROCESS_CONF_HISTOGRAMS
+  { "event-loop",           cmd_event_loop,           "'> event-loop [reset]': Shows the event loop latency and queue depth histograms, and optionally resets them" },
+#endif /* PROCESS_CONF_HISTOGRAMS */
 #if NETSTACK_CONF_WITH_IPV6
   { "ip-addr",              cmd_ipaddr,               "'> ip-addr': Shows all IPv6 addresses" },
   { "ip-nbr",               cmd_ip_neighbors,         "'> ip-nbr': Shows all IPv6 neighbors" },
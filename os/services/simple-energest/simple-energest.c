@@ -45,6 +45,7 @@
 #include "sys/energest.h"
 #include "simple-energest.h"
 #include <stdio.h>
+#include <string.h>
 #include <limits.h>
 #include <inttypes.h>
 
@@ -56,6 +57,14 @@
 static uint64_t last_tx, last_rx, last_time, last_cpu, last_lpm, last_deep_lpm;
 
 PROCESS(simple_energest_process, "Simple Energest");
+
+#if PROCESS_CONF_ENERGEST
+/* The counters of each process at the end of the previous period. */
+static struct {
+  const struct process *p;
+  struct process_energest last;
+} process_history[SIMPLE_ENERGEST_MAX_PROCESSES];
+#endif /* PROCESS_CONF_ENERGEST */
 /*---------------------------------------------------------------------------*/
 static uint64_t
 to_permil(uint64_t delta_metric, uint64_t delta_time)
@@ -69,6 +78,75 @@ log_energest(const char *name, uint64_t delta, uint64_t delta_time)
   LOG_INFO("%-12s: %10"PRIu64"/%10"PRIu64" (%"PRIu64" permil)\n",
            name, delta, delta_time, to_permil(delta, delta_time));
 }
+#if PROCESS_CONF_ENERGEST
+/*---------------------------------------------------------------------------*/
+static struct process_energest *
+process_last(const struct process *p)
+{
+  int i;
+  int free_slot = -1;
+
+  for(i = 0; i < SIMPLE_ENERGEST_MAX_PROCESSES; i++) {
+    if(process_history[i].p == p) {
+      return &process_history[i].last;
+    }
+    if(process_history[i].p == NULL && free_slot < 0) {
+      free_slot = i;
+    }
+  }
+  if(free_slot < 0) {
+    return NULL;
+  }
+  process_history[free_slot].p = p;
+  memset(&process_history[free_slot].last, 0,
+         sizeof(process_history[free_slot].last));
+  return &process_history[free_slot].last;
+}
+/*---------------------------------------------------------------------------*/
+static void
+process_forget(const struct process *p)
+{
+  int i;
+
+  for(i = 0; i < SIMPLE_ENERGEST_MAX_PROCESSES; i++) {
+    if(process_history[i].p == p) {
+      process_history[i].p = NULL;
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+log_processes(uint64_t delta_time)
+{
+  struct process *p;
+  struct process_energest *last;
+  uint64_t delta;
+
+  LOG_INFO("Processes   : time/total (permil), calls, events, "
+           "max time since boot\n");
+  for(p = PROCESS_LIST(); p != NULL; p = p->next) {
+    last = process_last(p);
+    if(last == NULL) {
+      /* Out of slots: report the totals since boot */
+      LOG_INFO("%-12s: %10"PRIu64" since boot\n",
+               PROCESS_NAME_STRING(p), p->energest.time);
+      continue;
+    }
+    delta = p->energest.time - last->time;
+    if(p->energest.calls != last->calls) {
+      LOG_INFO("%-12s: %10"PRIu64"/%10"PRIu64" (%"PRIu64" permil), "
+               "%"PRIu32", %"PRIu32", %"PRIu32"\n",
+               PROCESS_NAME_STRING(p), delta, delta_time,
+               to_permil(delta, delta_time),
+               p->energest.calls - last->calls,
+               p->energest.events - last->events,
+               p->energest.max_time);
+    }
+    *last = p->energest;
+  }
+}
+#endif /* PROCESS_CONF_ENERGEST */
 /*---------------------------------------------------------------------------*/
 static void
 simple_energest_step(void)
@@ -98,6 +176,9 @@ simple_energest_step(void)
   log_energest("Radio Rx", curr_rx - last_rx, delta_time);
   log_energest("Radio total", curr_tx - last_tx + curr_rx - last_rx,
                delta_time);
+#if PROCESS_CONF_ENERGEST
+  log_processes(delta_time);
+#endif /* PROCESS_CONF_ENERGEST */
 
   last_time = curr_time;
   last_cpu = curr_cpu;
@@ -114,9 +195,18 @@ PROCESS_THREAD(simple_energest_process, ev, data)
 
   etimer_set(&periodic_timer, SIMPLE_ENERGEST_PERIOD);
   while(1) {
-    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&periodic_timer));
-    etimer_reset(&periodic_timer);
-    simple_energest_step();
+    PROCESS_WAIT_EVENT();
+#if PROCESS_CONF_ENERGEST
+    if(ev == PROCESS_EVENT_EXITED) {
+      /* Free the slot of the process, for processes started later */
+      process_forget(data);
+      continue;
+    }
+#endif /* PROCESS_CONF_ENERGEST */
+    if(etimer_expired(&periodic_timer)) {
+      etimer_reset(&periodic_timer);
+      simple_energest_step();
+    }
   }
   PROCESS_END();
 }
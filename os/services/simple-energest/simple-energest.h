@@ -54,6 +54,17 @@
 #define SIMPLE_ENERGEST_PERIOD (CLOCK_SECOND * 60)
 #endif /* SIMPLE_ENERGEST_CONF_PERIOD */
 
+/**
+ * \brief The number of processes whose CPU time is tracked between
+ * periods, when PROCESS_CONF_ENERGEST is enabled. The slot of a process
+ * is freed when it exits.
+ */
+#ifdef SIMPLE_ENERGEST_CONF_MAX_PROCESSES
+#define SIMPLE_ENERGEST_MAX_PROCESSES SIMPLE_ENERGEST_CONF_MAX_PROCESSES
+#else /* SIMPLE_ENERGEST_CONF_MAX_PROCESSES */
+#define SIMPLE_ENERGEST_MAX_PROCESSES 16
+#endif /* SIMPLE_ENERGEST_CONF_MAX_PROCESSES */
+
 /**
  * Initialize the deployment module
  */
@@ -49,11 +49,316 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
-static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
 PROCESS(etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
+#if ETIMER_WHEEL
+/*
+ * The timing wheel consists of ETIMER_WHEEL_LEVELS levels of
+ * ETIMER_WHEEL_SLOTS slots each. A slot on level L covers
+ * ETIMER_WHEEL_SLOTS^L clock ticks, so that level 0 has a resolution
+ * of one tick. A timer is stored on the lowest level on which its
+ * expiration time falls within the same window as the current wheel
+ * time. When the wheel time advances, the slots that have been passed
+ * are emptied, and their timers are either moved to the list of
+ * expired timers or cascaded to a lower level. Timers that expire
+ * beyond the range of the top level are hashed into that level and
+ * are re-examined once per revolution of it.
+ *
+ * Each timer records the index of the list it is on. Whether a timer
+ * is pending is decided by looking for it on that list, so that an
+ * etimer in memory that has never been initialized is not mistaken
+ * for a pending one.
+ */
+#ifdef ETIMER_CONF_WHEEL_SLOT_BITS
+#define ETIMER_WHEEL_SLOT_BITS ETIMER_CONF_WHEEL_SLOT_BITS
+#else
+#define ETIMER_WHEEL_SLOT_BITS 4
+#endif /* ETIMER_CONF_WHEEL_SLOT_BITS */
+
+#ifdef ETIMER_CONF_WHEEL_LEVELS
+#define ETIMER_WHEEL_LEVELS ETIMER_CONF_WHEEL_LEVELS
+#else
+#define ETIMER_WHEEL_LEVELS 4
+#endif /* ETIMER_CONF_WHEEL_LEVELS */
+
+#define ETIMER_WHEEL_SLOTS (1 << ETIMER_WHEEL_SLOT_BITS)
+#define ETIMER_WHEEL_MASK  (ETIMER_WHEEL_SLOTS - 1)
+
+static_assert(ETIMER_WHEEL_LEVELS > 0 &&
+              ETIMER_WHEEL_SLOT_BITS * ETIMER_WHEEL_LEVELS <=
+              8 * sizeof(clock_time_t),
+              "The etimer wheel must not span more bits than clock_time_t.");
+
+/* The slots of the wheel, level by level, followed by the expired list */
+#define WHEEL_SLOT(level, index) \
+  ((level) * ETIMER_WHEEL_SLOTS + ((index) & ETIMER_WHEEL_MASK))
+#define EXPIRED_LIST  (ETIMER_WHEEL_LEVELS * ETIMER_WHEEL_SLOTS)
+#define WHEEL_LISTS   (EXPIRED_LIST + 1)
+
+static_assert(WHEEL_LISTS <= UINT16_MAX,
+              "The etimer wheel has too many slots for the list index.");
+
+static struct etimer *lists[WHEEL_LISTS];
+static clock_time_t wheel_time;
+static unsigned wheel_count;
+/*---------------------------------------------------------------------------*/
+static inline clock_time_t
+expiration(const struct etimer *t)
+{
+  return t->timer.start + t->timer.interval;
+}
+/*---------------------------------------------------------------------------*/
+/* Return the pointer that links t into its list, or NULL if t is not
+   pending. Only the list index of t is trusted, and only after a range
+   check. */
+static struct etimer **
+find_link(const struct etimer *t)
+{
+  struct etimer **link;
+
+  if(t->p == PROCESS_NONE || t->list >= WHEEL_LISTS) {
+    return NULL;
+  }
+  for(link = &lists[t->list]; *link != NULL; link = &(*link)->next) {
+    if(*link == t) {
+      return link;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+link_timer(unsigned list, struct etimer *t)
+{
+  t->next = lists[list];
+  t->list = list;
+  lists[list] = t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+unlink_timer(struct etimer **link)
+{
+  struct etimer *t = *link;
+
+  *link = t->next;
+  t->next = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+slot_for(const struct etimer *t)
+{
+  clock_time_t exp;
+  int level;
+
+  /* Same expiration test as timer_expired(), but relative to the wheel. */
+  if(t->timer.interval < (clock_time_t)(wheel_time - t->timer.start) + 1) {
+    return EXPIRED_LIST;
+  }
+
+  exp = expiration(t);
+  for(level = 0; level < ETIMER_WHEEL_LEVELS - 1; level++) {
+    unsigned shift = (level + 1) * ETIMER_WHEEL_SLOT_BITS;
+    if((exp >> shift) == (wheel_time >> shift)) {
+      break;
+    }
+  }
+
+  return WHEEL_SLOT(level, exp >> (level * ETIMER_WHEEL_SLOT_BITS));
+}
+/*---------------------------------------------------------------------------*/
+static void
+cascade(unsigned slot)
+{
+  struct etimer *t, *next;
+
+  /* Detach the slot first, since timers may be re-inserted into it. */
+  t = lists[slot];
+  lists[slot] = NULL;
+  for(; t != NULL; t = next) {
+    next = t->next;
+    link_timer(slot_for(t), t);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+advance(clock_time_t now)
+{
+  clock_time_t then = wheel_time;
+  clock_time_t from, steps;
+  unsigned level, i;
+
+  wheel_time = now;
+
+  if(wheel_count == 0) {
+    return;
+  }
+
+  for(level = 0; level < ETIMER_WHEEL_LEVELS; level++) {
+    from = then >> (level * ETIMER_WHEEL_SLOT_BITS);
+    steps = (now >> (level * ETIMER_WHEEL_SLOT_BITS)) - from;
+    if(steps == 0) {
+      /* Neither this level nor any level above it has moved. */
+      break;
+    }
+    if(steps > ETIMER_WHEEL_SLOTS) {
+      steps = ETIMER_WHEEL_SLOTS;
+    }
+    for(i = 1; i <= steps; i++) {
+      cascade(WHEEL_SLOT(level, from + i));
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_time(void)
+{
+  clock_time_t best = 0;
+  bool found = false;
+  unsigned level, k;
+  struct etimer *t;
+
+  if(wheel_count == 0) {
+    next_expiration = 0;
+    return;
+  }
+
+  if(lists[EXPIRED_LIST] != NULL) {
+    next_expiration = wheel_time;
+    return;
+  }
+
+  /*
+   * Search the slots in order of increasing distance from the current
+   * wheel time. A slot k steps ahead on a level with a slot width of G
+   * ticks cannot hold a timer that expires sooner than k * G - (wheel_time
+   * mod G) ticks from now, so the search stops as soon as that bound
+   * exceeds the best candidate found so far.
+   */
+  for(level = 0; level < ETIMER_WHEEL_LEVELS; level++) {
+    unsigned shift = level * ETIMER_WHEEL_SLOT_BITS;
+    clock_time_t width = (clock_time_t)1 << shift;
+    clock_time_t offset = wheel_time & (width - 1);
+    clock_time_t index = wheel_time >> shift;
+
+    for(k = 1; k <= ETIMER_WHEEL_SLOTS; k++) {
+      if(found && k * width - offset >= best) {
+        break;
+      }
+      for(t = lists[WHEEL_SLOT(level, index + k)]; t != NULL; t = t->next) {
+        clock_time_t remaining = expiration(t) - wheel_time;
+        if(!found || remaining < best) {
+          best = remaining;
+          found = true;
+        }
+      }
+    }
+  }
+
+  next_expiration = wheel_time + best;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_timers(struct process *p)
+{
+  struct etimer **link;
+  unsigned list;
+
+  for(list = 0; list < WHEEL_LISTS; list++) {
+    for(link = &lists[list]; *link != NULL;) {
+      if((*link)->p == p) {
+        unlink_timer(link);
+        wheel_count--;
+      } else {
+        link = &(*link)->next;
+      }
+    }
+  }
+
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+static void
+post_expired_timers(void)
+{
+  struct etimer **link;
+  struct etimer *t;
+
+  advance(clock_time());
+
+  for(link = &lists[EXPIRED_LIST]; *link != NULL;) {
+    t = *link;
+    if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+      unlink_timer(link);
+      wheel_count--;
+      /* Reset the process ID of the event timer, to signal that the
+         etimer has expired. This is later checked in the
+         etimer_expired() function. */
+      t->p = PROCESS_NONE;
+    } else {
+      etimer_request_poll();
+      link = &t->next;
+    }
+  }
+
+  update_time();
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_timer(struct etimer *timer)
+{
+  struct etimer **link;
+  unsigned slot;
+  bool was_linked;
+
+  etimer_request_poll();
+
+  link = find_link(timer);
+  was_linked = link != NULL;
+  if(was_linked) {
+    unlink_timer(link);
+  } else {
+    wheel_count++;
+  }
+
+  timer->p = PROCESS_CURRENT();
+  advance(clock_time());
+  slot = slot_for(timer);
+  link_timer(slot, timer);
+
+  if(was_linked) {
+    /* The timer may have been the next one to expire. */
+    update_time();
+  } else if(slot == EXPIRED_LIST) {
+    next_expiration = wheel_time;
+  } else if(wheel_count == 1 ||
+            CLOCK_LT(expiration(timer), next_expiration)) {
+    next_expiration = expiration(timer);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_timer(struct etimer *et)
+{
+  struct etimer **link;
+
+  link = find_link(et);
+  if(link == NULL) {
+    return;
+  }
+
+  unlink_timer(link);
+  wheel_count--;
+  if(wheel_count == 0 || !CLOCK_LT(next_expiration, expiration(et))) {
+    /* The timer was due or was the next one to expire. */
+    update_time();
+  }
+}
+/*---------------------------------------------------------------------------*/
+#else /* ETIMER_WHEEL */
+static struct etimer *timerlist;
+/*---------------------------------------------------------------------------*/
 static void
 update_time(void)
 {
@@ -77,74 +382,58 @@ update_time(void)
   }
 }
 /*---------------------------------------------------------------------------*/
-PROCESS_THREAD(etimer_process, ev, data)
+static void
+remove_timers(struct process *p)
 {
-  struct etimer *t, *u;
-
-  PROCESS_BEGIN();
-
-  timerlist = NULL;
-
-  while(1) {
-    PROCESS_YIELD();
-
-    if(ev == PROCESS_EVENT_EXITED) {
-      struct process *p = data;
+  struct etimer *t;
 
-      while(timerlist != NULL && timerlist->p == p) {
-        timerlist = timerlist->next;
-      }
+  while(timerlist != NULL && timerlist->p == p) {
+    timerlist = timerlist->next;
+  }
 
-      if(timerlist != NULL) {
-        t = timerlist;
-        while(t->next != NULL) {
-          if(t->next->p == p) {
-            t->next = t->next->next;
-          } else {
-            t = t->next;
-          }
-        }
+  if(timerlist != NULL) {
+    t = timerlist;
+    while(t->next != NULL) {
+      if(t->next->p == p) {
+        t->next = t->next->next;
+      } else {
+        t = t->next;
       }
-      continue;
-    } else if(ev != PROCESS_EVENT_POLL) {
-      continue;
     }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+post_expired_timers(void)
+{
+  struct etimer *t, *u;
 
 again:
 
-    u = NULL;
+  u = NULL;
 
-    for(t = timerlist; t != NULL; t = t->next) {
-      if(timer_expired(&t->timer)) {
-        if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
-
-          /* Reset the process ID of the event timer, to signal that the
-             etimer has expired. This is later checked in the
-             etimer_expired() function. */
-          t->p = PROCESS_NONE;
-          if(u != NULL) {
-            u->next = t->next;
-          } else {
-            timerlist = t->next;
-          }
-          t->next = NULL;
-          update_time();
-          goto again;
+  for(t = timerlist; t != NULL; t = t->next) {
+    if(timer_expired(&t->timer)) {
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) == PROCESS_ERR_OK) {
+
+        /* Reset the process ID of the event timer, to signal that the
+           etimer has expired. This is later checked in the
+           etimer_expired() function. */
+        t->p = PROCESS_NONE;
+        if(u != NULL) {
+          u->next = t->next;
         } else {
-          etimer_request_poll();
+          timerlist = t->next;
         }
+        t->next = NULL;
+        update_time();
+        goto again;
+      } else {
+        etimer_request_poll();
       }
-      u = t;
     }
+    u = t;
   }
-
-  PROCESS_END();
-}
-/*---------------------------------------------------------------------------*/
-void
-etimer_request_poll(void)
-{
-  process_poll(&etimer_process);
 }
 /*---------------------------------------------------------------------------*/
 static void
@@ -173,6 +462,63 @@ add_timer(struct etimer *timer)
   update_time();
 }
 /*---------------------------------------------------------------------------*/
+static void
+remove_timer(struct etimer *et)
+{
+  struct etimer *t;
+
+  /* First check if et is the first event timer on the list. */
+  if(et == timerlist) {
+    timerlist = timerlist->next;
+    update_time();
+  } else {
+    /* Else walk through the list and try to find the item before the
+       et timer. */
+    for(t = timerlist; t != NULL && t->next != et; t = t->next) {
+    }
+
+    if(t != NULL) {
+      /* We've found the item before the event timer that we are about
+         to remove. We point the items next pointer to the event after
+         the removed item. */
+      t->next = et->next;
+
+      update_time();
+    }
+  }
+
+  /* Remove the next pointer from the item to be removed. */
+  et->next = NULL;
+}
+#endif /* ETIMER_WHEEL */
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(etimer_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+#if !ETIMER_WHEEL
+  timerlist = NULL;
+#endif /* !ETIMER_WHEEL */
+
+  while(1) {
+    PROCESS_YIELD();
+
+    if(ev == PROCESS_EVENT_EXITED) {
+      remove_timers(data);
+    } else if(ev == PROCESS_EVENT_POLL) {
+      post_expired_timers();
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_request_poll(void)
+{
+  process_poll(&etimer_process);
+}
+/*---------------------------------------------------------------------------*/
 void
 etimer_set(struct etimer *et, clock_time_t interval)
 {
@@ -205,7 +551,21 @@ etimer_restart(struct etimer *et)
 void
 etimer_adjust(struct etimer *et, int timediff)
 {
+#if ETIMER_WHEEL
+  struct etimer **link = find_link(et);
+
+  if(link != NULL) {
+    /* The timer must be moved to the slot of its new expiration time. */
+    unlink_timer(link);
+    et->timer.start += timediff;
+    advance(clock_time());
+    link_timer(slot_for(et), et);
+  } else {
+    et->timer.start += timediff;
+  }
+#else /* ETIMER_WHEEL */
   et->timer.start += timediff;
+#endif /* ETIMER_WHEEL */
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -224,7 +584,11 @@ etimer_start_time(struct etimer *et)
 int
 etimer_pending(void)
 {
+#if ETIMER_WHEEL
+  return wheel_count != 0;
+#else /* ETIMER_WHEEL */
   return timerlist != NULL;
+#endif /* ETIMER_WHEEL */
 }
 /*---------------------------------------------------------------------------*/
 clock_time_t
@@ -236,30 +600,8 @@ etimer_next_expiration_time(void)
 void
 etimer_stop(struct etimer *et)
 {
-  struct etimer *t;
+  remove_timer(et);
 
-  /* First check if et is the first event timer on the list. */
-  if(et == timerlist) {
-    timerlist = timerlist->next;
-    update_time();
-  } else {
-    /* Else walk through the list and try to find the item before the
-       et timer. */
-    for(t = timerlist; t != NULL && t->next != et; t = t->next) {
-    }
-
-    if(t != NULL) {
-      /* We've found the item before the event timer that we are about
-         to remove. We point the items next pointer to the event after
-         the removed item. */
-      t->next = et->next;
-
-      update_time();
-    }
-  }
-
-  /* Remove the next pointer from the item to be removed. */
-  et->next = NULL;
   /* Set the timer as expired */
   et->p = PROCESS_NONE;
 }
@@ -68,6 +68,22 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+/**
+ * ETIMER_CONF_WHEEL selects the data structure used for keeping track
+ * of pending event timers. By default, the timers are kept in a
+ * single unsorted list, which is small but makes every timer
+ * operation linear in the number of pending timers. When set to 1, a
+ * hierarchical timing wheel is used instead. Setting and stopping a
+ * timer then only walk the timers in the same wheel slot, and
+ * expiration is amortized constant-time, at the cost of a slightly
+ * larger etimer structure and a static table of list heads.
+ */
+#ifdef ETIMER_CONF_WHEEL
+#define ETIMER_WHEEL ETIMER_CONF_WHEEL
+#else
+#define ETIMER_WHEEL 0
+#endif /* ETIMER_CONF_WHEEL */
+
 /**
  * A timer.
  *
@@ -79,6 +95,9 @@
 struct etimer {
   struct timer timer;
   struct etimer *next;
+#if ETIMER_WHEEL
+  uint16_t list;
+#endif /* ETIMER_WHEEL */
   struct process *p;
 };
 
@@ -0,0 +1,469 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/**
+ * \addtogroup log-binary
+ * @{
+ *
+ * \file
+ *         Binary deferred logging.
+ */
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "sys/log.h"
+#include "sys/int-master.h"
+#include "lib/crc16.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#if CONTIKI_TARGET_NATIVE && !defined(LOG_BINARY_CONF_OUTPUT)
+#include <stdio.h>
+#endif
+/*---------------------------------------------------------------------------*/
+#if LOG_BINARY
+/*---------------------------------------------------------------------------*/
+#define BUFFER_MASK (LOG_BINARY_BUFFER_SIZE - 1)
+
+#define SLIP_END     0300
+#define SLIP_ESC     0333
+#define SLIP_ESC_END 0334
+#define SLIP_ESC_ESC 0335
+
+/* Provided by the linker for the section holding the descriptors. */
+extern const char __start_log_fmt[];
+
+static uint8_t buffer[LOG_BINARY_BUFFER_SIZE];
+static volatile unsigned buffer_head;
+static volatile unsigned buffer_tail;
+static struct log_binary_stats stats;
+static bool drain_pending;
+
+/* Worst case: every byte escaped, plus the CRC and two END bytes. */
+static uint8_t frame[2 * (LOG_BINARY_MAX_RECORD + 2) + 2];
+
+PROCESS(log_binary_process, "Binary log");
+/*---------------------------------------------------------------------------*/
+#ifdef LOG_BINARY_CONF_OUTPUT
+#define output(buf, len) LOG_BINARY_CONF_OUTPUT(buf, len)
+#define output_init()
+#define output_done()
+#elif CONTIKI_TARGET_NATIVE
+static FILE *output_file;
+
+static void
+output_init(void)
+{
+  output_file = fopen(LOG_BINARY_FILE, "wb");
+  if(output_file == NULL) {
+    output_file = stdout;
+  }
+}
+
+static void
+output(const uint8_t *buf, unsigned len)
+{
+  fwrite(buf, 1, len, output_file);
+}
+
+static void
+output_done(void)
+{
+  fflush(output_file);
+}
+#else /* CONTIKI_TARGET_NATIVE */
+#define output_init()
+#define output_done()
+
+static void
+output(const uint8_t *buf, unsigned len)
+{
+  while(len--) {
+    putchar(*buf++);
+  }
+}
+#endif /* LOG_BINARY_CONF_OUTPUT */
+/*---------------------------------------------------------------------------*/
+static void
+buffer_write(const uint8_t *record, unsigned len)
+{
+  int_master_status_t status;
+  unsigned used;
+  unsigned offset;
+  unsigned first;
+
+  status = int_master_read_and_disable();
+  used = buffer_head - buffer_tail;
+  if(LOG_BINARY_BUFFER_SIZE - used < len) {
+    stats.dropped++;
+    int_master_status_set(status);
+    return;
+  }
+
+  offset = buffer_head & BUFFER_MASK;
+  first = LOG_BINARY_BUFFER_SIZE - offset;
+  if(first >= len) {
+    memcpy(&buffer[offset], record, len);
+  } else {
+    memcpy(&buffer[offset], record, first);
+    memcpy(buffer, record + first, len - first);
+  }
+  buffer_head += len;
+  stats.records++;
+  if(used + len > stats.max_used) {
+    stats.max_used = used + len;
+  }
+  int_master_status_set(status);
+
+  process_poll(&log_binary_process);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+buffer_read(uint8_t *record)
+{
+  unsigned offset;
+  unsigned first;
+  unsigned len;
+
+  if(buffer_head == buffer_tail) {
+    return 0;
+  }
+
+  offset = buffer_tail & BUFFER_MASK;
+  len = buffer[offset];
+  first = LOG_BINARY_BUFFER_SIZE - offset;
+  if(first >= len) {
+    memcpy(record, &buffer[offset], len);
+  } else {
+    memcpy(record, &buffer[offset], first);
+    memcpy(record + first, buffer, len - first);
+  }
+  buffer_tail += len;
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+frame_add(uint8_t *p, uint8_t c)
+{
+  if(c == SLIP_END) {
+    *p++ = SLIP_ESC;
+    c = SLIP_ESC_END;
+  } else if(c == SLIP_ESC) {
+    *p++ = SLIP_ESC;
+    c = SLIP_ESC_ESC;
+  }
+  *p++ = c;
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_record(const uint8_t *record, unsigned len)
+{
+  uint8_t *p = frame;
+  unsigned short crc;
+  unsigned i;
+
+  crc = crc16_data(record, len, 0);
+  *p++ = SLIP_END;
+  for(i = 0; i < len; i++) {
+    p = frame_add(p, record[i]);
+  }
+  p = frame_add(p, crc & 0xff);
+  p = frame_add(p, crc >> 8);
+  *p++ = SLIP_END;
+  output(frame, p - frame);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+drain(unsigned max)
+{
+  uint8_t record[LOG_BINARY_MAX_RECORD];
+  unsigned count;
+  unsigned len;
+
+  for(count = 0; count < max; count++) {
+    len = buffer_read(record);
+    if(len == 0) {
+      break;
+    }
+    send_record(record, len);
+    stats.sent++;
+  }
+  if(count > 0) {
+    output_done();
+  }
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init_header(struct log_binary_header *hdr, uint8_t flags, uint16_t id)
+{
+  hdr->flags = flags;
+  hdr->id = id;
+  hdr->timestamp = (uint32_t)RTIMER_NOW();
+}
+/*---------------------------------------------------------------------------*/
+void
+log_binary_printf(const char *desc, uint8_t fmt_offset, uint8_t flags, ...)
+{
+  union {
+    struct log_binary_header hdr;
+    uint8_t u8[LOG_BINARY_MAX_RECORD];
+  } record;
+  uint8_t *p = record.u8 + sizeof(struct log_binary_header);
+  uint8_t *end = record.u8 + LOG_BINARY_MAX_RECORD;
+  const char *fmt = desc + fmt_offset;
+  ptrdiff_t id = desc - __start_log_fmt;
+  va_list ap;
+
+  if(id < 0 || id > UINT16_MAX) {
+    stats.dropped++;
+    return;
+  }
+  init_header(&record.hdr, flags, (uint16_t)id);
+
+  /*
+   * Copy the arguments without formatting them. Integers that are at
+   * most 32 bits wide are stored as 32 bits, so that the decoder only
+   * needs to know the width of long and of pointers. Strings are
+   * stored with a length byte, and truncated to fit in the record.
+   */
+  va_start(ap, flags);
+  while(*fmt != '\0') {
+    uint8_t longs = 0;
+    bool is_size = false;
+    uint32_t u32;
+    uint64_t u64;
+    double d;
+
+    if(*fmt++ != '%') {
+      continue;
+    }
+    if(*fmt == '%') {
+      fmt++;
+      continue;
+    }
+    while(*fmt == '-' || *fmt == '+' || *fmt == ' '
+          || *fmt == '#' || *fmt == '0') {
+      fmt++;
+    }
+    while((*fmt >= '0' && *fmt <= '9') || *fmt == '.' || *fmt == '*') {
+      if(*fmt == '*') {
+        u32 = (uint32_t)va_arg(ap, int);
+        if(end - p >= 4) {
+          memcpy(p, &u32, 4);
+          p += 4;
+        }
+      }
+      fmt++;
+    }
+    while(*fmt == 'h' || *fmt == 'l' || *fmt == 'L' || *fmt == 'z'
+          || *fmt == 'j' || *fmt == 't') {
+      if(*fmt == 'l') {
+        longs++;
+      } else if(*fmt == 'z' || *fmt == 'j' || *fmt == 't') {
+        is_size = true;
+      }
+      fmt++;
+    }
+
+    switch(*fmt) {
+    case '\0':
+      continue;
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+      if(longs >= 2) {
+        u64 = (uint64_t)va_arg(ap, unsigned long long);
+      } else if(longs == 1) {
+        u64 = (uint64_t)va_arg(ap, unsigned long);
+      } else if(is_size) {
+        u64 = (uint64_t)va_arg(ap, size_t);
+      } else {
+        u64 = (uint32_t)va_arg(ap, unsigned);
+      }
+      if(longs >= 2 || (longs == 1 && sizeof(long) > 4)
+         || (is_size && sizeof(size_t) > 4)) {
+        if(end - p >= 8) {
+          memcpy(p, &u64, 8);
+          p += 8;
+        }
+      } else {
+        u32 = (uint32_t)u64;
+        if(end - p >= 4) {
+          memcpy(p, &u32, 4);
+          p += 4;
+        }
+      }
+      break;
+    case 'p':
+      u64 = (uintptr_t)va_arg(ap, void *);
+      if(sizeof(void *) > 4) {
+        if(end - p >= 8) {
+          memcpy(p, &u64, 8);
+          p += 8;
+        }
+      } else {
+        u32 = (uint32_t)u64;
+        if(end - p >= 4) {
+          memcpy(p, &u32, 4);
+          p += 4;
+        }
+      }
+      break;
+    case 'e': case 'E': case 'f': case 'F': case 'g': case 'G':
+      d = va_arg(ap, double);
+      if(end - p >= 8) {
+        memcpy(p, &d, 8);
+        p += 8;
+      }
+      break;
+    case 's': {
+      const char *s = va_arg(ap, const char *);
+      size_t len = s != NULL ? strlen(s) : 0;
+      if(end - p >= 1) {
+        if(len > (size_t)(end - p - 1)) {
+          len = end - p - 1;
+        }
+        *p++ = (uint8_t)len;
+        if(len > 0) {
+          memcpy(p, s, len);
+          p += len;
+        }
+      }
+      break;
+    }
+    case 'n':
+      (void)va_arg(ap, int *);
+      break;
+    default:
+      break;
+    }
+    fmt++;
+  }
+  va_end(ap);
+
+  record.hdr.len = p - record.u8;
+  buffer_write(record.u8, record.hdr.len);
+}
+/*---------------------------------------------------------------------------*/
+void
+log_binary_write_data(uint8_t type, const void *data, unsigned len)
+{
+  union {
+    struct log_binary_header hdr;
+    uint8_t u8[LOG_BINARY_MAX_RECORD];
+  } record;
+
+  if(data == NULL) {
+    len = 0;
+  } else if(len > LOG_BINARY_MAX_RECORD - sizeof(struct log_binary_header)) {
+    len = LOG_BINARY_MAX_RECORD - sizeof(struct log_binary_header);
+  }
+  init_header(&record.hdr, LOG_BINARY_FLAGS(type, 0, 0), 0);
+  if(len > 0) {
+    memcpy(record.u8 + sizeof(struct log_binary_header), data, len);
+  }
+  record.hdr.len = sizeof(struct log_binary_header) + len;
+  buffer_write(record.u8, record.hdr.len);
+}
+/*---------------------------------------------------------------------------*/
+unsigned
+log_binary_flush(void)
+{
+  unsigned count = 0;
+  unsigned n;
+
+  do {
+    n = drain(LOG_BINARY_DRAIN_BATCH);
+    count += n;
+  } while(n > 0);
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+const struct log_binary_stats *
+log_binary_get_stats(void)
+{
+  return &stats;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(log_binary_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+
+    /*
+     * Writers poll the process, since polling is safe from interrupt
+     * context. The draining itself is deferred to a low-priority event,
+     * so that it runs after all pending higher-priority events.
+     */
+    if(ev == PROCESS_EVENT_POLL && !drain_pending) {
+      if(process_post_prio(PROCESS_CURRENT(), PROCESS_EVENT_CONTINUE, NULL,
+                           PROCESS_PRIO_LOW) == PROCESS_ERR_OK) {
+        drain_pending = true;
+      }
+    } else if(ev == PROCESS_EVENT_CONTINUE) {
+      drain_pending = false;
+      if(drain(LOG_BINARY_DRAIN_BATCH) == LOG_BINARY_DRAIN_BATCH) {
+        /* There may be more; come back after other events. */
+        process_poll(PROCESS_CURRENT());
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+log_binary_init(void)
+{
+  union {
+    struct log_binary_header hdr;
+    uint8_t u8[sizeof(struct log_binary_header) + 4];
+  } record;
+  uint32_t second = RTIMER_SECOND;
+
+  output_init();
+
+  /* Tell the decoder the rtimer rate, ahead of any buffered records. */
+  init_header(&record.hdr, LOG_BINARY_FLAGS(LOG_BINARY_TYPE_START, 0, 0), 0);
+  record.hdr.len = sizeof(record.u8);
+  memcpy(record.u8 + sizeof(struct log_binary_header), &second, 4);
+  send_record(record.u8, record.hdr.len);
+  output_done();
+
+  process_start(&log_binary_process, NULL);
+  if(buffer_head != buffer_tail) {
+    process_poll(&log_binary_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+#endif /* LOG_BINARY */
+/** @} */
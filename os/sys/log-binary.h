@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+/*---------------------------------------------------------------------------*/
+/** \addtogroup log
+ * @{
+ *
+ * \defgroup log-binary Binary deferred logging
+ *
+ * When LOG_CONF_BINARY is enabled, the LOG_* macros do not format
+ * their arguments on the node. Each format string is instead stored,
+ * together with the name of its module, in the log_fmt section of the
+ * firmware image, and its offset in that section serves as a message
+ * ID. At log time, a compact record holding the message ID, the log
+ * level, an rtimer timestamp and the raw arguments is written to a RAM
+ * ring buffer. The format string is only scanned to find out the type
+ * of each argument.
+ *
+ * A low-priority process drains the ring buffer, and sends each record
+ * in a SLIP frame followed by a CRC16. On the native platform, the
+ * frames are written to the file LOG_BINARY_CONF_FILE; on other
+ * platforms, they are written byte by byte with putchar(), so they can
+ * be interleaved with regular text output. A different output function
+ * can be configured with LOG_BINARY_CONF_OUTPUT.
+ *
+ * The host tool tools/log-binary/log-decode.py reads the log_fmt
+ * section from the ELF file of the firmware, and turns the records
+ * back into text.
+ *
+ * The per-module log levels are checked before a record is created,
+ * exactly as for the text-based logs. Format strings must be string
+ * literals, and LOG_MODULE must be a string literal as well.
+ * @{
+ */
+/*---------------------------------------------------------------------------*/
+#ifndef LOG_BINARY_H_
+#define LOG_BINARY_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki-conf.h"
+
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/* Size of the RAM ring buffer in bytes. Must be a power of two. */
+#ifdef LOG_BINARY_CONF_BUFFER_SIZE
+#define LOG_BINARY_BUFFER_SIZE LOG_BINARY_CONF_BUFFER_SIZE
+#else /* LOG_BINARY_CONF_BUFFER_SIZE */
+#define LOG_BINARY_BUFFER_SIZE 1024
+#endif /* LOG_BINARY_CONF_BUFFER_SIZE */
+
+/* Maximum size of a record, including its header. Arguments that do
+   not fit are left out of the record. */
+#ifdef LOG_BINARY_CONF_MAX_RECORD
+#define LOG_BINARY_MAX_RECORD LOG_BINARY_CONF_MAX_RECORD
+#else /* LOG_BINARY_CONF_MAX_RECORD */
+#define LOG_BINARY_MAX_RECORD 64
+#endif /* LOG_BINARY_CONF_MAX_RECORD */
+
+/* Maximum number of records sent per run of the drain process. */
+#ifdef LOG_BINARY_CONF_DRAIN_BATCH
+#define LOG_BINARY_DRAIN_BATCH LOG_BINARY_CONF_DRAIN_BATCH
+#else /* LOG_BINARY_CONF_DRAIN_BATCH */
+#define LOG_BINARY_DRAIN_BATCH 8
+#endif /* LOG_BINARY_CONF_DRAIN_BATCH */
+
+/* Output file on the native platform. */
+#ifdef LOG_BINARY_CONF_FILE
+#define LOG_BINARY_FILE LOG_BINARY_CONF_FILE
+#else /* LOG_BINARY_CONF_FILE */
+#define LOG_BINARY_FILE "log.bin"
+#endif /* LOG_BINARY_CONF_FILE */
+
+#if LOG_BINARY_BUFFER_SIZE & (LOG_BINARY_BUFFER_SIZE - 1)
+#error LOG_BINARY_CONF_BUFFER_SIZE must be a power of two
+#endif
+
+#if LOG_BINARY_MAX_RECORD > 255
+#error LOG_BINARY_CONF_MAX_RECORD must not exceed 255
+#endif
+/*---------------------------------------------------------------------------*/
+/** \name Record types
+ * @{
+ */
+#define LOG_BINARY_TYPE_MESSAGE        0 /**< A formatted log message */
+#define LOG_BINARY_TYPE_6ADDR          1 /**< An IPv6 address */
+#define LOG_BINARY_TYPE_6ADDR_COMPACT  2 /**< An IPv6 address, compact format */
+#define LOG_BINARY_TYPE_LLADDR         3 /**< A link-layer address */
+#define LOG_BINARY_TYPE_LLADDR_COMPACT 4 /**< A link-layer address, compact format */
+#define LOG_BINARY_TYPE_BYTES          5 /**< A byte array, printed as hex */
+#define LOG_BINARY_TYPE_START          6 /**< Sent once at startup */
+/** @} */
+
+/*
+ * A record starts with the following header, followed by the raw
+ * arguments in the byte order of the node. The flags hold the log
+ * level in bits 0-2, the newline bit (a message that starts a new log
+ * line) in bit 3, and the record type in bits 4-7.
+ */
+struct log_binary_header {
+  uint8_t len;
+  uint8_t flags;
+  uint16_t id;
+  uint32_t timestamp;
+};
+
+#define LOG_BINARY_FLAGS(type, newline, level) \
+  ((uint8_t)(((type) << 4) | ((newline) ? 0x08 : 0) | ((level) & 0x07)))
+
+/* The section in which format strings are stored. The name must be a
+   valid C identifier, so that the linker provides __start_log_fmt.
+   The strings are not padded, which keeps the message IDs small. */
+#define LOG_BINARY_SECTION __attribute__((section("log_fmt"), aligned(1)))
+
+/**
+ * Log a message in binary form. Called by the LOG macro.
+ * \param newline Non-zero if the message starts a new log line
+ * \param level The log level
+ * \param fmt The format string, which must be a string literal
+ */
+#define LOG_BINARY_MESSAGE(newline, level, fmt, ...) do { \
+    static const char log_binary_desc[] LOG_BINARY_SECTION = \
+      LOG_MODULE "\0" fmt; \
+    log_binary_printf(log_binary_desc, sizeof(LOG_MODULE), \
+                      LOG_BINARY_FLAGS(LOG_BINARY_TYPE_MESSAGE, \
+                                       newline, level), ##__VA_ARGS__); \
+  } while(0)
+/*---------------------------------------------------------------------------*/
+/**
+ * Statistics of the binary log.
+ */
+struct log_binary_stats {
+  uint32_t records;        /**< Records written to the ring buffer */
+  uint32_t dropped;        /**< Records dropped because the buffer was full */
+  uint32_t sent;           /**< Records sent by the drain process */
+  uint16_t max_used;       /**< Highest ring buffer occupancy in bytes */
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * Initialize the binary log and start the drain process.
+ */
+void log_binary_init(void);
+
+/**
+ * Write a message record. Use the LOG_* macros instead.
+ * \param desc The message descriptor in the log_fmt section: the
+ * module name and the format string, separated by a null character
+ * \param fmt_offset The offset of the format string in the descriptor
+ * \param flags The record flags, see LOG_BINARY_FLAGS
+ */
+void log_binary_printf(const char *desc, uint8_t fmt_offset,
+                       uint8_t flags, ...);
+
+/**
+ * Write a record that holds raw data, such as an address.
+ * \param type The record type
+ * \param data The data, or NULL
+ * \param len The length of the data
+ */
+void log_binary_write_data(uint8_t type, const void *data, unsigned len);
+
+/**
+ * Send all records in the ring buffer right away, for instance
+ * before a reboot.
+ * \return The number of records sent
+ */
+unsigned log_binary_flush(void);
+
+/**
+ * Get the statistics of the binary log.
+ * \return A pointer to the statistics
+ */
+const struct log_binary_stats *log_binary_get_stats(void);
+/*---------------------------------------------------------------------------*/
+#endif /* LOG_BINARY_H_ */
+/** @} */
+/** @} */
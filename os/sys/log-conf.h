@@ -82,6 +82,14 @@
 #define LOG_OUTPUT(...) printf(__VA_ARGS__)
 #endif /* LOG_CONF_OUTPUT */
 
+/* Store logs as compact binary records, to be formatted on a host.
+ * See sys/log-binary.h. Disabled by default */
+#ifdef LOG_CONF_BINARY
+#define LOG_BINARY LOG_CONF_BINARY
+#else /* LOG_CONF_BINARY */
+#define LOG_BINARY 0
+#endif /* LOG_CONF_BINARY */
+
 /* Color the prefix based on the log level. Disabled by default */
 #ifdef LOG_CONF_WITH_COLOR
 #define LOG_WITH_COLOR LOG_CONF_WITH_COLOR
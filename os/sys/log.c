@@ -90,9 +90,13 @@ struct log_module all_modules[] = {
 void
 log_6addr(const uip_ipaddr_t *ipaddr)
 {
+#if LOG_BINARY
+  log_binary_write_data(LOG_BINARY_TYPE_6ADDR, ipaddr, sizeof(uip_ipaddr_t));
+#else /* LOG_BINARY */
   char buf[UIPLIB_IPV6_MAX_STR_LEN];
   uiplib_ipaddr_snprint(buf, sizeof(buf), ipaddr);
   LOG_OUTPUT("%s", buf);
+#endif /* LOG_BINARY */
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -120,15 +124,22 @@ log_6addr_compact_snprint(char *buf, size_t size, const uip_ipaddr_t *ipaddr)
 void
 log_6addr_compact(const uip_ipaddr_t *ipaddr)
 {
+#if LOG_BINARY
+  log_binary_write_data(LOG_BINARY_TYPE_6ADDR_COMPACT, ipaddr, sizeof(uip_ipaddr_t));
+#else /* LOG_BINARY */
   char buf[8];
   log_6addr_compact_snprint(buf, sizeof(buf), ipaddr);
   LOG_OUTPUT("%s", buf);
+#endif /* LOG_BINARY */
 }
 #endif /* NETSTACK_CONF_WITH_IPV6 */
 /*---------------------------------------------------------------------------*/
 void
 log_lladdr(const linkaddr_t *lladdr)
 {
+#if LOG_BINARY
+  log_binary_write_data(LOG_BINARY_TYPE_LLADDR, lladdr, LINKADDR_SIZE);
+#else /* LOG_BINARY */
   if(lladdr == NULL) {
     LOG_OUTPUT("(NULL LL addr)");
     return;
@@ -141,11 +152,15 @@ log_lladdr(const linkaddr_t *lladdr)
       LOG_OUTPUT("%02x", lladdr->u8[i]);
     }
   }
+#endif /* LOG_BINARY */
 }
 /*---------------------------------------------------------------------------*/
 void
 log_lladdr_compact(const linkaddr_t *lladdr)
 {
+#if LOG_BINARY
+  log_binary_write_data(LOG_BINARY_TYPE_LLADDR_COMPACT, lladdr, LINKADDR_SIZE);
+#else /* LOG_BINARY */
   if(lladdr == NULL || linkaddr_cmp(lladdr, &linkaddr_null)) {
     LOG_OUTPUT("LL-NULL");
   } else {
@@ -159,16 +174,21 @@ log_lladdr_compact(const linkaddr_t *lladdr)
 #endif
 #endif /* BUILD_WITH_DEPLOYMENT */
   }
+#endif /* LOG_BINARY */
 }
 /*---------------------------------------------------------------------------*/
 void
 log_bytes(const void *data, size_t length)
 {
+#if LOG_BINARY
+  log_binary_write_data(LOG_BINARY_TYPE_BYTES, data, length);
+#else /* LOG_BINARY */
   const uint8_t *u8data = (const uint8_t *)data;
   size_t i;
   for(i = 0; i != length; ++i) {
     LOG_OUTPUT("%02x", u8data[i]);
   }
+#endif /* LOG_BINARY */
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -54,6 +54,7 @@
 #include <stdio.h>
 #include "net/linkaddr.h"
 #include "sys/log-conf.h"
+#include "sys/log-binary.h"
 #if NETSTACK_CONF_WITH_IPV6
 #include "net/ipv6/uip.h"
 #endif /* NETSTACK_CONF_WITH_IPV6 */
@@ -138,6 +139,13 @@ extern struct log_module all_modules[];
 
 /* Main log function */
 
+#if LOG_BINARY
+#define LOG(newline, level, levelstr, levelcolor, ...) do {  \
+                            if(level <= (LOG_LEVEL)) { \
+                              LOG_BINARY_MESSAGE(newline, level, __VA_ARGS__); \
+                            } \
+                          } while (0)
+#else /* LOG_BINARY */
 #define LOG(newline, level, levelstr, levelcolor, ...) do {  \
                             if(level <= (LOG_LEVEL)) { \
                               if(newline) { \
@@ -157,6 +165,7 @@ extern struct log_module all_modules[];
                               LOG_OUTPUT(__VA_ARGS__); \
                             } \
                           } while (0)
+#endif /* LOG_BINARY */
 
 /* For Cooja annotations */
 #define LOG_ANNOTATE(...) do {  \
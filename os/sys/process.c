@@ -44,9 +44,12 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "contiki.h"
 #include "sys/process.h"
+#include "sys/critical.h"
+#include "sys/energest.h"
 
 #include "sys/log.h"
 #define LOG_MODULE "Process"
@@ -65,6 +68,22 @@ static_assert(PROCESS_CONF_NUMEVENTS > 0 && PROCESS_CONF_NUMEVENTS <= 128,
 static_assert(!(PROCESS_CONF_NUMEVENTS & (PROCESS_CONF_NUMEVENTS - 1)),
   "PROCESS_CONF_NUMEVENTS must be a power of 2.");
 
+#if PROCESS_CONF_PRIORITIES
+static_assert(PROCESS_CONF_NUMEVENTS_HIGH > 0 &&
+              !(PROCESS_CONF_NUMEVENTS_HIGH & (PROCESS_CONF_NUMEVENTS_HIGH - 1)),
+  "PROCESS_CONF_NUMEVENTS_HIGH must be a power of 2.");
+static_assert(PROCESS_CONF_NUMEVENTS_LOW > 0 &&
+              !(PROCESS_CONF_NUMEVENTS_LOW & (PROCESS_CONF_NUMEVENTS_LOW - 1)),
+  "PROCESS_CONF_NUMEVENTS_LOW must be a power of 2.");
+static_assert(PROCESS_CONF_NUMEVENTS_HIGH + PROCESS_CONF_NUMEVENTS +
+              PROCESS_CONF_NUMEVENTS_LOW < 255,
+  "The event queues must hold fewer than 255 events in total.");
+#endif /* PROCESS_CONF_PRIORITIES */
+
+#if PROCESS_CONF_ENERGEST && !ENERGEST_CONF_ON
+#error "PROCESS_CONF_ENERGEST requires ENERGEST_CONF_ON"
+#endif
+
 /*
  * A configurable function called after a process poll been requested.
  */
@@ -90,22 +109,115 @@ struct event_data {
   process_data_t data;
   struct process *p;
   process_event_t ev;
+#if PROCESS_CONF_HISTOGRAMS
+  uint32_t post_time;
+#endif /* PROCESS_CONF_HISTOGRAMS */
+};
+
+/*
+ * A circular queue of events. The size must be a power of 2.
+ */
+struct event_queue {
+  struct event_data *events;
+  process_num_events_t size;
+  process_num_events_t nevents;
+  process_num_events_t fevent;
+#if PROCESS_CONF_STATS
+  process_queue_stats_t stats;
+#endif
 };
 
-static process_num_events_t nevents, fevent;
 static struct event_data events[PROCESS_CONF_NUMEVENTS];
 
+#if PROCESS_CONF_PRIORITIES
+static struct event_data events_high[PROCESS_CONF_NUMEVENTS_HIGH];
+static struct event_data events_low[PROCESS_CONF_NUMEVENTS_LOW];
+
+/* One queue per priority class, in order of decreasing priority. */
+static struct event_queue queues[PROCESS_PRIO_CLASSES] = {
+  { events_high, PROCESS_CONF_NUMEVENTS_HIGH },
+  { events, PROCESS_CONF_NUMEVENTS },
+  { events_low, PROCESS_CONF_NUMEVENTS_LOW },
+};
+#define QUEUE(prio) (&queues[prio])
+#define NUM_QUEUES  PROCESS_PRIO_CLASSES
+#else /* PROCESS_CONF_PRIORITIES */
+static struct event_queue queues[1] = {
+  { events, PROCESS_CONF_NUMEVENTS },
+};
+#define QUEUE(prio) (&queues[0])
+#define NUM_QUEUES  1
+#endif /* PROCESS_CONF_PRIORITIES */
+
+/* The total number of events in all queues. */
+static process_num_events_t nevents;
+
 #if PROCESS_CONF_STATS
 process_num_events_t process_maxevents;
 #endif
 
 static volatile bool poll_requested;
 
+/*
+ * The processes that have requested a poll, in order of request. A
+ * process is on the queue if and only if its needspoll flag is set.
+ * The queue is modified from interrupt context by process_poll().
+ */
+static struct process *poll_head, *poll_tail;
+
+#if PROCESS_CONF_HISTOGRAMS
+static process_histograms_t histograms;
+static uint32_t last_run_time;
+static bool has_run;
+#endif /* PROCESS_CONF_HISTOGRAMS */
+
+#if PROCESS_CONF_ENERGEST
+/* The run time of the processes that have been called from within
+   the invocation that is currently being measured. */
+static ENERGEST_TIME_T nested_time;
+#endif /* PROCESS_CONF_ENERGEST */
+
 #define PROCESS_STATE_NONE        0
 #define PROCESS_STATE_RUNNING     1
 #define PROCESS_STATE_CALLED      2
 
 static void call_process(struct process *p, process_event_t ev, process_data_t data);
+#if PROCESS_CONF_HISTOGRAMS
+/*---------------------------------------------------------------------------*/
+static uint32_t
+histogram_now(void)
+{
+  return (uint32_t)RTIMER_NOW();
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+histogram_elapsed(uint32_t then)
+{
+  uint32_t now = histogram_now();
+
+  /* Handle the wrap-around of rtimer clocks narrower than 32 bits. */
+  if(sizeof(rtimer_clock_t) < sizeof(uint32_t)) {
+    return (rtimer_clock_t)(now - then);
+  }
+  return now - then;
+}
+/*---------------------------------------------------------------------------*/
+static void
+histogram_add(process_histogram_t *h, uint32_t value)
+{
+  unsigned bucket;
+
+  for(bucket = 0; bucket < PROCESS_HISTOGRAM_BUCKETS - 1; bucket++) {
+    if(value < ((uint32_t)1 << bucket)) {
+      break;
+    }
+  }
+  h->buckets[bucket]++;
+  if(value > h->max) {
+    h->max = value;
+  }
+}
+#endif /* PROCESS_CONF_HISTOGRAMS */
 /*---------------------------------------------------------------------------*/
 process_event_t
 process_alloc_event(void)
@@ -209,7 +321,25 @@ call_process(struct process *p, process_event_t ev, process_data_t data)
             PROCESS_NAME_STRING(p), ev);
     process_current = p;
     p->state = PROCESS_STATE_CALLED;
+#if PROCESS_CONF_ENERGEST
+    ENERGEST_TIME_T start = ENERGEST_CURRENT_TIME();
+    ENERGEST_TIME_T outer_nested_time = nested_time;
+    nested_time = 0;
+#endif /* PROCESS_CONF_ENERGEST */
     int ret = p->thread(&p->pt, ev, data);
+#if PROCESS_CONF_ENERGEST
+    ENERGEST_TIME_T elapsed = ENERGEST_CURRENT_TIME() - start;
+    uint32_t self_time = (ENERGEST_TIME_T)(elapsed - nested_time);
+    p->energest.time += self_time;
+    if(self_time > p->energest.max_time) {
+      p->energest.max_time = self_time;
+    }
+    p->energest.calls++;
+    if(ev != PROCESS_EVENT_POLL) {
+      p->energest.events++;
+    }
+    nested_time = outer_nested_time + elapsed;
+#endif /* PROCESS_CONF_ENERGEST */
     if(ret == PT_EXITED || ret == PT_ENDED || ev == PROCESS_EVENT_EXIT) {
       exit_process(p, p);
     } else {
@@ -237,12 +367,28 @@ process_init(void)
 static void
 do_poll(void)
 {
+  struct process *p, *next;
+  int_master_status_t status;
+
+  /* Take the current queue. Processes that request a poll while the
+     queue is being serviced are handled in the next call. */
+  status = critical_enter();
+  p = poll_head;
+  poll_head = poll_tail = NULL;
   poll_requested = false;
+  critical_exit(status);
+
   /* Call the processes that needs to be polled. */
-  for(struct process *p = process_list; p != NULL; p = p->next) {
-    if(p->needspoll) {
+  for(; p != NULL; p = next) {
+    /* The next pointer must be read before the flag is cleared, since
+       the process may be put on the queue again after that. */
+    next = p->next_poll;
+    p->needspoll = false;
+#if PROCESS_CONF_HISTOGRAMS
+    histogram_add(&histograms.poll_latency, histogram_elapsed(p->poll_time));
+#endif /* PROCESS_CONF_HISTOGRAMS */
+    if(process_is_running(p)) {
       p->state = PROCESS_STATE_RUNNING;
-      p->needspoll = false;
       call_process(p, PROCESS_EVENT_POLL, NULL);
     }
   }
@@ -265,14 +411,25 @@ do_event(void)
    */
   if(nevents > 0) {
 
-    /* There are events that we should deliver. */
-    process_event_t ev = events[fevent].ev;
-    process_data_t data = events[fevent].data;
-    struct process *receiver = events[fevent].p;
+    /* There are events that we should deliver. Take the first one
+       from the queue with the highest priority. */
+    struct event_queue *q = queues;
+    while(q->nevents == 0) {
+      q++;
+    }
+
+    process_event_t ev = q->events[q->fevent].ev;
+    process_data_t data = q->events[q->fevent].data;
+    struct process *receiver = q->events[q->fevent].p;
+#if PROCESS_CONF_HISTOGRAMS
+    histogram_add(&histograms.event_latency,
+                  histogram_elapsed(q->events[q->fevent].post_time));
+#endif /* PROCESS_CONF_HISTOGRAMS */
 
     /* Since we have seen the new event, we move pointer upwards
        and decrease the number of events. */
-    fevent = (fevent + 1) % PROCESS_CONF_NUMEVENTS;
+    q->fevent = (q->fevent + 1) & (q->size - 1);
+    --q->nevents;
     --nevents;
 
     /* If this is a broadcast event, we deliver it to all events, in
@@ -304,6 +461,15 @@ do_event(void)
 process_num_events_t
 process_run(void)
 {
+#if PROCESS_CONF_HISTOGRAMS
+  uint32_t now = histogram_now();
+  if(has_run) {
+    histogram_add(&histograms.run_interval, histogram_elapsed(last_run_time));
+  }
+  last_run_time = now;
+  has_run = true;
+#endif /* PROCESS_CONF_HISTOGRAMS */
+
   /* Process poll events. */
   if(poll_requested) {
     do_poll();
@@ -322,13 +488,19 @@ process_nevents(void)
 }
 /*---------------------------------------------------------------------------*/
 int
-process_post(struct process *p, process_event_t ev, process_data_t data)
+process_post_prio(struct process *p, process_event_t ev, process_data_t data,
+                  process_prio_t prio)
 {
-  if(nevents == PROCESS_CONF_NUMEVENTS) {
+  struct event_queue *q = QUEUE(prio < NUM_QUEUES ? prio : NUM_QUEUES - 1);
+
+  if(q->nevents == q->size) {
     LOG_WARN("Cannot post event %d to %s from %s because the queue is full\n",
              ev,
              p == PROCESS_BROADCAST ? "<broadcast>" : PROCESS_NAME_STRING(p),
              PROCESS_NAME_STRING(process_current));
+#if PROCESS_CONF_STATS
+    q->stats.dropped++;
+#endif /* PROCESS_CONF_STATS */
     return PROCESS_ERR_FULL;
   }
 
@@ -338,13 +510,22 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
           nevents);
 
   process_num_events_t snum =
-    (process_num_events_t)(fevent + nevents) % PROCESS_CONF_NUMEVENTS;
-  events[snum].ev = ev;
-  events[snum].data = data;
-  events[snum].p = p;
+    (process_num_events_t)(q->fevent + q->nevents) & (q->size - 1);
+  q->events[snum].ev = ev;
+  q->events[snum].data = data;
+  q->events[snum].p = p;
+  ++q->nevents;
   ++nevents;
 
+#if PROCESS_CONF_HISTOGRAMS
+  q->events[snum].post_time = histogram_now();
+  histogram_add(&histograms.queue_depth, nevents);
+#endif /* PROCESS_CONF_HISTOGRAMS */
+
 #if PROCESS_CONF_STATS
+  if(q->nevents > q->stats.max_events) {
+    q->stats.max_events = q->nevents;
+  }
   if(nevents > process_maxevents) {
     process_maxevents = nevents;
   }
@@ -353,6 +534,12 @@ process_post(struct process *p, process_event_t ev, process_data_t data)
   return PROCESS_ERR_OK;
 }
 /*---------------------------------------------------------------------------*/
+int
+process_post(struct process *p, process_event_t ev, process_data_t data)
+{
+  return process_post_prio(p, ev, data, PROCESS_PRIO_NORMAL);
+}
+/*---------------------------------------------------------------------------*/
 void
 process_post_synch(struct process *p, process_event_t ev, process_data_t data)
 {
@@ -367,8 +554,22 @@ process_poll(struct process *p)
 {
   if(p != NULL &&
      (p->state == PROCESS_STATE_RUNNING || p->state == PROCESS_STATE_CALLED)) {
-    p->needspoll = true;
+    int_master_status_t status = critical_enter();
+    if(!p->needspoll) {
+      p->needspoll = true;
+      p->next_poll = NULL;
+#if PROCESS_CONF_HISTOGRAMS
+      p->poll_time = histogram_now();
+#endif /* PROCESS_CONF_HISTOGRAMS */
+      if(poll_tail != NULL) {
+        poll_tail->next_poll = p;
+      } else {
+        poll_head = p;
+      }
+      poll_tail = p;
+    }
     poll_requested = true;
+    critical_exit(status);
     PROCESS_POLL_REQUESTED();
   }
 }
@@ -379,4 +580,65 @@ process_is_running(struct process *p)
   return p->state != PROCESS_STATE_NONE;
 }
 /*---------------------------------------------------------------------------*/
+void
+process_queue_stats(process_prio_t prio, process_queue_stats_t *stats)
+{
+#if PROCESS_CONF_STATS
+  *stats = QUEUE(prio < NUM_QUEUES ? prio : NUM_QUEUES - 1)->stats;
+#else /* PROCESS_CONF_STATS */
+  stats->max_events = 0;
+  stats->dropped = 0;
+#endif /* PROCESS_CONF_STATS */
+}
+/*---------------------------------------------------------------------------*/
+const process_histograms_t *
+process_get_histograms(void)
+{
+#if PROCESS_CONF_HISTOGRAMS
+  return &histograms;
+#else /* PROCESS_CONF_HISTOGRAMS */
+  return NULL;
+#endif /* PROCESS_CONF_HISTOGRAMS */
+}
+/*---------------------------------------------------------------------------*/
+void
+process_histograms_reset(void)
+{
+#if PROCESS_CONF_HISTOGRAMS
+  memset(&histograms, 0, sizeof(histograms));
+  has_run = false;
+#endif /* PROCESS_CONF_HISTOGRAMS */
+}
+/*---------------------------------------------------------------------------*/
+int
+process_histogram_snprint(char *buf, size_t size, const process_histogram_t *h)
+{
+  int len = 0;
+  unsigned i;
+
+  if(size > 0) {
+    buf[0] = '\0';
+  }
+  for(i = 0; i < PROCESS_HISTOGRAM_BUCKETS; i++) {
+    char *out = (size_t)len < size ? buf + len : NULL;
+    size_t out_size = (size_t)len < size ? size - len : 0;
+
+    if(h->buckets[i] == 0) {
+      continue;
+    }
+    if(i <= 1) {
+      len += snprintf(out, out_size, "%s%u:%lu", len > 0 ? " " : "", i,
+                      (unsigned long)h->buckets[i]);
+    } else if(i == PROCESS_HISTOGRAM_BUCKETS - 1) {
+      len += snprintf(out, out_size, "%s%lu+:%lu", len > 0 ? " " : "",
+                      1ul << (i - 1), (unsigned long)h->buckets[i]);
+    } else {
+      len += snprintf(out, out_size, "%s%lu-%lu:%lu", len > 0 ? " " : "",
+                      1ul << (i - 1), (1ul << i) - 1,
+                      (unsigned long)h->buckets[i]);
+    }
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
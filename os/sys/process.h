@@ -54,6 +54,7 @@
 #define PROCESS_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "sys/pt.h"
 #include "sys/cc.h"
@@ -61,6 +62,7 @@
 typedef uint8_t       process_event_t;
 typedef void *        process_data_t;
 typedef uint8_t       process_num_events_t;
+typedef uint8_t       process_prio_t;
 
 /**
  * \name Return values
@@ -90,6 +92,77 @@ typedef uint8_t       process_num_events_t;
 #define PROCESS_CONF_NUMEVENTS 32
 #endif /* PROCESS_CONF_NUMEVENTS */
 
+/**
+ * \name Event priorities
+ *
+ * When PROCESS_CONF_PRIORITIES is enabled, asynchronous events are
+ * queued in one of three priority classes, each with its own queue.
+ * The kernel always delivers the oldest event of the highest
+ * non-empty class next, so events within a class are delivered in
+ * the order they were posted. The normal class holds
+ * PROCESS_CONF_NUMEVENTS events, and the high and low classes hold
+ * PROCESS_CONF_NUMEVENTS_HIGH and PROCESS_CONF_NUMEVENTS_LOW events.
+ * When PROCESS_CONF_PRIORITIES is disabled, all classes share a single
+ * queue of PROCESS_CONF_NUMEVENTS events.
+ *
+ * @{
+ */
+#ifndef PROCESS_CONF_PRIORITIES
+#define PROCESS_CONF_PRIORITIES 0
+#endif /* PROCESS_CONF_PRIORITIES */
+
+#ifndef PROCESS_CONF_NUMEVENTS_HIGH
+#define PROCESS_CONF_NUMEVENTS_HIGH 8
+#endif /* PROCESS_CONF_NUMEVENTS_HIGH */
+
+#ifndef PROCESS_CONF_NUMEVENTS_LOW
+#define PROCESS_CONF_NUMEVENTS_LOW 8
+#endif /* PROCESS_CONF_NUMEVENTS_LOW */
+
+#define PROCESS_PRIO_HIGH     0
+#define PROCESS_PRIO_NORMAL   1
+#define PROCESS_PRIO_LOW      2
+#define PROCESS_PRIO_CLASSES  3
+/** @} */
+
+/**
+ * \name Per-process CPU accounting
+ *
+ * When PROCESS_CONF_ENERGEST is enabled, the kernel measures every
+ * invocation of a process with the energest clock, and keeps the
+ * results in the process structure. Energest must be enabled as
+ * well. The time spent in a process that is called from within
+ * another one, e.g. with process_post_synch(), is only attributed to
+ * the called process.
+ *
+ * @{
+ */
+#ifndef PROCESS_CONF_ENERGEST
+#define PROCESS_CONF_ENERGEST 0
+#endif /* PROCESS_CONF_ENERGEST */
+/** @} */
+
+/**
+ * \name Event loop histograms
+ *
+ * When PROCESS_CONF_HISTOGRAMS is enabled, the kernel keeps
+ * histograms of the time that events wait in the queue, of the time
+ * that polls wait before the poll handler is called, of the time
+ * between consecutive calls to process_run(), and of the depth of the
+ * event queue. Times are measured in rtimer ticks. Bucket 0 of a
+ * histogram counts samples with the value 0, and bucket i > 0 counts
+ * samples in the range [2^(i-1), 2^i). The last bucket also counts all
+ * larger samples.
+ *
+ * @{
+ */
+#ifndef PROCESS_CONF_HISTOGRAMS
+#define PROCESS_CONF_HISTOGRAMS 0
+#endif /* PROCESS_CONF_HISTOGRAMS */
+
+#define PROCESS_HISTOGRAM_BUCKETS 16
+/** @} */
+
 #define PROCESS_EVENT_NONE            0x80
 #define PROCESS_EVENT_INIT            0x81
 #define PROCESS_EVENT_POLL            0x82
@@ -303,16 +376,31 @@ static PT_THREAD(process_thread_##name(struct pt *process_pt,	\
 #define PROCESS(name, strname)				\
   PROCESS_THREAD(name, ev, data);			\
   struct process name = { NULL,		        \
-                          process_thread_##name, {0}, 0, 0 }
+                          process_thread_##name, {0}, 0, 0, NULL }
 #else
 #define PROCESS(name, strname)				\
   PROCESS_THREAD(name, ev, data);			\
   struct process name = { NULL, strname,		\
-                          process_thread_##name, {0}, 0, 0 }
+                          process_thread_##name, {0}, 0, 0, NULL }
 #endif
 
 /** @} */
 
+/**
+ * CPU accounting of a process, in energest ticks (ENERGEST_SECOND
+ * ticks per second). The counters are kept when the process exits.
+ */
+struct process_energest {
+  /** The cumulative run time. */
+  uint64_t time;
+  /** The longest run time of a single invocation since boot. */
+  uint32_t max_time;
+  /** The number of invocations, including polls. */
+  uint32_t calls;
+  /** The number of events delivered, i.e., invocations except polls. */
+  uint32_t events;
+};
+
 struct process {
   struct process *next;
 #if PROCESS_CONF_NO_PROCESS_NAMES
@@ -325,6 +413,15 @@ struct process {
   struct pt pt;
   uint8_t state;
   bool needspoll;
+  /* The next process in the queue of processes to poll. */
+  struct process *next_poll;
+#if PROCESS_CONF_ENERGEST
+  struct process_energest energest;
+#endif /* PROCESS_CONF_ENERGEST */
+#if PROCESS_CONF_HISTOGRAMS
+  /* The time of the pending poll request, in rtimer ticks. */
+  uint32_t poll_time;
+#endif /* PROCESS_CONF_HISTOGRAMS */
 };
 
 /**
@@ -366,6 +463,30 @@ void process_start(struct process *p, process_data_t data);
  */
 int process_post(struct process *p, process_event_t ev, process_data_t data);
 
+/**
+ * Post an asynchronous event with a given priority.
+ *
+ * This function works like process_post(), but queues the event in
+ * the given priority class. process_post() uses PROCESS_PRIO_NORMAL.
+ *
+ * \param p The process to which the event should be posted, or
+ * PROCESS_BROADCAST if the event should be posted to all processes.
+ *
+ * \param ev The event to be posted.
+ *
+ * \param data The auxiliary data to be sent with the event
+ *
+ * \param prio The priority class: PROCESS_PRIO_HIGH,
+ * PROCESS_PRIO_NORMAL, or PROCESS_PRIO_LOW.
+ *
+ * \retval PROCESS_ERR_OK The event could be posted.
+ *
+ * \retval PROCESS_ERR_FULL The event queue of the priority class was
+ * full and the event could not be posted.
+ */
+int process_post_prio(struct process *p, process_event_t ev,
+                      process_data_t data, process_prio_t prio);
+
 /**
  * Post a synchronous event to a process.
  *
@@ -527,6 +648,80 @@ bool process_is_running(struct process *p);
  */
 process_num_events_t process_nevents(void);
 
+/**
+ * Statistics for the event queue of a priority class.
+ */
+typedef struct {
+  /** The largest number of events that have been queued at once. */
+  process_num_events_t max_events;
+  /** The number of events that could not be posted. */
+  uint32_t dropped;
+} process_queue_stats_t;
+
+/**
+ * Get the statistics of the event queue of a priority class.
+ *
+ * The statistics are only collected when PROCESS_CONF_STATS is
+ * enabled; otherwise, all counters are zero.
+ *
+ * \param prio The priority class.
+ * \param stats A pointer to an object to copy the statistics to.
+ */
+void process_queue_stats(process_prio_t prio, process_queue_stats_t *stats);
+
+/**
+ * A histogram with logarithmic buckets.
+ */
+typedef struct {
+  /** The number of samples in each bucket. */
+  uint32_t buckets[PROCESS_HISTOGRAM_BUCKETS];
+  /** The largest sample. */
+  uint32_t max;
+} process_histogram_t;
+
+/**
+ * The histograms of the event loop.
+ */
+typedef struct {
+  /** The time from process_post() to the delivery of the event. */
+  process_histogram_t event_latency;
+  /** The time from process_poll() to the call of the poll handler. */
+  process_histogram_t poll_latency;
+  /** The time between the starts of consecutive process_run() calls. */
+  process_histogram_t run_interval;
+  /** The number of queued events after each process_post(). */
+  process_histogram_t queue_depth;
+} process_histograms_t;
+
+/**
+ * Get the histograms of the event loop.
+ *
+ * The histograms are only collected when PROCESS_CONF_HISTOGRAMS is
+ * enabled; otherwise, NULL is returned.
+ *
+ * \return A pointer to the histograms, or NULL.
+ */
+const process_histograms_t *process_get_histograms(void);
+
+/**
+ * Clear the histograms of the event loop.
+ */
+void process_histograms_reset(void);
+
+/**
+ * Write the non-empty buckets of a histogram to a string, as a list
+ * of "range:count" pairs. The output is always null-terminated,
+ * unless size is 0.
+ *
+ * \param buf A pointer to an output string with at least size bytes.
+ * \param size The max number of characters to write to the output string.
+ * \param h The histogram.
+ * \return The number of characters that the complete output would
+ * need, as for snprintf().
+ */
+int process_histogram_snprint(char *buf, size_t size,
+                              const process_histogram_t *h);
+
 /** @} */
 
 extern struct process *process_list;
@@ -45,14 +45,176 @@
 
 #include "sys/rtimer.h"
 #include "contiki.h"
+#include "sys/critical.h"
+
+#include <string.h>
 
 #include "sys/log.h"
 #define LOG_MODULE "RTimer"
 #define LOG_LEVEL LOG_LEVEL_NONE
 
+#if RTIMER_MULTIPLEX
+/* The scheduled rtimers, sorted by deadline. */
+static struct rtimer *rtimer_queue;
+/* Set while rtimer_run_next() dispatches tasks. */
+static bool dispatching;
+#else /* RTIMER_MULTIPLEX */
 static struct rtimer *next_rtimer;
+#endif /* RTIMER_MULTIPLEX */
+
+#if RTIMER_STATS
+static rtimer_stats_t stats;
+#endif /* RTIMER_STATS */
+
+/*---------------------------------------------------------------------------*/
+#if RTIMER_STATS
+static void
+update_stats(const struct rtimer *t, rtimer_clock_t now)
+{
+  rtimer_clock_t lateness;
+  unsigned bucket;
+
+  stats.dispatched++;
+  if(!RTIMER_CLOCK_LT(t->time, now)) {
+    stats.histogram[0]++;
+    return;
+  }
+
+  lateness = now - t->time;
+  stats.late++;
+  stats.total_lateness += lateness;
+  if(lateness > stats.max_lateness) {
+    stats.max_lateness = lateness;
+  }
+
+  for(bucket = 1; bucket < RTIMER_STATS_BUCKETS - 1; bucket++) {
+    if(lateness < ((rtimer_clock_t)1 << bucket)) {
+      break;
+    }
+  }
+  stats.histogram[bucket]++;
+}
+#else /* RTIMER_STATS */
+#define update_stats(t, now)
+#endif /* RTIMER_STATS */
+/*---------------------------------------------------------------------------*/
+#if RTIMER_MULTIPLEX
+static bool
+dequeue(struct rtimer *rtimer)
+{
+  struct rtimer **tp;
+
+  for(tp = &rtimer_queue; *tp != NULL; tp = &(*tp)->next) {
+    if(*tp == rtimer) {
+      *tp = rtimer->next;
+      rtimer->next = NULL;
+      return true;
+    }
+  }
+  return false;
+}
+/*---------------------------------------------------------------------------*/
+int
+rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
+	   rtimer_clock_t duration,
+	   rtimer_callback_t func, void *ptr)
+{
+  struct rtimer **tp;
+  int_master_status_t status;
+  bool was_first;
+
+  LOG_DBG("rtimer_set time %lu\n", (unsigned long)time);
+
+  status = critical_enter();
+
+  was_first = rtimer_queue == rtimer;
+  dequeue(rtimer);
+
+  rtimer->func = func;
+  rtimer->ptr = ptr;
+  rtimer->time = time;
+
+  /* Tasks with the same deadline are dispatched in the order they
+     were scheduled. */
+  for(tp = &rtimer_queue; *tp != NULL; tp = &(*tp)->next) {
+    if(RTIMER_CLOCK_LT(time, (*tp)->time)) {
+      break;
+    }
+  }
+  rtimer->next = *tp;
+  *tp = rtimer;
+
+  /* Reprogram the hardware timer whenever the head of the queue
+     changes, including when the head was moved to a later deadline.
+     rtimer_run_next() programs it when it is done. */
+  if((rtimer_queue == rtimer || was_first) && !dispatching) {
+    rtimer_arch_schedule(rtimer_queue->time);
+  }
+
+  critical_exit(status);
+
+  return RTIMER_OK;
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_cancel(struct rtimer *rtimer)
+{
+  int_master_status_t status;
+  bool was_first;
+
+  status = critical_enter();
+
+  was_first = rtimer_queue == rtimer;
+  if(dequeue(rtimer) && was_first && rtimer_queue != NULL && !dispatching) {
+    rtimer_arch_schedule(rtimer_queue->time);
+  }
+
+  critical_exit(status);
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_run_next(void)
+{
+  struct rtimer *t;
+  rtimer_clock_t now;
+  int_master_status_t status;
+
+  if(rtimer_queue == NULL || dispatching) {
+    return;
+  }
+
+  dispatching = true;
 
+  /*
+   * The hardware timer has fired for the task at the head of the
+   * queue, so it is dispatched unconditionally. Any following tasks
+   * whose deadlines have passed in the meantime are dispatched in the
+   * same run.
+   */
+  now = RTIMER_NOW();
+  do {
+    status = critical_enter();
+    t = rtimer_queue;
+    rtimer_queue = t->next;
+    t->next = NULL;
+    critical_exit(status);
+
+    update_stats(t, now);
+    t->func(t, t->ptr);
+
+    now = RTIMER_NOW();
+  } while(rtimer_queue != NULL && !RTIMER_CLOCK_LT(now, rtimer_queue->time));
+
+  dispatching = false;
+
+  status = critical_enter();
+  if(rtimer_queue != NULL) {
+    rtimer_arch_schedule(rtimer_queue->time);
+  }
+  critical_exit(status);
+}
 /*---------------------------------------------------------------------------*/
+#else /* RTIMER_MULTIPLEX */
 int
 rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
 	   rtimer_clock_t duration,
@@ -75,6 +237,14 @@ rtimer_set(struct rtimer *rtimer, rtimer_clock_t time,
 }
 /*---------------------------------------------------------------------------*/
 void
+rtimer_cancel(struct rtimer *rtimer)
+{
+  if(next_rtimer == rtimer) {
+    next_rtimer = NULL;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
 rtimer_run_next(void)
 {
   struct rtimer *t;
@@ -83,8 +253,32 @@ rtimer_run_next(void)
   }
   t = next_rtimer;
   next_rtimer = NULL;
+  update_stats(t, RTIMER_NOW());
   t->func(t, t->ptr);
 }
+#endif /* RTIMER_MULTIPLEX */
+/*---------------------------------------------------------------------------*/
+void
+rtimer_stats(rtimer_stats_t *dst)
+{
+#if RTIMER_STATS
+  int_master_status_t status = critical_enter();
+  memcpy(dst, &stats, sizeof(*dst));
+  critical_exit(status);
+#else /* RTIMER_STATS */
+  memset(dst, 0, sizeof(*dst));
+#endif /* RTIMER_STATS */
+}
+/*---------------------------------------------------------------------------*/
+void
+rtimer_stats_reset(void)
+{
+#if RTIMER_STATS
+  int_master_status_t status = critical_enter();
+  memset(&stats, 0, sizeof(stats));
+  critical_exit(status);
+#endif /* RTIMER_STATS */
+}
 /*---------------------------------------------------------------------------*/
 
 /** @}*/
@@ -104,6 +104,33 @@ typedef uint64_t rtimer_clock_t;
 #define RTIMER_GUARD_TIME (RTIMER_ARCH_SECOND >> 14)
 #endif /* RTIMER_CONF_GUARD_TIME */
 
+/*
+ * RTIMER_CONF_MULTIPLEX enables any number of rtimers to be scheduled
+ * at the same time. The scheduled rtimers are kept in a queue sorted
+ * by deadline, and the hardware timer is always programmed with the
+ * earliest deadline. When disabled, only a single rtimer can be
+ * scheduled at a time, and rtimer_set() fails with
+ * RTIMER_ERR_ALREADY_SCHEDULED while another rtimer is pending.
+ */
+#ifdef RTIMER_CONF_MULTIPLEX
+#define RTIMER_MULTIPLEX RTIMER_CONF_MULTIPLEX
+#else /* RTIMER_CONF_MULTIPLEX */
+#define RTIMER_MULTIPLEX 0
+#endif /* RTIMER_CONF_MULTIPLEX */
+
+/*
+ * RTIMER_CONF_STATS enables statistics on how late rtimer tasks are
+ * dispatched relative to their deadlines. See rtimer_stats().
+ */
+#ifdef RTIMER_CONF_STATS
+#define RTIMER_STATS RTIMER_CONF_STATS
+#else /* RTIMER_CONF_STATS */
+#define RTIMER_STATS 0
+#endif /* RTIMER_CONF_STATS */
+
+/* The number of buckets in the histogram of dispatch lateness. */
+#define RTIMER_STATS_BUCKETS 12
+
 /*---------------------------------------------------------------------------*/
 
 /**
@@ -133,11 +160,32 @@ typedef void (* rtimer_callback_t)(struct rtimer *t, void *ptr);
  *             support module for the real-time module.
  */
 struct rtimer {
+#if RTIMER_MULTIPLEX
+  struct rtimer *next;
+#endif /* RTIMER_MULTIPLEX */
   rtimer_clock_t time;
   rtimer_callback_t func;
   void *ptr;
 };
 
+/**
+ * \brief      Statistics on the dispatch lateness of rtimer tasks
+ *
+ *             The lateness of a task is the number of rtimer ticks
+ *             between its deadline and the time at which its callback
+ *             is called. Bucket 0 of the histogram counts tasks that
+ *             were dispatched on time, and bucket i > 0 counts tasks
+ *             with a lateness in the range [2^(i-1), 2^i). The last
+ *             bucket also counts all tasks that were even later.
+ */
+typedef struct {
+  uint32_t dispatched;
+  uint32_t late;
+  uint32_t total_lateness;
+  rtimer_clock_t max_lateness;
+  uint32_t histogram[RTIMER_STATS_BUCKETS];
+} rtimer_stats_t;
+
 /**
  * TODO: we need to document meanings of these symbols.
  */
@@ -165,6 +213,29 @@ enum {
 int rtimer_set(struct rtimer *task, rtimer_clock_t time,
 	       rtimer_clock_t duration, rtimer_callback_t func, void *ptr);
 
+/**
+ * \brief      Cancel a scheduled real-time task.
+ * \param task A pointer to the task to cancel.
+ *
+ *             The callback of a cancelled task will not be called. It
+ *             is safe to cancel a task that is not scheduled.
+ */
+void rtimer_cancel(struct rtimer *task);
+
+/**
+ * \brief      Get the dispatch lateness statistics.
+ * \param stats A pointer to an object to copy the statistics to.
+ *
+ *             The statistics are only collected when RTIMER_CONF_STATS
+ *             is enabled; otherwise, all counters are zero.
+ */
+void rtimer_stats(rtimer_stats_t *stats);
+
+/**
+ * \brief      Reset the dispatch lateness statistics.
+ */
+void rtimer_stats_reset(void);
+
 /**
  * \brief      Execute the next real-time task and schedule the next task, if any
  *
@@ -151,5 +151,37 @@ main(void)
     (void)memb_free(&memb_pool, memb_block_p);
   }
 
+#if MEMB_STATS
+  /*
+   * NUM_MEMB_BLOCKS blocks were allocated at most, one allocation
+   * failed, and the double frees and the invalid free failed.
+   */
+  memb_stats_t stats;
+  memb_stats(&memb_pool, &stats);
+  if(stats.allocated != 0 || stats.max_allocated != NUM_MEMB_BLOCKS ||
+     stats.alloc_failures != 1 || stats.free_failures != NUM_MEMB_BLOCKS + 1) {
+    printf("test failed: memb_stats() returns %u/%u/%u/%u\n",
+           stats.allocated, stats.max_allocated,
+           stats.alloc_failures, stats.free_failures);
+    return -1;
+  } else if(memb_stats_list_head() != &memb_pool ||
+            memb_pool.next != NULL) {
+    printf("test failed: memb_pool is not registered once\n");
+    return -1;
+  } else {
+    printf("- memb_stats is OK\n");
+  }
+
+  memb_stats_reset(&memb_pool);
+  memb_stats(&memb_pool, &stats);
+  if(stats.max_allocated != 0 || stats.alloc_failures != 0 ||
+     stats.free_failures != 0) {
+    printf("test failed: memb_stats_reset() did not reset the counters\n");
+    return -1;
+  } else {
+    printf("- memb_stats_reset is OK\n");
+  }
+#endif /* MEMB_STATS */
+
   return 0;
 }
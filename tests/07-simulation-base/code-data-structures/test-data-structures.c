@@ -36,6 +36,7 @@
 #include "lib/circular-list.h"
 #include "lib/dbl-list.h"
 #include "lib/dbl-circ-list.h"
+#include "lib/tail-list.h"
 #include "lib/random.h"
 #include "services/unit-test/unit-test.h"
 
@@ -214,6 +215,100 @@ UNIT_TEST(test_list)
   UNIT_TEST_END();
 }
 /*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_tail_list, "Singly-linked list with tail pointer");
+UNIT_TEST(test_tail_list)
+{
+  demo_struct_t *head, *tail;
+
+  TAIL_LIST(lst);
+
+  UNIT_TEST_BEGIN();
+
+  memset(elements, 0, sizeof(elements));
+  tail_list_init(lst);
+
+  /* Starts from empty */
+  UNIT_TEST_ASSERT(tail_list_head(lst) == NULL);
+  UNIT_TEST_ASSERT(tail_list_tail(lst) == NULL);
+  UNIT_TEST_ASSERT(tail_list_length(lst) == 0);
+  UNIT_TEST_ASSERT(tail_list_pop(lst) == NULL);
+  UNIT_TEST_ASSERT(tail_list_chop(lst) == NULL);
+
+  /*
+   * Add two items. The second should be the tail
+   * 0 --> 1 --> NULL
+   */
+  tail_list_add(lst, &elements[0]);
+  UNIT_TEST_ASSERT(tail_list_head(lst) == &elements[0]);
+  UNIT_TEST_ASSERT(tail_list_tail(lst) == &elements[0]);
+  tail_list_add(lst, &elements[1]);
+  head = tail_list_head(lst);
+  tail = tail_list_tail(lst);
+  UNIT_TEST_ASSERT(head == &elements[0]);
+  UNIT_TEST_ASSERT(tail == &elements[1]);
+  UNIT_TEST_ASSERT(head->next == tail);
+  UNIT_TEST_ASSERT(tail->next == NULL);
+  UNIT_TEST_ASSERT(tail_list_length(lst) == 2);
+
+  /*
+   * Push an item and insert one after the tail
+   * 2 --> 0 --> 1 --> 3 --> NULL
+   */
+  tail_list_push(lst, &elements[2]);
+  tail_list_insert(lst, tail_list_tail(lst), &elements[3]);
+  UNIT_TEST_ASSERT(tail_list_head(lst) == &elements[2]);
+  UNIT_TEST_ASSERT(tail_list_tail(lst) == &elements[3]);
+  UNIT_TEST_ASSERT(elements[2].next == &elements[0]);
+  UNIT_TEST_ASSERT(elements[1].next == &elements[3]);
+  UNIT_TEST_ASSERT(elements[3].next == NULL);
+  UNIT_TEST_ASSERT(tail_list_length(lst) == 4);
+
+  /*
+   * Insert an item in the middle
+   * 2 --> 4 --> 0 --> 1 --> 3 --> NULL
+   */
+  tail_list_insert(lst, &elements[2], &elements[4]);
+  UNIT_TEST_ASSERT(elements[2].next == &elements[4]);
+  UNIT_TEST_ASSERT(elements[4].next == &elements[0]);
+  UNIT_TEST_ASSERT(tail_list_tail(lst) == &elements[3]);
+  UNIT_TEST_ASSERT(tail_list_length(lst) == 5);
+  UNIT_TEST_ASSERT(tail_list_contains(lst, &elements[4]));
+  UNIT_TEST_ASSERT(!tail_list_contains(lst, &elements[5]));
+
+  /*
+   * Remove the tail, an item in the middle, and an item that is not
+   * on the list
+   * 2 --> 0 --> 1 --> NULL
+   */
+  UNIT_TEST_ASSERT(tail_list_chop(lst) == &elements[3]);
+  tail_list_remove(lst, &elements[4]);
+  tail_list_remove(lst, &elements[5]);
+  UNIT_TEST_ASSERT(tail_list_tail(lst) == &elements[1]);
+  UNIT_TEST_ASSERT(elements[2].next == &elements[0]);
+  UNIT_TEST_ASSERT(tail_list_length(lst) == 3);
+
+  /*
+   * Remove the tail with tail_list_remove and append a new item
+   * 2 --> 0 --> 5 --> NULL
+   */
+  tail_list_remove(lst, &elements[1]);
+  UNIT_TEST_ASSERT(tail_list_tail(lst) == &elements[0]);
+  tail_list_add(lst, &elements[5]);
+  UNIT_TEST_ASSERT(elements[0].next == &elements[5]);
+  UNIT_TEST_ASSERT(tail_list_tail(lst) == &elements[5]);
+  UNIT_TEST_ASSERT(tail_list_length(lst) == 3);
+
+  /* Ends empty */
+  UNIT_TEST_ASSERT(tail_list_pop(lst) == &elements[2]);
+  UNIT_TEST_ASSERT(tail_list_pop(lst) == &elements[0]);
+  UNIT_TEST_ASSERT(tail_list_pop(lst) == &elements[5]);
+  UNIT_TEST_ASSERT(tail_list_head(lst) == NULL);
+  UNIT_TEST_ASSERT(tail_list_tail(lst) == NULL);
+  UNIT_TEST_ASSERT(tail_list_length(lst) == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
 UNIT_TEST_REGISTER(test_stack, "Stack Push/Pop");
 UNIT_TEST(test_stack)
 {
@@ -1034,6 +1129,7 @@ PROCESS_THREAD(data_structure_test_process, ev, data)
   memset(elements, 0, sizeof(elements));
 
   UNIT_TEST_RUN(test_list);
+  UNIT_TEST_RUN(test_tail_list);
   UNIT_TEST_RUN(test_stack);
   UNIT_TEST_RUN(test_queue);
   UNIT_TEST_RUN(test_csll);
@@ -345,6 +345,121 @@ UNIT_TEST(test_ringbufindex_empty)
   UNIT_TEST_END();
 }
 
+UNIT_TEST_REGISTER(test_ringbufindex_put_n, "PutN");
+UNIT_TEST(test_ringbufindex_put_n)
+{
+  int ret;
+  uint16_t n;
+
+  UNIT_TEST_BEGIN();
+
+  ringbufindex_init(&ri, 8);
+
+  /* Reserve more than there is space for; 7 items fit */
+  n = 10;
+  ret = ringbufindex_peek_put_n(&ri, &n);
+  UNIT_TEST_ASSERT(ret == 0 && n == 7 && ri.put_ptr == 0 && ri.get_ptr == 0);
+
+  /* Put 5 items */
+  ret = ringbufindex_put_n(&ri, 5);
+  UNIT_TEST_ASSERT(ret == 1 && ri.put_ptr == 5 && ri.get_ptr == 0);
+
+  /* There is no space for 3 more items */
+  ret = ringbufindex_put_n(&ri, 3);
+  UNIT_TEST_ASSERT(ret == 0 && ri.put_ptr == 5 && ri.get_ptr == 0);
+
+  /* Get 4 items */
+  ret = ringbufindex_get_n(&ri, 4);
+  UNIT_TEST_ASSERT(ret == 1 && ri.put_ptr == 5 && ri.get_ptr == 4);
+
+  /* The reservation stops at the end of the array */
+  n = 6;
+  ret = ringbufindex_peek_put_n(&ri, &n);
+  UNIT_TEST_ASSERT(ret == 5 && n == 3 && ri.put_ptr == 5 && ri.get_ptr == 4);
+
+  /* Putting may wrap around */
+  ret = ringbufindex_put_n(&ri, 6);
+  UNIT_TEST_ASSERT(ret == 1 && ri.put_ptr == 3 && ri.get_ptr == 4);
+  UNIT_TEST_ASSERT(ringbufindex_full(&ri));
+
+  n = 1;
+  ret = ringbufindex_peek_put_n(&ri, &n);
+  UNIT_TEST_ASSERT(ret == -1 && n == 0);
+
+  UNIT_TEST_END();
+}
+
+UNIT_TEST_REGISTER(test_ringbufindex_get_n, "GetN");
+UNIT_TEST(test_ringbufindex_get_n)
+{
+  int ret;
+  uint16_t n;
+
+  UNIT_TEST_BEGIN();
+
+  ringbufindex_init(&ri, 8);
+
+  /* Nothing in ringbuf */
+  n = 4;
+  ret = ringbufindex_peek_get_n(&ri, &n);
+  UNIT_TEST_ASSERT(ret == -1 && n == 0);
+  ret = ringbufindex_get_n(&ri, 1);
+  UNIT_TEST_ASSERT(ret == 0 && ri.put_ptr == 0 && ri.get_ptr == 0);
+
+  /* Move to the end of the array, then put 5 items */
+  ringbufindex_put_n(&ri, 6);
+  ringbufindex_get_n(&ri, 6);
+  ret = ringbufindex_put_n(&ri, 5);
+  UNIT_TEST_ASSERT(ret == 1 && ri.put_ptr == 3 && ri.get_ptr == 6);
+
+  /* The first batch stops at the end of the array */
+  n = 8;
+  ret = ringbufindex_peek_get_n(&ri, &n);
+  UNIT_TEST_ASSERT(ret == 6 && n == 2 && ri.put_ptr == 3 && ri.get_ptr == 6);
+  ret = ringbufindex_get_n(&ri, n);
+  UNIT_TEST_ASSERT(ret == 1 && ri.put_ptr == 3 && ri.get_ptr == 0);
+
+  /* The second batch has at most as many items as asked for */
+  n = 2;
+  ret = ringbufindex_peek_get_n(&ri, &n);
+  UNIT_TEST_ASSERT(ret == 0 && n == 2 && ri.put_ptr == 3 && ri.get_ptr == 0);
+
+  /* Getting more items than there are fails */
+  ret = ringbufindex_get_n(&ri, 4);
+  UNIT_TEST_ASSERT(ret == 0 && ri.put_ptr == 3 && ri.get_ptr == 0);
+  ret = ringbufindex_get_n(&ri, 3);
+  UNIT_TEST_ASSERT(ret == 1 && ri.put_ptr == 3 && ri.get_ptr == 3);
+  UNIT_TEST_ASSERT(ringbufindex_empty(&ri));
+
+  UNIT_TEST_END();
+}
+
+UNIT_TEST_REGISTER(test_ringbufindex_large, "Large");
+UNIT_TEST(test_ringbufindex_large)
+{
+  int ret;
+  uint16_t n;
+
+  UNIT_TEST_BEGIN();
+
+  ringbufindex_init(&ri, 1024);
+
+  ret = ringbufindex_size(&ri);
+  UNIT_TEST_ASSERT(ret == 1024);
+
+  ret = ringbufindex_put_n(&ri, 1000);
+  UNIT_TEST_ASSERT(ret == 1 && ringbufindex_elements(&ri) == 1000);
+
+  n = 1024;
+  ret = ringbufindex_peek_put_n(&ri, &n);
+  UNIT_TEST_ASSERT(ret == 1000 && n == 23);
+
+  ret = ringbufindex_get(&ri);
+  UNIT_TEST_ASSERT(ret == 0 && ringbufindex_elements(&ri) == 999);
+
+  UNIT_TEST_END();
+}
+
 PROCESS_THREAD(test_process, ev, data)
 {
   PROCESS_BEGIN();
@@ -360,6 +475,9 @@ PROCESS_THREAD(test_process, ev, data)
   UNIT_TEST_RUN(test_ringbufindex_elements);
   UNIT_TEST_RUN(test_ringbufindex_full);
   UNIT_TEST_RUN(test_ringbufindex_empty);
+  UNIT_TEST_RUN(test_ringbufindex_put_n);
+  UNIT_TEST_RUN(test_ringbufindex_get_n);
+  UNIT_TEST_RUN(test_ringbufindex_large);
 
   printf("=check-me= DONE\n");
   PROCESS_END();
@@ -38,6 +38,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "contiki.h"
 #include "lib/heapmem.h"
@@ -67,6 +68,20 @@
 #define TEST_MAX_SIZE       200
 #endif
 /*****************************************************************************/
+/* The number of operations in the allocation benchmark. */
+#ifdef TEST_CONF_BENCH_LIMIT
+#define TEST_BENCH_LIMIT TEST_CONF_BENCH_LIMIT
+#else
+#define TEST_BENCH_LIMIT 200000
+#endif
+
+/* The maximum size of objects allocated in the benchmark. */
+#ifdef TEST_CONF_BENCH_MAX_SIZE
+#define TEST_BENCH_MAX_SIZE TEST_CONF_BENCH_MAX_SIZE
+#else
+#define TEST_BENCH_MAX_SIZE 512
+#endif
+
 PROCESS(test_heapmem_process, "Heapmem test process");
 AUTOSTART_PROCESSES(&test_heapmem_process);
 /*****************************************************************************/
@@ -317,6 +332,90 @@ UNIT_TEST(zones)
   UNIT_TEST_END();
 }
 /*****************************************************************************/
+static uint64_t
+nsec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(benchmark, "Allocation benchmark");
+UNIT_TEST(benchmark)
+{
+  UNIT_TEST_BEGIN();
+
+  static char *ptrs[TEST_CONCURRENT];
+  unsigned failed_allocations = 0;
+  uint64_t alloc_time = 0;
+  uint64_t free_time = 0;
+  uint64_t max_latency = 0;
+  size_t max_allocated = 0;
+  size_t max_footprint = 0;
+
+  /*
+   * Free and allocate objects in a random order, with sizes spread
+   * over a wider range than in the other tests, and measure the time
+   * of each operation. The footprint of the heap relative to the
+   * amount of allocated memory indicates the degree of fragmentation.
+   */
+  for(unsigned count = 0; count < TEST_BENCH_LIMIT; count++) {
+    unsigned i = rand() % TEST_CONCURRENT;
+    uint64_t start, elapsed;
+
+    if(ptrs[i] != NULL) {
+      start = nsec_now();
+      heapmem_free(ptrs[i]);
+      elapsed = nsec_now() - start;
+      free_time += elapsed;
+      if(elapsed > max_latency) {
+        max_latency = elapsed;
+      }
+      ptrs[i] = NULL;
+    }
+
+    size_t alloc_size = 1 + (rand() % TEST_BENCH_MAX_SIZE);
+    start = nsec_now();
+    ptrs[i] = heapmem_alloc(alloc_size);
+    elapsed = nsec_now() - start;
+    alloc_time += elapsed;
+    if(elapsed > max_latency) {
+      max_latency = elapsed;
+    }
+    if(ptrs[i] == NULL) {
+      failed_allocations++;
+    }
+
+    if((count & 0x3ff) == 0) {
+      heapmem_stats_t stats;
+      heapmem_stats(&stats);
+      if(stats.footprint > max_footprint) {
+        max_footprint = stats.footprint;
+        max_allocated = stats.allocated;
+      }
+    }
+  }
+
+  for(unsigned i = 0; i < TEST_CONCURRENT; i++) {
+    heapmem_free(ptrs[i]);
+    ptrs[i] = NULL;
+  }
+
+  printf("Benchmark of %u operations:\n", TEST_BENCH_LIMIT);
+  printf("* alloc %u ns/op\n* free %u ns/op\n* max latency %u ns\n",
+         (unsigned)(alloc_time / TEST_BENCH_LIMIT),
+         (unsigned)(free_time / TEST_BENCH_LIMIT),
+         (unsigned)max_latency);
+  printf("* peak footprint %zu bytes for %zu allocated bytes\n",
+         max_footprint, max_allocated);
+  /* The benchmark is informational: allocation failures are reported
+     as a measure of fragmentation, but not treated as errors. */
+  printf("* failed allocations %u\n", failed_allocations);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
 PROCESS_THREAD(test_heapmem_process, ev, data)
 {
   PROCESS_BEGIN();
@@ -335,6 +434,7 @@ PROCESS_THREAD(test_heapmem_process, ev, data)
   UNIT_TEST_RUN(zero_init_alloc);
   UNIT_TEST_RUN(stats_check);
   UNIT_TEST_RUN(zones);
+  UNIT_TEST_RUN(benchmark);
 
   if(!UNIT_TEST_PASSED(do_many_allocations) ||
      !UNIT_TEST_PASSED(max_alloc) ||
@@ -342,7 +442,8 @@ PROCESS_THREAD(test_heapmem_process, ev, data)
      !UNIT_TEST_PASSED(reallocations) ||
      !UNIT_TEST_PASSED(zero_init_alloc) ||
      !UNIT_TEST_PASSED(stats_check) ||
-     !UNIT_TEST_PASSED(zones)) {
+     !UNIT_TEST_PASSED(zones) ||
+     !UNIT_TEST_PASSED(benchmark)) {
     printf("=check-me= FAILED\n");
     printf("---\n");
   }
@@ -411,6 +411,55 @@ UNIT_TEST(sha_256_hmac)
   UNIT_TEST_END();
 }
 /*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(sha_256_hmac_with_context, "SHA-256 HMAC with context");
+UNIT_TEST(sha_256_hmac_with_context)
+{
+  UNIT_TEST_BEGIN();
+
+  for(size_t i = 0; i < sizeof(hmacs) / sizeof(hmacs[0]); i++) {
+    sha_256_hmac_context_t context;
+    sha_256_hmac_context_init(&context,
+        (uint8_t *)hmacs[i].key, hmacs[i].keylen);
+    /* the context must be reusable */
+    for(size_t j = 0; j < 3; j++) {
+      uint8_t hmac[SHA_256_DIGEST_LENGTH];
+      sha_256_hmac_with_context(&context,
+          hmacs[i].data, hmacs[i].datalen,
+          hmac);
+      UNIT_TEST_ASSERT(!memcmp(hmac, hmacs[i].hmac, sizeof(hmac)));
+    }
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(sha_256_hash_long, "SHA-256 long message");
+UNIT_TEST(sha_256_hash_long)
+{
+  /* one million times 'a' as per FIPS 180-2 */
+  static const uint8_t expected[SHA_256_DIGEST_LENGTH] = {
+    0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92,
+    0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67,
+    0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e,
+    0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0
+  };
+  uint8_t chunk[1000];
+  uint8_t digest[SHA_256_DIGEST_LENGTH];
+
+  UNIT_TEST_BEGIN();
+
+  /* chunks of 1000 bytes span several blocks at varying offsets */
+  memset(chunk, 'a', sizeof(chunk));
+  SHA_256.init();
+  for(size_t i = 0; i < 1000; i++) {
+    SHA_256.update(chunk, sizeof(chunk));
+  }
+  SHA_256.finalize(digest);
+  UNIT_TEST_ASSERT(!memcmp(digest, expected, sizeof(digest)));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
 UNIT_TEST_REGISTER(sha_256_hkdf, "SHA-256 HKDF");
 UNIT_TEST(sha_256_hkdf)
 {
@@ -427,6 +476,14 @@ UNIT_TEST(sha_256_hkdf)
         keys[i].info, keys[i].info_len,
         okm, keys[i].okm_len);
     UNIT_TEST_ASSERT(!memcmp(okm, keys[i].okm, keys[i].okm_len));
+
+    sha_256_hmac_context_t context;
+    sha_256_hmac_context_init(&context, prk, sizeof(prk));
+    memset(okm, 0, sizeof(okm));
+    sha_256_hkdf_expand_with_context(&context,
+        keys[i].info, keys[i].info_len,
+        okm, keys[i].okm_len);
+    UNIT_TEST_ASSERT(!memcmp(okm, keys[i].okm, keys[i].okm_len));
   }
 
   UNIT_TEST_END();
@@ -443,12 +500,16 @@ PROCESS_THREAD(test_process, ev, data)
   UNIT_TEST_RUN(sha_256_hash_with_checkpoint);
   UNIT_TEST_RUN(sha_256_hash_shorthand);
   UNIT_TEST_RUN(sha_256_hmac);
+  UNIT_TEST_RUN(sha_256_hmac_with_context);
+  UNIT_TEST_RUN(sha_256_hash_long);
   UNIT_TEST_RUN(sha_256_hkdf);
 
   if(!UNIT_TEST_PASSED(sha_256_hash_stepwise)
       || !UNIT_TEST_PASSED(sha_256_hash_with_checkpoint)
       || !UNIT_TEST_PASSED(sha_256_hash_shorthand)
       || !UNIT_TEST_PASSED(sha_256_hmac)
+      || !UNIT_TEST_PASSED(sha_256_hmac_with_context)
+      || !UNIT_TEST_PASSED(sha_256_hash_long)
       || !UNIT_TEST_PASSED(sha_256_hkdf)) {
     printf("=check-me= FAILED\n");
     printf("---\n");
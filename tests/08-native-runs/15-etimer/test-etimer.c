@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      A set of unit tests for the event timer module.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of concurrent event timers. */
+#ifdef TEST_CONF_TIMERS
+#define TEST_TIMERS TEST_CONF_TIMERS
+#else
+#define TEST_TIMERS 200
+#endif
+
+/* Maximum timer interval. All intervals will be chosen randomly in the
+   range [1, TEST_MAX_INTERVAL]. */
+#ifdef TEST_CONF_MAX_INTERVAL
+#define TEST_MAX_INTERVAL TEST_CONF_MAX_INTERVAL
+#else
+#define TEST_MAX_INTERVAL (3 * CLOCK_SECOND)
+#endif
+
+/* Number of times that the periodic timer is reset. */
+#define TEST_PERIODS 10
+#define TEST_PERIOD  (CLOCK_SECOND / 10)
+/*****************************************************************************/
+PROCESS(test_etimer_process, "Etimer test process");
+AUTOSTART_PROCESSES(&test_etimer_process);
+
+static struct etimer timers[TEST_TIMERS];
+static bool stopped[TEST_TIMERS];
+static bool fired[TEST_TIMERS];
+static unsigned early_events;
+static unsigned unexpected_events;
+static unsigned wrong_next_expirations;
+static unsigned periods;
+static struct etimer periodic;
+static clock_time_t periodic_start;
+/* A timer in memory that has not been zero-initialized */
+static struct etimer dirty;
+static unsigned dirty_events;
+/*****************************************************************************/
+static void
+check_next_expiration(void)
+{
+  clock_time_t now = clock_time();
+  clock_time_t next = 0;
+  bool found = false;
+
+  /* Timers that are already due are about to be delivered by the event
+     timer process, so only the timers that expire later are considered. */
+  for(unsigned i = 0; i <= TEST_TIMERS; i++) {
+    struct etimer *et = i < TEST_TIMERS ? &timers[i] : &periodic;
+    if(!etimer_expired(et)) {
+      clock_time_t exp = etimer_expiration_time(et);
+      if(CLOCK_LT(now, exp) && (!found || CLOCK_LT(exp, next))) {
+        next = exp;
+        found = true;
+      }
+    }
+  }
+
+  /* The event timer module may report an earlier time because of the
+     timers of other processes, but never a later time. */
+  if(found && CLOCK_LT(next, etimer_next_expiration_time())) {
+    wrong_next_expirations++;
+  }
+}
+/*****************************************************************************/
+static bool
+test_timers_pending(void)
+{
+  for(unsigned i = 0; i < TEST_TIMERS; i++) {
+    if(!stopped[i] && !fired[i]) {
+      return true;
+    }
+  }
+  return periods < TEST_PERIODS;
+}
+/*****************************************************************************/
+static void
+handle_timer_event(struct etimer *et)
+{
+  if(et == &dirty) {
+    dirty_events++;
+    return;
+  }
+
+  if(et == &periodic) {
+    if(clock_time() - periodic_start < (periods + 1) * TEST_PERIOD) {
+      early_events++;
+    }
+    if(++periods < TEST_PERIODS) {
+      etimer_reset(&periodic);
+    }
+    return;
+  }
+
+  if(et < timers || et >= &timers[TEST_TIMERS]) {
+    unexpected_events++;
+    return;
+  }
+
+  unsigned i = et - timers;
+  if(stopped[i] || fired[i]) {
+    unexpected_events++;
+  }
+  if(CLOCK_LT(clock_time(), etimer_expiration_time(et))) {
+    early_events++;
+  }
+  fired[i] = true;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(timer_events, "Timer events");
+UNIT_TEST(timer_events)
+{
+  UNIT_TEST_BEGIN();
+
+  unsigned missing = 0;
+  for(unsigned i = 0; i < TEST_TIMERS; i++) {
+    if(!stopped[i] && !fired[i]) {
+      missing++;
+    }
+  }
+
+  printf("Missing events: %u\n", missing);
+  printf("Unexpected events: %u\n", unexpected_events);
+  printf("Early events: %u\n", early_events);
+  printf("Periodic timer events: %u\n", periods);
+
+  UNIT_TEST_ASSERT(missing == 0);
+  UNIT_TEST_ASSERT(unexpected_events == 0);
+  UNIT_TEST_ASSERT(early_events == 0);
+  UNIT_TEST_ASSERT(periods == TEST_PERIODS);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(next_expiration, "Next expiration time");
+UNIT_TEST(next_expiration)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("Wrong next expiration times: %u\n", wrong_next_expirations);
+  UNIT_TEST_ASSERT(wrong_next_expirations == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(dirty_timer, "Timer in uninitialized memory");
+UNIT_TEST(dirty_timer)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("Events of the uninitialized timer: %u\n", dirty_events);
+  UNIT_TEST_ASSERT(dirty_events == 1);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_etimer_process, ev, data)
+{
+  static unsigned victim;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  srand(500);
+
+  /* Stopping or setting a timer that is not zero-initialized must
+     neither touch the other timers nor lose track of it. */
+  memset(&dirty, 0xa5, sizeof(dirty));
+  etimer_stop(&dirty);
+  memset(&dirty, 0xa5, sizeof(dirty));
+  etimer_set(&dirty, TEST_PERIOD);
+  etimer_stop(&dirty);
+  memset(&dirty, 0xa5, sizeof(dirty));
+  etimer_set(&dirty, TEST_PERIOD);
+
+  periodic_start = clock_time();
+  etimer_set(&periodic, TEST_PERIOD);
+
+  for(unsigned i = 0; i < TEST_TIMERS; i++) {
+    etimer_set(&timers[i], 1 + (rand() % TEST_MAX_INTERVAL));
+  }
+  check_next_expiration();
+
+  /* Stop some of the timers, and move some of the others. */
+  for(unsigned i = 0; i < TEST_TIMERS; i++) {
+    if((rand() % 4) == 0) {
+      etimer_stop(&timers[i]);
+      stopped[i] = true;
+    } else if((rand() % 4) == 0) {
+      etimer_set(&timers[i], 1 + (rand() % TEST_MAX_INTERVAL));
+    } else if((rand() % 4) == 0 &&
+              timers[i].timer.interval > CLOCK_SECOND / 5) {
+      /* Move the timer earlier, but not into the past. */
+      etimer_adjust(&timers[i], -(rand() % (CLOCK_SECOND / 10)));
+    }
+    check_next_expiration();
+  }
+
+  /* Stopping a timer that has already been stopped must have no effect. */
+  etimer_stop(&timers[0]);
+  etimer_stop(&timers[0]);
+  stopped[0] = true;
+
+  while(test_timers_pending()) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+    handle_timer_event(data);
+    check_next_expiration();
+
+    /* Occasionally stop one of the remaining timers. */
+    victim = rand() % TEST_TIMERS;
+    if((rand() % 8) == 0 && !etimer_expired(&timers[victim])) {
+      etimer_stop(&timers[victim]);
+      stopped[victim] = true;
+      check_next_expiration();
+    }
+  }
+
+  UNIT_TEST_RUN(timer_events);
+  UNIT_TEST_RUN(next_expiration);
+  UNIT_TEST_RUN(dirty_timer);
+
+  if(!UNIT_TEST_PASSED(timer_events) ||
+     !UNIT_TEST_PASSED(next_expiration) ||
+     !UNIT_TEST_PASSED(dirty_timer)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
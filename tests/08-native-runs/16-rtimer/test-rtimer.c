@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests for the rtimer multiplexer: ordering of the dispatched
+ *      tasks and dispatch lateness under load.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "contiki.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of concurrently scheduled periodic tasks. */
+#define TEST_TASKS      16
+/* Number of times that each task is dispatched. */
+#define TEST_DISPATCHES 50
+/* Maximum period of a task, in rtimer ticks. */
+#define TEST_MAX_PERIOD (RTIMER_SECOND / 50)
+/* Upper bound on the dispatch lateness that is accepted. */
+#define TEST_MAX_LATENESS (RTIMER_SECOND / 10)
+/*****************************************************************************/
+PROCESS(test_rtimer_process, "Rtimer test process");
+AUTOSTART_PROCESSES(&test_rtimer_process);
+
+static struct rtimer tasks[TEST_TASKS];
+static rtimer_clock_t periods[TEST_TASKS];
+static volatile unsigned dispatches[TEST_TASKS];
+static volatile unsigned completed;
+static rtimer_clock_t last_deadline;
+static bool first_dispatch = true;
+static unsigned order_violations;
+static unsigned early_dispatches;
+static unsigned failed_schedules;
+
+static struct rtimer cancelled_task;
+static volatile unsigned cancelled_dispatches;
+
+static struct rtimer moved_task;
+static struct rtimer next_task;
+static volatile unsigned moved_dispatches;
+static volatile unsigned moved_early_dispatches;
+/*****************************************************************************/
+static void
+task_callback(struct rtimer *t, void *ptr)
+{
+  unsigned i = (uintptr_t)ptr;
+
+  if(!first_dispatch && RTIMER_CLOCK_LT(t->time, last_deadline)) {
+    order_violations++;
+  }
+  if(RTIMER_CLOCK_LT(RTIMER_NOW(), t->time)) {
+    early_dispatches++;
+  }
+  first_dispatch = false;
+  last_deadline = t->time;
+
+  if(++dispatches[i] < TEST_DISPATCHES) {
+    if(rtimer_set(t, t->time + periods[i], 0, task_callback, ptr)
+       != RTIMER_OK) {
+      failed_schedules++;
+    }
+  } else {
+    completed++;
+  }
+}
+/*****************************************************************************/
+static void
+cancelled_callback(struct rtimer *t, void *ptr)
+{
+  cancelled_dispatches++;
+}
+/*****************************************************************************/
+static void
+moved_callback(struct rtimer *t, void *ptr)
+{
+  if(RTIMER_CLOCK_LT(RTIMER_NOW(), t->time)) {
+    moved_early_dispatches++;
+  }
+  moved_dispatches++;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(ordering, "Dispatch ordering");
+UNIT_TEST(ordering)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("Completed tasks: %u\n", completed);
+  printf("Order violations: %u\n", order_violations);
+  printf("Early dispatches: %u\n", early_dispatches);
+  printf("Failed schedules: %u\n", failed_schedules);
+  printf("Cancelled task dispatches: %u\n", cancelled_dispatches);
+
+  UNIT_TEST_ASSERT(completed == TEST_TASKS);
+  UNIT_TEST_ASSERT(order_violations == 0);
+  UNIT_TEST_ASSERT(early_dispatches == 0);
+  UNIT_TEST_ASSERT(failed_schedules == 0);
+  UNIT_TEST_ASSERT(cancelled_dispatches == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(lateness, "Dispatch lateness");
+UNIT_TEST(lateness)
+{
+  rtimer_stats_t stats;
+
+  UNIT_TEST_BEGIN();
+
+  rtimer_stats(&stats);
+
+  printf("Dispatched: %lu\n", (unsigned long)stats.dispatched);
+  printf("Late: %lu\n", (unsigned long)stats.late);
+  printf("Mean lateness: %lu ticks\n", stats.late == 0 ? 0 :
+         (unsigned long)(stats.total_lateness / stats.late));
+  printf("Max lateness: %lu ticks\n", (unsigned long)stats.max_lateness);
+  for(unsigned i = 0; i < RTIMER_STATS_BUCKETS; i++) {
+    printf("Lateness histogram [%u]: %lu\n", i,
+           (unsigned long)stats.histogram[i]);
+  }
+
+  UNIT_TEST_ASSERT(stats.dispatched == TEST_TASKS * TEST_DISPATCHES);
+  UNIT_TEST_ASSERT(stats.max_lateness <= TEST_MAX_LATENESS);
+
+  uint32_t histogram_total = 0;
+  for(unsigned i = 0; i < RTIMER_STATS_BUCKETS; i++) {
+    histogram_total += stats.histogram[i];
+  }
+  UNIT_TEST_ASSERT(histogram_total == stats.dispatched);
+  UNIT_TEST_ASSERT(stats.dispatched - stats.histogram[0] == stats.late);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(reschedule, "Head moved to a later deadline");
+UNIT_TEST(reschedule)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("Moved task dispatches: %u\n", moved_dispatches);
+  printf("Moved task early dispatches: %u\n", moved_early_dispatches);
+
+  UNIT_TEST_ASSERT(moved_dispatches == 2);
+  UNIT_TEST_ASSERT(moved_early_dispatches == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_rtimer_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned waited;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  srand(500);
+  rtimer_stats_reset();
+
+  rtimer_clock_t start = RTIMER_NOW() + RTIMER_SECOND / 20;
+  for(unsigned i = 0; i < TEST_TASKS; i++) {
+    periods[i] = 1 + (rand() % TEST_MAX_PERIOD);
+    if(rtimer_set(&tasks[i], start + (rand() % TEST_MAX_PERIOD), 0,
+                  task_callback, (void *)(uintptr_t)i) != RTIMER_OK) {
+      failed_schedules++;
+    }
+  }
+
+  /* A task that is cancelled before its deadline must never run. */
+  if(rtimer_set(&cancelled_task, start + TEST_MAX_PERIOD, 0,
+                cancelled_callback, NULL) != RTIMER_OK) {
+    failed_schedules++;
+  }
+  rtimer_cancel(&cancelled_task);
+
+  for(waited = 0; completed < TEST_TASKS && waited < 100; waited++) {
+    etimer_set(&et, CLOCK_SECOND / 10);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+
+  UNIT_TEST_RUN(ordering);
+  UNIT_TEST_RUN(lateness);
+
+  /*
+   * Move the task at the head of the queue behind the next one. The
+   * hardware timer must be reprogrammed for the new head instead of
+   * firing at the deadline of the moved task.
+   */
+  start = RTIMER_NOW() + RTIMER_SECOND / 10;
+  if(rtimer_set(&moved_task, start, 0, moved_callback, NULL) != RTIMER_OK ||
+     rtimer_set(&next_task, start + RTIMER_SECOND / 5, 0,
+                moved_callback, NULL) != RTIMER_OK ||
+     rtimer_set(&moved_task, start + RTIMER_SECOND / 2, 0,
+                moved_callback, NULL) != RTIMER_OK) {
+    failed_schedules++;
+  }
+  for(waited = 0; moved_dispatches < 2 && waited < 20; waited++) {
+    etimer_set(&et, CLOCK_SECOND / 10);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+
+  UNIT_TEST_RUN(reschedule);
+
+  if(!UNIT_TEST_PASSED(ordering) ||
+     !UNIT_TEST_PASSED(lateness) ||
+     !UNIT_TEST_PASSED(reschedule)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
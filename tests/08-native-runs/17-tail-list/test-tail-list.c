@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      A microbenchmark of appending to and measuring the length of
+ *      a list and a list with a tail pointer, at queue depths that are
+ *      typical of packet queues and route lists.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "lib/list.h"
+#include "lib/tail-list.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* The largest queue depth that is measured. */
+#define TEST_MAX_DEPTH 256
+/* The number of enqueue/dequeue operations per queue depth. */
+#define TEST_OPERATIONS 100000
+/*****************************************************************************/
+PROCESS(test_tail_list_process, "Tail list test process");
+AUTOSTART_PROCESSES(&test_tail_list_process);
+
+struct item {
+  struct item *next;
+  unsigned seqno;
+};
+
+static struct item items[TEST_MAX_DEPTH + 1];
+static const unsigned depths[] = { 4, 8, 16, 32, 64, 256 };
+#define NUM_DEPTHS (sizeof(depths) / sizeof(depths[0]))
+static uint64_t list_time[NUM_DEPTHS];
+static uint64_t tail_list_time[NUM_DEPTHS];
+static unsigned out_of_order;
+/*****************************************************************************/
+static uint64_t
+nsec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+/*
+ * Keep a FIFO queue at a fixed depth: each operation checks the
+ * length of the queue, removes the element at its head, and appends
+ * it at the tail, as CSMA does with its per-neighbor packet queues.
+ */
+static uint64_t
+run_list(unsigned depth)
+{
+  LIST(queue);
+  unsigned seqno = 0;
+  unsigned expected = 0;
+
+  list_init(queue);
+  for(unsigned i = 0; i < depth; i++) {
+    items[i].seqno = seqno++;
+    list_add(queue, &items[i]);
+  }
+
+  uint64_t start = nsec_now();
+  for(unsigned i = 0; i < TEST_OPERATIONS; i++) {
+    if(list_length(queue) != depth) {
+      out_of_order++;
+    }
+    struct item *item = list_pop(queue);
+    if(item->seqno != expected++) {
+      out_of_order++;
+    }
+    item->seqno = seqno++;
+    list_add(queue, item);
+  }
+  return nsec_now() - start;
+}
+/*****************************************************************************/
+static uint64_t
+run_tail_list(unsigned depth)
+{
+  TAIL_LIST(queue);
+  unsigned seqno = 0;
+  unsigned expected = 0;
+
+  tail_list_init(queue);
+  for(unsigned i = 0; i < depth; i++) {
+    items[i].seqno = seqno++;
+    tail_list_add(queue, &items[i]);
+  }
+
+  uint64_t start = nsec_now();
+  for(unsigned i = 0; i < TEST_OPERATIONS; i++) {
+    if(tail_list_length(queue) != depth) {
+      out_of_order++;
+    }
+    struct item *item = tail_list_pop(queue);
+    if(item->seqno != expected++) {
+      out_of_order++;
+    }
+    item->seqno = seqno++;
+    tail_list_add(queue, item);
+  }
+  return nsec_now() - start;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(benchmark, "List append benchmark");
+UNIT_TEST(benchmark)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("depth  list ns/op  tail-list ns/op\n");
+  for(unsigned i = 0; i < NUM_DEPTHS; i++) {
+    list_time[i] = run_list(depths[i]);
+    tail_list_time[i] = run_tail_list(depths[i]);
+    printf("%5u  %10u  %15u\n", depths[i],
+           (unsigned)(list_time[i] / TEST_OPERATIONS),
+           (unsigned)(tail_list_time[i] / TEST_OPERATIONS));
+  }
+
+  UNIT_TEST_ASSERT(out_of_order == 0);
+  /* Appending to the deepest list must not be slower with a tail pointer. */
+  UNIT_TEST_ASSERT(tail_list_time[NUM_DEPTHS - 1] <
+                   list_time[NUM_DEPTHS - 1]);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_tail_list_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(benchmark);
+
+  if(!UNIT_TEST_PASSED(benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
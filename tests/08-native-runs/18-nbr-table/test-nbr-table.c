@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests for link-layer address lookups in the neighbor table,
+ *      including the reuse of entries when the table is full.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/nbr-table.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* The number of lookup rounds over all neighbors in the benchmark. */
+#define TEST_ROUNDS 1000
+/*****************************************************************************/
+PROCESS(test_nbr_table_process, "Neighbor table test process");
+AUTOSTART_PROCESSES(&test_nbr_table_process);
+
+struct test_nbr {
+  unsigned id;
+};
+NBR_TABLE(struct test_nbr, test_nbrs);
+
+static linkaddr_t addrs[NBR_TABLE_MAX_NEIGHBORS * 2];
+/*****************************************************************************/
+static void
+random_lladdr(linkaddr_t *addr)
+{
+  for(int i = 0; i < LINKADDR_SIZE; i++) {
+    addr->u8[i] = rand();
+  }
+}
+/*****************************************************************************/
+static bool
+has_id(unsigned i)
+{
+  struct test_nbr *nbr = nbr_table_get_from_lladdr(test_nbrs, &addrs[i]);
+  return nbr != NULL && nbr->id == i;
+}
+/*****************************************************************************/
+static uint64_t
+nsec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(lookups, "Lookups and replacements");
+UNIT_TEST(lookups)
+{
+  const unsigned max = NBR_TABLE_MAX_NEIGHBORS;
+  unsigned missing = 0;
+  unsigned stale = 0;
+
+  UNIT_TEST_BEGIN();
+
+  nbr_table_clear();
+
+  /* Fill the table, and lock every second neighbor. */
+  for(unsigned i = 0; i < max; i++) {
+    random_lladdr(&addrs[i]);
+    struct test_nbr *nbr = nbr_table_add_lladdr(test_nbrs, &addrs[i],
+                                                NBR_TABLE_REASON_UNDEFINED,
+                                                NULL);
+    UNIT_TEST_ASSERT(nbr != NULL);
+    nbr->id = i;
+    if(i & 1) {
+      nbr_table_lock(test_nbrs, nbr);
+    }
+  }
+  UNIT_TEST_ASSERT(nbr_table_count_entries() == max);
+
+  for(unsigned i = 0; i < max; i++) {
+    missing += !has_id(i);
+  }
+  UNIT_TEST_ASSERT(missing == 0);
+
+  /* Release the unlocked neighbors, and add as many new ones, which
+     must replace them. */
+  for(unsigned i = 0; i < max; i += 2) {
+    nbr_table_remove(test_nbrs, nbr_table_get_from_lladdr(test_nbrs,
+                                                          &addrs[i]));
+  }
+  for(unsigned i = max; i < max + max / 2; i++) {
+    random_lladdr(&addrs[i]);
+    struct test_nbr *nbr = nbr_table_add_lladdr(test_nbrs, &addrs[i],
+                                                NBR_TABLE_REASON_UNDEFINED,
+                                                NULL);
+    UNIT_TEST_ASSERT(nbr != NULL);
+    nbr->id = i;
+  }
+
+  for(unsigned i = 0; i < max + max / 2; i++) {
+    if(i < max && !(i & 1)) {
+      stale += nbr_table_get_from_lladdr(test_nbrs, &addrs[i]) != NULL;
+    } else {
+      missing += !has_id(i);
+    }
+  }
+  printf("Missing %u, stale %u\n", missing, stale);
+  UNIT_TEST_ASSERT(missing == 0);
+  UNIT_TEST_ASSERT(stale == 0);
+
+  /* Benchmark the lookup of every neighbor that is in the table. */
+  uint64_t start = nsec_now();
+  for(unsigned round = 0; round < TEST_ROUNDS; round++) {
+    for(unsigned i = 1; i < max + max / 2; i += 2) {
+      missing += !has_id(i);
+    }
+  }
+  uint64_t elapsed = nsec_now() - start;
+  printf("Lookup with %u neighbors: %u ns\n", max,
+         (unsigned)(elapsed / (TEST_ROUNDS * ((max + max / 2) / 2))));
+  UNIT_TEST_ASSERT(missing == 0);
+
+  nbr_table_clear();
+  UNIT_TEST_ASSERT(nbr_table_count_entries() == 0);
+  for(unsigned i = 0; i < max + max / 2; i++) {
+    stale += nbr_table_get_from_lladdr(test_nbrs, &addrs[i]) != NULL;
+  }
+  UNIT_TEST_ASSERT(stale == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_nbr_table_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  srand(500);
+  nbr_table_register(test_nbrs, NULL);
+
+  UNIT_TEST_RUN(lookups);
+
+  if(!UNIT_TEST_PASSED(lookups)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests for longest prefix matching in the IPv6 routing table,
+ *      and a benchmark of the lookup rate against the number of routes.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* The number of destinations that the lookups cycle through. */
+#define TEST_DESTINATIONS 1024
+/* The number of lookups per benchmarked routing table size. */
+#define TEST_LOOKUPS 200000
+/*****************************************************************************/
+PROCESS(test_route_lookup_process, "Route lookup test process");
+AUTOSTART_PROCESSES(&test_route_lookup_process);
+
+static uip_ipaddr_t nexthop;
+static uip_ipaddr_t hosts[UIP_DS6_ROUTE_NB];
+static unsigned num_hosts;
+static uip_ipaddr_t destinations[TEST_DESTINATIONS];
+/*****************************************************************************/
+static void
+random_host(uip_ipaddr_t *addr, unsigned subnets)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, rand() % subnets,
+              (rand() & 0x7fff) | 0x8000, rand(), rand(), rand());
+}
+/*****************************************************************************/
+static uint64_t
+nsec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+/* The longest matching prefix length found by scanning all routes, or
+   -1 if no route matches. */
+static int
+reference_length(const uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+  int length = -1;
+
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    if(r->length > length && uip_ipaddr_prefixcmp(addr, &r->ipaddr,
+                                                  r->length)) {
+      length = r->length;
+    }
+  }
+  return length;
+}
+/*****************************************************************************/
+static unsigned
+count_mismatches(void)
+{
+  unsigned mismatches = 0;
+
+  for(unsigned i = 0; i < TEST_DESTINATIONS; i++) {
+    uip_ds6_route_t *r = uip_ds6_route_lookup(&destinations[i]);
+    int expected = reference_length(&destinations[i]);
+    if(r == NULL ? expected != -1 : r->length != expected) {
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
+/*****************************************************************************/
+/* Fills the routing table with host routes, every second /64 subnet
+   that the hosts are in, and a /52 that catches the other subnets. */
+static void
+fill_table(unsigned count)
+{
+  unsigned subnets = count / 8 + 1;
+  uip_ipaddr_t prefix;
+
+  num_hosts = 0;
+  while((unsigned)uip_ds6_route_num_routes() < count - (subnets + 1) / 2 - 1) {
+    random_host(&hosts[num_hosts], subnets);
+    if(uip_ds6_route_add(&hosts[num_hosts], 128, &nexthop) != NULL) {
+      num_hosts++;
+    }
+  }
+  for(unsigned s = 0; s < subnets; s += 2) {
+    uip_ip6addr(&prefix, 0xfd00, 0, 0, s, 0, 0, 0, 0);
+    uip_ds6_route_add(&prefix, 64, &nexthop);
+  }
+  uip_ip6addr(&prefix, 0xfd00, 0, 0, 0x1000, 0, 0, 0, 0);
+  uip_ds6_route_add(&prefix, 52, &nexthop);
+
+  /* Look up hosts, other addresses in their subnets, and addresses
+     without a route. */
+  for(unsigned i = 0; i < TEST_DESTINATIONS; i++) {
+    switch(rand() % 4) {
+    case 0:
+    case 1:
+      uip_ipaddr_copy(&destinations[i], &hosts[rand() % num_hosts]);
+      break;
+    case 2:
+      random_host(&destinations[i], subnets * 2);
+      break;
+    default:
+      uip_ip6addr(&destinations[i], 0xfd01, 0, 0, 0, 0, 0, 0, rand());
+      break;
+    }
+  }
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(lookups, "Longest prefix match");
+UNIT_TEST(lookups)
+{
+  uip_ds6_route_t *r;
+  unsigned mismatches = 0;
+
+  UNIT_TEST_BEGIN();
+
+  for(unsigned count = 16; count <= UIP_DS6_ROUTE_NB; count *= 4) {
+    fill_table(count);
+    UNIT_TEST_ASSERT((unsigned)uip_ds6_route_num_routes() == count);
+    mismatches += count_mismatches();
+
+    unsigned found = 0;
+    uint64_t start = nsec_now();
+    for(unsigned i = 0; i < TEST_LOOKUPS; i++) {
+      found += uip_ds6_route_lookup(&destinations[i % TEST_DESTINATIONS])
+        != NULL;
+    }
+    uint64_t elapsed = nsec_now() - start;
+    printf("%4u routes: %lu lookups/s (%u found)\n", count,
+           (unsigned long)((uint64_t)TEST_LOOKUPS * 1000000000 / elapsed),
+           found);
+
+    /* Remove every second route, then the rest by next hop. */
+    unsigned i = 0;
+    for(r = uip_ds6_route_head(); r != NULL; i++) {
+      uip_ds6_route_t *next = uip_ds6_route_next(r);
+      if(i & 1) {
+        uip_ds6_route_rm(r);
+      }
+      r = next;
+    }
+    mismatches += count_mismatches();
+    uip_ds6_route_rm_by_nexthop(&nexthop);
+    UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == 0);
+    UNIT_TEST_ASSERT(uip_ds6_route_lookup(&hosts[0]) == NULL);
+  }
+
+  printf("Mismatches %u\n", mismatches);
+  UNIT_TEST_ASSERT(mismatches == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(eviction, "Least recently used route eviction");
+UNIT_TEST(eviction)
+{
+  uip_ipaddr_t extra;
+  unsigned missing = 0;
+
+  UNIT_TEST_BEGIN();
+
+  num_hosts = 0;
+  while(num_hosts < UIP_DS6_ROUTE_NB) {
+    random_host(&hosts[num_hosts], 1);
+    if(uip_ds6_route_add(&hosts[num_hosts], 128, &nexthop) != NULL) {
+      num_hosts++;
+    }
+  }
+
+  /* Use every route, which leaves the first one least recently used. */
+  for(unsigned i = 0; i < num_hosts; i++) {
+    missing += uip_ds6_route_lookup(&hosts[i]) == NULL;
+  }
+  UNIT_TEST_ASSERT(missing == 0);
+
+  random_host(&extra, 1);
+  UNIT_TEST_ASSERT(uip_ds6_route_add(&extra, 128, &nexthop) != NULL);
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == UIP_DS6_ROUTE_NB);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&hosts[0]) == NULL);
+  for(unsigned i = 1; i < num_hosts; i++) {
+    missing += uip_ds6_route_lookup(&hosts[i]) == NULL;
+  }
+  UNIT_TEST_ASSERT(missing == 0);
+
+  uip_ds6_route_rm_by_nexthop(&nexthop);
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_route_lookup_process, ev, data)
+{
+  static const uip_lladdr_t lladdr = { { 0x02, 0x01 } };
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  srand(500);
+  uip_ip6addr(&nexthop, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  uip_ds6_nbr_add(&nexthop, &lladdr, 1, NBR_REACHABLE,
+                  NBR_TABLE_REASON_UNDEFINED, NULL);
+
+  UNIT_TEST_RUN(lookups);
+  UNIT_TEST_RUN(eviction);
+
+  if(!UNIT_TEST_PASSED(lookups) ||
+     !UNIT_TEST_PASSED(eviction)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
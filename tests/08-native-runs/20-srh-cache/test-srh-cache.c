@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests for the source routing headers that the RPL root inserts
+ *      in downward packets, and a benchmark of their insertion time.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uipbuf.h"
+#include "net/ipv6/uip-sr.h"
+#include "net/routing/routing.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* The nodes form a complete binary tree below the root. */
+#define TEST_NODES (UIP_SR_LINK_NUM - 1)
+/* The number of destinations that the benchmarked packets go to. */
+#define TEST_DESTINATIONS 16
+#define TEST_PACKETS 100000
+#define TEST_PAYLOAD_LEN 32
+#define TEST_LIFETIME 3600
+/*****************************************************************************/
+PROCESS(test_srh_cache_process, "SRH cache test process");
+AUTOSTART_PROCESSES(&test_srh_cache_process);
+
+static uip_ipaddr_t root_addr;
+static uip_ipaddr_t node_addrs[TEST_NODES];
+static unsigned parents[TEST_NODES];
+static uint8_t first_packet[UIP_BUFSIZE];
+static uint16_t first_len;
+/*****************************************************************************/
+static const uip_ipaddr_t *
+parent_addr(unsigned i)
+{
+  return parents[i] == TEST_NODES ? &root_addr : &node_addrs[parents[i]];
+}
+/*****************************************************************************/
+static void
+set_parent(unsigned i, unsigned parent)
+{
+  parents[i] = parent;
+  uip_sr_update_node(NULL, &node_addrs[i], parent_addr(i), TEST_LIFETIME);
+}
+/*****************************************************************************/
+/* The node on the path to node i that is a child of the root. */
+static unsigned
+first_hop(unsigned i, unsigned *depth)
+{
+  *depth = 1;
+  while(parents[i] != TEST_NODES) {
+    i = parents[i];
+    (*depth)++;
+  }
+  return i;
+}
+/*****************************************************************************/
+static int
+send_to(unsigned i)
+{
+  uipbuf_clear();
+  memset(UIP_IP_BUF, 0, UIP_IPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &root_addr);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &node_addrs[i]);
+  memset(UIP_IP_PAYLOAD(0), 0xaa, TEST_PAYLOAD_LEN);
+  uip_len = UIP_IPH_LEN + TEST_PAYLOAD_LEN;
+  uipbuf_set_len_field(UIP_IP_BUF, TEST_PAYLOAD_LEN);
+
+  return NETSTACK_ROUTING.ext_header_update();
+}
+/*****************************************************************************/
+/* Checks that the packet in the buffer goes to node i through the
+   first hop of its path, with a segment for every further hop. */
+static int
+check_packet(unsigned i)
+{
+  struct uip_routing_hdr *rh_hdr;
+  unsigned depth;
+  unsigned hop = first_hop(i, &depth);
+
+  rh_hdr = (struct uip_routing_hdr *)UIP_IP_PAYLOAD(0);
+  return UIP_IP_BUF->proto == UIP_PROTO_ROUTING &&
+    rh_hdr->seg_left == depth - 1 &&
+    uip_ipaddr_cmp(&UIP_IP_BUF->destipaddr, &node_addrs[hop]) &&
+    uip_len == UIP_IPH_LEN + uip_ext_len + TEST_PAYLOAD_LEN;
+}
+/*****************************************************************************/
+static uint64_t
+nsec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(headers, "Source routing headers");
+UNIT_TEST(headers)
+{
+  unsigned failures = 0;
+  uint32_t version;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(NETSTACK_ROUTING.root_start() == 0);
+  UNIT_TEST_ASSERT(NETSTACK_ROUTING.get_root_ipaddr(&root_addr));
+
+  for(unsigned i = 0; i < TEST_NODES; i++) {
+    uip_ipaddr_copy(&node_addrs[i], &root_addr);
+    node_addrs[i].u16[7] = UIP_HTONS(i + 1);
+    node_addrs[i].u16[6] = UIP_HTONS(0x1234);
+    set_parent(i, i < 2 ? TEST_NODES : (i - 2) / 2);
+  }
+  UNIT_TEST_ASSERT(uip_sr_num_nodes() == TEST_NODES + 1);
+
+  /* Every packet gets a header, and the same one when sent twice. */
+  for(unsigned i = 0; i < TEST_NODES; i++) {
+    failures += !send_to(i) || !check_packet(i);
+    first_len = uip_len;
+    memcpy(first_packet, uip_buf, uip_len);
+    failures += !send_to(i) || uip_len != first_len ||
+      memcmp(first_packet, uip_buf, uip_len) != 0;
+  }
+  UNIT_TEST_ASSERT(failures == 0);
+
+  /* Refreshing a link leaves the graph unchanged. */
+  version = uip_sr_version();
+  set_parent(TEST_NODES - 1, parents[TEST_NODES - 1]);
+  UNIT_TEST_ASSERT(uip_sr_version() == version);
+
+  /* Moving a node to another subtree changes its path. */
+  UNIT_TEST_ASSERT(send_to(TEST_NODES - 1) && check_packet(TEST_NODES - 1));
+  set_parent(TEST_NODES - 1, 2);
+  UNIT_TEST_ASSERT(uip_sr_version() != version);
+  UNIT_TEST_ASSERT(send_to(TEST_NODES - 1) && check_packet(TEST_NODES - 1));
+  set_parent(TEST_NODES - 1, TEST_NODES);
+  UNIT_TEST_ASSERT(send_to(TEST_NODES - 1) && check_packet(TEST_NODES - 1));
+
+  /* Expiring a link changes the graph. */
+  version = uip_sr_version();
+  uip_sr_expire_parent(NULL, &node_addrs[TEST_NODES - 1], &root_addr);
+  UNIT_TEST_ASSERT(uip_sr_version() != version);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(benchmark, "Header insertion benchmark");
+UNIT_TEST(benchmark)
+{
+  unsigned destinations[TEST_DESTINATIONS];
+  unsigned failures = 0;
+
+  UNIT_TEST_BEGIN();
+
+  /* Send to the deepest nodes, which have the longest headers. */
+  for(unsigned i = 0; i < TEST_DESTINATIONS; i++) {
+    destinations[i] = TEST_NODES - 2 - rand() % (TEST_NODES / 2);
+  }
+
+  uint64_t start = nsec_now();
+  for(unsigned i = 0; i < TEST_PACKETS; i++) {
+    failures += !send_to(destinations[i % TEST_DESTINATIONS]);
+  }
+  uint64_t elapsed = nsec_now() - start;
+  printf("%u nodes, %u destinations: %u ns per packet\n", TEST_NODES + 1,
+         TEST_DESTINATIONS, (unsigned)(elapsed / TEST_PACKETS));
+  UNIT_TEST_ASSERT(failures == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_srh_cache_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  srand(500);
+
+  UNIT_TEST_RUN(headers);
+  UNIT_TEST_RUN(benchmark);
+
+  if(!UNIT_TEST_PASSED(headers) ||
+     !UNIT_TEST_PASSED(benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
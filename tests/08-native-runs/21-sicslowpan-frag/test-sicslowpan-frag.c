@@ -0,0 +1,981 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests for the fragmentation of outgoing 6LoWPAN datagrams, using
+ *      a MAC layer that captures the fragments and modifies packetbuf like a
+ *      framer would.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/sicslowpan.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+#define TEST_MAX_PAYLOAD 96
+#define TEST_MAX_FRAMES 24
+#define TEST_DATAGRAMS 100000
+/* One more than the reassembly contexts in project-conf.h */
+#define TEST_SETS 5
+/*****************************************************************************/
+PROCESS(test_sicslowpan_frag_process, "6LoWPAN fragmentation test process");
+AUTOSTART_PROCESSES(&test_sicslowpan_frag_process);
+
+static struct {
+  uint8_t data[PACKETBUF_SIZE];
+  uint16_t len;
+  linkaddr_t receiver;
+  packetbuf_attr_t seqno;
+} frames[TEST_MAX_FRAMES];
+static unsigned num_frames;
+static bool capture;
+static bool keep_frames;
+
+static uint8_t datagram[UIP_BUFSIZE];
+static uint16_t datagram_len;
+static unsigned reassembled;
+static const linkaddr_t dest = { { 0x02, 0x12, 0x74, 0x01, 0, 0x01, 0x01, 0x01 } };
+
+/* Datagrams and their fragments, for feeding fragments in any order */
+static struct {
+  uint8_t datagram[UIP_BUFSIZE];
+  uint16_t datagram_len;
+  struct {
+    uint8_t data[PACKETBUF_SIZE];
+    uint16_t len;
+  } frames[TEST_MAX_FRAMES];
+  unsigned num_frames;
+  unsigned reassembled;
+} sets[TEST_SETS];
+/*****************************************************************************/
+static void
+mac_init(void)
+{
+}
+/*****************************************************************************/
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  if(capture && num_frames < TEST_MAX_FRAMES) {
+    if(keep_frames) {
+      memcpy(frames[num_frames].data, packetbuf_hdrptr(), packetbuf_totlen());
+      frames[num_frames].len = packetbuf_totlen();
+      linkaddr_copy(&frames[num_frames].receiver,
+                    packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+      frames[num_frames].seqno = packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO);
+    }
+    num_frames++;
+  }
+
+  /* Change packetbuf the way a framer does. */
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, 0x55);
+  if(packetbuf_hdralloc(9)) {
+    memset(packetbuf_hdrptr(), 0xff, 9);
+  }
+
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*****************************************************************************/
+static void
+mac_input(void)
+{
+}
+/*****************************************************************************/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*****************************************************************************/
+static int
+mac_off(void)
+{
+  return 1;
+}
+/*****************************************************************************/
+static int
+mac_max_payload(void)
+{
+  return TEST_MAX_PAYLOAD;
+}
+/*****************************************************************************/
+const struct mac_driver test_mac_driver = {
+  "test-mac",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_max_payload,
+};
+/*****************************************************************************/
+static void
+sniffer_input(void)
+{
+  if(uip_len == datagram_len && memcmp(uip_buf, datagram, uip_len) == 0) {
+    reassembled++;
+  }
+  for(unsigned i = 0; i < TEST_SETS; i++) {
+    if(uip_len == sets[i].datagram_len &&
+       memcmp(uip_buf, sets[i].datagram, uip_len) == 0) {
+      sets[i].reassembled++;
+    }
+  }
+}
+/*****************************************************************************/
+static void
+sniffer_output(int mac_status)
+{
+}
+/*****************************************************************************/
+NETSTACK_SNIFFER(sniffer, sniffer_input, sniffer_output);
+/*****************************************************************************/
+static void
+make_datagram(uint16_t payload_len)
+{
+  struct uip_udp_hdr *udp;
+
+  memset(uip_buf, 0, UIP_IPUDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfd00, 0, 0, 0, 0x1234, 0, 0, 1);
+  uip_ip6addr(&UIP_IP_BUF->destipaddr, 0xfd00, 0, 0, 0, 0x5678, 0, 0, 2);
+  uipbuf_set_len_field(UIP_IP_BUF, UIP_UDPH_LEN + payload_len);
+
+  udp = (struct uip_udp_hdr *)UIP_IP_PAYLOAD(0);
+  udp->srcport = UIP_HTONS(5683);
+  udp->destport = UIP_HTONS(61616);
+  udp->udplen = UIP_HTONS(UIP_UDPH_LEN + payload_len);
+  udp->udpchksum = UIP_HTONS(0xbeef);
+
+  for(uint16_t i = 0; i < payload_len; i++) {
+    uip_buf[UIP_IPUDPH_LEN + i] = rand();
+  }
+  uip_len = UIP_IPUDPH_LEN + payload_len;
+  uipbuf_clear_attr();
+
+  datagram_len = uip_len;
+  memcpy(datagram, uip_buf, uip_len);
+}
+/*****************************************************************************/
+static int
+send_datagram(void)
+{
+  num_frames = 0;
+  capture = true;
+  memcpy(uip_buf, datagram, datagram_len);
+  uip_len = datagram_len;
+  int ret = NETSTACK_NETWORK.output(&dest);
+  capture = false;
+  return ret;
+}
+/*****************************************************************************/
+static void
+input_frame_from(const linkaddr_t *sender, const uint8_t *data, uint16_t len)
+{
+  packetbuf_copyfrom(data, len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, sender);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+  NETSTACK_NETWORK.input();
+}
+/*****************************************************************************/
+static void
+input_frame(const uint8_t *data, uint16_t len)
+{
+  input_frame_from(&dest, data, len);
+}
+/*****************************************************************************/
+/* Sends a new datagram and keeps it and its fragments in a set. */
+static int
+make_set(unsigned set, uint16_t payload_len)
+{
+  make_datagram(payload_len);
+  keep_frames = true;
+  if(!send_datagram()) {
+    return 0;
+  }
+  memcpy(sets[set].datagram, datagram, datagram_len);
+  sets[set].datagram_len = datagram_len;
+  for(unsigned i = 0; i < num_frames; i++) {
+    memcpy(sets[set].frames[i].data, frames[i].data, frames[i].len);
+    sets[set].frames[i].len = frames[i].len;
+  }
+  sets[set].num_frames = num_frames;
+  sets[set].reassembled = 0;
+  return 1;
+}
+/*****************************************************************************/
+static uint64_t
+nsec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(fragments, "Fragmentation and reassembly");
+UNIT_TEST(fragments)
+{
+  static const uint16_t sizes[] = { 40, 200, 600, 1000, UIP_BUFSIZE - UIP_IPUDPH_LEN };
+  unsigned failures = 0;
+
+  UNIT_TEST_BEGIN();
+
+  keep_frames = true;
+  for(unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    make_datagram(sizes[s]);
+    UNIT_TEST_ASSERT(send_datagram());
+    UNIT_TEST_ASSERT(num_frames > 0 && num_frames < TEST_MAX_FRAMES);
+
+    /* Every fragment keeps the attributes set by 6LoWPAN. */
+    for(unsigned i = 0; i < num_frames; i++) {
+      failures += !linkaddr_cmp(&frames[i].receiver, &dest) ||
+        frames[i].seqno != 0 || frames[i].len > TEST_MAX_PAYLOAD;
+    }
+
+    /* Feed the fragments back, which must give the original datagram. */
+    reassembled = 0;
+    for(unsigned i = 0; i < num_frames; i++) {
+      packetbuf_copyfrom(frames[i].data, frames[i].len);
+      packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &dest);
+      packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_node_addr);
+      NETSTACK_NETWORK.input();
+    }
+    printf("%u bytes: %u frames, reassembled %u\n", datagram_len, num_frames,
+           reassembled);
+    failures += reassembled != 1;
+  }
+  UNIT_TEST_ASSERT(failures == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(benchmark, "Fragmentation benchmark");
+UNIT_TEST(benchmark)
+{
+  unsigned failures = 0;
+
+  UNIT_TEST_BEGIN();
+
+  keep_frames = false;
+  make_datagram(UIP_BUFSIZE - UIP_IPUDPH_LEN);
+  uint64_t start = nsec_now();
+  for(unsigned i = 0; i < TEST_DATAGRAMS; i++) {
+    failures += !send_datagram();
+  }
+  uint64_t elapsed = nsec_now() - start;
+  printf("%u bytes in %u frames: %u ns per datagram\n", datagram_len,
+         num_frames, (unsigned)(elapsed / TEST_DATAGRAMS));
+  UNIT_TEST_ASSERT(failures == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(reass_benchmark, "Reassembly benchmark");
+UNIT_TEST(reass_benchmark)
+{
+  unsigned failures = 0;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(make_set(0, UIP_BUFSIZE - UIP_IPUDPH_LEN));
+  uint64_t start = nsec_now();
+  for(unsigned i = 0; i < TEST_DATAGRAMS; i++) {
+    for(unsigned j = 0; j < sets[0].num_frames; j++) {
+      input_frame(sets[0].frames[j].data, sets[0].frames[j].len);
+    }
+  }
+  uint64_t elapsed = nsec_now() - start;
+  failures += sets[0].reassembled != TEST_DATAGRAMS;
+  printf("%u bytes from %u frames: %u ns per datagram\n",
+         sets[0].datagram_len, sets[0].num_frames,
+         (unsigned)(elapsed / TEST_DATAGRAMS));
+  UNIT_TEST_ASSERT(failures == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+#if SICSLOWPAN_REASS_DIRECT
+UNIT_TEST_REGISTER(reass_order, "Out-of-order and duplicate fragments");
+UNIT_TEST(reass_order)
+{
+  struct {
+    uint8_t set;
+    uint8_t frame;
+  } schedule[(TEST_SETS - 1) * TEST_MAX_FRAMES], tmp;
+  unsigned num_scheduled = 0;
+  bool fed[TEST_SETS - 1] = { false };
+  sicslowpan_reass_stats_t stats;
+  unsigned failures = 0;
+
+  UNIT_TEST_BEGIN();
+
+  /* Interleave the fragments of as many datagrams as there are
+     reassembly contexts, in random order. */
+  for(unsigned s = 0; s < TEST_SETS - 1; s++) {
+    UNIT_TEST_ASSERT(make_set(s, 400 + 200 * s));
+    for(unsigned i = 0; i < sets[s].num_frames; i++) {
+      schedule[num_scheduled].set = s;
+      schedule[num_scheduled].frame = i;
+      num_scheduled++;
+    }
+  }
+  for(unsigned i = num_scheduled - 1; i > 0; i--) {
+    unsigned j = rand() % (i + 1);
+    tmp = schedule[i];
+    schedule[i] = schedule[j];
+    schedule[j] = tmp;
+  }
+
+  sicslowpan_reass_stats_reset();
+  for(unsigned i = 0; i < num_scheduled; i++) {
+    unsigned s = schedule[i].set;
+    unsigned f = schedule[i].frame;
+    input_frame(sets[s].frames[f].data, sets[s].frames[f].len);
+    if(!fed[s]) {
+      /* The first fragment of each datagram is received twice */
+      input_frame(sets[s].frames[f].data, sets[s].frames[f].len);
+      fed[s] = true;
+    }
+  }
+  for(unsigned s = 0; s < TEST_SETS - 1; s++) {
+    failures += sets[s].reassembled != 1;
+  }
+  sicslowpan_reass_stats(&stats);
+  printf("%u fragments: started %u completed %u duplicates %u\n",
+         num_scheduled, (unsigned)stats.started, (unsigned)stats.completed,
+         (unsigned)stats.duplicates);
+  UNIT_TEST_ASSERT(failures == 0);
+  UNIT_TEST_ASSERT(stats.started == TEST_SETS - 1);
+  UNIT_TEST_ASSERT(stats.completed == TEST_SETS - 1);
+  UNIT_TEST_ASSERT(stats.duplicates == TEST_SETS - 1);
+  UNIT_TEST_ASSERT(stats.evicted == 0 && stats.dropped == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(reass_evict, "Reassembly eviction and timeout");
+UNIT_TEST(reass_evict)
+{
+  sicslowpan_reass_stats_t stats;
+  unsigned failures = 0;
+
+  UNIT_TEST_BEGIN();
+
+  sicslowpan_reass_stats_reset();
+
+  /* A later fragment of one datagram more than there are contexts is
+     dropped, but its first fragment evicts the oldest one. */
+  for(unsigned s = 0; s < TEST_SETS; s++) {
+    UNIT_TEST_ASSERT(make_set(s, 600));
+    input_frame(sets[s].frames[1].data, sets[s].frames[1].len);
+  }
+  sicslowpan_reass_stats(&stats);
+  UNIT_TEST_ASSERT(stats.started == TEST_SETS - 1 && stats.evicted == 0);
+  UNIT_TEST_ASSERT(stats.dropped == 1);
+  input_frame(sets[TEST_SETS - 1].frames[0].data,
+              sets[TEST_SETS - 1].frames[0].len);
+  sicslowpan_reass_stats(&stats);
+  UNIT_TEST_ASSERT(stats.started == TEST_SETS && stats.evicted == 1);
+  for(unsigned s = 1; s < TEST_SETS; s++) {
+    for(unsigned i = 0; i < sets[s].num_frames; i++) {
+      input_frame(sets[s].frames[i].data, sets[s].frames[i].len);
+    }
+    failures += sets[s].reassembled != 1;
+  }
+  UNIT_TEST_ASSERT(failures == 0 && sets[0].reassembled == 0);
+
+  /* An incomplete datagram is dropped when the next fragment arrives
+     after the reassembly timeout. */
+  input_frame(sets[0].frames[0].data, sets[0].frames[0].len);
+  clock_time_t end = clock_time() + SICSLOWPAN_REASS_MAXAGE * CLOCK_SECOND / 16 + 2;
+  while(clock_time() < end);
+  input_frame(sets[1].frames[0].data, sets[1].frames[0].len);
+
+  sicslowpan_reass_stats(&stats);
+  printf("started %u completed %u evicted %u timed out %u\n",
+         (unsigned)stats.started, (unsigned)stats.completed,
+         (unsigned)stats.evicted, (unsigned)stats.timed_out);
+  UNIT_TEST_ASSERT(stats.completed == TEST_SETS - 1);
+  UNIT_TEST_ASSERT(stats.timed_out == 1);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(reass_bad_first, "First fragment that fails to decompress");
+UNIT_TEST(reass_bad_first)
+{
+  static uint8_t bad[PACKETBUF_SIZE];
+  sicslowpan_reass_stats_t stats;
+  unsigned bad_set = TEST_SETS - 1;
+  unsigned failures = 0;
+
+  UNIT_TEST_BEGIN();
+
+  sicslowpan_reass_stats_reset();
+
+  /* A first fragment with an unknown dispatch after the fragment
+     header is dropped without keeping its context. */
+  UNIT_TEST_ASSERT(make_set(bad_set, 600));
+  memcpy(bad, sets[bad_set].frames[0].data, sets[bad_set].frames[0].len);
+  bad[SICSLOWPAN_FRAG1_HDR_LEN] = 0;
+  input_frame(bad, sets[bad_set].frames[0].len);
+
+  /* All contexts are free for as many valid datagrams, received
+     interleaved. */
+  for(unsigned s = 0; s < TEST_SETS - 1; s++) {
+    UNIT_TEST_ASSERT(make_set(s, 600));
+    input_frame(sets[s].frames[0].data, sets[s].frames[0].len);
+  }
+  for(unsigned s = 0; s < TEST_SETS - 1; s++) {
+    for(unsigned i = 1; i < sets[s].num_frames; i++) {
+      input_frame(sets[s].frames[i].data, sets[s].frames[i].len);
+    }
+    failures += sets[s].reassembled != 1;
+  }
+  sicslowpan_reass_stats(&stats);
+  printf("started %u completed %u evicted %u dropped %u\n",
+         (unsigned)stats.started, (unsigned)stats.completed,
+         (unsigned)stats.evicted, (unsigned)stats.dropped);
+  UNIT_TEST_ASSERT(failures == 0 && sets[bad_set].reassembled == 0);
+  UNIT_TEST_ASSERT(stats.completed == TEST_SETS - 1);
+  UNIT_TEST_ASSERT(stats.started == stats.completed + stats.dropped);
+  UNIT_TEST_ASSERT(stats.evicted == 0 && stats.dropped <= 1);
+
+  UNIT_TEST_END();
+}
+#endif /* SICSLOWPAN_REASS_DIRECT */
+/*****************************************************************************/
+#if SICSLOWPAN_FRAG_FORWARD
+UNIT_TEST_REGISTER(forward, "Fragment forwarding");
+UNIT_TEST(forward)
+{
+  static const uip_lladdr_t nexthop_ll = {
+    { 0x02, 0x12, 0x74, 0x02, 0, 0x02, 0x02, 0x02 }
+  };
+  uip_ipaddr_t nexthop_ip;
+  uip_ipaddr_t dest_ip;
+  uip_ds6_nbr_t *nbr;
+  uip_ds6_defrt_t *defrt;
+  uip_ds6_addr_t *addr;
+  sicslowpan_reass_stats_t stats;
+  unsigned num_forwarded;
+  unsigned failures = 0;
+
+  UNIT_TEST_BEGIN();
+
+  /* Send everything to a neighbor */
+  uip_create_linklocal_prefix(&nexthop_ip);
+  uip_ds6_set_addr_iid(&nexthop_ip, &nexthop_ll);
+  nbr = uip_ds6_nbr_add(&nexthop_ip, &nexthop_ll, 1, NBR_REACHABLE,
+                        NBR_TABLE_REASON_UNDEFINED, NULL);
+  defrt = uip_ds6_defrt_add(&nexthop_ip, 0);
+  UNIT_TEST_ASSERT(nbr != NULL && defrt != NULL);
+
+  /* The fragments leave for the next hop as they arrive. Only the
+     first fragment changes, other than the tag. */
+  UNIT_TEST_ASSERT(make_set(0, 600));
+  sicslowpan_reass_stats_reset();
+  num_frames = 0;
+  capture = true;
+  for(unsigned i = 0; i < sets[0].num_frames; i++) {
+    input_frame(sets[0].frames[i].data, sets[0].frames[i].len);
+  }
+  capture = false;
+  num_forwarded = num_frames;
+
+  sicslowpan_reass_stats(&stats);
+  printf("%u fragments in, %u out\n", sets[0].num_frames, num_forwarded);
+  UNIT_TEST_ASSERT(stats.forwarded == 1 && stats.started == 0);
+  UNIT_TEST_ASSERT(sets[0].reassembled == 0);
+  UNIT_TEST_ASSERT(num_forwarded >= sets[0].num_frames);
+  for(unsigned i = 0; i < num_forwarded; i++) {
+    failures += !linkaddr_cmp(&frames[i].receiver, (linkaddr_t *)&nexthop_ll);
+    failures += frames[i].data[2] == sets[0].frames[0].data[2] &&
+      frames[i].data[3] == sets[0].frames[0].data[3];
+  }
+  for(unsigned i = 1; i < sets[0].num_frames; i++) {
+    unsigned j = num_forwarded - sets[0].num_frames + i;
+    failures += frames[j].len != sets[0].frames[i].len ||
+      memcmp(frames[j].data + 4, sets[0].frames[i].data + 4,
+             frames[j].len - 4) != 0;
+  }
+  UNIT_TEST_ASSERT(failures == 0);
+
+  /* The next hop reassembles the datagram, with one hop less to go */
+  memcpy(&dest_ip, &((struct uip_ip_hdr *)datagram)->destipaddr, sizeof(dest_ip));
+  addr = uip_ds6_addr_add(&dest_ip, 0, ADDR_MANUAL);
+  UNIT_TEST_ASSERT(addr != NULL);
+  ((struct uip_ip_hdr *)datagram)->ttl--;
+  reassembled = 0;
+  for(unsigned i = 0; i < num_forwarded; i++) {
+    input_frame(frames[i].data, frames[i].len);
+  }
+  uip_ds6_addr_rm(addr);
+  UNIT_TEST_ASSERT(reassembled == 1);
+
+  /* A retransmitted fragment does not complete the datagram early, so
+     the last fragment is still forwarded rather than reassembled */
+  UNIT_TEST_ASSERT(make_set(1, 600) && sets[1].num_frames > 2);
+  sicslowpan_reass_stats_reset();
+  num_frames = 0;
+  capture = true;
+  for(unsigned i = 0; i < sets[1].num_frames; i++) {
+    input_frame(sets[1].frames[i].data, sets[1].frames[i].len);
+    if(i == 1) {
+      input_frame(sets[1].frames[i].data, sets[1].frames[i].len);
+    }
+  }
+  capture = false;
+  uip_ds6_defrt_rm(defrt);
+  uip_ds6_nbr_rm(nbr);
+
+  sicslowpan_reass_stats(&stats);
+  printf("%u fragments and a duplicate in, %u out\n", sets[1].num_frames,
+         num_frames);
+  UNIT_TEST_ASSERT(stats.forwarded == 1 && stats.started == 0);
+  UNIT_TEST_ASSERT(stats.duplicates == 1);
+  UNIT_TEST_ASSERT(num_frames >= sets[1].num_frames + 1);
+
+  UNIT_TEST_END();
+}
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+/*****************************************************************************/
+#if SICSLOWPAN_RFRAG
+/* Fields of recoverable fragments and RFRAG-ACKs */
+#define RFRAG_DISPATCH(f) ((f)[0] & SICSLOWPAN_DISPATCH_RFRAG_MASK)
+#define RFRAG_SEQ(f) (((f)[2] >> 2) & 0x1f)
+#define RFRAG_SIZE(f) ((((f)[2] & 0x03) << 8) | (f)[3])
+#define RFRAG_OFFSET(f) (((f)[4] << 8) | (f)[5])
+#define RFRAG_BITMAP(f) ((uint32_t)(f)[2] << 24 | (uint32_t)(f)[3] << 16 | \
+                         (uint32_t)(f)[4] << 8 | (f)[5])
+
+static uint8_t ack[SICSLOWPAN_RFRAG_ACK_LEN];
+static bool rfrag_abort_sent;
+/*****************************************************************************/
+/* Keeps the last RFRAG-ACK among the captured frames */
+static bool
+keep_ack(void)
+{
+  for(unsigned i = num_frames; i > 0; i--) {
+    if(RFRAG_DISPATCH(frames[i - 1].data) == SICSLOWPAN_DISPATCH_RFRAG_ACK) {
+      memcpy(ack, frames[i - 1].data, sizeof(ack));
+      return true;
+    }
+  }
+  return false;
+}
+/*****************************************************************************/
+/* Feeds all fragments of a set, and the RFRAG-ACK that they produce back
+   to the sender, which then releases the datagram */
+static void
+rfrag_complete(unsigned set)
+{
+  num_frames = 0;
+  capture = true;
+  for(unsigned i = 0; i < sets[set].num_frames; i++) {
+    input_frame(sets[set].frames[i].data, sets[set].frames[i].len);
+  }
+  capture = false;
+  if(keep_ack()) {
+    input_frame(ack, sizeof(ack));
+  }
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(rfrag, "Recoverable fragments");
+UNIT_TEST(rfrag)
+{
+  sicslowpan_reass_stats_t stats;
+  const uint8_t *f;
+  uint32_t expected;
+  uint16_t len = 0;
+  unsigned last;
+  unsigned failures = 0;
+
+  UNIT_TEST_BEGIN();
+
+  keep_frames = true;
+  sicslowpan_reass_stats_reset();
+
+  /* The fragments are numbered, the first one carries the size of the
+     compressed datagram, and the last one asks for an RFRAG-ACK. */
+  UNIT_TEST_ASSERT(make_set(0, 600) && sets[0].num_frames > 2);
+  last = sets[0].num_frames - 1;
+  for(unsigned i = 0; i < sets[0].num_frames; i++) {
+    f = sets[0].frames[i].data;
+    failures += RFRAG_DISPATCH(f) != SICSLOWPAN_DISPATCH_RFRAG ||
+      f[1] != sets[0].frames[0].data[1] || RFRAG_SEQ(f) != i ||
+      !(f[0] & SICSLOWPAN_RFRAG_ACK_REQUEST) != (i != last) ||
+      sets[0].frames[i].len != SICSLOWPAN_RFRAG_HDR_LEN + RFRAG_SIZE(f) ||
+      (i > 0 && RFRAG_OFFSET(f) != len);
+    len += RFRAG_SIZE(f);
+  }
+  failures += RFRAG_OFFSET(sets[0].frames[0].data) != len;
+  UNIT_TEST_ASSERT(failures == 0);
+
+  /* Without the second fragment, the RFRAG-ACK tells what is missing */
+  num_frames = 0;
+  capture = true;
+  for(unsigned i = 0; i < sets[0].num_frames; i++) {
+    if(i != 1) {
+      input_frame(sets[0].frames[i].data, sets[0].frames[i].len);
+    }
+  }
+  capture = false;
+  expected = ~(SICSLOWPAN_RFRAG_BITMAP_FULL >> sets[0].num_frames) &
+    ~(0x80000000UL >> 1);
+  UNIT_TEST_ASSERT(num_frames == 1 && keep_ack());
+  UNIT_TEST_ASSERT(linkaddr_cmp(&frames[0].receiver, &dest));
+  UNIT_TEST_ASSERT(ack[1] == sets[0].frames[0].data[1]);
+  UNIT_TEST_ASSERT(RFRAG_BITMAP(ack) == expected);
+  UNIT_TEST_ASSERT(sets[0].reassembled == 0);
+
+  /* Only the missing fragment is sent again, and asks for an RFRAG-ACK */
+  num_frames = 0;
+  capture = true;
+  input_frame(ack, sizeof(ack));
+  capture = false;
+  f = frames[0].data;
+  UNIT_TEST_ASSERT(num_frames == 1 && (f[0] & SICSLOWPAN_RFRAG_ACK_REQUEST));
+  UNIT_TEST_ASSERT(frames[0].len == sets[0].frames[1].len &&
+                   memcmp(f + 1, sets[0].frames[1].data + 1,
+                          frames[0].len - 1) == 0);
+
+  /* It completes the datagram */
+  memcpy(frames[TEST_MAX_FRAMES - 1].data, f, frames[0].len);
+  num_frames = 0;
+  capture = true;
+  input_frame(frames[TEST_MAX_FRAMES - 1].data, frames[0].len);
+  capture = false;
+  UNIT_TEST_ASSERT(sets[0].reassembled == 1);
+  UNIT_TEST_ASSERT(num_frames == 1 && keep_ack() &&
+                   RFRAG_BITMAP(ack) == SICSLOWPAN_RFRAG_BITMAP_FULL);
+
+  /* The FULL RFRAG-ACK releases the datagram */
+  num_frames = 0;
+  capture = true;
+  input_frame(ack, sizeof(ack));
+  capture = false;
+  UNIT_TEST_ASSERT(num_frames == 0);
+
+  /* If that RFRAG-ACK was lost, asking again gets another one */
+  num_frames = 0;
+  capture = true;
+  input_frame(sets[0].frames[last].data, sets[0].frames[last].len);
+  capture = false;
+  UNIT_TEST_ASSERT(sets[0].reassembled == 1);
+  UNIT_TEST_ASSERT(num_frames == 1 && keep_ack() &&
+                   RFRAG_BITMAP(ack) == SICSLOWPAN_RFRAG_BITMAP_FULL);
+
+  sicslowpan_reass_stats(&stats);
+  printf("%u fragments, one lost: started %u completed %u retransmitted %u\n",
+         sets[0].num_frames, (unsigned)stats.started,
+         (unsigned)stats.completed, (unsigned)stats.retransmitted);
+  UNIT_TEST_ASSERT(stats.started == 1 && stats.completed == 1);
+  UNIT_TEST_ASSERT(stats.retransmitted == 1 && stats.aborted == 0);
+
+  /* The datagram buffer is free for the next datagram */
+  UNIT_TEST_ASSERT(make_set(1, 600));
+  UNIT_TEST_ASSERT(RFRAG_DISPATCH(sets[1].frames[0].data) == SICSLOWPAN_DISPATCH_RFRAG);
+  rfrag_complete(1);
+  UNIT_TEST_ASSERT(sets[1].reassembled == 1);
+
+  /* Broadcast datagrams are sent in RFC 4944 fragments */
+  make_datagram(600);
+  num_frames = 0;
+  capture = true;
+  memcpy(uip_buf, datagram, datagram_len);
+  uip_len = datagram_len;
+  UNIT_TEST_ASSERT(NETSTACK_NETWORK.output(NULL));
+  capture = false;
+  UNIT_TEST_ASSERT(num_frames > 1 &&
+                   (frames[0].data[0] & 0xf8) == SICSLOWPAN_DISPATCH_FRAG1);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+/* Sends a datagram whose fragments are all lost */
+static void
+rfrag_abort_begin(void)
+{
+  keep_frames = true;
+  sicslowpan_reass_stats_reset();
+  rfrag_abort_sent = make_set(0, 600);
+  num_frames = 0;
+  capture = true;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(rfrag_abort, "Recoverable fragments timeout and abort");
+UNIT_TEST(rfrag_abort)
+{
+  sicslowpan_reass_stats_t stats;
+  unsigned last;
+  unsigned failures = 0;
+  const uint8_t *f;
+
+  UNIT_TEST_BEGIN();
+
+  capture = false;
+  UNIT_TEST_ASSERT(rfrag_abort_sent);
+  last = sets[0].num_frames - 1;
+
+  /* After each timeout, the last fragment asks for an RFRAG-ACK again.
+     Then the receiver is told to drop the datagram. */
+  printf("%u frames after the timeouts\n", num_frames);
+  UNIT_TEST_ASSERT(num_frames == SICSLOWPAN_CONF_RFRAG_MAX_RETRIES + 1);
+  for(unsigned i = 0; i < SICSLOWPAN_CONF_RFRAG_MAX_RETRIES; i++) {
+    failures += frames[i].len != sets[0].frames[last].len ||
+      memcmp(frames[i].data, sets[0].frames[last].data, frames[i].len) != 0;
+  }
+  UNIT_TEST_ASSERT(failures == 0);
+  f = frames[SICSLOWPAN_CONF_RFRAG_MAX_RETRIES].data;
+  UNIT_TEST_ASSERT(frames[SICSLOWPAN_CONF_RFRAG_MAX_RETRIES].len == SICSLOWPAN_RFRAG_HDR_LEN);
+  UNIT_TEST_ASSERT(RFRAG_DISPATCH(f) == SICSLOWPAN_DISPATCH_RFRAG &&
+                   f[1] == sets[0].frames[0].data[1] &&
+                   RFRAG_SEQ(f) == 0 && RFRAG_SIZE(f) == 0 &&
+                   RFRAG_OFFSET(f) == 0);
+
+  /* The receiver drops what it has of the datagram */
+  for(unsigned i = 0; i < last; i++) {
+    input_frame(sets[0].frames[i].data, sets[0].frames[i].len);
+  }
+  input_frame(f, SICSLOWPAN_RFRAG_HDR_LEN);
+  input_frame(sets[0].frames[last].data, sets[0].frames[last].len);
+
+  sicslowpan_reass_stats(&stats);
+  printf("retransmitted %u aborted %u started %u dropped %u\n",
+         (unsigned)stats.retransmitted, (unsigned)stats.aborted,
+         (unsigned)stats.started, (unsigned)stats.dropped);
+  UNIT_TEST_ASSERT(stats.retransmitted == SICSLOWPAN_CONF_RFRAG_MAX_RETRIES);
+  UNIT_TEST_ASSERT(stats.aborted == 1);
+  UNIT_TEST_ASSERT(stats.dropped == 1 && stats.completed == 0);
+  UNIT_TEST_ASSERT(sets[0].reassembled == 0);
+
+  /* The datagram buffer is free again */
+  UNIT_TEST_ASSERT(make_set(1, 600));
+  UNIT_TEST_ASSERT(RFRAG_DISPATCH(sets[1].frames[0].data) == SICSLOWPAN_DISPATCH_RFRAG);
+  rfrag_complete(1);
+  UNIT_TEST_ASSERT(sets[1].reassembled == 1);
+
+  UNIT_TEST_END();
+}
+#if SICSLOWPAN_FRAG_FORWARD
+/*****************************************************************************/
+UNIT_TEST_REGISTER(rfrag_forward, "Recoverable fragment forwarding");
+UNIT_TEST(rfrag_forward)
+{
+  static const linkaddr_t nexthop_ll = {
+    { 0x02, 0x12, 0x74, 0x02, 0, 0x02, 0x02, 0x02 }
+  };
+  static struct {
+    uint8_t data[PACKETBUF_SIZE];
+    uint16_t len;
+  } forwarded[TEST_MAX_FRAMES];
+  uip_ipaddr_t nexthop_ip;
+  uip_ipaddr_t dest_ip;
+  uip_ds6_nbr_t *nbr;
+  uip_ds6_defrt_t *defrt;
+  uip_ds6_addr_t *addr;
+  sicslowpan_reass_stats_t stats;
+  const uint8_t *f;
+  const uint8_t *in;
+  unsigned num_forwarded;
+  int delta;
+  unsigned failures = 0;
+
+  UNIT_TEST_BEGIN();
+
+  keep_frames = true;
+  uip_create_linklocal_prefix(&nexthop_ip);
+  uip_ds6_set_addr_iid(&nexthop_ip, (const uip_lladdr_t *)&nexthop_ll);
+  nbr = uip_ds6_nbr_add(&nexthop_ip, (const uip_lladdr_t *)&nexthop_ll, 1,
+                        NBR_REACHABLE, NBR_TABLE_REASON_UNDEFINED, NULL);
+  defrt = uip_ds6_defrt_add(&nexthop_ip, 0);
+  UNIT_TEST_ASSERT(nbr != NULL && defrt != NULL);
+
+  /* The fragments leave for the next hop with another tag. The header
+     grows by the hop limit, which no longer compresses, so the offsets
+     of the fragments that follow the first one are shifted. */
+  UNIT_TEST_ASSERT(make_set(0, 600));
+  sicslowpan_reass_stats_reset();
+  num_frames = 0;
+  capture = true;
+  for(unsigned i = 0; i < sets[0].num_frames; i++) {
+    input_frame(sets[0].frames[i].data, sets[0].frames[i].len);
+  }
+  capture = false;
+  num_forwarded = num_frames;
+  for(unsigned i = 0; i < num_forwarded; i++) {
+    memcpy(forwarded[i].data, frames[i].data, frames[i].len);
+    forwarded[i].len = frames[i].len;
+  }
+
+  sicslowpan_reass_stats(&stats);
+  delta = (int)forwarded[0].len - sets[0].frames[0].len;
+  printf("%u fragments in, %u out, header %+d\n", sets[0].num_frames,
+         num_forwarded, delta);
+  UNIT_TEST_ASSERT(stats.forwarded == 1 && stats.started == 0);
+  UNIT_TEST_ASSERT(num_forwarded == sets[0].num_frames && delta == 1);
+  UNIT_TEST_ASSERT(forwarded[0].data[1] != sets[0].frames[0].data[1]);
+  UNIT_TEST_ASSERT(RFRAG_OFFSET(forwarded[0].data) ==
+                   RFRAG_OFFSET(sets[0].frames[0].data) + delta);
+  for(unsigned i = 0; i < num_forwarded; i++) {
+    f = forwarded[i].data;
+    in = sets[0].frames[i].data;
+    failures += !linkaddr_cmp(&frames[i].receiver, &nexthop_ll) ||
+      f[0] != in[0] || f[1] != forwarded[0].data[1] ||
+      RFRAG_SEQ(f) != RFRAG_SEQ(in);
+    if(i > 0) {
+      failures += forwarded[i].len != sets[0].frames[i].len ||
+        RFRAG_OFFSET(f) != RFRAG_OFFSET(in) + delta ||
+        memcmp(f + SICSLOWPAN_RFRAG_HDR_LEN, in + SICSLOWPAN_RFRAG_HDR_LEN,
+               forwarded[i].len - SICSLOWPAN_RFRAG_HDR_LEN) != 0;
+    }
+  }
+  UNIT_TEST_ASSERT(failures == 0);
+
+  /* The next hop reassembles the datagram, with one hop less to go */
+  memcpy(&dest_ip, &((struct uip_ip_hdr *)datagram)->destipaddr, sizeof(dest_ip));
+  addr = uip_ds6_addr_add(&dest_ip, 0, ADDR_MANUAL);
+  UNIT_TEST_ASSERT(addr != NULL);
+  ((struct uip_ip_hdr *)datagram)->ttl--;
+  reassembled = 0;
+  num_frames = 0;
+  capture = true;
+  for(unsigned i = 0; i < num_forwarded; i++) {
+    input_frame_from(&nexthop_ll, forwarded[i].data, forwarded[i].len);
+  }
+  capture = false;
+  uip_ds6_addr_rm(addr);
+  UNIT_TEST_ASSERT(reassembled == 1);
+  UNIT_TEST_ASSERT(keep_ack() && ack[1] == forwarded[0].data[1] &&
+                   RFRAG_BITMAP(ack) == SICSLOWPAN_RFRAG_BITMAP_FULL);
+
+  /* Its RFRAG-ACK is relayed to the previous hop with the tag of the
+     previous hop, and releases the datagram there */
+  num_frames = 0;
+  capture = true;
+  input_frame_from(&nexthop_ll, ack, sizeof(ack));
+  capture = false;
+  UNIT_TEST_ASSERT(num_frames == 1 && keep_ack() &&
+                   linkaddr_cmp(&frames[0].receiver, &dest));
+  UNIT_TEST_ASSERT(ack[1] == sets[0].frames[0].data[1] &&
+                   RFRAG_BITMAP(ack) == SICSLOWPAN_RFRAG_BITMAP_FULL);
+  input_frame(ack, sizeof(ack));
+  uip_ds6_defrt_rm(defrt);
+  uip_ds6_nbr_rm(nbr);
+
+  UNIT_TEST_ASSERT(make_set(1, 600));
+  UNIT_TEST_ASSERT(RFRAG_DISPATCH(sets[1].frames[0].data) == SICSLOWPAN_DISPATCH_RFRAG);
+  rfrag_complete(1);
+  UNIT_TEST_ASSERT(sets[1].reassembled == 1);
+
+  UNIT_TEST_END();
+}
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+#endif /* SICSLOWPAN_RFRAG */
+/*****************************************************************************/
+PROCESS_THREAD(test_sicslowpan_frag_process, ev, data)
+{
+#if SICSLOWPAN_RFRAG
+  static struct etimer et;
+#endif /* SICSLOWPAN_RFRAG */
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  srand(500);
+  netstack_sniffer_add(&sniffer);
+
+#if SICSLOWPAN_RFRAG
+  /* First, while no datagram waits for an RFRAG-ACK */
+  UNIT_TEST_RUN(rfrag);
+#if SICSLOWPAN_FRAG_FORWARD
+  UNIT_TEST_RUN(rfrag_forward);
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+  rfrag_abort_begin();
+  etimer_set(&et, (SICSLOWPAN_CONF_RFRAG_MAX_RETRIES + 2) *
+             SICSLOWPAN_CONF_RFRAG_ACK_TIMEOUT);
+  PROCESS_WAIT_UNTIL(etimer_expired(&et));
+  UNIT_TEST_RUN(rfrag_abort);
+#endif /* SICSLOWPAN_RFRAG */
+  UNIT_TEST_RUN(fragments);
+  UNIT_TEST_RUN(benchmark);
+  UNIT_TEST_RUN(reass_benchmark);
+#if SICSLOWPAN_REASS_DIRECT
+  UNIT_TEST_RUN(reass_order);
+  UNIT_TEST_RUN(reass_bad_first);
+  UNIT_TEST_RUN(reass_evict);
+#endif /* SICSLOWPAN_REASS_DIRECT */
+#if SICSLOWPAN_FRAG_FORWARD
+  UNIT_TEST_RUN(forward);
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+
+  if(!UNIT_TEST_PASSED(fragments) ||
+     !UNIT_TEST_PASSED(benchmark) ||
+     !UNIT_TEST_PASSED(reass_benchmark)
+#if SICSLOWPAN_REASS_DIRECT
+     || !UNIT_TEST_PASSED(reass_order)
+     || !UNIT_TEST_PASSED(reass_evict)
+     || !UNIT_TEST_PASSED(reass_bad_first)
+#endif /* SICSLOWPAN_REASS_DIRECT */
+#if SICSLOWPAN_FRAG_FORWARD
+     || !UNIT_TEST_PASSED(forward)
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+#if SICSLOWPAN_RFRAG
+     || !UNIT_TEST_PASSED(rfrag)
+     || !UNIT_TEST_PASSED(rfrag_abort)
+#if SICSLOWPAN_FRAG_FORWARD
+     || !UNIT_TEST_PASSED(rfrag_forward)
+#endif /* SICSLOWPAN_FRAG_FORWARD */
+#endif /* SICSLOWPAN_RFRAG */
+     ) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
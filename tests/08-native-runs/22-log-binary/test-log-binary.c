@@ -0,0 +1,333 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests for binary logging: the contents of the records, the
+ *      framing of the output, the per-module log levels and the
+ *      behavior when the ring buffer is full.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "lib/crc16.h"
+#include "unit-test/unit-test.h"
+
+#include "sys/log.h"
+#define LOG_MODULE "Test"
+#define LOG_LEVEL LOG_LEVEL_MAIN
+/*****************************************************************************/
+/* The number of messages logged in the benchmark. */
+#define TEST_ROUNDS 100000
+/*****************************************************************************/
+PROCESS(test_log_binary_process, "Binary log test process");
+AUTOSTART_PROCESSES(&test_log_binary_process);
+
+extern const char __start_log_fmt[];
+
+static uint8_t output[4096];
+static unsigned output_len;
+static bool output_enabled = true;
+
+static uint8_t record[LOG_BINARY_MAX_RECORD];
+static unsigned record_len;
+/*****************************************************************************/
+void
+test_log_output(const unsigned char *buf, unsigned len)
+{
+  if(output_enabled && output_len + len <= sizeof(output)) {
+    memcpy(&output[output_len], buf, len);
+    output_len += len;
+  }
+}
+/*****************************************************************************/
+/* Remove the SLIP framing from the first record of the output, check
+   its CRC, and remove it from the output. */
+static bool
+next_record(void)
+{
+  unsigned i = 0;
+  unsigned end;
+  bool esc = false;
+
+  while(i < output_len && output[i] == 0300) {
+    i++;
+  }
+  record_len = 0;
+  for(end = i; end < output_len && output[end] != 0300; end++) {
+    if(record_len == sizeof(record)) {
+      return false;
+    }
+    if(esc) {
+      record[record_len++] = output[end] == 0334 ? 0300 : 0333;
+      esc = false;
+    } else if(output[end] == 0333) {
+      esc = true;
+    } else {
+      record[record_len++] = output[end];
+    }
+  }
+  if(end == output_len || record_len < sizeof(struct log_binary_header) + 2) {
+    return false;
+  }
+  memmove(output, &output[end + 1], output_len - end - 1);
+  output_len -= end + 1;
+
+  record_len -= 2;
+  return crc16_data(record, record_len, 0)
+    == (record[record_len] | (record[record_len + 1] << 8))
+    && record[0] == record_len;
+}
+/*****************************************************************************/
+static const struct log_binary_header *
+header(void)
+{
+  return (const struct log_binary_header *)record;
+}
+/*****************************************************************************/
+static const uint8_t *
+args(void)
+{
+  return record + sizeof(struct log_binary_header);
+}
+/*****************************************************************************/
+static void
+drain_all(void)
+{
+  log_binary_flush();
+  output_len = 0;
+}
+/*****************************************************************************/
+static uint64_t
+nsec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(records, "Record contents");
+UNIT_TEST(records)
+{
+  const char *desc;
+  uint32_t u32;
+  uint64_t u64;
+  uip_ipaddr_t ipaddr;
+
+  UNIT_TEST_BEGIN();
+
+  drain_all();
+
+  LOG_INFO("int %d unsigned %u long %lu str %s!\n",
+           -5, 42u, 123456789ul, "abc");
+  UNIT_TEST_ASSERT(log_binary_flush() == 1);
+  UNIT_TEST_ASSERT(next_record());
+  UNIT_TEST_ASSERT(header()->flags
+                   == LOG_BINARY_FLAGS(LOG_BINARY_TYPE_MESSAGE, 1,
+                                       LOG_LEVEL_INFO));
+
+  /* The message ID locates the module and the format string. */
+  desc = __start_log_fmt + header()->id;
+  UNIT_TEST_ASSERT(strcmp(desc, LOG_MODULE) == 0);
+  UNIT_TEST_ASSERT(strcmp(desc + sizeof(LOG_MODULE),
+                          "int %d unsigned %u long %lu str %s!\n") == 0);
+
+  UNIT_TEST_ASSERT(record_len == sizeof(struct log_binary_header)
+                   + 4 + 4 + sizeof(long) + 1 + 3);
+  memcpy(&u32, args(), 4);
+  UNIT_TEST_ASSERT((int32_t)u32 == -5);
+  memcpy(&u32, args() + 4, 4);
+  UNIT_TEST_ASSERT(u32 == 42);
+  if(sizeof(long) == 8) {
+    memcpy(&u64, args() + 8, 8);
+  } else {
+    memcpy(&u32, args() + 8, 4);
+    u64 = u32;
+  }
+  UNIT_TEST_ASSERT(u64 == 123456789);
+  UNIT_TEST_ASSERT(args()[8 + sizeof(long)] == 3);
+  UNIT_TEST_ASSERT(memcmp(args() + 9 + sizeof(long), "abc", 3) == 0);
+
+  /* Continuations and addresses. */
+  uip_ip6addr(&ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0xc000);
+  LOG_DBG_("addr ");
+  LOG_DBG_6ADDR(&ipaddr);
+  UNIT_TEST_ASSERT(log_binary_flush() == 2);
+  UNIT_TEST_ASSERT(next_record());
+  UNIT_TEST_ASSERT(header()->flags
+                   == LOG_BINARY_FLAGS(LOG_BINARY_TYPE_MESSAGE, 0,
+                                       LOG_LEVEL_DBG));
+  UNIT_TEST_ASSERT(next_record());
+  UNIT_TEST_ASSERT(header()->flags >> 4 == LOG_BINARY_TYPE_6ADDR);
+  UNIT_TEST_ASSERT(record_len == sizeof(struct log_binary_header) + 16);
+  UNIT_TEST_ASSERT(memcmp(args(), &ipaddr, 16) == 0);
+  UNIT_TEST_ASSERT(output_len == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(levels, "Per-module log levels");
+UNIT_TEST(levels)
+{
+  UNIT_TEST_BEGIN();
+
+  drain_all();
+
+  log_set_level("main", LOG_LEVEL_WARN);
+  LOG_INFO("filtered\n");
+  LOG_WARN("kept\n");
+  log_set_level("main", LOG_LEVEL_DBG);
+
+  UNIT_TEST_ASSERT(log_binary_flush() == 1);
+  UNIT_TEST_ASSERT(next_record());
+  UNIT_TEST_ASSERT((header()->flags & 0x07) == LOG_LEVEL_WARN);
+  UNIT_TEST_ASSERT(strcmp(__start_log_fmt + header()->id + sizeof(LOG_MODULE),
+                          "kept\n") == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(overflow, "Full ring buffer");
+UNIT_TEST(overflow)
+{
+  const struct log_binary_stats *stats = log_binary_get_stats();
+  uint32_t records;
+  uint32_t dropped;
+  unsigned i;
+  uint32_t u32;
+
+  UNIT_TEST_BEGIN();
+
+  drain_all();
+  records = stats->records;
+  dropped = stats->dropped;
+
+  /* 12-byte records do not all fit in the ring buffer. */
+  for(i = 0; i < LOG_BINARY_BUFFER_SIZE / 12 + 5; i++) {
+    LOG_INFO("%u\n", i);
+  }
+  printf("Logged %u, stored %u, dropped %u\n", i,
+         (unsigned)(stats->records - records),
+         (unsigned)(stats->dropped - dropped));
+  UNIT_TEST_ASSERT(stats->records - records == LOG_BINARY_BUFFER_SIZE / 12);
+  UNIT_TEST_ASSERT(stats->dropped - dropped == 5);
+
+  /* The stored records come out in order, after wrapping around. */
+  UNIT_TEST_ASSERT(log_binary_flush() == LOG_BINARY_BUFFER_SIZE / 12);
+  for(i = 0; i < LOG_BINARY_BUFFER_SIZE / 12; i++) {
+    UNIT_TEST_ASSERT(next_record());
+    memcpy(&u32, args(), 4);
+    UNIT_TEST_ASSERT(u32 == i);
+  }
+  UNIT_TEST_ASSERT(output_len == 0);
+
+  /* There is room again. */
+  LOG_INFO("%u\n", i);
+  UNIT_TEST_ASSERT(stats->dropped - dropped == 5);
+  drain_all();
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(benchmark, "Logging cost");
+UNIT_TEST(benchmark)
+{
+  char buf[64];
+  uint64_t start;
+  uint64_t record = 0;
+  uint64_t send = 0;
+  uint64_t text;
+  unsigned i;
+
+  UNIT_TEST_BEGIN();
+
+  drain_all();
+  output_enabled = false;
+
+  /* Compare the cost of a binary record at log time, and of sending it
+     later, with formatting the same message as text. */
+  for(i = 0; i < TEST_ROUNDS; i++) {
+    start = nsec_now();
+    LOG_INFO("Received %u bytes from %u, rssi %d\n", i, i & 0xff, -70);
+    record += nsec_now() - start;
+    if((i & 7) == 7) {
+      start = nsec_now();
+      log_binary_flush();
+      send += nsec_now() - start;
+    }
+  }
+
+  start = nsec_now();
+  for(i = 0; i < TEST_ROUNDS; i++) {
+    snprintf(buf, sizeof(buf), "[%-4s: %-10s] ", "INFO", LOG_MODULE);
+    snprintf(buf, sizeof(buf), "Received %u bytes from %u, rssi %d\n",
+             i, i & 0xff, -70);
+  }
+  text = nsec_now() - start;
+
+  printf("Binary record: %u ns, sending: %u ns, text formatting: %u ns "
+         "per message\n", (unsigned)(record / TEST_ROUNDS),
+         (unsigned)(send / TEST_ROUNDS), (unsigned)(text / TEST_ROUNDS));
+
+  output_enabled = true;
+  UNIT_TEST_ASSERT(log_binary_get_stats()->dropped == 5);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_log_binary_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(records);
+  UNIT_TEST_RUN(levels);
+  UNIT_TEST_RUN(overflow);
+  UNIT_TEST_RUN(benchmark);
+
+  if(!UNIT_TEST_PASSED(records) ||
+     !UNIT_TEST_PASSED(levels) ||
+     !UNIT_TEST_PASSED(overflow) ||
+     !UNIT_TEST_PASSED(benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
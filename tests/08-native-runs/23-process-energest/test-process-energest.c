@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests for the per-process CPU accounting, including the
+ *      attribution of time to processes that are called synchronously
+ *      from within other processes.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "sys/energest.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Busy times of the worker and of the caller, in milliseconds. */
+#define WORKER_MSEC 20
+#define CALLER_MSEC 10
+#define ROUNDS      5
+/*****************************************************************************/
+PROCESS(test_process_energest_process, "Process energest test process");
+PROCESS(worker_process, "Worker");
+PROCESS(caller_process, "Caller");
+AUTOSTART_PROCESSES(&test_process_energest_process);
+/*****************************************************************************/
+static void
+busy_wait(unsigned msec)
+{
+  struct timespec start, now;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  do {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+  } while((now.tv_sec - start.tv_sec) * 1000 +
+          (now.tv_nsec - start.tv_nsec) / 1000000 < msec);
+}
+/*****************************************************************************/
+static unsigned
+to_msec(uint64_t time)
+{
+  return (unsigned)(time * 1000 / ENERGEST_SECOND);
+}
+/*****************************************************************************/
+PROCESS_THREAD(worker_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    busy_wait(WORKER_MSEC);
+  }
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(caller_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    busy_wait(CALLER_MSEC);
+    process_post_synch(&worker_process, PROCESS_EVENT_CONTINUE, NULL);
+  }
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(accounting, "Per-process accounting");
+UNIT_TEST(accounting)
+{
+  const struct process_energest *worker = &worker_process.energest;
+  const struct process_energest *caller = &caller_process.energest;
+
+  UNIT_TEST_BEGIN();
+
+  /* The initialization event of each process. */
+  UNIT_TEST_ASSERT(worker->calls == 1);
+  UNIT_TEST_ASSERT(caller->calls == 1);
+
+  for(int i = 0; i < ROUNDS; i++) {
+    process_post_synch(&caller_process, PROCESS_EVENT_CONTINUE, NULL);
+  }
+  process_poll(&worker_process);
+  process_run();
+
+  printf("Worker: %u calls, %u events, %u ms, max %u ms\n",
+         (unsigned)worker->calls, (unsigned)worker->events,
+         to_msec(worker->time), to_msec(worker->max_time));
+  printf("Caller: %u calls, %u events, %u ms, max %u ms\n",
+         (unsigned)caller->calls, (unsigned)caller->events,
+         to_msec(caller->time), to_msec(caller->max_time));
+
+  UNIT_TEST_ASSERT(worker->calls == 2 + ROUNDS);
+  UNIT_TEST_ASSERT(worker->events == 1 + ROUNDS);
+  UNIT_TEST_ASSERT(caller->calls == 1 + ROUNDS);
+  UNIT_TEST_ASSERT(caller->events == 1 + ROUNDS);
+
+  /* The caller is not charged for the worker's time. The energest
+     clock is coarser than the busy wait, so allow 1 ms per call. */
+  UNIT_TEST_ASSERT(to_msec(worker->time) >= (ROUNDS + 1) * (WORKER_MSEC - 1));
+  UNIT_TEST_ASSERT(to_msec(worker->time) < (ROUNDS + 1) * WORKER_MSEC * 3 / 2);
+  UNIT_TEST_ASSERT(to_msec(caller->time) >= ROUNDS * (CALLER_MSEC - 1));
+  UNIT_TEST_ASSERT(to_msec(caller->time) < ROUNDS * WORKER_MSEC);
+  UNIT_TEST_ASSERT(to_msec(worker->max_time) >= WORKER_MSEC - 1);
+  UNIT_TEST_ASSERT(to_msec(caller->max_time) < WORKER_MSEC);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_process_energest_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  process_start(&worker_process, NULL);
+  process_start(&caller_process, NULL);
+
+  UNIT_TEST_RUN(accounting);
+
+  if(!UNIT_TEST_PASSED(accounting)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
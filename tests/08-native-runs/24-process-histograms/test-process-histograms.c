@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests for the event loop histograms: event and poll
+ *      latencies, intervals between process_run() calls, and event
+ *      queue depths.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* The number of events posted at once, and the time they wait. */
+#define EVENTS     5
+#define WAIT_MSEC  5
+/*****************************************************************************/
+PROCESS(test_process_histograms_process, "Histogram test process");
+PROCESS(sink_process, "Sink");
+AUTOSTART_PROCESSES(&test_process_histograms_process);
+
+static unsigned received;
+/*****************************************************************************/
+static void
+busy_wait(unsigned msec)
+{
+  struct timespec start, now;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  do {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+  } while((now.tv_sec - start.tv_sec) * 1000 +
+          (now.tv_nsec - start.tv_nsec) / 1000000 < msec);
+}
+/*****************************************************************************/
+static uint32_t
+samples(const process_histogram_t *h)
+{
+  uint32_t count = 0;
+
+  for(int i = 0; i < PROCESS_HISTOGRAM_BUCKETS; i++) {
+    count += h->buckets[i];
+  }
+  return count;
+}
+/*****************************************************************************/
+/* The number of samples of at least the given value. */
+static uint32_t
+samples_from(const process_histogram_t *h, uint32_t value)
+{
+  uint32_t count = 0;
+
+  for(int i = 1; i < PROCESS_HISTOGRAM_BUCKETS; i++) {
+    if(((uint32_t)1 << (i - 1)) >= value) {
+      count += h->buckets[i];
+    }
+  }
+  return count;
+}
+/*****************************************************************************/
+PROCESS_THREAD(sink_process, ev, data)
+{
+  PROCESS_POLLHANDLER(received++);
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT();
+    if(ev == PROCESS_EVENT_CONTINUE) {
+      received++;
+    }
+  }
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(histograms, "Event loop histograms");
+UNIT_TEST(histograms)
+{
+  const process_histograms_t *h = process_get_histograms();
+  uint32_t wait = WAIT_MSEC * RTIMER_SECOND / 1000;
+  char buf[64];
+  int runs;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(h != NULL);
+
+  /* Start from an idle event loop. */
+  while(process_run() > 0);
+  process_histograms_reset();
+  received = 0;
+
+  /* Events wait in the queue while the current process runs. */
+  for(int i = 0; i < EVENTS; i++) {
+    UNIT_TEST_ASSERT(process_post(&sink_process, PROCESS_EVENT_CONTINUE,
+                                  NULL) == PROCESS_ERR_OK);
+  }
+  busy_wait(WAIT_MSEC);
+  for(runs = 0; process_run() > 0; runs++);
+  UNIT_TEST_ASSERT(received == EVENTS);
+
+  UNIT_TEST_ASSERT(samples(&h->event_latency) == EVENTS);
+  UNIT_TEST_ASSERT(samples_from(&h->event_latency, wait / 2) == EVENTS);
+  UNIT_TEST_ASSERT(h->event_latency.max >= wait);
+  UNIT_TEST_ASSERT(samples(&h->run_interval) == runs);
+
+  /* Queue depths 1, 2, 3, 4 and 5. */
+  process_histogram_snprint(buf, sizeof(buf), &h->queue_depth);
+  printf("Queue depth: %s\n", buf);
+  UNIT_TEST_ASSERT(strcmp(buf, "1:1 2-3:2 4-7:2") == 0);
+  UNIT_TEST_ASSERT(h->queue_depth.max == EVENTS);
+
+  /* A poll that waits. */
+  process_poll(&sink_process);
+  busy_wait(WAIT_MSEC);
+  while(process_run() > 0);
+  UNIT_TEST_ASSERT(received == EVENTS + 1);
+  UNIT_TEST_ASSERT(samples(&h->poll_latency) == 1);
+  UNIT_TEST_ASSERT(h->poll_latency.max >= wait);
+
+  process_histogram_snprint(buf, sizeof(buf), &h->event_latency);
+  printf("Event latency: %s (max %u)\n", buf, (unsigned)h->event_latency.max);
+
+  process_histograms_reset();
+  UNIT_TEST_ASSERT(samples(&h->event_latency) == 0);
+  UNIT_TEST_ASSERT(h->queue_depth.max == 0);
+  process_histogram_snprint(buf, sizeof(buf), &h->event_latency);
+  UNIT_TEST_ASSERT(buf[0] == '\0');
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_process_histograms_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  process_start(&sink_process, NULL);
+
+  UNIT_TEST_RUN(histograms);
+
+  if(!UNIT_TEST_PASSED(histograms)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Tests for the epoll-based native main loop: callbacks beyond
+ *      SELECT_MAX file descriptors, registered descriptors beyond
+ *      FD_SETSIZE, and etimer wake-up latency.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "contiki.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* More pipes than the select backend supports by default. */
+#define PIPES         20
+#define TIMER_ROUNDS  20
+#define TIMER_MSEC    5
+/*
+ * Without the timerfd, an idle main loop may sleep for up to
+ * SELECT_TIMEOUT (one second) past the expiration.
+ */
+#define MAX_LATENESS_MSEC 100
+/*****************************************************************************/
+PROCESS(test_native_epoll_process, "Native epoll test process");
+AUTOSTART_PROCESSES(&test_native_epoll_process);
+
+static int pipes[PIPES][2];
+static unsigned reads;
+static unsigned handled[PIPES];
+static clock_time_t max_lateness;
+/* Duplicates of the read ends, numbered from FD_SETSIZE up */
+static int high_fds[PIPES];
+static unsigned high_handled[PIPES];
+static bool high_rejected;
+static unsigned paused_reads;
+/*****************************************************************************/
+static int
+pipe_set_fd(fd_set *rset, fd_set *wset)
+{
+  for(int i = 0; i < PIPES; i++) {
+    FD_SET(pipes[i][0], rset);
+  }
+  return 1;
+}
+/*****************************************************************************/
+static void
+pipe_handle_fd(fd_set *rset, fd_set *wset)
+{
+  char c;
+
+  for(int i = 0; i < PIPES; i++) {
+    if(FD_ISSET(pipes[i][0], rset) && read(pipes[i][0], &c, 1) == 1) {
+      handled[i]++;
+      reads++;
+    }
+  }
+  process_poll(&test_native_epoll_process);
+}
+/*****************************************************************************/
+static const struct select_callback pipe_callback = {
+  pipe_set_fd, pipe_handle_fd
+};
+/*****************************************************************************/
+static void
+high_handle_fd(int fd, unsigned events, void *ptr)
+{
+  unsigned *handled = ptr;
+  char c;
+
+  if((events & SELECT_FD_READ) && read(fd, &c, 1) == 1) {
+    (*handled)++;
+  }
+  process_poll(&test_native_epoll_process);
+}
+/*****************************************************************************/
+static unsigned
+high_reads(void)
+{
+  unsigned count = 0;
+
+  for(int i = 0; i < PIPES; i++) {
+    count += high_handled[i];
+  }
+  return count;
+}
+/*****************************************************************************/
+static unsigned
+handled_pipes(void)
+{
+  unsigned count = 0;
+
+  for(int i = 0; i < PIPES; i++) {
+    count += handled[i] > 0;
+  }
+  return count;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(callbacks, "Callbacks beyond SELECT_MAX");
+UNIT_TEST(callbacks)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(pipes[PIPES - 1][0] >= 8);
+  /* Every pipe was handled once, and the unregistered ones not again. */
+  UNIT_TEST_ASSERT(reads == PIPES);
+  UNIT_TEST_ASSERT(handled_pipes() == PIPES);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(registered, "Registered descriptors beyond FD_SETSIZE");
+UNIT_TEST(registered)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("Reads from registered descriptors: %u (%u while half were paused)\n",
+         high_reads(), paused_reads);
+  UNIT_TEST_ASSERT(high_fds[0] >= FD_SETSIZE);
+  UNIT_TEST_ASSERT(high_rejected);
+  /* One pending byte each, another one each after half of them were
+     paused and resumed, and none after they were unregistered. */
+  UNIT_TEST_ASSERT(paused_reads == PIPES + PIPES / 2);
+  UNIT_TEST_ASSERT(high_reads() == 2 * PIPES);
+  for(int i = 0; i < PIPES; i++) {
+    UNIT_TEST_ASSERT(high_handled[i] == 2);
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(timer_latency, "Etimer wake-up latency");
+UNIT_TEST(timer_latency)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("Max etimer lateness: %lu ms\n", (unsigned long)max_lateness);
+  UNIT_TEST_ASSERT(max_lateness < MAX_LATENESS_MSEC * CLOCK_SECOND / 1000);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_native_epoll_process, ev, data)
+{
+  static struct etimer et;
+  static int i;
+  clock_time_t lateness;
+  struct rlimit limit;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  for(i = 0; i < PIPES; i++) {
+    if(pipe(pipes[i]) < 0 ||
+       !select_set_callback(pipes[i][0], &pipe_callback)) {
+      printf("=check-me= FAILED\n");
+      PROCESS_EXIT();
+    }
+  }
+
+  /* Wake up on the readiness of every pipe. */
+  etimer_set(&et, CLOCK_SECOND * 5);
+  for(i = 0; i < PIPES; i++) {
+    if(write(pipes[i][1], "x", 1) != 1) {
+      break;
+    }
+  }
+  while(reads < PIPES && !etimer_expired(&et)) {
+    PROCESS_WAIT_EVENT();
+  }
+
+  /* Unregistered descriptors are no longer monitored. */
+  for(i = 0; i < PIPES; i++) {
+    select_set_callback(pipes[i][0], NULL);
+    if(write(pipes[i][1], "y", 1) != 1) {
+      break;
+    }
+  }
+  etimer_set(&et, CLOCK_SECOND / 10);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  UNIT_TEST_RUN(callbacks);
+
+  /* Register duplicates of the read ends, which still have the second
+     byte pending, above the descriptors that fit in an fd_set. */
+  if(getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+     limit.rlim_cur < FD_SETSIZE + PIPES &&
+     limit.rlim_max >= FD_SETSIZE + PIPES) {
+    limit.rlim_cur = FD_SETSIZE + PIPES;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+  high_rejected = true;
+  for(i = 0; i < PIPES; i++) {
+    high_fds[i] = fcntl(pipes[i][0], F_DUPFD, FD_SETSIZE);
+    if(high_fds[i] < 0 ||
+       !select_register_fd(high_fds[i], SELECT_FD_READ, high_handle_fd,
+                           &high_handled[i])) {
+      printf("=check-me= FAILED\n");
+      PROCESS_EXIT();
+    }
+    if(select_set_callback(high_fds[i], &pipe_callback)) {
+      high_rejected = false;
+    }
+  }
+  etimer_set(&et, CLOCK_SECOND * 5);
+  while(high_reads() < PIPES && !etimer_expired(&et)) {
+    PROCESS_WAIT_EVENT();
+  }
+
+  /* Descriptors without events are not handled until they get them back. */
+  for(i = 0; i < PIPES; i += 2) {
+    select_modify_fd(high_fds[i], 0);
+  }
+  for(i = 0; i < PIPES; i++) {
+    if(write(pipes[i][1], "z", 1) != 1) {
+      break;
+    }
+  }
+  etimer_set(&et, CLOCK_SECOND / 10);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  paused_reads = high_reads();
+  for(i = 0; i < PIPES; i += 2) {
+    select_modify_fd(high_fds[i], SELECT_FD_READ);
+  }
+  etimer_set(&et, CLOCK_SECOND * 5);
+  while(high_reads() < 2 * PIPES && !etimer_expired(&et)) {
+    PROCESS_WAIT_EVENT();
+  }
+
+  /* Unregistered descriptors are no longer monitored. */
+  for(i = 0; i < PIPES; i++) {
+    select_unregister_fd(high_fds[i]);
+    if(write(pipes[i][1], "w", 1) != 1) {
+      break;
+    }
+  }
+  etimer_set(&et, CLOCK_SECOND / 10);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+
+  UNIT_TEST_RUN(registered);
+
+  /* Idle waits for etimers that expire in a few milliseconds. */
+  for(i = 0; i < TIMER_ROUNDS; i++) {
+    etimer_set(&et, TIMER_MSEC * CLOCK_SECOND / 1000);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+    lateness = clock_time() - etimer_expiration_time(&et);
+    if(lateness > max_lateness) {
+      max_lateness = lateness;
+    }
+  }
+
+  UNIT_TEST_RUN(timer_latency);
+
+  if(!UNIT_TEST_PASSED(callbacks) || !UNIT_TEST_PASSED(registered) ||
+     !UNIT_TEST_PASSED(timer_latency)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
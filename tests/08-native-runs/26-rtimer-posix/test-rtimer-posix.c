@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests for the POSIX timer rtimer backend of the native
+ *      platform: clock resolution, sub-millisecond periodic tasks and
+ *      the timer signal lateness statistics.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* A period well below the resolution of the system clock. */
+#define TEST_PERIOD     (RTIMER_SECOND / 4000)
+#define TEST_DISPATCHES 200
+/*****************************************************************************/
+PROCESS(test_rtimer_posix_process, "Rtimer POSIX test process");
+AUTOSTART_PROCESSES(&test_rtimer_posix_process);
+
+static struct rtimer task;
+static volatile unsigned dispatches;
+static unsigned early_dispatches;
+static rtimer_clock_t first_deadline;
+static rtimer_clock_t last_dispatch;
+/*****************************************************************************/
+static void
+task_callback(struct rtimer *t, void *ptr)
+{
+  last_dispatch = RTIMER_NOW();
+  if(RTIMER_CLOCK_LT(last_dispatch, t->time)) {
+    early_dispatches++;
+  }
+  if(++dispatches < TEST_DISPATCHES) {
+    rtimer_set(t, t->time + TEST_PERIOD, 0, task_callback, NULL);
+  }
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(resolution, "Clock resolution");
+UNIT_TEST(resolution)
+{
+  struct timespec start, end;
+  rtimer_clock_t now, next;
+
+  UNIT_TEST_BEGIN();
+
+  /* The clock advances within a millisecond. */
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  now = RTIMER_NOW();
+  do {
+    next = RTIMER_NOW();
+  } while(next == now);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  printf("Tick: %lu ns\n", (unsigned long)
+         ((end.tv_sec - start.tv_sec) * 1000000000L +
+          end.tv_nsec - start.tv_nsec));
+  UNIT_TEST_ASSERT(RTIMER_CLOCK_DIFF(next, now) > 0);
+  UNIT_TEST_ASSERT(RTIMER_CLOCK_DIFF(next, now) < RTIMER_SECOND / 1000);
+  UNIT_TEST_ASSERT((end.tv_sec - start.tv_sec) * 1000000000L +
+                   end.tv_nsec - start.tv_nsec < 1000000);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(periodic, "Sub-millisecond periodic task");
+UNIT_TEST(periodic)
+{
+  rtimer_stats_t stats;
+  rtimer_arch_stats_t arch_stats;
+
+  UNIT_TEST_BEGIN();
+
+  rtimer_stats(&stats);
+  rtimer_arch_stats(&arch_stats);
+
+  printf("Dispatches: %u\n", dispatches);
+  printf("Max dispatch lateness: %lu ticks\n",
+         (unsigned long)stats.max_lateness);
+  printf("Timer signals: %lu\n", (unsigned long)arch_stats.interrupts);
+  printf("Mean signal lateness: %lu ns\n", arch_stats.interrupts == 0 ? 0 :
+         (unsigned long)(arch_stats.total_ns / arch_stats.interrupts));
+  printf("Max signal lateness: %lu ns\n", (unsigned long)arch_stats.max_ns);
+
+  UNIT_TEST_ASSERT(dispatches == TEST_DISPATCHES);
+  UNIT_TEST_ASSERT(early_dispatches == 0);
+  UNIT_TEST_ASSERT(stats.dispatched == TEST_DISPATCHES);
+  /* Late signals may dispatch several tasks at once. */
+  UNIT_TEST_ASSERT(arch_stats.interrupts > 0);
+  UNIT_TEST_ASSERT(arch_stats.interrupts <= TEST_DISPATCHES);
+  UNIT_TEST_ASSERT(arch_stats.total_ns >= arch_stats.max_ns);
+  /* The tasks cannot complete before their deadlines. */
+  UNIT_TEST_ASSERT(RTIMER_CLOCK_DIFF(last_dispatch, first_deadline) >=
+                   (TEST_DISPATCHES - 1) * TEST_PERIOD);
+
+  rtimer_arch_stats_reset();
+  rtimer_arch_stats(&arch_stats);
+  UNIT_TEST_ASSERT(arch_stats.interrupts == 0);
+  UNIT_TEST_ASSERT(arch_stats.max_ns == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_rtimer_posix_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned waited;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(resolution);
+
+  rtimer_stats_reset();
+  rtimer_arch_stats_reset();
+  first_deadline = RTIMER_NOW() + RTIMER_SECOND / 100;
+  rtimer_set(&task, first_deadline, 0, task_callback, NULL);
+
+  for(waited = 0; dispatches < TEST_DISPATCHES && waited < 100; waited++) {
+    etimer_set(&et, CLOCK_SECOND / 10);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+
+  UNIT_TEST_RUN(periodic);
+
+  if(!UNIT_TEST_PASSED(resolution) || !UNIT_TEST_PASSED(periodic)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
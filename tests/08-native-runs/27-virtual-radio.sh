@@ -0,0 +1,47 @@
+#!/bin/bash
+
+source ../utils.sh
+
+BASENAME=27-virtual-radio
+NODES=3
+MEDIUM=$(mktemp -d)
+
+cd $BASENAME
+test_init
+
+echo "-- Starting test $BASENAME"
+
+# A line of nodes 10 m apart, in which only neighbors hear each other.
+# The RSSI of each link is -30 - 30 * log10(10) = -60 dBm.
+../../../tools/native-radio/launch.py --nodes $NODES --topology line \
+  --spacing 10 --range 15 --rssi-1m -30 --path-loss-exponent 3 \
+  --dir $MEDIUM --log-dir . --duration 10 \
+  --env TEST_NODES=$NODES --env TEST_RSSI=-60 \
+  ./build/native/test-virtual-radio.native
+rm -rf $MEDIUM
+
+for ID in $(seq $NODES); do
+  RUNLOG=node-$ID.log
+  register_logfile $RUNLOG
+  assert "run node $ID" "grep -q '=check-me= DONE' $RUNLOG"
+  assert "check node $ID" "! grep -q '=check-me= FAILED' $RUNLOG"
+done
+
+# Links with different delays: node 2 must get the frame of node 3,
+# sent 100 ms after the one of node 1, first.
+MEDIUM=$(mktemp -d)
+mkdir -p order
+../../../tools/native-radio/launch.py --topology-file delays.topology \
+  --dir $MEDIUM --log-dir order --duration 4 \
+  --env TEST_START_MS=$(($(date +%s%3N) + 1500)) \
+  ./build/native/test-virtual-radio.native
+rm -rf $MEDIUM
+
+for ID in $(seq $NODES); do
+  RUNLOG=order/node-$ID.log
+  register_logfile $RUNLOG
+  assert "run order node $ID" "grep -q '=check-me= DONE' $RUNLOG"
+  assert "check order node $ID" "! grep -q '=check-me= FAILED' $RUNLOG"
+done
+
+do_wrap_up
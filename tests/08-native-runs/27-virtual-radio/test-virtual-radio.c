@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Test of the virtual radio medium, run on each node of a line
+ *      topology started by tools/native-radio/launch.py: only the
+ *      neighbors are heard, with the RSSI of the link model, and
+ *      unicast frames are acknowledged only by existing neighbors.
+ *
+ *      With TEST_START_MS set, the nodes instead check that frames are
+ *      delivered in the order of their delivery time: node 1 sends at
+ *      that wall-clock time over a slow link, and node 3 sends later
+ *      over a fast link, so that node 2 receives node 3's frame first.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/mac/mac.h"
+#include "net/nullnet/nullnet.h"
+#include "sys/node-id.h"
+#include "dev/virtual-radio.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+#define MAX_NODES     16
+#define SEND_INTERVAL (CLOCK_SECOND / 5)
+#define TEST_DURATION (CLOCK_SECOND * 3)
+/* When node 3 sends after node 1, and when node 2 checks the order */
+#define ORDER_SEND_MS  100
+#define ORDER_CHECK_MS 1000
+/*****************************************************************************/
+PROCESS(test_virtual_radio_process, "Virtual radio test process");
+AUTOSTART_PROCESSES(&test_virtual_radio_process);
+
+static unsigned nodes;
+static int expected_rssi;
+static unsigned heard[MAX_NODES + 2];
+static unsigned unexpected_rssi;
+static unsigned unicast_received;
+static unsigned acked;
+static unsigned not_acked;
+static uint64_t order_start;
+static uint16_t order[4];
+static unsigned order_count;
+/*****************************************************************************/
+static uint16_t
+addr_to_id(const linkaddr_t *addr)
+{
+  return (addr->u8[LINKADDR_SIZE - 2] << 8) | addr->u8[LINKADDR_SIZE - 1];
+}
+/*****************************************************************************/
+static void
+input_callback(const void *data, uint16_t len,
+               const linkaddr_t *src, const linkaddr_t *dest)
+{
+  uint16_t id = addr_to_id(src);
+
+  if(order_start != 0) {
+    if(order_count < sizeof(order) / sizeof(order[0])) {
+      order[order_count] = id;
+    }
+    order_count++;
+    return;
+  }
+
+  if(id < MAX_NODES + 2) {
+    heard[id]++;
+  }
+  if((int16_t)packetbuf_attr(PACKETBUF_ATTR_RSSI) != expected_rssi) {
+    unexpected_rssi++;
+  }
+  if(!linkaddr_cmp(dest, &linkaddr_null)) {
+    unicast_received++;
+  }
+}
+/*****************************************************************************/
+static void
+sent_callback(void *ptr, int status, int transmissions)
+{
+  if(ptr == NULL) {
+    /* A broadcast. */
+    return;
+  }
+  if(status == MAC_TX_OK) {
+    acked++;
+  } else {
+    not_acked++;
+  }
+}
+/*****************************************************************************/
+static void
+send(uint16_t dest_id)
+{
+  linkaddr_t dest;
+
+  packetbuf_clear();
+  packetbuf_copyfrom(&node_id, sizeof(node_id));
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
+  if(dest_id == 0) {
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &linkaddr_null);
+    NETSTACK_MAC.send(sent_callback, NULL);
+  } else {
+    linkaddr_copy(&dest, &linkaddr_node_addr);
+    dest.u8[LINKADDR_SIZE - 2] = dest_id >> 8;
+    dest.u8[LINKADDR_SIZE - 1] = dest_id & 0xff;
+    packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
+    NETSTACK_MAC.send(sent_callback, &dest);
+  }
+}
+/*****************************************************************************/
+/* Wall-clock time in milliseconds, on which all the nodes agree */
+static uint64_t
+wall_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+/*****************************************************************************/
+static void
+set_wall_timer(struct etimer *et, uint64_t at_ms)
+{
+  uint64_t now = wall_ms();
+
+  etimer_set(et, at_ms > now ? (at_ms - now) * CLOCK_SECOND / 1000 : 0);
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(neighbors, "Neighbors");
+UNIT_TEST(neighbors)
+{
+  UNIT_TEST_BEGIN();
+
+  for(unsigned id = 0; id < MAX_NODES + 2; id++) {
+    if(heard[id] > 0) {
+      printf("Heard node %u: %u frames\n", id, heard[id]);
+    }
+    if(id == node_id - 1 || id == node_id + 1) {
+      UNIT_TEST_ASSERT((heard[id] > 0) == (id >= 1 && id <= nodes));
+    } else {
+      UNIT_TEST_ASSERT(heard[id] == 0);
+    }
+  }
+  UNIT_TEST_ASSERT(unexpected_rssi == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(acks, "Acknowledgements");
+UNIT_TEST(acks)
+{
+  const struct virtual_radio_stats *stats = virtual_radio_get_stats();
+
+  UNIT_TEST_BEGIN();
+
+  printf("Acked: %u, not acked: %u, unicast received: %u\n",
+         acked, not_acked, unicast_received);
+  printf("Radio tx %lu, lost %lu, rx %lu, dropped %lu\n",
+         (unsigned long)stats->tx, (unsigned long)stats->tx_lost,
+         (unsigned long)stats->rx, (unsigned long)stats->rx_dropped);
+
+  /* Each node sends unicast frames to the next node in the line. */
+  if(node_id < nodes) {
+    UNIT_TEST_ASSERT(acked > 0);
+    UNIT_TEST_ASSERT(not_acked == 0);
+  } else {
+    UNIT_TEST_ASSERT(acked == 0);
+    UNIT_TEST_ASSERT(not_acked > 0);
+  }
+  UNIT_TEST_ASSERT((unicast_received > 0) == (node_id > 1));
+  UNIT_TEST_ASSERT(stats->tx_lost == 0);
+  UNIT_TEST_ASSERT(stats->rx > 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(delivery_order, "Delivery order over links with delays");
+UNIT_TEST(delivery_order)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("Received %u frames:", order_count);
+  for(unsigned i = 0;
+      i < order_count && i < sizeof(order) / sizeof(order[0]); i++) {
+    printf(" from %u", order[i]);
+  }
+  printf("\n");
+
+  if(node_id == 2) {
+    UNIT_TEST_ASSERT(order_count == 2);
+    UNIT_TEST_ASSERT(order[0] == 3 && order[1] == 1);
+  } else {
+    UNIT_TEST_ASSERT(order_count == 0);
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_virtual_radio_process, ev, data)
+{
+  static struct etimer send_timer;
+  static struct etimer test_timer;
+
+  PROCESS_BEGIN();
+
+  nodes = atoi(getenv("TEST_NODES") ? : "0");
+  expected_rssi = atoi(getenv("TEST_RSSI") ? : "0");
+  order_start = strtoull(getenv("TEST_START_MS") ? : "0", NULL, 10);
+  nullnet_set_input_callback(input_callback);
+
+  printf("Run unit-test\n");
+  printf("Node %u of %u\n", node_id, nodes);
+  printf("---\n");
+
+  if(order_start != 0) {
+    if(node_id == 1 || node_id == 3) {
+      set_wall_timer(&send_timer,
+                     order_start + (node_id == 3 ? ORDER_SEND_MS : 0));
+      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&send_timer));
+      send(0);
+    }
+    set_wall_timer(&test_timer, order_start + ORDER_CHECK_MS);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&test_timer));
+
+    UNIT_TEST_RUN(delivery_order);
+    if(!UNIT_TEST_PASSED(delivery_order)) {
+      printf("=check-me= FAILED\n");
+      printf("---\n");
+    }
+    printf("=check-me= DONE\n");
+    printf("---\n");
+    PROCESS_EXIT();
+  }
+
+  /* Let all nodes start. */
+  etimer_set(&send_timer, CLOCK_SECOND / 2);
+  PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&send_timer));
+
+  etimer_set(&test_timer, TEST_DURATION);
+  etimer_set(&send_timer, SEND_INTERVAL);
+  while(!etimer_expired(&test_timer)) {
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&send_timer) ||
+                             etimer_expired(&test_timer));
+    if(etimer_expired(&send_timer)) {
+      send(0);
+      send(node_id + 1);
+      etimer_reset(&send_timer);
+    }
+  }
+
+  UNIT_TEST_RUN(neighbors);
+  UNIT_TEST_RUN(acks);
+
+  if(!UNIT_TEST_PASSED(neighbors) || !UNIT_TEST_PASSED(acks)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
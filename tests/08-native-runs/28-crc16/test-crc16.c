@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests for the CRC16 variants and lookup tables, checked
+ *      against bit-by-bit reference implementations.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "lib/crc16.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+#define TEST_MAX_LEN 300
+#define TEST_ROUNDS 2000
+#define TEST_BENCH_LEN 1024
+#define TEST_BENCH_ROUNDS 2000
+/*****************************************************************************/
+PROCESS(test_crc16_process, "CRC16 test process");
+AUTOSTART_PROCESSES(&test_crc16_process);
+
+static unsigned char data[TEST_BENCH_LEN];
+/*****************************************************************************/
+static unsigned short
+reference_crc16(const unsigned char *p, int len, unsigned short acc)
+{
+  for(int i = 0; i < len; i++) {
+    for(int bit = 0; bit < 8; bit++) {
+      unsigned in = (p[i] >> bit) & 1;
+      unsigned feedback = (acc & 1) ^ in;
+      acc = (acc >> 1) ^ (feedback ? 0x8408 : 0);
+    }
+  }
+  return acc;
+}
+/*****************************************************************************/
+static unsigned short
+reference_crc16_ccitt(const unsigned char *p, int len, unsigned short acc)
+{
+  for(int i = 0; i < len; i++) {
+    for(int bit = 0; bit < 8; bit++) {
+      unsigned in = (p[i] >> (7 - bit)) & 1;
+      unsigned feedback = (acc >> 15) ^ in;
+      acc = (unsigned short)(acc << 1) ^ (feedback ? 0x1021 : 0);
+    }
+  }
+  return acc;
+}
+/*****************************************************************************/
+/* The functions of a CRC variant, and the reference they are checked
+   against. */
+static const struct variant {
+  const char *name;
+  unsigned short (*add)(unsigned char b, unsigned short acc);
+  unsigned short (*data)(const unsigned char *data, int len,
+                         unsigned short acc);
+  unsigned short (*reference)(const unsigned char *p, int len,
+                              unsigned short acc);
+} variants[] = {
+  { "IEEE 802.15.4", crc16_add, crc16_data, reference_crc16 },
+  { "CCITT", crc16_ccitt_add, crc16_ccitt_data, reference_crc16_ccitt },
+};
+#define NUM_VARIANTS (sizeof(variants) / sizeof(variants[0]))
+/*****************************************************************************/
+static uint64_t
+nsec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(check_value, "Check value");
+UNIT_TEST(check_value)
+{
+  static const unsigned char check[] = "123456789";
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(crc16_data(check, 9, 0) == 0x2189);
+  UNIT_TEST_ASSERT(crc16_ccitt_data(check, 9, 0) == 0x31c3);
+  UNIT_TEST_ASSERT(crc16_ccitt_data(check, 9, 0xffff) == 0x29b1);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(random_data, "Random data");
+UNIT_TEST(random_data)
+{
+  unsigned mismatches = 0;
+
+  UNIT_TEST_BEGIN();
+
+  for(unsigned round = 0; round < TEST_ROUNDS; round++) {
+    int len = rand() % (TEST_MAX_LEN + 1);
+    int split = len ? rand() % len : 0;
+    unsigned short init = rand();
+
+    for(int i = 0; i < len; i++) {
+      data[i] = rand();
+    }
+
+    for(unsigned v = 0; v < NUM_VARIANTS; v++) {
+      const struct variant *var = &variants[v];
+      unsigned short expected = var->reference(data, len, init);
+      unsigned short acc;
+
+      /* All at once, in two parts, and byte by byte. */
+      mismatches += var->data(data, len, init) != expected;
+      acc = var->data(data, split, init);
+      mismatches += var->data(data + split, len - split, acc) != expected;
+      acc = init;
+      for(int i = 0; i < len; i++) {
+        acc = var->add(data[i], acc);
+      }
+      mismatches += acc != expected;
+    }
+  }
+  UNIT_TEST_ASSERT(mismatches == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(throughput, "Throughput");
+UNIT_TEST(throughput)
+{
+  volatile unsigned short sink = 0;
+  uint64_t start, table_nsec, reference_nsec;
+
+  UNIT_TEST_BEGIN();
+
+  for(unsigned v = 0; v < NUM_VARIANTS; v++) {
+    const struct variant *var = &variants[v];
+
+    start = nsec_now();
+    for(unsigned i = 0; i < TEST_BENCH_ROUNDS; i++) {
+      sink ^= var->data(data, TEST_BENCH_LEN, i);
+    }
+    table_nsec = nsec_now() - start;
+
+    start = nsec_now();
+    for(unsigned i = 0; i < TEST_BENCH_ROUNDS; i++) {
+      sink ^= var->reference(data, TEST_BENCH_LEN, i);
+    }
+    reference_nsec = nsec_now() - start;
+
+    printf("CRC16 %s table %u: %lu MB/s, bit by bit: %lu MB/s\n",
+           var->name, CRC16_TABLE,
+           (unsigned long)((uint64_t)TEST_BENCH_ROUNDS * TEST_BENCH_LEN * 1000
+                           / table_nsec),
+           (unsigned long)((uint64_t)TEST_BENCH_ROUNDS * TEST_BENCH_LEN * 1000
+                           / reference_nsec));
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_crc16_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(check_value);
+  UNIT_TEST_RUN(random_data);
+  UNIT_TEST_RUN(throughput);
+
+  if(!UNIT_TEST_PASSED(check_value) ||
+     !UNIT_TEST_PASSED(random_data) ||
+     !UNIT_TEST_PASSED(throughput)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*****************************************************************************/
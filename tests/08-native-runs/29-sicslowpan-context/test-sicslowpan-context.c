@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * \file
+ *      Unit tests for the IPHC address contexts: compression with all 16
+ *      contexts, their hit counters, and their updates from the 6CO options
+ *      of Router Advertisements.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "net/ipv6/uip-nd6.h"
+#include "net/ipv6/sicslowpan.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+#define TEST_CONTEXTS 16
+#define TEST_PAYLOAD 16
+#define TEST_DATAGRAMS 100000
+/*****************************************************************************/
+PROCESS(test_sicslowpan_context_process, "6LoWPAN context test process");
+AUTOSTART_PROCESSES(&test_sicslowpan_context_process);
+
+static uint8_t frame[PACKETBUF_SIZE];
+static uint16_t frame_len;
+static uint8_t datagram[UIP_BUFSIZE];
+static uint16_t datagram_len;
+static unsigned received;
+static const linkaddr_t dest = { { 0x02, 0x12, 0x74, 0x01, 0, 0x01, 0x01, 0x01 } };
+/*****************************************************************************/
+static void
+mac_init(void)
+{
+}
+/*****************************************************************************/
+static void
+mac_send(mac_callback_t sent, void *ptr)
+{
+  memcpy(frame, packetbuf_hdrptr(), packetbuf_totlen());
+  frame_len = packetbuf_totlen();
+  mac_call_sent_callback(sent, ptr, MAC_TX_OK, 1);
+}
+/*****************************************************************************/
+static void
+mac_input(void)
+{
+}
+/*****************************************************************************/
+static int
+mac_on(void)
+{
+  return 1;
+}
+/*****************************************************************************/
+static int
+mac_off(void)
+{
+  return 1;
+}
+/*****************************************************************************/
+static int
+mac_max_payload(void)
+{
+  return PACKETBUF_SIZE;
+}
+/*****************************************************************************/
+const struct mac_driver test_mac_driver = {
+  "test-mac",
+  mac_init,
+  mac_send,
+  mac_input,
+  mac_on,
+  mac_off,
+  mac_max_payload,
+};
+/*****************************************************************************/
+static void
+sniffer_input(void)
+{
+  if(uip_len == datagram_len && memcmp(uip_buf, datagram, uip_len) == 0) {
+    received++;
+  }
+}
+/*****************************************************************************/
+static void
+sniffer_output(int mac_status)
+{
+}
+/*****************************************************************************/
+NETSTACK_SNIFFER(sniffer, sniffer_input, sniffer_output);
+/*****************************************************************************/
+static void
+make_prefix(uip_ipaddr_t *prefix, uint16_t n)
+{
+  uip_ip6addr(prefix, 0x2001, 0xdb8, n, 0, 0, 0, 0, 0);
+}
+/*****************************************************************************/
+/* Makes a UDP datagram from this node on one prefix to a host on another */
+static void
+make_datagram(uint16_t src_prefix, uint16_t dest_prefix)
+{
+  struct uip_udp_hdr *udp;
+
+  memset(uip_buf, 0, UIP_IPUDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  make_prefix(&UIP_IP_BUF->srcipaddr, src_prefix);
+  uip_ds6_set_addr_iid(&UIP_IP_BUF->srcipaddr, &uip_lladdr);
+  make_prefix(&UIP_IP_BUF->destipaddr, dest_prefix);
+  UIP_IP_BUF->destipaddr.u16[7] = UIP_HTONS(0x1234);
+  uipbuf_set_len_field(UIP_IP_BUF, UIP_UDPH_LEN + TEST_PAYLOAD);
+
+  udp = (struct uip_udp_hdr *)UIP_IP_PAYLOAD(0);
+  udp->srcport = UIP_HTONS(5683);
+  udp->destport = UIP_HTONS(61616);
+  udp->udplen = UIP_HTONS(UIP_UDPH_LEN + TEST_PAYLOAD);
+  udp->udpchksum = UIP_HTONS(0xbeef);
+
+  for(uint16_t i = 0; i < TEST_PAYLOAD; i++) {
+    uip_buf[UIP_IPUDPH_LEN + i] = rand();
+  }
+  uip_len = UIP_IPUDPH_LEN + TEST_PAYLOAD;
+
+  datagram_len = uip_len;
+  memcpy(datagram, uip_buf, uip_len);
+}
+/*****************************************************************************/
+/* Compresses the datagram, and returns the length of the frame */
+static uint16_t
+send_datagram(void)
+{
+  memcpy(uip_buf, datagram, datagram_len);
+  uip_len = datagram_len;
+  uipbuf_clear_attr();
+  frame_len = 0;
+  NETSTACK_NETWORK.output(&dest);
+  return frame_len;
+}
+/*****************************************************************************/
+static void
+receive_frame(void)
+{
+  packetbuf_copyfrom(frame, frame_len);
+  packetbuf_set_addr(PACKETBUF_ADDR_SENDER, &linkaddr_node_addr);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
+  NETSTACK_NETWORK.input();
+}
+/*****************************************************************************/
+/* Processes a Router Advertisement with one 6CO option */
+static void
+input_ra(uint8_t cid, bool compress, uint16_t lifetime,
+         const uip_ipaddr_t *prefix, uint8_t context_len)
+{
+  uip_nd6_opt_6co *opt;
+
+  uip_len = UIP_IPH_LEN + UIP_ICMPH_LEN + UIP_ND6_RA_LEN + 24;
+  memset(uip_buf, 0, uip_len);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_ICMP6;
+  UIP_IP_BUF->ttl = UIP_ND6_HOP_LIMIT;
+  uip_ip6addr(&UIP_IP_BUF->srcipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 1);
+  uip_create_linklocal_allnodes_mcast(&UIP_IP_BUF->destipaddr);
+  uipbuf_set_len_field(UIP_IP_BUF, uip_len - UIP_IPH_LEN);
+  UIP_ICMP_BUF->type = ICMP6_RA;
+
+  opt = (uip_nd6_opt_6co *)(UIP_ICMP_PAYLOAD + UIP_ND6_RA_LEN);
+  opt->type = UIP_ND6_OPT_6CO;
+  opt->len = 3;
+  opt->context_len = context_len;
+  opt->flags_cid = cid | (compress ? UIP_ND6_6CO_FLAG_C : 0);
+  opt->lifetime = UIP_HTONS(lifetime);
+  memcpy(opt->prefix, prefix, sizeof(opt->prefix));
+
+  UIP_ICMP_BUF->icmpchksum = 0;
+  UIP_ICMP_BUF->icmpchksum = ~uip_icmp6chksum();
+  tcpip_input();
+}
+/*****************************************************************************/
+static uint64_t
+nsec_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(contexts, "Compression with 16 contexts");
+UNIT_TEST(contexts)
+{
+  uip_ipaddr_t prefix;
+  uint16_t with_contexts;
+  uint16_t without_contexts;
+  unsigned failures = 0;
+
+  UNIT_TEST_BEGIN();
+
+  for(unsigned i = 0; i < TEST_CONTEXTS; i++) {
+    make_prefix(&prefix, i);
+    UNIT_TEST_ASSERT(sicslowpan_addr_context_set(i, &prefix, 64, true, 0));
+  }
+  UNIT_TEST_ASSERT(!sicslowpan_addr_context_set(TEST_CONTEXTS, &prefix, 64, true, 0));
+  sicslowpan_addr_context_stats_reset();
+
+  /* Every context is used once for a source and once for a destination,
+     in both directions. */
+  received = 0;
+  with_contexts = 0;
+  for(unsigned i = 0; i < TEST_CONTEXTS; i++) {
+    make_datagram(i, TEST_CONTEXTS - 1 - i);
+    with_contexts = send_datagram();
+    receive_frame();
+  }
+  for(unsigned i = 0; i < TEST_CONTEXTS; i++) {
+    const struct sicslowpan_addr_context *context = sicslowpan_addr_context_get(i);
+    failures += context == NULL || context->compressed != 2 ||
+      context->decompressed != 2;
+  }
+  UNIT_TEST_ASSERT(failures == 0);
+  UNIT_TEST_ASSERT(received == TEST_CONTEXTS);
+
+  /* Without contexts, both prefixes and the source IID are inline, and
+     the context identifier byte is not. */
+  for(unsigned i = 0; i < TEST_CONTEXTS; i++) {
+    sicslowpan_addr_context_rm(i);
+    UNIT_TEST_ASSERT(sicslowpan_addr_context_get(i) == NULL);
+  }
+  without_contexts = send_datagram();
+  receive_frame();
+  printf("frame length with contexts %u, without %u\n",
+         with_contexts, without_contexts);
+  UNIT_TEST_ASSERT(without_contexts == with_contexts + 8 + 16 - 1);
+  UNIT_TEST_ASSERT(received == TEST_CONTEXTS + 1);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(ra_6co, "Context updates from 6CO options");
+UNIT_TEST(ra_6co)
+{
+  const struct sicslowpan_addr_context *context;
+  uip_ipaddr_t prefix;
+  unsigned long start;
+
+  UNIT_TEST_BEGIN();
+
+  /* A new context is used for compression */
+  make_prefix(&prefix, 0xaaaa);
+  input_ra(5, true, 10, &prefix, 64);
+  context = sicslowpan_addr_context_get(5);
+  UNIT_TEST_ASSERT(context != NULL && !context->decompress_only);
+  UNIT_TEST_ASSERT(context->expiration >= clock_seconds() + 9 * 60);
+  make_datagram(0xaaaa, 1);
+  send_datagram();
+  UNIT_TEST_ASSERT(context->compressed == 1);
+
+  /* Without the C flag, it is only used for decompression */
+  input_ra(5, false, 10, &prefix, 64);
+  context = sicslowpan_addr_context_get(5);
+  UNIT_TEST_ASSERT(context != NULL && context->decompress_only);
+  received = 0;
+  receive_frame();
+  UNIT_TEST_ASSERT(received == 1 && context->decompressed == 1);
+  send_datagram();
+  UNIT_TEST_ASSERT(context->compressed == 0);
+
+  /* A zero lifetime removes it */
+  input_ra(5, true, 0, &prefix, 64);
+  UNIT_TEST_ASSERT(sicslowpan_addr_context_get(5) == NULL);
+
+  /* The bits beyond a short context are zeroes */
+  prefix.u16[3] = UIP_HTONS(0xbbbb);
+  input_ra(6, true, 10, &prefix, 48);
+  context = sicslowpan_addr_context_get(6);
+  prefix.u16[3] = 0;
+  UNIT_TEST_ASSERT(context != NULL && memcmp(context->prefix, &prefix, 8) == 0);
+  sicslowpan_addr_context_rm(6);
+
+  /* Contexts longer than 64 bits are not supported */
+  make_prefix(&prefix, 0xcccc);
+  input_ra(6, true, 10, &prefix, 96);
+  UNIT_TEST_ASSERT(sicslowpan_addr_context_get(6) == NULL);
+  UNIT_TEST_ASSERT(!sicslowpan_addr_context_set(6, &prefix, 65, true, 0));
+  UNIT_TEST_ASSERT(sicslowpan_addr_context_set(6, &prefix, 64, true, 0));
+  sicslowpan_addr_context_rm(6);
+
+  /* A context is not used after its lifetime, and another context with
+     the same prefix is used instead. Context 7 is compared first, both
+     in the table and in the hash bucket. */
+  make_prefix(&prefix, 7);
+  UNIT_TEST_ASSERT(sicslowpan_addr_context_set(9, &prefix, 64, true, 0));
+  UNIT_TEST_ASSERT(sicslowpan_addr_context_set(7, &prefix, 64, true, 1));
+  start = clock_seconds();
+  while(clock_seconds() < start + 2);
+  make_datagram(7, 1);
+  send_datagram();
+  context = sicslowpan_addr_context_get(9);
+  UNIT_TEST_ASSERT(context != NULL && context->compressed == 1);
+  UNIT_TEST_ASSERT(sicslowpan_addr_context_get(7) == NULL);
+  sicslowpan_addr_context_rm(9);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(benchmark, "Context lookup benchmark");
+UNIT_TEST(benchmark)
+{
+  uip_ipaddr_t prefix;
+  uint64_t start;
+
+  UNIT_TEST_BEGIN();
+
+  for(unsigned i = 0; i < TEST_CONTEXTS; i++) {
+    make_prefix(&prefix, i);
+    UNIT_TEST_ASSERT(sicslowpan_addr_context_set(i, &prefix, 64, true, 0));
+  }
+
+  /* Both addresses match the last context that is compared */
+  make_datagram(TEST_CONTEXTS - 1, TEST_CONTEXTS - 1);
+  start = nsec_now();
+  for(unsigned i = 0; i < TEST_DATAGRAMS; i++) {
+    send_datagram();
+  }
+  printf("%u contexts: %"PRIu64" ns per datagram\n", TEST_CONTEXTS,
+         (nsec_now() - start) / TEST_DATAGRAMS);
+  UNIT_TEST_ASSERT(sicslowpan_addr_context_get(TEST_CONTEXTS - 1)->compressed ==
+                   2 * TEST_DATAGRAMS);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_sicslowpan_context_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  srand(500);
+  netstack_sniffer_add(&sniffer);
+
+  UNIT_TEST_RUN(contexts);
+  UNIT_TEST_RUN(ra_6co);
+  UNIT_TEST_RUN(benchmark);
+
+  if(!UNIT_TEST_PASSED(contexts) ||
+     !UNIT_TEST_PASSED(ra_6co) ||
+     !UNIT_TEST_PASSED(benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
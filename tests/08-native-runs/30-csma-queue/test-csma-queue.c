@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2022, RISE Research Institutes of Sweden.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+/*
+ * \file
+ *      Unit tests for the CSMA packet queue: retransmissions are sent
+ *      from the queued frame, and queuebufs are reference counted.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+#define TEST_PAYLOAD       60
+#define TEST_TRANSMISSIONS 4
+/*****************************************************************************/
+PROCESS(test_csma_queue_process, "CSMA queue test process");
+AUTOSTART_PROCESSES(&test_csma_queue_process);
+
+static uint8_t first_frame[PACKETBUF_SIZE];
+static uint16_t first_frame_len;
+static unsigned transmissions;
+static unsigned changed_frames;
+static unsigned packetbuf_frames;
+static bool sent;
+static int sent_status;
+static int sent_transmissions;
+static const linkaddr_t dest = { { 0x02, 0x12, 0x74, 0x01, 0, 0x01, 0x01, 0x01 } };
+/*****************************************************************************/
+/* A radio that never receives: unicast frames are never acknowledged */
+static int
+radio_init(void)
+{
+  return 1;
+}
+/*****************************************************************************/
+static int
+radio_prepare(const void *payload, unsigned short payload_len)
+{
+  if(payload == packetbuf_hdrptr()) {
+    /* The frame was copied back to packetbuf for this attempt */
+    packetbuf_frames++;
+  }
+  if(transmissions == 0) {
+    memcpy(first_frame, payload, payload_len);
+    first_frame_len = payload_len;
+  } else if(payload_len != first_frame_len ||
+            memcmp(first_frame, payload, payload_len) != 0) {
+    changed_frames++;
+  }
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_transmit(unsigned short transmit_len)
+{
+  if(transmit_len != first_frame_len) {
+    changed_frames++;
+  }
+  transmissions++;
+  return RADIO_TX_OK;
+}
+/*****************************************************************************/
+static int
+radio_send(const void *payload, unsigned short payload_len)
+{
+  radio_prepare(payload, payload_len);
+  return radio_transmit(payload_len);
+}
+/*****************************************************************************/
+static int
+radio_read(void *buf, unsigned short buf_len)
+{
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_channel_clear(void)
+{
+  return 1;
+}
+/*****************************************************************************/
+static int
+radio_receiving_packet(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_pending_packet(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_on(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static int
+radio_off(void)
+{
+  return 0;
+}
+/*****************************************************************************/
+static radio_result_t
+radio_get_value(radio_param_t param, radio_value_t *value)
+{
+  if(param == RADIO_CONST_MAX_PAYLOAD_LEN) {
+    *value = 127;
+    return RADIO_RESULT_OK;
+  }
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*****************************************************************************/
+static radio_result_t
+radio_set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*****************************************************************************/
+static radio_result_t
+radio_get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*****************************************************************************/
+static radio_result_t
+radio_set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*****************************************************************************/
+const struct radio_driver test_radio_driver = {
+  radio_init,
+  radio_prepare,
+  radio_transmit,
+  radio_send,
+  radio_read,
+  radio_channel_clear,
+  radio_receiving_packet,
+  radio_pending_packet,
+  radio_on,
+  radio_off,
+  radio_get_value,
+  radio_set_value,
+  radio_get_object,
+  radio_set_object
+};
+/*****************************************************************************/
+static void
+packet_sent(void *ptr, int status, int num_tx)
+{
+  sent = true;
+  sent_status = status;
+  sent_transmissions = num_tx;
+}
+/*****************************************************************************/
+/* Queue a packet with CSMA, then overwrite packetbuf: the attempts
+   must not depend on it */
+static void
+send_packet(const linkaddr_t *receiver)
+{
+  uint8_t *payload;
+
+  transmissions = 0;
+  changed_frames = 0;
+  packetbuf_frames = 0;
+  sent = false;
+
+  packetbuf_clear();
+  payload = packetbuf_dataptr();
+  for(unsigned i = 0; i < TEST_PAYLOAD; i++) {
+    payload[i] = i;
+  }
+  packetbuf_set_datalen(TEST_PAYLOAD);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, receiver);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS, TEST_TRANSMISSIONS);
+  NETSTACK_MAC.send(packet_sent, NULL);
+
+  packetbuf_clear();
+  memset(packetbuf_dataptr(), 0xff, TEST_PAYLOAD);
+  packetbuf_set_datalen(TEST_PAYLOAD);
+}
+/*****************************************************************************/
+static bool
+payload_sent(void)
+{
+  const uint8_t *payload = first_frame + first_frame_len - TEST_PAYLOAD;
+
+  if(first_frame_len <= TEST_PAYLOAD) {
+    return false;
+  }
+  for(unsigned i = 0; i < TEST_PAYLOAD; i++) {
+    if(payload[i] != i) {
+      return false;
+    }
+  }
+  return true;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(unicast, "Unicast retransmissions");
+UNIT_TEST(unicast)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("Transmissions: %u\n", transmissions);
+  printf("Changed frames: %u\n", changed_frames);
+  printf("Frames sent from packetbuf: %u\n", packetbuf_frames);
+  printf("Status: %d, reported transmissions: %d\n",
+         sent_status, sent_transmissions);
+
+  UNIT_TEST_ASSERT(sent);
+  UNIT_TEST_ASSERT(sent_status == MAC_TX_NOACK);
+  UNIT_TEST_ASSERT(sent_transmissions == TEST_TRANSMISSIONS);
+  UNIT_TEST_ASSERT(transmissions == TEST_TRANSMISSIONS);
+  UNIT_TEST_ASSERT(changed_frames == 0);
+  UNIT_TEST_ASSERT(packetbuf_frames == 0);
+  UNIT_TEST_ASSERT(payload_sent());
+  UNIT_TEST_ASSERT(queuebuf_numfree() == QUEUEBUF_NUM);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(broadcast, "Broadcast");
+UNIT_TEST(broadcast)
+{
+  UNIT_TEST_BEGIN();
+
+  printf("Transmissions: %u\n", transmissions);
+
+  UNIT_TEST_ASSERT(sent);
+  UNIT_TEST_ASSERT(sent_status == MAC_TX_OK);
+  UNIT_TEST_ASSERT(transmissions == 1);
+  UNIT_TEST_ASSERT(packetbuf_frames == 0);
+  UNIT_TEST_ASSERT(payload_sent());
+  UNIT_TEST_ASSERT(queuebuf_numfree() == QUEUEBUF_NUM);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(refs, "Queuebuf references");
+UNIT_TEST(refs)
+{
+  struct queuebuf *b;
+  struct queuebuf *shared;
+
+  UNIT_TEST_BEGIN();
+
+  packetbuf_clear();
+  memset(packetbuf_dataptr(), 0x5a, TEST_PAYLOAD);
+  packetbuf_set_datalen(TEST_PAYLOAD);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &dest);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_SEQNO, 42);
+
+  b = queuebuf_new_from_packetbuf();
+  UNIT_TEST_ASSERT(b != NULL);
+  UNIT_TEST_ASSERT(queuebuf_numfree() == QUEUEBUF_NUM - 1);
+
+  shared = queuebuf_ref(b);
+  UNIT_TEST_ASSERT(shared == b);
+  UNIT_TEST_ASSERT(queuebuf_numfree() == QUEUEBUF_NUM - 1);
+
+  /* The first reference goes; the frame stays for the second one */
+  queuebuf_free(b);
+  UNIT_TEST_ASSERT(queuebuf_numfree() == QUEUEBUF_NUM - 1);
+  UNIT_TEST_ASSERT(queuebuf_datalen(shared) == TEST_PAYLOAD);
+  UNIT_TEST_ASSERT(((uint8_t *)queuebuf_dataptr(shared))[0] == 0x5a);
+
+  /* Only the attributes come back to packetbuf */
+  queuebuf_attr_to_packetbuf(shared);
+  UNIT_TEST_ASSERT(packetbuf_datalen() == 0);
+  UNIT_TEST_ASSERT(packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO) == 42);
+  UNIT_TEST_ASSERT(linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
+                                &dest));
+
+  queuebuf_free(shared);
+  UNIT_TEST_ASSERT(queuebuf_numfree() == QUEUEBUF_NUM);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_csma_queue_process, ev, data)
+{
+  static struct etimer et;
+  static unsigned waited;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  send_packet(&dest);
+  for(waited = 0; !sent && waited < 20; waited++) {
+    etimer_set(&et, CLOCK_SECOND / 10);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+  UNIT_TEST_RUN(unicast);
+
+  send_packet(&linkaddr_null);
+  for(waited = 0; !sent && waited < 20; waited++) {
+    etimer_set(&et, CLOCK_SECOND / 10);
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et));
+  }
+  UNIT_TEST_RUN(broadcast);
+
+  UNIT_TEST_RUN(refs);
+
+  if(!UNIT_TEST_PASSED(unicast) ||
+     !UNIT_TEST_PASSED(broadcast) ||
+     !UNIT_TEST_PASSED(refs)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
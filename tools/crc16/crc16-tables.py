@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022, RISE Research Institutes of Sweden.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+# 3. Neither the name of the Institute nor the names of its contributors
+#    may be used to endorse or promote products derived from this software
+#    without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+# OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+# HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+# OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+# SUCH DAMAGE.
+
+"""Generates os/lib/crc16-tables.h, the lookup tables of crc16.c.
+
+Usage: crc16-tables.py > os/lib/crc16-tables.h
+"""
+
+import sys
+
+ROWS = 8
+
+
+def reflected_step(crc, bits):
+    for _ in range(bits):
+        crc = (crc >> 1) ^ (0x8408 if crc & 1 else 0)
+    return crc
+
+
+def msb_first_step(crc, bits):
+    for _ in range(bits):
+        crc = ((crc << 1) ^ (0x1021 if crc & 0x8000 else 0)) & 0xffff
+    return crc
+
+
+def reflected_tables():
+    rows = [[reflected_step(i, 8) for i in range(256)]]
+    for _ in range(1, ROWS):
+        prev = rows[-1]
+        rows.append([(t >> 8) ^ rows[0][t & 0xff] for t in prev])
+    nibbles = [reflected_step(i, 4) for i in range(16)]
+    return rows, nibbles
+
+
+def msb_first_tables():
+    rows = [[msb_first_step(i << 8, 8) for i in range(256)]]
+    for _ in range(1, ROWS):
+        prev = rows[-1]
+        rows.append([((t << 8) & 0xffff) ^ rows[0][t >> 8] for t in prev])
+    nibbles = [msb_first_step(i << 12, 4) for i in range(16)]
+    return rows, nibbles
+
+
+def print_values(values, indent):
+    for i in range(0, len(values), 8):
+        line = ', '.join('0x%04x' % v for v in values[i:i + 8])
+        print(indent + line + (',' if i + 8 < len(values) else ''))
+
+
+def print_variant(comment, name, tables):
+    rows, nibbles = tables
+    print('/* %s */' % comment)
+    print('#if CRC16_TABLE == CRC16_TABLE_SMALL')
+    print('static const uint16_t %s[16] = {' % name)
+    print_values(nibbles, '  ')
+    print('};')
+    print('#elif CRC16_TABLE != CRC16_TABLE_NONE')
+    print('static const uint16_t %s[CRC16_TABLE][256] = {' % name)
+    for r, row in enumerate(rows):
+        if r in (1, 4):
+            print('#if CRC16_TABLE > %u' % r)
+        print('  {')
+        print_values(row, '    ')
+        print('  },' if r + 1 < ROWS else '  }')
+        if r in (3, 7):
+            print('#endif')
+    print('};')
+    print('#endif')
+
+
+def main():
+    with open(sys.argv[0]) as f:
+        license = ''.join(f.readlines()[2:28]).replace('#', ' *')
+    print('/*')
+    print(license.rstrip())
+    print(' */')
+    print()
+    print('/* Generated by tools/crc16/crc16-tables.py. Do not edit. */')
+    print()
+    print('#ifndef CRC16_TABLES_H_')
+    print('#define CRC16_TABLES_H_')
+    print()
+    print_variant('IEEE 802.15.4: least significant bit first',
+                  'crc16_table', reflected_tables())
+    print()
+    print_variant('CCITT: most significant bit first',
+                  'crc16_ccitt_table', msb_first_tables())
+    print()
+    print('#endif /* CRC16_TABLES_H_ */')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,334 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022, RISE Research Institutes of Sweden.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+# 3. Neither the name of the Institute nor the names of its contributors
+#    may be used to endorse or promote products derived from this software
+#    without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+# OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+# HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+# OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+# SUCH DAMAGE.
+
+"""
+Decode the output of the binary log (LOG_CONF_BINARY, see
+os/sys/log-binary.h) into text, using the format strings stored in
+the log_fmt section of the firmware ELF file.
+
+Examples:
+  log-decode.py build/native/hello-world.native log.bin
+  log-decode.py build/zoul/remote-revb/node.zoul /dev/ttyUSB0
+"""
+
+import argparse
+import ipaddress
+import re
+import struct
+import sys
+
+SLIP_END = 0o300
+SLIP_ESC = 0o333
+SLIP_ESC_END = 0o334
+SLIP_ESC_ESC = 0o335
+
+TYPE_MESSAGE = 0
+TYPE_6ADDR = 1
+TYPE_6ADDR_COMPACT = 2
+TYPE_LLADDR = 3
+TYPE_LLADDR_COMPACT = 4
+TYPE_BYTES = 5
+TYPE_START = 6
+
+HEADER_LEN = 8
+
+LEVELS = ["PRI", "ERR", "WARN", "INFO", "DBG"]
+
+CONVERSION = re.compile(
+    r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d*))?(hh|h|ll|l|L|z|j|t)?"
+    r"([diuxXocspeEfFgGn%])")
+
+
+def crc16(data):
+    """The CRC of os/lib/crc16.c."""
+    acc = 0
+    for b in data:
+        acc ^= b
+        acc = ((acc >> 8) | (acc << 8)) & 0xffff
+        acc ^= (acc & 0xff00) << 4
+        acc &= 0xffff
+        acc ^= (acc >> 8) >> 4
+        acc ^= (acc & 0xff00) >> 5
+    return acc
+
+
+class Firmware:
+    """The parts of a firmware ELF file needed to decode records."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            elf = f.read()
+        if elf[:4] != b"\x7fELF":
+            raise ValueError("%s is not an ELF file" % path)
+        is64 = elf[4] == 2
+        self.endian = "<" if elf[5] == 1 else ">"
+        # Width of long, size_t and pointers on the node
+        self.long_size = 8 if is64 else 4
+        if is64:
+            shoff, = struct.unpack_from(self.endian + "Q", elf, 0x28)
+            shentsize, shnum, shstrndx = struct.unpack_from(
+                self.endian + "HHH", elf, 0x3a)
+        else:
+            shoff, = struct.unpack_from(self.endian + "I", elf, 0x20)
+            shentsize, shnum, shstrndx = struct.unpack_from(
+                self.endian + "HHH", elf, 0x2e)
+
+        sections = []
+        for i in range(shnum):
+            base = shoff + i * shentsize
+            if is64:
+                name, _, _, _, offset, size = struct.unpack_from(
+                    self.endian + "IIQQQQ", elf, base)
+            else:
+                name, _, _, _, offset, size = struct.unpack_from(
+                    self.endian + "IIIIII", elf, base)
+            sections.append((name, offset, size))
+
+        strtab = sections[shstrndx]
+        self.log_fmt = None
+        for name, offset, size in sections:
+            start = strtab[1] + name
+            if elf[start:elf.index(b"\0", start)] == b"log_fmt":
+                self.log_fmt = elf[offset:offset + size]
+        if self.log_fmt is None:
+            raise ValueError("%s has no log_fmt section; was it built with "
+                             "LOG_CONF_BINARY=1?" % path)
+
+    def descriptor(self, msg_id):
+        """Return the module name and format string of a message."""
+        if msg_id >= len(self.log_fmt):
+            return None, None
+        end = self.log_fmt.index(b"\0", msg_id)
+        module = self.log_fmt[msg_id:end].decode("latin-1")
+        fmt_end = self.log_fmt.index(b"\0", end + 1)
+        fmt = self.log_fmt[end + 1:fmt_end].decode("latin-1")
+        return module, fmt
+
+
+class Decoder:
+    def __init__(self, firmware, show_time, show_prefix):
+        self.fw = firmware
+        self.show_time = show_time
+        self.show_prefix = show_prefix
+        self.second = None
+
+    def unpack(self, fmt, data, pos):
+        size = struct.calcsize(fmt)
+        if pos + size > len(data):
+            return None, len(data)
+        value, = struct.unpack_from(self.fw.endian + fmt, data, pos)
+        return value, pos + size
+
+    def integer(self, length, signed, data, pos):
+        if length == "ll" or (length in ("l", "z", "j", "t")
+                              and self.fw.long_size == 8):
+            fmt = "q" if signed else "Q"
+        else:
+            fmt = "i" if signed else "I"
+        value, pos = self.unpack(fmt, data, pos)
+        if value is not None and length in ("h", "hh"):
+            bits = 16 if length == "h" else 8
+            value &= (1 << bits) - 1
+            if signed and value >= 1 << (bits - 1):
+                value -= 1 << bits
+        return value, pos
+
+    def format(self, fmt, data):
+        pos = 0
+        out = []
+        last = 0
+        for m in CONVERSION.finditer(fmt):
+            out.append(fmt[last:m.start()])
+            last = m.end()
+            flags, width, precision, length, conv = m.groups()
+            if conv == "%":
+                out.append("%")
+                continue
+            if width == "*":
+                width, pos = self.unpack("i", data, pos)
+                width = "?" if width is None else str(width)
+            if precision == "*":
+                precision, pos = self.unpack("i", data, pos)
+                precision = "?" if precision is None else str(precision)
+            spec = "%" + flags + (width or "")
+            if precision is not None:
+                spec += "." + precision
+            if "?" in spec:
+                out.append("?")
+                continue
+
+            if conv in "di":
+                value, pos = self.integer(length, True, data, pos)
+                spec += "d"
+            elif conv in "uxXoc":
+                value, pos = self.integer(length, False, data, pos)
+                spec += "d" if conv == "u" else conv
+            elif conv == "p":
+                value, pos = self.unpack(
+                    "Q" if self.fw.long_size == 8 else "I", data, pos)
+                spec += "#x"
+            elif conv in "eEfFgG":
+                value, pos = self.unpack("d", data, pos)
+                spec += conv
+            elif conv == "s":
+                if pos < len(data):
+                    end = pos + 1 + data[pos]
+                    value = data[pos + 1:end].decode("latin-1")
+                    pos = end
+                else:
+                    value = None
+                spec += "s"
+            else:
+                continue
+            out.append("?" if value is None else spec % value)
+        out.append(fmt[last:])
+        return "".join(out)
+
+    def prefix(self, timestamp, level, module):
+        text = ""
+        if self.show_time:
+            if self.second:
+                text += "%12.6f " % (timestamp / self.second)
+            else:
+                text += "%10u " % timestamp
+        if self.show_prefix:
+            text += "[%-4s: %-10s] " % (LEVELS[level] if level < len(LEVELS)
+                                        else "?", module)
+        return text
+
+    def record(self, rec):
+        length, flags, msg_id, timestamp = struct.unpack_from(
+            self.fw.endian + "BBHI", rec, 0)
+        data = rec[HEADER_LEN:]
+        rtype = flags >> 4
+        level = flags & 0x07
+        newline = flags & 0x08
+
+        if rtype == TYPE_START:
+            self.second, _ = self.unpack("I", data, 0)
+            return ""
+        if rtype == TYPE_MESSAGE:
+            module, fmt = self.fw.descriptor(msg_id)
+            if fmt is None:
+                return "<unknown message %u>\n" % msg_id
+            text = self.format(fmt, data)
+            if newline:
+                text = self.prefix(timestamp, level, module) + text
+            return text
+        if rtype == TYPE_6ADDR:
+            if len(data) == 0:
+                return "(NULL IP addr)"
+            return str(ipaddress.IPv6Address(bytes(data[:16])))
+        if rtype == TYPE_6ADDR_COMPACT:
+            if len(data) == 0:
+                return "6A-NULL"
+            addr = ipaddress.IPv6Address(bytes(data[:16]))
+            kind = "6M" if addr.is_multicast else \
+                "6L" if addr.is_link_local else "6G"
+            return "%s-%04x" % (kind, struct.unpack(">H", data[14:16])[0])
+        if rtype == TYPE_LLADDR:
+            if len(data) == 0:
+                return "(NULL LL addr)"
+            return ".".join(data[i:i + 2].hex()
+                            for i in range(0, len(data), 2))
+        if rtype == TYPE_LLADDR_COMPACT:
+            if len(data) == 0 or not any(data):
+                return "LL-NULL"
+            return "LL-%s" % data[-2:].hex()
+        if rtype == TYPE_BYTES:
+            return data.hex()
+        return "<unknown record type %u>" % rtype
+
+
+def frames(stream):
+    """Yield (is_record, bytes) for each SLIP frame or stretch of text."""
+    buf = bytearray()
+    esc = False
+    while True:
+        chunk = stream.read1(4096) if hasattr(stream, "read1") \
+            else stream.read(4096)
+        if not chunk:
+            break
+        for c in chunk:
+            if c == SLIP_END:
+                if buf:
+                    if len(buf) >= HEADER_LEN + 2 and buf[0] == len(buf) - 2 \
+                       and crc16(buf[:-2]) == buf[-2] | (buf[-1] << 8):
+                        yield True, bytes(buf[:-2])
+                    else:
+                        yield False, bytes(buf)
+                    buf = bytearray()
+                esc = False
+            elif esc:
+                buf.append(SLIP_END if c == SLIP_ESC_END else
+                           SLIP_ESC if c == SLIP_ESC_ESC else c)
+                esc = False
+            elif c == SLIP_ESC:
+                esc = True
+            else:
+                buf.append(c)
+    if buf:
+        yield False, bytes(buf)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Decode Contiki-NG binary logs.")
+    parser.add_argument("elf", help="firmware ELF file")
+    parser.add_argument("input", nargs="?", default="-",
+                        help="binary log file or serial device "
+                        "(default: stdin)")
+    parser.add_argument("--no-time", action="store_true",
+                        help="do not print timestamps")
+    parser.add_argument("--no-prefix", action="store_true",
+                        help="do not print the level and module")
+    args = parser.parse_args()
+
+    try:
+        fw = Firmware(args.elf)
+    except (OSError, ValueError) as e:
+        sys.exit(str(e))
+    decoder = Decoder(fw, not args.no_time, not args.no_prefix)
+
+    stream = sys.stdin.buffer if args.input == "-" \
+        else open(args.input, "rb", buffering=0)
+    try:
+        for is_record, data in frames(stream):
+            if is_record:
+                sys.stdout.write(decoder.record(data))
+            else:
+                # Regular text output, interleaved with the frames
+                sys.stdout.write(data.decode("latin-1"))
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
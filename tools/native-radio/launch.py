@@ -0,0 +1,227 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022, RISE Research Institutes of Sweden.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+# 1. Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+# 2. Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+# 3. Neither the name of the Institute nor the names of its contributors
+#    may be used to endorse or promote products derived from this software
+#    without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+# ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+# OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+# HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+# LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+# OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+# SUCH DAMAGE.
+
+"""
+Start a network of native nodes that communicate over the virtual radio
+medium (NETSTACK_CONF_RADIO virtual_radio_driver, see
+arch/platform/native/dev/virtual-radio.h).
+
+The nodes are placed on a line, a grid or at random, and a link is
+created between every pair of nodes within radio range. The RSSI of a
+link follows a log-distance path loss model, and its packet reception
+ratio falls linearly from 1 close to the sender to 1 - loss at the edge
+of the range. A topology file can be given instead.
+
+The output of each node is written to node-<id>.log in the log
+directory.
+
+Examples:
+  launch.py -n 100 --topology grid --duration 600 build/native/node.native
+  launch.py --topology-file links.txt --log-dir logs build/native/node.native
+  launch.py -n 50 --firmware-for 1=build/native/udp-server.native \
+    build/native/udp-client.native
+"""
+
+import argparse
+import math
+import os
+import random
+import signal
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def positions(args):
+    """Return the (x, y) position of each node."""
+    n = args.nodes
+    s = args.spacing
+    if args.topology == "line":
+        return [(i * s, 0.0) for i in range(n)]
+    if args.topology == "grid":
+        width = math.ceil(math.sqrt(n))
+        return [((i % width) * s, (i // width) * s) for i in range(n)]
+    side = math.sqrt(n) * s
+    return [(random.uniform(0, side), random.uniform(0, side))
+            for _ in range(n)]
+
+
+def links(args):
+    """Yield (src, dst, prr, rssi, delay) for every link in range."""
+    pos = positions(args)
+    for i, (xi, yi) in enumerate(pos):
+        for j, (xj, yj) in enumerate(pos):
+            if i == j:
+                continue
+            d = math.hypot(xi - xj, yi - yj)
+            if d > args.range:
+                continue
+            rssi = args.rssi_1m - 10 * args.path_loss_exponent * \
+                math.log10(max(d, 1.0))
+            prr = 1.0 - args.loss * d / args.range
+            yield (args.first_id + i, args.first_id + j, prr,
+                   round(rssi), args.delay)
+
+
+def write_topology(args, path):
+    """Write the topology file, and return the IDs of all nodes."""
+    if args.topology_file:
+        ids = set()
+        with open(args.topology_file) as f, open(path, "w") as out:
+            for line in f:
+                out.write(line)
+                fields = line.split()
+                if len(fields) == 5 and not line.startswith("#"):
+                    ids.update((int(fields[0]), int(fields[1])))
+        return sorted(ids)
+
+    count = 0
+    with open(path, "w") as out:
+        out.write("# src dst prr rssi delay\n")
+        for link in links(args):
+            out.write("%u %u %.3f %d %u\n" % link)
+            count += 1
+    print("%u nodes, %u links" % (args.nodes, count))
+    return list(range(args.first_id, args.first_id + args.nodes))
+
+
+def stop(nodes):
+    for p in nodes.values():
+        if p.poll() is None:
+            p.send_signal(signal.SIGTERM)
+    deadline = time.monotonic() + 2
+    for p in nodes.values():
+        try:
+            p.wait(max(0.0, deadline - time.monotonic()))
+        except subprocess.TimeoutExpired:
+            p.kill()
+            p.wait()
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("firmware", help="native node executable")
+    parser.add_argument("args", nargs="*",
+                        help="arguments passed on to every node")
+    parser.add_argument("-n", "--nodes", type=int, default=10,
+                        help="number of nodes (default: %(default)s)")
+    parser.add_argument("--topology", choices=["line", "grid", "random"],
+                        default="grid",
+                        help="node placement (default: %(default)s)")
+    parser.add_argument("--topology-file",
+                        help="use the links of this file instead")
+    parser.add_argument("--spacing", type=float, default=10.0,
+                        help="distance between nodes in m "
+                        "(default: %(default)s)")
+    parser.add_argument("--range", type=float, default=15.0,
+                        help="radio range in m (default: %(default)s)")
+    parser.add_argument("--loss", type=float, default=0.0,
+                        help="loss ratio at the edge of the range "
+                        "(default: %(default)s)")
+    parser.add_argument("--rssi-1m", type=float, default=-40.0,
+                        help="RSSI at 1 m in dBm (default: %(default)s)")
+    parser.add_argument("--path-loss-exponent", type=float, default=3.0,
+                        help="(default: %(default)s)")
+    parser.add_argument("--delay", type=int, default=0,
+                        help="link delay in us (default: %(default)s)")
+    parser.add_argument("--first-id", type=int, default=1,
+                        help="ID of the first node (default: %(default)s)")
+    parser.add_argument("--seed", type=int,
+                        help="seed for the random placement")
+    parser.add_argument("--dir",
+                        help="medium directory (default: a new "
+                        "temporary directory)")
+    parser.add_argument("--log-dir",
+                        help="directory of the node logs (default: the "
+                        "medium directory)")
+    parser.add_argument("--duration", type=float,
+                        help="stop the nodes after this many seconds "
+                        "(default: run until interrupted)")
+    parser.add_argument("--firmware-for", action="append", default=[],
+                        metavar="ID=FILE",
+                        help="run another executable on the given node, "
+                        "for example a border router")
+    parser.add_argument("--env", action="append", default=[],
+                        metavar="NAME=VALUE",
+                        help="set an environment variable for every node")
+    args = parser.parse_args()
+
+    random.seed(args.seed)
+    medium = args.dir or tempfile.mkdtemp(prefix="contiki-ng-radio-")
+    os.makedirs(medium, exist_ok=True)
+    log_dir = args.log_dir or medium
+    os.makedirs(log_dir, exist_ok=True)
+    topology = os.path.join(medium, "topology")
+    ids = write_topology(args, topology)
+    print("Medium directory: %s" % medium)
+
+    env = dict(os.environ)
+    env["CONTIKI_RADIO_DIR"] = medium
+    env["CONTIKI_RADIO_TOPOLOGY"] = topology
+    for var in args.env:
+        name, _, value = var.partition("=")
+        env[name] = value
+
+    firmware = {}
+    for var in args.firmware_for:
+        node_id, _, path = var.partition("=")
+        firmware[int(node_id)] = os.path.abspath(path)
+    nodes = {}
+    try:
+        for node_id in ids:
+            env["CONTIKI_NODE_ID"] = str(node_id)
+            with open(os.path.join(log_dir, "node-%u.log" % node_id),
+                      "w") as log:
+                nodes[node_id] = subprocess.Popen(
+                    [firmware.get(node_id, os.path.abspath(args.firmware))] +
+                    args.args, env=env, cwd=log_dir,
+                    stdin=subprocess.DEVNULL, stdout=log,
+                    stderr=subprocess.STDOUT)
+        print("Started %u nodes" % len(nodes))
+
+        start = time.monotonic()
+        while args.duration is None or \
+                time.monotonic() - start < args.duration:
+            time.sleep(0.2)
+            failed = [i for i, p in nodes.items() if p.poll() is not None]
+            if failed:
+                print("Nodes %s exited" % failed, file=sys.stderr)
+                return 1
+    except KeyboardInterrupt:
+        pass
+    finally:
+        stop(nodes)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())